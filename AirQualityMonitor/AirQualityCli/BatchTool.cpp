@@ -0,0 +1,354 @@
+﻿/**
+ * @file BatchTool.cpp
+ * @brief Implementacja poleceń wsadowych.
+ */
+
+#include "BatchTool.h"
+#include "GapAnalysis.h"
+#include "MeasurementStatistics.h"
+#include "Parallel.h"
+#include <QDateTime>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <QSet>
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+    const char* kDateFormat = "yyyy-MM-dd HH:mm:ss";    ///< Format dat w plikach i eksporcie
+
+    /**
+     * @brief Koniec zakresu (0 oznacza brak ograniczenia).
+     */
+    qint64 rangeEnd(const BatchOptions& options)
+    {
+        return options.toMs > 0 ? options.toMs : std::numeric_limits<qint64>::max();
+    }
+}
+
+BatchTool::BatchTool(DataRepository& repository, QTextStream& out, QTextStream& err)
+    : repository(repository),
+    out(out),
+    err(err)
+{
+}
+
+void BatchTool::reportTiming(const QString& phase, const QElapsedTimer& timer, int items)
+{
+    const qint64 ms = timer.elapsed();
+    const double perSecond = ms > 0 ? items * 1000.0 / ms : 0.0;
+    err << QString("%1: %2 elementów w %3 ms (%4/s)")
+        .arg(phase).arg(items).arg(ms).arg(perSecond, 0, 'f', 1) << Qt::endl;
+}
+
+Async::Task<std::shared_ptr<BatchTool::FetchBatch>> BatchTool::fetchAll(QVector<int> ids, int jobs, Fetch fetch)
+{
+    auto batch = std::make_shared<FetchBatch>();
+    batch->ids = ids;
+    if (ids.isEmpty())
+        co_return batch;
+
+    // Najwyżej jobs żądań w toku - każdy pobierający bierze kolejny identyfikator po zakończeniu poprzedniego
+    QVector<Async::Task<void>> workers;
+    const int inFlight = qBound(1, jobs, int(ids.size()));
+    for (int i = 0; i < inFlight; ++i)
+        workers.append(fetchWorker(batch, fetch));
+    co_await Async::whenAll(workers);
+    co_return batch;
+}
+
+Async::Task<void> BatchTool::fetchWorker(std::shared_ptr<FetchBatch> batch, Fetch fetch)
+{
+    while (batch->next < batch->ids.size()) {
+        const int id = batch->ids[batch->next++];
+        const ApiResult result = co_await fetch(id);
+        if (result.ok()) {
+            batch->results.insert(id, result.data);
+        }
+        else {
+            ++batch->errors;
+            err << QString("Błąd pobierania %1: %2").arg(id).arg(result.error) << Qt::endl;
+        }
+    }
+}
+
+QHash<int, SensorRecord> BatchTool::sensorsById() const
+{
+    QHash<int, SensorRecord> sensors;
+    for (const QJsonValue& value : repository.loadSensors()) {
+        const SensorRecord sensor = SensorRecord::fromJson(value.toObject());
+        sensors.insert(sensor.id, sensor);
+    }
+    return sensors;
+}
+
+bool BatchTool::matches(const SensorRecord& sensor, const BatchOptions& options)
+{
+    if (!options.sensorIds.isEmpty() && !options.sensorIds.contains(sensor.id))
+        return false;
+    if (!options.stationIds.isEmpty() && !options.stationIds.contains(sensor.stationId))
+        return false;
+    if (!options.paramCodes.isEmpty() && !options.paramCodes.contains(sensor.paramCode, Qt::CaseInsensitive))
+        return false;
+    return true;
+}
+
+Async::Task<int> BatchTool::syncStations(BatchOptions options)
+{
+    if (repository.hasStations() && !options.refresh) {
+        err << QString("Stacje zapisane lokalnie: %1").arg(repository.loadStations().size()) << Qt::endl;
+        co_return 0;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    const ApiResult stations = co_await client.stations();
+    if (!stations.ok()) {
+        err << "Błąd pobierania stacji: " << stations.error << Qt::endl;
+        co_return 1;
+    }
+    if (!repository.saveStations(stations.data)) {
+        err << "Nie udało się zapisać stacji: " << repository.errorString() << Qt::endl;
+        co_return 1;
+    }
+
+    reportTiming("Stacje", timer, stations.data.size());
+    co_return 0;
+}
+
+Async::Task<int> BatchTool::syncSensors(BatchOptions options)
+{
+    QJsonArray allSensors = repository.loadSensors();
+
+    // Stacje, których sensory są już zapisane, pomijane są bez --refresh
+    QSet<int> known;
+    if (!options.refresh) {
+        for (const QJsonValue& value : allSensors)
+            known.insert(value.toObject().value("stationId").toInt());
+    }
+
+    QVector<int> ids;
+    for (const StationRecord& station : StationRecord::fromJson(repository.loadStations())) {
+        if (!options.stationIds.isEmpty() && !options.stationIds.contains(station.id))
+            continue;
+        if (!known.contains(station.id))
+            ids.append(station.id);
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    const auto batch = co_await fetchAll(ids, options.jobs, [this](int id) {
+        return client.sensors(id);
+        });
+    const QHash<int, QJsonArray>& fetched = batch->results;
+    const int errors = batch->errors;
+    reportTiming("Sensory (pobieranie)", timer, ids.size());
+
+    if (fetched.isEmpty())
+        co_return errors > 0 ? 1 : 0;
+
+    // Stare sensory pobranych stacji zastępowane są nowymi, zapis raz dla całej partii
+    for (int i = allSensors.size() - 1; i >= 0; --i) {
+        if (fetched.contains(allSensors.at(i).toObject().value("stationId").toInt()))
+            allSensors.removeAt(i);
+    }
+    int count = 0;
+    for (const QJsonArray& stationSensors : fetched) {
+        for (const QJsonValue& value : stationSensors)
+            allSensors.append(value);
+        count += stationSensors.size();
+    }
+
+    timer.restart();
+    if (!repository.saveSensors(allSensors)) {
+        err << "Nie udało się zapisać sensorów: " << repository.errorString() << Qt::endl;
+        co_return 1;
+    }
+    reportTiming("Sensory (zapis)", timer, count);
+    co_return errors > 0 ? 1 : 0;
+}
+
+Async::Task<int> BatchTool::syncMeasurements(BatchOptions options)
+{
+    QVector<int> ids;
+    for (const SensorRecord& sensor : sensorsById()) {
+        if (matches(sensor, options))
+            ids.append(sensor.id);
+    }
+    std::sort(ids.begin(), ids.end());
+
+    QElapsedTimer timer;
+    timer.start();
+    const int timeoutMs = options.timeoutMs;
+    const auto batch = co_await fetchAll(ids, options.jobs, [this, timeoutMs](int id) {
+        return client.measurements(id, timeoutMs);
+        });
+    const QHash<int, QJsonArray>& fetched = batch->results;
+    const int errors = batch->errors;
+    reportTiming("Pomiary (pobieranie)", timer, ids.size());
+
+    if (fetched.isEmpty())
+        co_return errors > 0 ? 1 : 0;
+
+    timer.restart();
+    int changed = 0;
+    if (!repository.mergeMeasurements(fetched, &changed)) {
+        err << "Nie udało się zapisać pomiarów: " << repository.errorString() << Qt::endl;
+        co_return 1;
+    }
+    reportTiming("Pomiary (scalanie i zapis)", timer, fetched.size());
+    err << QString("Nowe lub zmienione pomiary: %1").arg(changed) << Qt::endl;
+    co_return errors > 0 ? 1 : 0;
+}
+
+QVector<QPair<SensorRecord, QJsonArray>> BatchTool::selectMeasurements(const BatchOptions& options)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    const QHash<int, SensorRecord> sensors = sensorsById();
+    QVector<QPair<SensorRecord, QJsonArray>> selected;
+    for (const QJsonValue& value : repository.loadMeasurements()) {
+        const QJsonObject obj = value.toObject();
+        const int id = obj.value("id").toInt();
+
+        // Sensor spoza sensors.json ma tylko ID
+        SensorRecord sensor = sensors.value(id);
+        sensor.id = id;
+        if (matches(sensor, options))
+            selected.append(qMakePair(sensor, obj.value("values").toArray()));
+    }
+
+    reportTiming("Odczyt pomiarów", timer, selected.size());
+    return selected;
+}
+
+int BatchTool::exportRange(const BatchOptions& options)
+{
+    const auto selected = selectMeasurements(options);
+    const qint64 fromMs = options.fromMs;
+    const qint64 toMs = rangeEnd(options);
+    const bool json = options.format.compare("json", Qt::CaseInsensitive) == 0;
+
+    QElapsedTimer timer;
+    timer.start();
+    TaskPriorityScope batch(TaskPriority::Batch);
+
+    // Fragmenty wyniku przygotowywane są równolegle, a zapisywane w kolejności sensorów
+    using Chunk = QPair<QByteArray, int>;
+    const auto chunks = Parallel::map(selected,
+        [fromMs, toMs, json](const QPair<SensorRecord, QJsonArray>& entry) {
+            const SensorRecord& sensor = entry.first;
+            const MeasurementSeries series = GapAnalysis::fromJson(entry.second);
+
+            QByteArray text;
+            QJsonArray values;
+            int rows = 0;
+            for (int i = 0; i < series.size(); ++i) {
+                const qint64 ms = series.timeAt(i);
+                if (ms < fromMs || ms > toMs || series.origin[i] != PointOrigin::Measured)
+                    continue;
+
+                const QString date = QDateTime::fromMSecsSinceEpoch(ms).toString(kDateFormat);
+                if (json) {
+                    QJsonObject point;
+                    point["date"] = date;
+                    point["value"] = series.values[i];
+                    values.append(point);
+                }
+                else {
+                    text += QString("%1;%2;%3;%4;%5\n")
+                        .arg(sensor.id).arg(sensor.stationId).arg(sensor.paramCode, date)
+                        .arg(series.values[i], 0, 'f', 2).toUtf8();
+                }
+                ++rows;
+            }
+
+            if (json) {
+                QJsonObject obj;
+                obj["id"] = sensor.id;
+                obj["stationId"] = sensor.stationId;
+                obj["paramCode"] = sensor.paramCode;
+                obj["values"] = values;
+                text = QJsonDocument(obj).toJson(QJsonDocument::Compact);
+            }
+            return qMakePair(text, rows);
+        });
+
+    QFile file(options.output);
+    if (!options.output.isEmpty() && !file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        err << "Nie można otworzyć pliku " << options.output << ": " << file.errorString() << Qt::endl;
+        return 1;
+    }
+    QTextStream fileStream(&file);
+    QTextStream& target = options.output.isEmpty() ? out : fileStream;
+
+    int rows = 0;
+    if (json) {
+        target << "[";
+        for (int i = 0; i < chunks.size(); ++i)
+            target << (i > 0 ? ",\n" : "\n") << chunks[i].first;
+        target << "\n]\n";
+    }
+    else {
+        target << "sensorId;stationId;paramCode;date;value\n";
+        for (const Chunk& chunk : chunks)
+            target << chunk.first;
+    }
+    for (const Chunk& chunk : chunks)
+        rows += chunk.second;
+    target.flush();
+
+    reportTiming("Eksport", timer, rows);
+    return 0;
+}
+
+int BatchTool::statistics(const BatchOptions& options)
+{
+    const auto selected = selectMeasurements(options);
+    const qint64 fromMs = options.fromMs;
+    const qint64 toMs = rangeEnd(options);
+
+    QElapsedTimer timer;
+    timer.start();
+    TaskPriorityScope batch(TaskPriority::Batch);
+
+    // Statystyki sensorów liczone są równolegle
+    const auto summaries = Parallel::map(selected,
+        [fromMs, toMs](const QPair<SensorRecord, QJsonArray>& entry) {
+            return MeasurementStatistics::summarize(GapAnalysis::fromJson(entry.second), fromMs, toMs);
+        });
+
+    out << "sensorId;stationId;paramCode;count;min;max;mean;trend\n";
+    QMap<QString, RollupBucket> byParam;
+    int points = 0;
+    for (int i = 0; i < selected.size(); ++i) {
+        const SensorRecord& sensor = selected[i].first;
+        const RollupBucket& total = summaries[i].total;
+        if (total.count == 0)
+            continue;
+
+        out << QString("%1;%2;%3;%4;%5;%6;%7;%8\n")
+            .arg(sensor.id).arg(sensor.stationId).arg(sensor.paramCode).arg(total.count)
+            .arg(total.min, 0, 'f', 2).arg(total.max, 0, 'f', 2).arg(total.mean(), 0, 'f', 2)
+            .arg(MeasurementStatistics::trendName(summaries[i].trend()));
+        byParam[sensor.paramCode].merge(total);
+        points += total.count;
+    }
+
+    // Podsumowanie parametrów ze wszystkich wybranych sensorów
+    out << "\nparamCode;count;min;max;mean\n";
+    for (auto it = byParam.constBegin(); it != byParam.constEnd(); ++it) {
+        out << QString("%1;%2;%3;%4;%5\n")
+            .arg(it.key()).arg(it.value().count)
+            .arg(it.value().min, 0, 'f', 2).arg(it.value().max, 0, 'f', 2).arg(it.value().mean(), 0, 'f', 2);
+    }
+    out.flush();
+
+    reportTiming("Statystyki", timer, points);
+    return 0;
+}
@@ -0,0 +1,143 @@
+﻿/**
+ * @file BatchTool.h
+ * @brief Polecenia wsadowe narzędzia wiersza poleceń.
+ *
+ * Narzędzie działa bez interfejsu graficznego na tych samych plikach
+ * stations.json, sensors.json i measurements.json co aplikacja okienkowa.
+ * Synchronizacja pobiera dane z API z ograniczoną liczbą równoległych
+ * żądań, a eksport i statystyki liczone są równolegle dla wielu sensorów.
+ * Czas każdej fazy wypisywany jest na standardowe wyjście błędów, więc
+ * narzędzie służy także do pomiaru przepustowości.
+ *
+ * Polecenia synchronizacji są korutynami - wynik odbiera się przez co_await
+ * albo Async::Task::then() w działającej pętli zdarzeń.
+ *
+ * @author Jakub Frąckowiak
+ * @date Maj 2025
+ */
+
+#pragma once
+
+#include "DataRepository.h"
+#include "GiosClient.h"
+#include "Records.h"
+#include "Task.h"
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonArray>
+#include <QStringList>
+#include <QTextStream>
+#include <QVector>
+#include <memory>
+
+/**
+ * @brief Opcje poleceń wsadowych.
+ */
+struct BatchOptions
+{
+    int jobs = 6;                   ///< Liczba równoległych żądań do API
+    int timeoutMs = 10000;          ///< Limit czasu pojedynczego żądania pomiarów
+    bool refresh = false;           ///< Pobierz ponownie dane już zapisane lokalnie
+    QVector<int> stationIds;        ///< Wybrane stacje (puste - wszystkie)
+    QVector<int> sensorIds;         ///< Wybrane sensory (puste - wszystkie)
+    QStringList paramCodes;         ///< Wybrane parametry (puste - wszystkie)
+    qint64 fromMs = 0;              ///< Początek zakresu (ms od epoki)
+    qint64 toMs = 0;                ///< Koniec zakresu (0 - bez ograniczenia)
+    QString output;                 ///< Plik wynikowy eksportu (pusty - standardowe wyjście)
+    QString format = "csv";         ///< Format eksportu: csv lub json
+};
+
+/**
+ * @class BatchTool
+ * @brief Synchronizacja, eksport i statystyki dla wielu sensorów.
+ *
+ * Każde polecenie zwraca kod wyjścia procesu: 0 przy powodzeniu,
+ * 1 gdy wystąpiły błędy.
+ */
+class BatchTool
+{
+public:
+    /**
+     * @brief Tworzy narzędzie dla repozytorium.
+     * @param repository Pliki danych.
+     * @param out Strumień wyników.
+     * @param err Strumień komunikatów i czasów.
+     */
+    BatchTool(DataRepository& repository, QTextStream& out, QTextStream& err);
+
+    /**
+     * @brief Pobiera listę stacji (jeśli brak jej lokalnie lub wymuszono odświeżenie).
+     */
+    Async::Task<int> syncStations(BatchOptions options);
+
+    /**
+     * @brief Pobiera sensory wybranych stacji.
+     */
+    Async::Task<int> syncSensors(BatchOptions options);
+
+    /**
+     * @brief Pobiera pomiary wybranych sensorów i scala je z historią.
+     */
+    Async::Task<int> syncMeasurements(BatchOptions options);
+
+    /**
+     * @brief Eksportuje zapisane pomiary wybranych sensorów z zakresu dat.
+     */
+    int exportRange(const BatchOptions& options);
+
+    /**
+     * @brief Wypisuje statystyki zakresu dla sensorów i parametrów.
+     */
+    int statistics(const BatchOptions& options);
+
+private:
+    /// Pobieranie dla jednego identyfikatora
+    using Fetch = std::function<Async::Task<ApiResult>(int id)>;
+
+    /**
+     * @brief Stan partii żądań wspólny dla równoległych pobierających.
+     */
+    struct FetchBatch
+    {
+        QVector<int> ids;                   ///< Identyfikatory do pobrania
+        int next = 0;                       ///< Indeks kolejnego identyfikatora
+        int errors = 0;                     ///< Liczba nieudanych żądań
+        QHash<int, QJsonArray> results;     ///< Wyniki udanych żądań
+    };
+
+    /**
+     * @brief Pobiera dane dla wszystkich identyfikatorów, najwyżej jobs naraz.
+     * @return Wyniki według identyfikatora (tylko udane żądania) i liczba błędów.
+     */
+    Async::Task<std::shared_ptr<FetchBatch>> fetchAll(QVector<int> ids, int jobs, Fetch fetch);
+
+    /**
+     * @brief Pobiera kolejne identyfikatory partii, dopóki jakieś zostały.
+     */
+    Async::Task<void> fetchWorker(std::shared_ptr<FetchBatch> batch, Fetch fetch);
+
+    /**
+     * @brief Sensory z sensors.json według ID.
+     */
+    QHash<int, SensorRecord> sensorsById() const;
+
+    /**
+     * @brief Czy sensor pasuje do filtrów stacji, sensorów i parametrów.
+     */
+    static bool matches(const SensorRecord& sensor, const BatchOptions& options);
+
+    /**
+     * @brief Zapisane historie pomiarów sensorów pasujących do filtrów.
+     */
+    QVector<QPair<SensorRecord, QJsonArray>> selectMeasurements(const BatchOptions& options);
+
+    /**
+     * @brief Wypisuje czas fazy i przepustowość.
+     */
+    void reportTiming(const QString& phase, const QElapsedTimer& timer, int items);
+
+    DataRepository& repository;     ///< Pliki danych
+    GiosClient client;              ///< Klient API GIOŚ
+    QTextStream& out;               ///< Wyniki
+    QTextStream& err;               ///< Komunikaty i czasy
+};
@@ -0,0 +1,180 @@
+﻿/**
+ * @file main.cpp
+ * @brief Narzędzie wiersza poleceń do synchronizacji, eksportu, statystyk i lokalnego API.
+ *
+ * Przykłady:
+ * @code
+ * AirQualityCli sync --jobs 8
+ * AirQualityCli sync measurements --param PM10,PM2.5 --jobs 16
+ * AirQualityCli export --station 114 --from 2025-05-01 --to 2025-05-07 --output pomiary.csv
+ * AirQualityCli stats --param NO2 --threads 8
+ * AirQualityCli serve --port 8080 --lan
+ * @endcode
+ */
+
+#include "BatchTool.h"
+#include "LocalApiServer.h"
+#include "TaskScheduler.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QThreadPool>
+
+namespace
+{
+    /**
+     * @brief Odczytuje listę liczb z powtarzanej opcji (także rozdzielanej przecinkami).
+     */
+    QVector<int> idList(const QStringList& values)
+    {
+        QVector<int> ids;
+        for (const QString& value : values) {
+            for (const QString& part : value.split(',', Qt::SkipEmptyParts))
+                ids.append(part.trimmed().toInt());
+        }
+        return ids;
+    }
+
+    /**
+     * @brief Odczytuje datę z opcji (pusta - 0, czyli bez ograniczenia).
+     * @param endOfDay Dla samej daty przyjmij ostatnią godzinę dnia.
+     */
+    qint64 dateOption(const QString& text, bool endOfDay)
+    {
+        if (text.isEmpty())
+            return 0;
+        QDateTime dt = QDateTime::fromString(text, "yyyy-MM-dd HH:mm:ss");
+        if (!dt.isValid())
+            dt = QDateTime::fromString(text, Qt::ISODate);
+        if (!dt.isValid()) {
+            const QDate date = QDate::fromString(text, Qt::ISODate);
+            dt = endOfDay ? date.endOfDay() : date.startOfDay();
+        }
+        return dt.isValid() ? dt.toMSecsSinceEpoch() : -1;
+    }
+
+    /**
+     * @brief Synchronizuje kolejno wybrane etapy (pusty etap - wszystkie).
+     */
+    Async::Task<int> sync(BatchTool* tool, QString stage, BatchOptions options)
+    {
+        int result = 0;
+        if (stage.isEmpty() || stage == "stations")
+            result |= co_await tool->syncStations(options);
+        if (stage.isEmpty() || stage == "sensors")
+            result |= co_await tool->syncSensors(options);
+        if (stage.isEmpty() || stage == "measurements")
+            result |= co_await tool->syncMeasurements(options);
+        co_return result;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("AirQualityCli");
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Wsadowa synchronizacja, eksport i statystyki danych GIOŚ.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("command", "sync [stations|sensors|measurements], export, stats lub serve");
+
+    const QCommandLineOption dataDirOption("data-dir", "Katalog plików JSON (domyślnie bieżący).", "dir");
+    const QCommandLineOption jobsOption("jobs", "Liczba równoległych żądań do API.", "n", "6");
+    const QCommandLineOption threadsOption("threads", "Liczba wątków obliczeń (domyślnie liczba rdzeni).", "n");
+    const QCommandLineOption timeoutOption("timeout", "Limit czasu żądania pomiarów w ms.", "ms", "10000");
+    const QCommandLineOption refreshOption("refresh", "Pobierz ponownie dane zapisane lokalnie.");
+    const QCommandLineOption stationOption("station", "ID stacji (można powtarzać lub rozdzielać przecinkami).", "ids");
+    const QCommandLineOption sensorOption("sensor", "ID sensora (można powtarzać lub rozdzielać przecinkami).", "ids");
+    const QCommandLineOption paramOption("param", "Kod parametru, np. PM10 (można rozdzielać przecinkami).", "codes");
+    const QCommandLineOption fromOption("from", "Początek zakresu (yyyy-MM-dd lub yyyy-MM-dd HH:mm:ss).", "date");
+    const QCommandLineOption toOption("to", "Koniec zakresu (yyyy-MM-dd lub yyyy-MM-dd HH:mm:ss).", "date");
+    const QCommandLineOption outputOption("output", "Plik wynikowy eksportu (domyślnie standardowe wyjście).", "file");
+    const QCommandLineOption formatOption("format", "Format eksportu: csv lub json.", "format", "csv");
+    const QCommandLineOption portOption("port", "Port serwera HTTP (serve).", "port",
+        QString::number(LocalApiServer::kDefaultPort));
+    const QCommandLineOption lanOption("lan", "Udostępnia serwer (serve) w sieci lokalnej (domyślnie tylko na tym komputerze).");
+    parser.addOptions({ dataDirOption, jobsOption, threadsOption, timeoutOption, refreshOption, stationOption,
+        sensorOption, paramOption, fromOption, toOption, outputOption, formatOption, portOption, lanOption });
+    parser.process(app);
+
+    const QStringList args = parser.positionalArguments();
+    if (args.isEmpty()) {
+        parser.showHelp(1);
+    }
+
+    BatchOptions options;
+    options.jobs = qMax(1, parser.value(jobsOption).toInt());
+    options.timeoutMs = parser.value(timeoutOption).toInt();
+    options.refresh = parser.isSet(refreshOption);
+    options.stationIds = idList(parser.values(stationOption));
+    options.sensorIds = idList(parser.values(sensorOption));
+    for (const QString& value : parser.values(paramOption))
+        options.paramCodes += value.split(',', Qt::SkipEmptyParts);
+    options.fromMs = dateOption(parser.value(fromOption), false);
+    options.toMs = dateOption(parser.value(toOption), true);
+    options.output = parser.value(outputOption);
+    options.format = parser.value(formatOption);
+
+    if (options.fromMs < 0 || options.toMs < 0) {
+        err << "Nieprawidłowa data zakresu" << Qt::endl;
+        return 1;
+    }
+    if (parser.isSet(threadsOption)) {
+        const int threads = qMax(1, parser.value(threadsOption).toInt());
+        TaskScheduler::setDefaultWorkerCount(threads);
+        QThreadPool::globalInstance()->setMaxThreadCount(threads);
+    }
+
+    DataRepository repository(parser.value(dataDirOption));
+    BatchTool tool(repository, out, err);
+
+    QElapsedTimer timer;
+    timer.start();
+    int result = 0;
+
+    const QString command = args.first();
+    if (command == "sync") {
+        // Bez wskazania etapu synchronizowane są kolejno stacje, sensory i pomiary
+        const QString stage = args.value(1);
+        if (!stage.isEmpty() && !QStringList({ "stations", "sensors", "measurements" }).contains(stage)) {
+            err << "Nieznany etap synchronizacji: " << stage << Qt::endl;
+            return 1;
+        }
+
+        // Żądania obsługuje pętla zdarzeń, kończona po ostatnim etapie
+        sync(&tool, stage, options).then([](int code) {
+            QCoreApplication::exit(code);
+            });
+        result = app.exec();
+    }
+    else if (command == "export") {
+        result = tool.exportRange(options);
+    }
+    else if (command == "stats") {
+        result = tool.statistics(options);
+    }
+    else if (command == "serve") {
+        // Serwer działa do zakończenia procesu; dane odczytywane są raz przy starcie
+        LocalApiServer server(repository);
+        server.reload();
+        const QHostAddress address = parser.isSet(lanOption) ? QHostAddress::Any : QHostAddress::LocalHost;
+        if (!server.listen(quint16(parser.value(portOption).toUInt()), address)) {
+            err << "Nie udało się uruchomić serwera: " << server.errorString() << Qt::endl;
+            return 1;
+        }
+        err << QString("Wczytano dane w %1 ms, serwer nasłuchuje na %2:%3")
+            .arg(timer.elapsed()).arg(address.toString()).arg(server.port()) << Qt::endl;
+        return app.exec();
+    }
+    else {
+        err << "Nieznane polecenie: " << command << Qt::endl;
+        parser.showHelp(1);
+    }
+
+    err << QString("Łącznie: %1 ms").arg(timer.elapsed()) << Qt::endl;
+    return result;
+}
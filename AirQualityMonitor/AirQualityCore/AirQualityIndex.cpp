@@ -0,0 +1,108 @@
+﻿/**
+ * @file AirQualityIndex.cpp
+ * @brief Implementacja indeksu jakości powietrza.
+ */
+
+#include "AirQualityIndex.h"
+#include <cmath>
+
+namespace
+{
+    /**
+     * @brief Górne granice klas 0-4 indeksu (µg/m³); powyżej ostatniej - bardzo zły.
+     */
+    struct IndexThresholds
+    {
+        const char* paramCode;
+        double limits[AirQualityIndex::kLevelCount - 1];
+    };
+
+    constexpr IndexThresholds kThresholds[] = {
+        { "PM10",  { 20.0, 50.0, 80.0, 110.0, 150.0 } },
+        { "PM2.5", { 13.0, 35.0, 55.0, 75.0, 110.0 } },
+        { "NO2",   { 40.0, 100.0, 150.0, 230.0, 400.0 } },
+        { "O3",    { 70.0, 120.0, 150.0, 180.0, 240.0 } },
+        { "SO2",   { 50.0, 100.0, 200.0, 350.0, 500.0 } },
+    };
+}
+
+QStringList AirQualityIndex::pollutants()
+{
+    QStringList codes;
+    for (const IndexThresholds& thresholds : kThresholds)
+        codes.append(QString::fromLatin1(thresholds.paramCode));
+    return codes;
+}
+
+int AirQualityIndex::level(const QString& paramCode, double value)
+{
+    if (std::isnan(value) || value < 0.0)
+        return kNoLevel;
+
+    for (const IndexThresholds& thresholds : kThresholds) {
+        if (paramCode != QLatin1String(thresholds.paramCode))
+            continue;
+        for (int i = 0; i < kLevelCount - 1; ++i) {
+            if (value <= thresholds.limits[i])
+                return i;
+        }
+        return kLevelCount - 1;
+    }
+    return kNoLevel;
+}
+
+void StationIndexMap::addSensors(const QVector<SensorRecord>& records)
+{
+    for (const SensorRecord& sensor : records) {
+        if (sensor.id == -1 || sensor.stationId == -1)
+            continue;
+        sensors.insert(sensor.id, { sensor.stationId, sensor.paramCode });
+        stationsByParam[sensor.paramCode].insert(sensor.stationId);
+    }
+}
+
+bool StationIndexMap::update(int sensorId, const MeasurementSeries& series, StationReadingChange& change)
+{
+    auto link = sensors.constFind(sensorId);
+    if (link == sensors.constEnd())
+        return false;
+
+    // Najnowsza godzina z wartością zmierzoną
+    int last = series.size() - 1;
+    while (last >= 0 && !series.validity.testBit(last))
+        --last;
+    if (last < 0)
+        return false;
+
+    StationReading reading;
+    reading.ms = series.timeAt(last);
+    reading.value = series.values[last];
+    reading.level = AirQualityIndex::level(link->paramCode, reading.value);
+
+    StationReading& current = byParam[link->paramCode][link->stationId];
+    if (reading.ms < current.ms)
+        return false;
+    if (reading.ms == current.ms && reading.value == current.value)
+        return false;
+
+    current = reading;
+    change.stationId = link->stationId;
+    change.paramCode = link->paramCode;
+    change.reading = reading;
+    return true;
+}
+
+QVector<StationReadingChange> StationIndexMap::allReadings() const
+{
+    QVector<StationReadingChange> entries;
+    for (auto param = byParam.cbegin(); param != byParam.cend(); ++param) {
+        for (auto station = param->cbegin(); station != param->cend(); ++station) {
+            StationReadingChange entry;
+            entry.stationId = station.key();
+            entry.paramCode = param.key();
+            entry.reading = station.value();
+            entries.append(entry);
+        }
+    }
+    return entries;
+}
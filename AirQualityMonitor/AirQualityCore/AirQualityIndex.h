@@ -0,0 +1,117 @@
+﻿/**
+ * @file AirQualityIndex.h
+ * @brief Polski indeks jakości powietrza i najnowsze klasy indeksu stacji.
+ *
+ * Klasy indeksu (od bardzo dobrego do bardzo złego) wyznaczane są z progów
+ * stężeń godzinowych GIOŚ dla PM10, PM2.5, NO2, O3 i SO2. Mapa stacji
+ * przechowuje najnowszy zmierzony pomiar każdego parametru stacji, a jego
+ * aktualizacja zwraca zmianę, którą można przekazać mapie jako różnicę.
+ *
+ * @author Jakub Frąckowiak
+ * @date Maj 2025
+ */
+
+#pragma once
+
+#include "GapAnalysis.h"
+#include "Records.h"
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+#include <QVector>
+#include <limits>
+
+/**
+ * @brief Progi i klasy polskiego indeksu jakości powietrza.
+ */
+namespace AirQualityIndex
+{
+    constexpr int kNoLevel = -1;        ///< Brak klasy (brak pomiaru lub nieobsługiwany parametr)
+    constexpr int kLevelCount = 6;      ///< Liczba klas indeksu
+
+    /**
+     * @brief Zwraca kody parametrów, dla których wyznaczany jest indeks.
+     */
+    QStringList pollutants();
+
+    /**
+     * @brief Wyznacza klasę indeksu dla stężenia godzinowego.
+     * @param paramCode Kod parametru (np. PM10).
+     * @param value Stężenie w µg/m³.
+     * @return Klasa od 0 (bardzo dobry) do 5 (bardzo zły) lub kNoLevel.
+     */
+    int level(const QString& paramCode, double value);
+}
+
+/**
+ * @brief Najnowszy zmierzony pomiar parametru na stacji.
+ */
+struct StationReading
+{
+    qint64 ms = 0;                                              ///< Czas pomiaru (ms od epoki)
+    double value = std::numeric_limits<double>::quiet_NaN();    ///< Stężenie (NaN, gdy brak)
+    int level = AirQualityIndex::kNoLevel;                      ///< Klasa indeksu
+};
+
+/**
+ * @brief Zmiana najnowszego pomiaru stacji.
+ */
+struct StationReadingChange
+{
+    int stationId = -1;         ///< ID stacji
+    QString paramCode;          ///< Kod parametru
+    StationReading reading;     ///< Nowy pomiar
+};
+
+/**
+ * @class StationIndexMap
+ * @brief Najnowsze pomiary i klasy indeksu stacji według parametru.
+ */
+class StationIndexMap
+{
+public:
+    /**
+     * @brief Rejestruje sensory stacji (przypisanie sensora do stacji i parametru).
+     */
+    void addSensors(const QVector<SensorRecord>& sensors);
+
+    /**
+     * @brief Ustawia najnowszy zmierzony pomiar sensora z jego serii.
+     * @param sensorId ID sensora.
+     * @param series Seria pomiarowa sensora.
+     * @param change Zmiana pomiaru stacji (wypełniana, gdy zwrócono true).
+     * @return True, jeśli zmieniła się wartość lub klasa pomiaru stacji.
+     */
+    bool update(int sensorId, const MeasurementSeries& series, StationReadingChange& change);
+
+    /**
+     * @brief Zwraca najnowsze pomiary stacji dla parametru (ID stacji -> pomiar).
+     */
+    QHash<int, StationReading> readings(const QString& paramCode) const { return byParam.value(paramCode); }
+
+    /**
+     * @brief Sprawdza, czy stacja ma sensor danego parametru.
+     */
+    bool measures(int stationId, const QString& paramCode) const { return stationsByParam.value(paramCode).contains(stationId); }
+
+    /**
+     * @brief Zwraca wszystkie najnowsze pomiary stacji (do zapisu w migawce stanu).
+     */
+    QVector<StationReadingChange> allReadings() const;
+
+    /**
+     * @brief Ustawia zapisany wcześniej pomiar stacji bez przeliczania serii.
+     */
+    void setReading(const StationReadingChange& entry) { byParam[entry.paramCode][entry.stationId] = entry.reading; }
+
+private:
+    struct SensorLink
+    {
+        int stationId = -1;     ///< ID stacji sensora
+        QString paramCode;      ///< Mierzony parametr
+    };
+
+    QHash<int, SensorLink> sensors;                         ///< ID sensora -> stacja i parametr
+    QHash<QString, QHash<int, StationReading>> byParam;     ///< Parametr -> ID stacji -> pomiar
+    QHash<QString, QSet<int>> stationsByParam;              ///< Parametr -> stacje z jego sensorem
+};
@@ -0,0 +1,76 @@
+﻿/**
+ * @file AsyncIo.cpp
+ * @brief Implementacja operacji sieciowych i plikowych zwracających zadania.
+ */
+
+#include "AsyncIo.h"
+#include <QFile>
+#include <QFutureWatcher>
+#include <QNetworkAccessManager>
+#include <QNetworkRequest>
+#include <QPointer>
+#include <QtConcurrent/QtConcurrentRun>
+
+namespace Async
+{
+    Task<NetworkResult> fetch(QNetworkAccessManager* network, const QNetworkRequest& request,
+        const CancellationToken& cancel)
+    {
+        TaskSource<NetworkResult> source;
+        if (cancel.isCancelled()) {
+            NetworkResult result;
+            result.error = "Anulowano";
+            result.code = QNetworkReply::OperationCanceledError;
+            result.cancelled = true;
+            source.complete(result);
+            return source.task();
+        }
+
+        QNetworkReply* reply = network->get(request);
+        QPointer<QNetworkReply> guard(reply);
+        cancel.onCancel([guard]() {
+            if (guard && !guard->isFinished())
+                guard->abort();
+            });
+
+        QObject::connect(reply, &QNetworkReply::finished, reply, [reply, source, cancel]() {
+            reply->deleteLater();
+            NetworkResult result;
+            result.code = reply->error();
+            if (cancel.isCancelled()) {
+                result.error = "Anulowano";
+                result.cancelled = true;
+            }
+            else if (result.code != QNetworkReply::NoError) {
+                result.error = reply->errorString();
+            }
+            else {
+                result.data = reply->readAll();
+            }
+            source.complete(result);
+            });
+        return source.task();
+    }
+
+    Task<FileResult> readFileAsync(const QString& path)
+    {
+        TaskSource<FileResult> source;
+
+        // Obserwator żyje w wątku aplikacji, więc wynik trafia do niego przez pętlę zdarzeń
+        auto* watcher = new QFutureWatcher<FileResult>();
+        QObject::connect(watcher, &QFutureWatcherBase::finished, watcher, [watcher, source]() {
+            source.complete(watcher->result());
+            watcher->deleteLater();
+            });
+        watcher->setFuture(QtConcurrent::run([path]() {
+            FileResult result;
+            QFile file(path);
+            if (!file.open(QIODevice::ReadOnly))
+                result.error = file.errorString();
+            else
+                result.data = file.readAll();
+            return result;
+            }));
+        return source.task();
+    }
+}
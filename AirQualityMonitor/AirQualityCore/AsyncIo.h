@@ -0,0 +1,62 @@
+﻿/**
+ * @file AsyncIo.h
+ * @brief Operacje sieciowe i plikowe zwracające zadania Async::Task.
+ *
+ * Żądania sieciowe obsługiwane są przez pętlę zdarzeń Qt, a odczyt pliku
+ * odbywa się w puli wątków; w obu przypadkach korutyna wznawiana jest
+ * w wątku aplikacji.
+ *
+ * @author Jakub Frąckowiak
+ * @date Maj 2025
+ */
+
+#pragma once
+
+#include "Task.h"
+#include <QByteArray>
+#include <QNetworkReply>
+#include <QString>
+
+class QNetworkAccessManager;
+class QNetworkRequest;
+
+namespace Async
+{
+    /**
+     * @brief Wynik żądania HTTP.
+     */
+    struct NetworkResult
+    {
+        QByteArray data;                                                ///< Treść odpowiedzi
+        QString error;                                                  ///< Opis błędu (pusty - powodzenie)
+        QNetworkReply::NetworkError code = QNetworkReply::NoError;      ///< Kod błędu Qt
+        bool cancelled = false;                                         ///< Przerwane przez CancellationToken
+
+        bool ok() const { return error.isEmpty(); }
+    };
+
+    /**
+     * @brief Wynik odczytu pliku.
+     */
+    struct FileResult
+    {
+        QByteArray data;    ///< Zawartość pliku
+        QString error;      ///< Opis błędu (pusty - powodzenie)
+
+        bool ok() const { return error.isEmpty(); }
+    };
+
+    /**
+     * @brief Wysyła żądanie GET.
+     *
+     * Anulowanie tokenu przerywa żądanie; wynik ma wtedy ustawione cancelled.
+     * Limit czasu ustawia się w żądaniu (QNetworkRequest::setTransferTimeout).
+     */
+    Task<NetworkResult> fetch(QNetworkAccessManager* network, const QNetworkRequest& request,
+        const CancellationToken& cancel = CancellationToken());
+
+    /**
+     * @brief Odczytuje cały plik w puli wątków.
+     */
+    Task<FileResult> readFileAsync(const QString& path);
+}
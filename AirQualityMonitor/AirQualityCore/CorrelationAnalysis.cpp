@@ -0,0 +1,235 @@
+﻿/**
+ * @file CorrelationAnalysis.cpp
+ * @brief Implementacja korelacji między zanieczyszczeniami.
+ */
+
+#include "CorrelationAnalysis.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace
+{
+    constexpr int kBlockRows = 2048;    ///< Liczba wierszy przetwarzanych w jednym bloku
+    const double kNaN = std::numeric_limits<double>::quiet_NaN();
+}
+
+AlignedColumns CorrelationAnalysis::align(const QVector<QPair<QString, MeasurementSeries>>& series)
+{
+    AlignedColumns result;
+
+    qint64 start = std::numeric_limits<qint64>::max();
+    qint64 end = std::numeric_limits<qint64>::min();
+    for (const auto& entry : series) {
+        const MeasurementSeries& s = entry.second;
+        if (s.size() == 0)
+            continue;
+        start = std::min(start, s.timeAt(0));
+        end = std::max(end, s.timeAt(s.size() - 1));
+    }
+
+    if (start > end)
+        return result;
+
+    result.startMs = start;
+    result.rows = int((end - start) / MeasurementSeries::kHourMs) + 1;
+    for (const auto& entry : series)
+        result.names.append(entry.first);
+
+    result.data.fill(kNaN, qsizetype(result.rows) * result.columns());
+
+    for (int c = 0; c < series.size(); ++c) {
+        const MeasurementSeries& s = series[c].second;
+        double* column = result.data.data() + qsizetype(c) * result.rows;
+        const int offset = int((s.startMs - start) / MeasurementSeries::kHourMs);
+        for (int i = 0; i < s.size(); ++i) {
+            if (s.validity.testBit(i))
+                column[offset + i] = s.values[i];
+        }
+    }
+
+    return result;
+}
+
+double CorrelationAnalysis::pearsonKernel(const double* x, const double* y, int rows, int* count)
+{
+    // Najpierw średnie z par kompletnych - centrowanie poprawia stabilność numeryczną
+    double n = 0.0, sx = 0.0, sy = 0.0;
+    for (int block = 0; block < rows; block += kBlockRows) {
+        const int end = std::min(rows, block + kBlockRows);
+        for (int r = block; r < end; ++r) {
+            const bool valid = !std::isnan(x[r]) && !std::isnan(y[r]);
+            n += valid ? 1.0 : 0.0;
+            sx += valid ? x[r] : 0.0;
+            sy += valid ? y[r] : 0.0;
+        }
+    }
+
+    if (count)
+        *count = int(n);
+    if (n < kMinPairCount)
+        return kNaN;
+
+    const double mx = sx / n;
+    const double my = sy / n;
+
+    double sxx = 0.0, syy = 0.0, sxy = 0.0;
+    for (int block = 0; block < rows; block += kBlockRows) {
+        const int end = std::min(rows, block + kBlockRows);
+        for (int r = block; r < end; ++r) {
+            const bool valid = !std::isnan(x[r]) && !std::isnan(y[r]);
+            const double dx = valid ? x[r] - mx : 0.0;
+            const double dy = valid ? y[r] - my : 0.0;
+            sxx += dx * dx;
+            syy += dy * dy;
+            sxy += dx * dy;
+        }
+    }
+
+    if (sxx <= 0.0 || syy <= 0.0)
+        return kNaN;
+
+    return sxy / std::sqrt(sxx * syy);
+}
+
+QVector<double> CorrelationAnalysis::ranks(const double* x, int rows)
+{
+    // Rangi średnie dla remisów; braki pozostają NaN
+    QVector<int> order;
+    order.reserve(rows);
+    for (int r = 0; r < rows; ++r) {
+        if (!std::isnan(x[r]))
+            order.append(r);
+    }
+    std::sort(order.begin(), order.end(), [x](int a, int b) { return x[a] < x[b]; });
+
+    QVector<double> result(rows, kNaN);
+    int i = 0;
+    while (i < order.size()) {
+        int j = i;
+        while (j + 1 < order.size() && x[order[j + 1]] == x[order[i]])
+            ++j;
+        const double rank = (i + j) / 2.0 + 1.0;
+        for (int k = i; k <= j; ++k)
+            result[order[k]] = rank;
+        i = j + 1;
+    }
+    return result;
+}
+
+double CorrelationAnalysis::pairwiseSpearman(const double* x, const double* y, int rows)
+{
+    // Rangi liczone od nowa na wierszach, w których zmierzono oba parametry
+    QVector<double> px, py;
+    for (int r = 0; r < rows; ++r) {
+        if (!std::isnan(x[r]) && !std::isnan(y[r])) {
+            px.append(x[r]);
+            py.append(y[r]);
+        }
+    }
+    if (px.size() < kMinPairCount)
+        return kNaN;
+
+    const QVector<double> rx = ranks(px.constData(), int(px.size()));
+    const QVector<double> ry = ranks(py.constData(), int(py.size()));
+    return pearsonKernel(rx.constData(), ry.constData(), int(rx.size()), nullptr);
+}
+
+CorrelationResult CorrelationAnalysis::correlate(const AlignedColumns& columns)
+{
+    CorrelationResult result;
+    result.names = columns.names;
+    const int n = columns.columns();
+    result.pearson.fill(kNaN, n * n);
+    result.spearman.fill(kNaN, n * n);
+    result.pairCounts.fill(0, n * n);
+
+    if (n == 0 || columns.rows == 0)
+        return result;
+
+    // Kolumny rang dla Spearmana, liczone raz na kolumnę; pary o innych brakach rangowane są osobno
+    QVector<int> columnIndices(n);
+    std::iota(columnIndices.begin(), columnIndices.end(), 0);
+    const QVector<QVector<double>> rankColumns = Parallel::map(columnIndices,
+        [&columns](int c) { return ranks(columns.column(c), columns.rows); });
+    QVector<int> validCounts(n, 0);
+    for (int c = 0; c < n; ++c) {
+        const double* column = columns.column(c);
+        validCounts[c] = int(std::count_if(column, column + columns.rows, [](double v) { return !std::isnan(v); }));
+    }
+
+    QVector<QPair<int, int>> pairs;
+    for (int i = 0; i < n; ++i) {
+        for (int j = i; j < n; ++j)
+            pairs.append(qMakePair(i, j));
+    }
+
+    // Każda para zapisuje wyłącznie swoje komórki macierzy - bez synchronizacji
+    double* pearson = result.pearson.data();
+    double* spearman = result.spearman.data();
+    int* pairCounts = result.pairCounts.data();
+    Parallel::forEach(int(pairs.size()), [&](int index) {
+        const int i = pairs.at(index).first;
+        const int j = pairs.at(index).second;
+        int count = 0;
+        const double p = pearsonKernel(columns.column(i), columns.column(j), columns.rows, &count);
+
+        // Rangi całych kolumn są rangami pary tylko wtedy, gdy braki obu kolumn się pokrywają
+        const double s = count == validCounts[i] && count == validCounts[j]
+            ? pearsonKernel(rankColumns[i].constData(), rankColumns[j].constData(), columns.rows, nullptr)
+            : pairwiseSpearman(columns.column(i), columns.column(j), columns.rows);
+
+        pearson[result.at(i, j)] = p;
+        pearson[result.at(j, i)] = p;
+        spearman[result.at(i, j)] = s;
+        spearman[result.at(j, i)] = s;
+        pairCounts[result.at(i, j)] = count;
+        pairCounts[result.at(j, i)] = count;
+        });
+
+    return result;
+}
+
+QVector<CorrelationResult> CorrelationAnalysis::correlateAll(const QVector<AlignedColumns>& stations)
+{
+    return Parallel::map(stations, &CorrelationAnalysis::correlate);
+}
+
+LaggedCorrelation CorrelationAnalysis::crossCorrelation(const AlignedColumns& columns, int a, int b, int maxLag)
+{
+    LaggedCorrelation result;
+    result.maxLag = maxLag;
+    result.values.fill(kNaN, 2 * maxLag + 1);
+
+    if (a < 0 || b < 0 || a >= columns.columns() || b >= columns.columns())
+        return result;
+
+    const double* x = columns.column(a);
+    const double* y = columns.column(b);
+    const int rows = columns.rows;
+
+    double* values = result.values.data();
+    Parallel::forEach(2 * maxLag + 1, [&](int index) {
+        const int lag = index - maxLag;
+        // corr(x[t], y[t + lag]) na części wspólnej obu zakresów
+        const int from = std::max(0, -lag);
+        const int to = std::min(rows, rows - lag);
+        if (to - from <= 0)
+            return;
+        values[lag + maxLag] = pearsonKernel(x + from, y + from + lag, to - from, nullptr);
+        });
+
+    double bestAbs = -1.0;
+    for (int i = 0; i < result.values.size(); ++i) {
+        const double v = result.values[i];
+        if (!std::isnan(v) && std::abs(v) > bestAbs) {
+            bestAbs = std::abs(v);
+            result.bestLag = i - maxLag;
+            result.best = v;
+        }
+    }
+
+    return result;
+}
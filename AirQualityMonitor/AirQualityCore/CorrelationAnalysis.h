@@ -0,0 +1,129 @@
+﻿/**
+ * @file CorrelationAnalysis.h
+ * @brief Korelacje między zanieczyszczeniami mierzonymi na jednej stacji.
+ *
+ * Serie wszystkich sensorów stacji są wyrównywane do wspólnej osi godzinowej
+ * w buforze kolumnowym, a następnie liczona jest macierz korelacji Pearsona
+ * i Spearmana oraz korelacja wzajemna z przesunięciem czasowym.
+ *
+ * @author Jakub Frąckowiak
+ * @date Maj 2025
+ */
+
+#pragma once
+
+#include "GapAnalysis.h"
+#include <QPair>
+#include <QStringList>
+#include <QVector>
+
+/**
+ * @brief Serie jednej stacji wyrównane do wspólnej osi godzinowej.
+ *
+ * Dane przechowywane są kolumnowo: kolumna c zajmuje zakres
+ * data[c * rows, (c + 1) * rows). Braki pomiarów zapisane są jako NaN.
+ */
+struct AlignedColumns
+{
+    qint64 startMs = 0;         ///< Czas pierwszego wiersza (ms od epoki)
+    int rows = 0;               ///< Liczba godzin na wspólnej osi
+    QStringList names;          ///< Nazwy kolumn (np. kody parametrów)
+    QVector<double> data;       ///< Bufor kolumnowy rows * names.size()
+
+    /**
+     * @brief Zwraca liczbę kolumn.
+     */
+    int columns() const { return names.size(); }
+
+    /**
+     * @brief Zwraca wskaźnik na początek kolumny.
+     */
+    const double* column(int c) const { return data.constData() + qsizetype(c) * rows; }
+};
+
+/**
+ * @brief Macierze korelacji dla jednej stacji (układ wierszowy n x n).
+ */
+struct CorrelationResult
+{
+    QStringList names;          ///< Nazwy kolumn
+    QVector<double> pearson;    ///< Współczynniki Pearsona (NaN gdy za mało danych)
+    QVector<double> spearman;   ///< Współczynniki Spearmana (NaN gdy za mało danych)
+    QVector<int> pairCounts;    ///< Liczba godzin wspólnych dla każdej pary
+
+    /**
+     * @brief Zwraca rozmiar macierzy.
+     */
+    int size() const { return names.size(); }
+
+    /**
+     * @brief Zwraca indeks elementu (i, j) w macierzy.
+     */
+    int at(int i, int j) const { return i * names.size() + j; }
+};
+
+/**
+ * @brief Korelacja wzajemna dwóch kolumn w funkcji przesunięcia.
+ */
+struct LaggedCorrelation
+{
+    int maxLag = 0;             ///< Największe badane przesunięcie (w godzinach)
+    QVector<double> values;     ///< Korelacje dla przesunięć -maxLag..maxLag
+    int bestLag = 0;            ///< Przesunięcie o największej wartości bezwzględnej korelacji
+    double best = 0.0;          ///< Korelacja dla najlepszego przesunięcia
+};
+
+/**
+ * @class CorrelationAnalysis
+ * @brief Obliczenia korelacji na wyrównanych kolumnach.
+ *
+ * Pary kolumn liczone są równolegle, a każda para przetwarzana jest blokami
+ * wierszy, tak aby obie kolumny pozostawały w pamięci podręcznej procesora.
+ */
+class CorrelationAnalysis
+{
+public:
+    /**
+     * @brief Minimalna liczba wspólnych godzin, od której korelacja jest liczona.
+     */
+    static constexpr int kMinPairCount = 24;
+
+    /**
+     * @brief Wyrównuje serie do wspólnej osi godzinowej.
+     * @param series Pary (nazwa kolumny, seria godzinowa).
+     * @return Bufor kolumnowy obejmujący sumę zakresów wszystkich serii.
+     *
+     * Do bufora trafiają tylko wartości zmierzone; uzupełnienia są pomijane,
+     * aby nie zawyżały korelacji.
+     */
+    static AlignedColumns align(const QVector<QPair<QString, MeasurementSeries>>& series);
+
+    /**
+     * @brief Liczy macierze korelacji Pearsona i Spearmana.
+     * @param columns Wyrównane kolumny stacji.
+     * @return Macierze korelacji z liczbą wspólnych obserwacji.
+     */
+    static CorrelationResult correlate(const AlignedColumns& columns);
+
+    /**
+     * @brief Liczy macierze korelacji dla wielu stacji równolegle.
+     * @param stations Wyrównane kolumny kolejnych stacji.
+     * @return Wyniki w kolejności wejścia.
+     */
+    static QVector<CorrelationResult> correlateAll(const QVector<AlignedColumns>& stations);
+
+    /**
+     * @brief Liczy korelację wzajemną kolumny b przesuniętej względem a.
+     * @param columns Wyrównane kolumny stacji.
+     * @param a Indeks pierwszej kolumny.
+     * @param b Indeks drugiej kolumny.
+     * @param maxLag Największe przesunięcie w godzinach.
+     * @return Korelacje corr(a[t], b[t + lag]) dla lag w [-maxLag, maxLag].
+     */
+    static LaggedCorrelation crossCorrelation(const AlignedColumns& columns, int a, int b, int maxLag);
+
+private:
+    static double pearsonKernel(const double* x, const double* y, int rows, int* count);
+    static QVector<double> ranks(const double* x, int rows);
+    static double pairwiseSpearman(const double* x, const double* y, int rows);
+};
@@ -0,0 +1,326 @@
+﻿/**
+ * @file DataRepository.cpp
+ * @brief Implementacja lokalnych plików danych.
+ */
+
+#include "DataRepository.h"
+#include "Parallel.h"
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <QMutex>
+#include <QSaveFile>
+#include <cmath>
+
+namespace
+{
+    /// Chroni odczyt bajtów pliku przed jednoczesną podmianą pliku przez zapis
+    /// (pomiary czytane są także w wątku prognoz, a Windows nie podmieni otwartego pliku)
+    QMutex fileMutex;
+}
+
+DataRepository::DataRepository(const QString& directory)
+    : dir(directory.isEmpty() ? QDir::currentPath() : directory)
+{
+}
+
+QString DataRepository::filePath(const QString& fileName) const
+{
+    return dir + "/" + fileName;
+}
+
+QJsonArray DataRepository::readArray(const QString& fileName) const
+{
+    QByteArray bytes;
+    {
+        const QMutexLocker locker(&fileMutex);
+        QFile file(filePath(fileName));
+        if (!file.exists())
+            return QJsonArray();
+
+        if (!file.open(QIODevice::ReadOnly)) {
+            qDebug() << "Nie można otworzyć pliku" << fileName << ":" << file.errorString();
+            return QJsonArray();
+        }
+        bytes = file.readAll();
+    }
+
+    // Parsowanie poza blokadą - zapis nie czeka na nie
+    QJsonParseError parseError;
+    const QJsonDocument doc = QJsonDocument::fromJson(bytes, &parseError);
+
+    if (parseError.error != QJsonParseError::NoError) {
+        qDebug() << "Błąd parsowania JSON" << fileName << ":" << parseError.errorString();
+        return QJsonArray();
+    }
+
+    if (!doc.isArray()) {
+        qDebug() << "Plik" << fileName << "nie zawiera tablicy jako głównego elementu.";
+        return QJsonArray();
+    }
+
+    return doc.array();
+}
+
+bool DataRepository::writeArray(const QString& fileName, const QJsonArray& array)
+{
+    const QByteArray bytes = QJsonDocument(array).toJson();
+
+    // Plik podmieniany dopiero po pełnym zapisie, więc odczyt (także w innym
+    // wątku lub procesie) widzi starą albo nową treść, nigdy obciętą
+    const QMutexLocker locker(&fileMutex);
+    QSaveFile file(filePath(fileName));
+    if (!file.open(QIODevice::WriteOnly)) {
+        lastError = QString("Nie można zapisać pliku %1: %2").arg(fileName, file.errorString());
+        qDebug() << lastError;
+        return false;
+    }
+
+    file.write(bytes);
+    if (!file.commit()) {
+        lastError = QString("Nie można zapisać pliku %1: %2").arg(fileName, file.errorString());
+        qDebug() << lastError;
+        return false;
+    }
+    qDebug() << "Dane zapisane do pliku" << fileName;
+    return true;
+}
+
+bool DataRepository::hasStations() const
+{
+    return QFile::exists(filePath(kStationsFile));
+}
+
+QJsonArray DataRepository::loadStations() const
+{
+    return readArray(kStationsFile);
+}
+
+bool DataRepository::saveStations(const QJsonArray& stations)
+{
+    return writeArray(kStationsFile, stations);
+}
+
+QJsonArray DataRepository::loadSensors() const
+{
+    return readArray(kSensorsFile);
+}
+
+QJsonArray DataRepository::loadSensors(int stationId) const
+{
+    QJsonArray stationSensors;
+    for (const QJsonValue& value : loadSensors()) {
+        if (value.toObject().value("stationId").toInt() == stationId)
+            stationSensors.append(value);
+    }
+    return stationSensors;
+}
+
+bool DataRepository::saveSensors(const QJsonArray& sensors)
+{
+    return writeArray(kSensorsFile, sensors);
+}
+
+bool DataRepository::replaceStationSensors(const QJsonArray& stationSensors)
+{
+    QJsonArray allSensors = loadSensors();
+
+    // Usuń stare dane stacji, jeśli istnieją
+    const int stationId = stationSensors.isEmpty() ? -1 : stationSensors.at(0).toObject().value("stationId").toInt(-1);
+    if (stationId != -1) {
+        for (int i = allSensors.size() - 1; i >= 0; --i) {
+            if (allSensors.at(i).toObject().value("stationId").toInt() == stationId)
+                allSensors.removeAt(i);
+        }
+    }
+
+    for (const QJsonValue& value : stationSensors)
+        allSensors.append(value);
+
+    return saveSensors(allSensors);
+}
+
+QJsonArray DataRepository::loadMeasurements() const
+{
+    return readArray(kMeasurementsFile);
+}
+
+QJsonArray DataRepository::loadMeasurements(int sensorId, QDateTime* lastUpdated) const
+{
+    for (const QJsonValue& value : loadMeasurements()) {
+        const QJsonObject obj = value.toObject();
+        if (obj.value("id").toInt() != sensorId)
+            continue;
+        if (lastUpdated)
+            *lastUpdated = QDateTime::fromString(obj.value("lastUpdated").toString(), Qt::ISODate);
+        return obj.value("values").toArray();
+    }
+    if (lastUpdated)
+        *lastUpdated = QDateTime();
+    return QJsonArray();
+}
+
+bool DataRepository::saveMeasurements(const QJsonArray& measurements)
+{
+    return writeArray(kMeasurementsFile, measurements);
+}
+
+QJsonArray DataRepository::mergeMeasurements(int sensorId, const QJsonArray& newValues,
+    QVector<MeasurementChange>* changes, bool* saved)
+{
+    QJsonArray allMeasurements = loadMeasurements();
+
+    // Znajdź dotychczasowe dane sensora
+    int sensorIndex = -1;
+    for (int i = 0; i < allMeasurements.size(); ++i) {
+        if (allMeasurements[i].toObject().value("id").toInt() == sensorId) {
+            sensorIndex = i;
+            break;
+        }
+    }
+
+    const QJsonArray existing = sensorIndex != -1
+        ? allMeasurements[sensorIndex].toObject().value("values").toArray()
+        : QJsonArray();
+    const QJsonArray merged = mergeValues(existing, newValues, changes);
+
+    QJsonObject entry;
+    entry["id"] = sensorId;
+    entry["values"] = merged;
+    // Czas, kiedy dane były ostatnio aktualizowane
+    entry["lastUpdated"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+
+    if (sensorIndex != -1)
+        allMeasurements[sensorIndex] = entry;
+    else
+        allMeasurements.append(entry);
+
+    const bool ok = saveMeasurements(allMeasurements);
+    if (saved)
+        *saved = ok;
+    return merged;
+}
+
+bool DataRepository::mergeMeasurements(const QHash<int, QJsonArray>& newValues, int* changedCount)
+{
+    QJsonArray allMeasurements = loadMeasurements();
+
+    // Pozycje sensorów w pliku; nowe sensory dopisywane są na końcu
+    QHash<int, int> positions;
+    for (int i = 0; i < allMeasurements.size(); ++i)
+        positions.insert(allMeasurements[i].toObject().value("id").toInt(), i);
+
+    struct Job
+    {
+        int sensorId = -1;
+        QJsonArray existing;
+        QJsonArray newValues;
+    };
+    QVector<Job> jobs;
+    jobs.reserve(newValues.size());
+    for (auto it = newValues.constBegin(); it != newValues.constEnd(); ++it) {
+        const int position = positions.value(it.key(), -1);
+        jobs.append({ it.key(),
+            position != -1 ? allMeasurements[position].toObject().value("values").toArray() : QJsonArray(),
+            it.value() });
+    }
+
+    // Scalanie sensorów jest niezależne, więc wykonywane jest równolegle
+    const auto merged = Parallel::map(jobs, [](const Job& job) {
+        QVector<MeasurementChange> changes;
+        const QJsonArray values = mergeValues(job.existing, job.newValues, &changes);
+        return qMakePair(values, int(changes.size()));
+        });
+
+    const QString now = QDateTime::currentDateTime().toString(Qt::ISODate);
+    int changed = 0;
+    for (int i = 0; i < jobs.size(); ++i) {
+        QJsonObject entry;
+        entry["id"] = jobs[i].sensorId;
+        entry["values"] = merged[i].first;
+        entry["lastUpdated"] = now;
+        changed += merged[i].second;
+
+        const int position = positions.value(jobs[i].sensorId, -1);
+        if (position != -1)
+            allMeasurements[position] = entry;
+        else
+            allMeasurements.append(entry);
+    }
+
+    if (changedCount)
+        *changedCount = changed;
+    return saveMeasurements(allMeasurements);
+}
+
+QJsonArray DataRepository::mergeValues(const QJsonArray& existing, const QJsonArray& newValues,
+    QVector<MeasurementChange>* changes)
+{
+    // Scalanie według daty - klucz "yyyy-MM-dd HH:mm:ss" sortuje się chronologicznie
+    QMap<QString, QJsonValue> byDate;
+    for (const QJsonValue& val : existing) {
+        const QJsonObject obj = val.toObject();
+        byDate.insert(obj.value("date").toString(), obj.value("value"));
+    }
+
+    for (const QJsonValue& val : newValues) {
+        const QJsonObject obj = val.toObject();
+        const QString date = obj.value("date").toString();
+        const QJsonValue value = obj.value("value");
+        const QJsonValue previous = byDate.value(date, QJsonValue(QJsonValue::Null));
+
+        if (value.isNull() || value.isUndefined()) {
+            if (!byDate.contains(date))
+                byDate.insert(date, QJsonValue(QJsonValue::Null));
+            continue;
+        }
+        if (!previous.isNull() && previous.toDouble() == value.toDouble())
+            continue;
+
+        if (changes) {
+            MeasurementChange change;
+            change.ms = QDateTime::fromString(date, "yyyy-MM-dd HH:mm:ss").toMSecsSinceEpoch();
+            change.oldValue = previous.isNull() ? std::nan("") : previous.toDouble();
+            change.newValue = value.toDouble();
+            changes->append(change);
+        }
+        byDate.insert(date, value);
+    }
+
+    QJsonArray merged;
+    for (auto it = byDate.constEnd(); it != byDate.constBegin();) {
+        --it;
+        QJsonObject obj;
+        obj["date"] = it.key();
+        obj["value"] = it.value();
+        merged.append(obj);
+    }
+    return merged;
+}
+
+bool DataRepository::backup(const QString& fileName)
+{
+    QFile file(filePath(fileName));
+    if (!file.exists())
+        return true;    // Nic do kopiowania
+
+    QDir backups(filePath("backups"));
+    if (!backups.exists())
+        backups.mkpath(".");
+
+    // Nazwa kopii z czasem jej utworzenia
+    const QString timestamp = QDateTime::currentDateTime().toString("yyyyMMdd_HHmmss");
+    const QString backupName = QString("backups/%1_%2").arg(timestamp, fileName);
+
+    if (!file.copy(filePath(backupName))) {
+        lastError = QString("Nie udało się utworzyć kopii pliku %1: %2").arg(fileName, file.errorString());
+        qDebug() << lastError;
+        return false;
+    }
+
+    qDebug() << "Kopia utworzona:" << backupName;
+    return true;
+}
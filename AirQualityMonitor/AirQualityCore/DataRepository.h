@@ -0,0 +1,163 @@
+﻿/**
+ * @file DataRepository.h
+ * @brief Lokalne pliki danych stacji, sensorów i pomiarów.
+ *
+ * Dane przechowywane są w trzech plikach JSON w katalogu danych:
+ * stations.json (tablica stacji z API), sensors.json (sensory wszystkich
+ * stacji z dopisanym stationId) i measurements.json (historia pomiarów
+ * każdego sensora: {"id", "values", "lastUpdated"}). Klasa nie korzysta
+ * z interfejsu graficznego; błędy zapisu zwracane są jako false, a ich
+ * opis dostępny przez errorString().
+ *
+ * @author Jakub Frąckowiak
+ * @date Maj 2025
+ */
+
+#pragma once
+
+#include "Rollups.h"
+#include <QDateTime>
+#include <QHash>
+#include <QJsonArray>
+#include <QString>
+#include <QVector>
+
+/**
+ * @class DataRepository
+ * @brief Odczyt i zapis plików danych aplikacji.
+ */
+class DataRepository
+{
+public:
+    static constexpr const char* kStationsFile = "stations.json";          ///< Plik stacji
+    static constexpr const char* kSensorsFile = "sensors.json";            ///< Plik sensorów
+    static constexpr const char* kMeasurementsFile = "measurements.json";  ///< Plik pomiarów
+
+    /**
+     * @brief Tworzy repozytorium w katalogu danych.
+     * @param directory Katalog plików; domyślnie bieżący katalog roboczy.
+     */
+    explicit DataRepository(const QString& directory = QString());
+
+    /**
+     * @brief Zwraca katalog danych.
+     */
+    QString directory() const { return dir; }
+
+    /**
+     * @brief Zwraca pełną ścieżkę pliku w katalogu danych.
+     */
+    QString filePath(const QString& fileName) const;
+
+    /**
+     * @brief Zwraca opis ostatniego błędu zapisu.
+     */
+    QString errorString() const { return lastError; }
+
+    // ===== STACJE =====
+
+    /**
+     * @brief Sprawdza, czy plik stacji istnieje.
+     */
+    bool hasStations() const;
+
+    /**
+     * @brief Odczytuje stacje (pusta tablica, gdy brak pliku lub błąd).
+     */
+    QJsonArray loadStations() const;
+
+    /**
+     * @brief Zapisuje stacje.
+     */
+    bool saveStations(const QJsonArray& stations);
+
+    // ===== SENSORY =====
+
+    /**
+     * @brief Odczytuje sensory wszystkich stacji.
+     */
+    QJsonArray loadSensors() const;
+
+    /**
+     * @brief Odczytuje sensory jednej stacji.
+     */
+    QJsonArray loadSensors(int stationId) const;
+
+    /**
+     * @brief Zapisuje sensory wszystkich stacji.
+     */
+    bool saveSensors(const QJsonArray& sensors);
+
+    /**
+     * @brief Zastępuje zapisane sensory stacji nowymi.
+     * @param stationSensors Sensory jednej stacji (z polem stationId).
+     */
+    bool replaceStationSensors(const QJsonArray& stationSensors);
+
+    // ===== POMIARY =====
+
+    /**
+     * @brief Odczytuje historię pomiarów wszystkich sensorów.
+     */
+    QJsonArray loadMeasurements() const;
+
+    /**
+     * @brief Odczytuje historię pomiarów sensora (od najnowszych).
+     * @param lastUpdated Opcjonalnie czas ostatniej aktualizacji zapisu.
+     */
+    QJsonArray loadMeasurements(int sensorId, QDateTime* lastUpdated = nullptr) const;
+
+    /**
+     * @brief Zapisuje historię pomiarów wszystkich sensorów.
+     */
+    bool saveMeasurements(const QJsonArray& measurements);
+
+    /**
+     * @brief Scala nowe pomiary sensora z zapisaną historią i zapisuje plik.
+     * @param sensorId ID sensora.
+     * @param newValues Pomiary z API ({"date", "value"}).
+     * @param changes Opcjonalnie dodane i zmienione pomiary.
+     * @param saved Opcjonalnie informacja, czy plik został zapisany.
+     * @return Pełna historia sensora po scaleniu (od najnowszych).
+     */
+    QJsonArray mergeMeasurements(int sensorId, const QJsonArray& newValues,
+        QVector<MeasurementChange>* changes = nullptr, bool* saved = nullptr);
+
+    /**
+     * @brief Scala nowe pomiary wielu sensorów i zapisuje plik jeden raz.
+     *
+     * Historie sensorów scalane są równolegle, a plik pomiarów odczytywany
+     * i zapisywany jest raz dla całej partii zamiast raz na sensor.
+     *
+     * @param newValues Pomiary z API według ID sensora.
+     * @param changedCount Opcjonalnie liczba dodanych i zmienionych pomiarów.
+     * @return True, jeśli plik został zapisany.
+     */
+    bool mergeMeasurements(const QHash<int, QJsonArray>& newValues, int* changedCount = nullptr);
+
+    /**
+     * @brief Scala pomiary według daty.
+     *
+     * Nowe godziny są dopisywane, a wartości zmienione przez API nadpisywane.
+     * Wartość null nie nadpisuje wcześniej zapisanego pomiaru.
+     *
+     * @param existing Zapisana historia.
+     * @param newValues Nowe pomiary.
+     * @param changes Opcjonalnie dodane i zmienione pomiary.
+     * @return Scalona historia (od najnowszych).
+     */
+    static QJsonArray mergeValues(const QJsonArray& existing, const QJsonArray& newValues,
+        QVector<MeasurementChange>* changes = nullptr);
+
+    /**
+     * @brief Tworzy kopię pliku danych w podkatalogu backups.
+     */
+    bool backup(const QString& fileName);
+
+private:
+    QJsonArray readArray(const QString& fileName) const;
+    bool writeArray(const QString& fileName, const QJsonArray& array);
+
+    QString dir;            ///< Katalog danych
+    QString lastError;      ///< Opis ostatniego błędu zapisu
+};
@@ -0,0 +1,148 @@
+﻿/**
+ * @file Downsampling.cpp
+ * @brief Implementacja redukcji punktów i piramidy poziomów.
+ */
+
+#include "Downsampling.h"
+#include <algorithm>
+#include <cmath>
+
+QVector<QPointF> Downsampling::lttb(const QPointF* points, int count, int threshold)
+{
+    QVector<QPointF> result;
+    if (threshold >= count || threshold < 3) {
+        result.reserve(count);
+        for (int i = 0; i < count; ++i)
+            result.append(points[i]);
+        return result;
+    }
+
+    result.reserve(threshold);
+    // Pierwszy i ostatni punkt zostają, reszta dzielona jest na przedziały
+    const double every = double(count - 2) / (threshold - 2);
+    int a = 0;
+    result.append(points[0]);
+
+    for (int i = 0; i < threshold - 2; ++i) {
+        // Średnia następnego przedziału jako trzeci wierzchołek trójkąta
+        const int avgStart = int(std::floor((i + 1) * every)) + 1;
+        const int avgEnd = std::min(int(std::floor((i + 2) * every)) + 1, count);
+        double avgX = 0.0, avgY = 0.0;
+        for (int j = avgStart; j < avgEnd; ++j) {
+            avgX += points[j].x();
+            avgY += points[j].y();
+        }
+        const int avgCount = avgEnd - avgStart;
+        if (avgCount > 0) {
+            avgX /= avgCount;
+            avgY /= avgCount;
+        }
+        else {
+            avgX = points[count - 1].x();
+            avgY = points[count - 1].y();
+        }
+
+        const int rangeStart = int(std::floor(i * every)) + 1;
+        const int rangeEnd = int(std::floor((i + 1) * every)) + 1;
+        const double ax = points[a].x();
+        const double ay = points[a].y();
+
+        double maxArea = -1.0;
+        int next = rangeStart;
+        for (int j = rangeStart; j < rangeEnd; ++j) {
+            const double area = std::abs((ax - avgX) * (points[j].y() - ay) - (ax - points[j].x()) * (avgY - ay));
+            if (area > maxArea) {
+                maxArea = area;
+                next = j;
+            }
+        }
+
+        result.append(points[next]);
+        a = next;
+    }
+
+    result.append(points[count - 1]);
+    return result;
+}
+
+QVector<QPointF> Downsampling::minMax(const QPointF* points, int count, int threshold)
+{
+    QVector<QPointF> result;
+    const int buckets = threshold / 2;
+    if (threshold >= count || buckets < 1) {
+        result.reserve(count);
+        for (int i = 0; i < count; ++i)
+            result.append(points[i]);
+        return result;
+    }
+
+    result.reserve(buckets * 2);
+    const double every = double(count) / buckets;
+    for (int b = 0; b < buckets; ++b) {
+        const int start = int(std::floor(b * every));
+        const int end = std::min(int(std::floor((b + 1) * every)), count);
+        if (start >= end)
+            continue;
+
+        int minIndex = start, maxIndex = start;
+        for (int j = start + 1; j < end; ++j) {
+            if (points[j].y() < points[minIndex].y())
+                minIndex = j;
+            if (points[j].y() > points[maxIndex].y())
+                maxIndex = j;
+        }
+
+        // Kolejność według osi X, aby linia nie cofała się w czasie
+        result.append(points[std::min(minIndex, maxIndex)]);
+        if (minIndex != maxIndex)
+            result.append(points[std::max(minIndex, maxIndex)]);
+    }
+    return result;
+}
+
+QVector<QPointF> Downsampling::reduce(const QPointF* points, int count, int threshold, DownsampleMode mode)
+{
+    return mode == DownsampleMode::MinMax
+        ? minMax(points, count, threshold)
+        : lttb(points, count, threshold);
+}
+
+void DownsamplePyramid::build(const QVector<QPointF>& points, DownsampleMode downsampleMode)
+{
+    mode = downsampleMode;
+    levels.clear();
+    levels.append(points);
+
+    while (levels.last().size() > kMinLevelSize) {
+        const QVector<QPointF>& previous = levels.last();
+        levels.append(Downsampling::reduce(previous.constData(), previous.size(), previous.size() / 2, mode));
+    }
+}
+
+void DownsamplePyramid::restore(const QVector<QVector<QPointF>>& savedLevels, DownsampleMode downsampleMode)
+{
+    mode = downsampleMode;
+    levels = savedLevels;
+}
+
+QVector<QPointF> DownsamplePyramid::query(double fromX, double toX, int targetPoints) const
+{
+    auto lessX = [](const QPointF& p, double x) { return p.x() < x; };
+    auto greaterX = [](double x, const QPointF& p) { return x < p.x(); };
+
+    // Od najgrubszego poziomu - pierwszy, który ma dość punktów w zakresie
+    for (int level = levels.size() - 1; level >= 0; --level) {
+        const QVector<QPointF>& points = levels[level];
+        const auto begin = std::lower_bound(points.cbegin(), points.cend(), fromX, lessX);
+        const auto end = std::upper_bound(begin, points.cend(), toX, greaterX);
+        const int count = int(end - begin);
+
+        if (count < targetPoints && level > 0)
+            continue;
+        if (count == 0)
+            break;
+
+        return Downsampling::reduce(&*begin, count, targetPoints, mode);
+    }
+    return QVector<QPointF>();
+}
@@ -0,0 +1,112 @@
+﻿/**
+ * @file Downsampling.h
+ * @brief Redukcja liczby punktów serii przed narysowaniem wykresu.
+ *
+ * Wieloletnia historia godzinowa to dziesiątki tysięcy punktów, a wykres
+ * ma szerokość kilkuset pikseli. Moduł udostępnia algorytm LTTB
+ * (Largest-Triangle-Three-Buckets) oraz wariant zachowujący minimum
+ * i maksimum każdego przedziału, a także piramidę wstępnie zredukowanych
+ * poziomów, z której zapytanie o dowolny zakres czyta tylko tyle punktów,
+ * ile potrzeba do jego narysowania.
+ *
+ * @author Jakub Frąckowiak
+ * @date Maj 2025
+ */
+
+#pragma once
+
+#include <QPointF>
+#include <QVector>
+
+/**
+ * @brief Sposób redukcji punktów.
+ */
+enum class DownsampleMode
+{
+    Lttb,       ///< Zachowuje kształt przebiegu (największe trójkąty)
+    MinMax      ///< Zachowuje minimum i maksimum każdego przedziału (piki)
+};
+
+/**
+ * @class Downsampling
+ * @brief Algorytmy redukcji punktów uporządkowanych rosnąco według osi X.
+ */
+class Downsampling
+{
+public:
+    /**
+     * @brief Redukuje punkty algorytmem LTTB.
+     * @param points Wskaźnik na pierwszy punkt.
+     * @param count Liczba punktów.
+     * @param threshold Docelowa liczba punktów (co najmniej 3).
+     * @return Zredukowane punkty; pierwszy i ostatni punkt są zachowane.
+     */
+    static QVector<QPointF> lttb(const QPointF* points, int count, int threshold);
+
+    /**
+     * @brief Redukuje punkty, zachowując minimum i maksimum każdego przedziału.
+     * @param points Wskaźnik na pierwszy punkt.
+     * @param count Liczba punktów.
+     * @param threshold Docelowa liczba punktów (dwa na przedział).
+     * @return Zredukowane punkty w kolejności osi X.
+     */
+    static QVector<QPointF> minMax(const QPointF* points, int count, int threshold);
+
+    /**
+     * @brief Redukuje punkty wybraną metodą.
+     */
+    static QVector<QPointF> reduce(const QPointF* points, int count, int threshold, DownsampleMode mode);
+};
+
+/**
+ * @class DownsamplePyramid
+ * @brief Wielopoziomowa reprezentacja serii do szybkiego powiększania i przesuwania.
+ *
+ * Poziom 0 to punkty oryginalne, każdy kolejny ma o połowę mniej punktów.
+ * Zapytanie wybiera najgrubszy poziom, który w zadanym zakresie ma
+ * jeszcze co najmniej docelową liczbę punktów, i redukuje tylko ten wycinek.
+ */
+class DownsamplePyramid
+{
+public:
+    /**
+     * @brief Buduje piramidę dla serii.
+     * @param points Punkty uporządkowane rosnąco według osi X.
+     * @param mode Metoda redukcji używana na wszystkich poziomach.
+     */
+    void build(const QVector<QPointF>& points, DownsampleMode mode);
+
+    /**
+     * @brief Zwraca punkty z zakresu zredukowane do docelowej liczby.
+     * @param fromX Początek zakresu osi X.
+     * @param toX Koniec zakresu osi X.
+     * @param targetPoints Docelowa liczba punktów (np. dwukrotność szerokości wykresu).
+     */
+    QVector<QPointF> query(double fromX, double toX, int targetPoints) const;
+
+    /**
+     * @brief Zwraca liczbę punktów oryginalnej serii.
+     */
+    int size() const { return levels.isEmpty() ? 0 : levels.first().size(); }
+
+    /**
+     * @brief Zwraca metodę redukcji (do zapisu piramidy).
+     */
+    DownsampleMode reductionMode() const { return mode; }
+
+    /**
+     * @brief Zwraca poziomy piramidy od najdokładniejszego (do zapisu piramidy).
+     */
+    const QVector<QVector<QPointF>>& levelPoints() const { return levels; }
+
+    /**
+     * @brief Odtwarza piramidę z zapisanych poziomów bez ponownej redukcji.
+     */
+    void restore(const QVector<QVector<QPointF>>& savedLevels, DownsampleMode downsampleMode);
+
+private:
+    static constexpr int kMinLevelSize = 256;   ///< Poniżej tej liczby punktów nie tworzy się kolejnych poziomów
+
+    DownsampleMode mode = DownsampleMode::Lttb; ///< Metoda redukcji
+    QVector<QVector<QPointF>> levels;           ///< Poziomy od najdokładniejszego
+};
@@ -0,0 +1,167 @@
+﻿/**
+ * @file Forecast.cpp
+ * @brief Implementacja prognoz Holta-Wintersa.
+ */
+
+#include "Forecast.h"
+#include "Parallel.h"
+#include <QDateTime>
+#include <QMutexLocker>
+#include <algorithm>
+#include <cmath>
+
+void HoltWintersModel::step(qint64 ms, int hour, double value)
+{
+    if (!initialized) {
+        // Rozgrzewka: dwa pełne sezony potrzebne do oszacowania trendu i sezonowości
+        if (std::isnan(value)) {
+            warmup.clear();
+            return;
+        }
+
+        if (warmup.isEmpty())
+            lastHour = hour;
+        warmup.append(value);
+        lastMs = ms;
+        if (warmup.size() < 2 * kSeason)
+            return;
+
+        double first = 0.0, second = 0.0;
+        for (int i = 0; i < kSeason; ++i) {
+            first += warmup[i];
+            second += warmup[kSeason + i];
+        }
+        first /= kSeason;
+        second /= kSeason;
+
+        const int firstHour = lastHour;
+        for (int i = 0; i < kSeason; ++i) {
+            const int h = (firstHour + i) % kSeason;
+            season[h] = ((warmup[i] - first) + (warmup[kSeason + i] - second)) / 2.0;
+        }
+        trend = (second - first) / kSeason;
+        level = second + trend * (kSeason - 1) / 2.0;
+        lastHour = hour;
+        initialized = true;
+        warmup.clear();
+        warmup.squeeze();
+        return;
+    }
+
+    const double previousLevel = level;
+    if (std::isnan(value)) {
+        // Brak pomiaru - model przesuwa się zgodnie z własną prognozą
+        level = previousLevel + trend;
+    }
+    else {
+        level = alpha * (value - season[hour]) + (1.0 - alpha) * (previousLevel + trend);
+        trend = beta * (level - previousLevel) + (1.0 - beta) * trend;
+        season[hour] = gamma * (value - level) + (1.0 - gamma) * season[hour];
+    }
+
+    lastMs = ms;
+    lastHour = hour;
+}
+
+double HoltWintersModel::predict(int h) const
+{
+    const int hour = (lastHour + h) % kSeason;
+    return std::max(0.0, level + h * trend + season[hour]);
+}
+
+void ForecastEngine::fit(HoltWintersModel& model, const MeasurementSeries& series)
+{
+    if (series.size() == 0)
+        return;
+
+    // Tylko godziny, których model jeszcze nie widział
+    int first = 0;
+    if (model.lastMs > 0)
+        first = std::max(0, series.indexOf(model.lastMs) + 1);
+
+    if (first >= series.size())
+        return;
+
+    // Godziny pomiędzy końcem poprzedniej serii a początkiem nowej traktujemy jako braki
+    if (model.lastMs > 0) {
+        int hour = model.lastHour;
+        for (qint64 ms = model.lastMs + MeasurementSeries::kHourMs; ms < series.timeAt(first); ms += MeasurementSeries::kHourMs) {
+            hour = (hour + 1) % HoltWintersModel::kSeason;
+            model.step(ms, hour, std::nan(""));
+        }
+    }
+
+    int hour = QDateTime::fromMSecsSinceEpoch(series.timeAt(first)).time().hour();
+    for (int i = first; i < series.size(); ++i) {
+        model.step(series.timeAt(i), hour, series.hasValue(i) ? series.values[i] : std::nan(""));
+        hour = (hour + 1) % HoltWintersModel::kSeason;
+    }
+}
+
+QVector<QPointF> ForecastEngine::project(const HoltWintersModel& model)
+{
+    QVector<QPointF> points;
+    if (!model.initialized)
+        return points;
+
+    points.reserve(kHorizonHours);
+    for (int h = 1; h <= kHorizonHours; ++h)
+        points.append(QPointF(double(model.lastMs + h * MeasurementSeries::kHourMs), model.predict(h)));
+    return points;
+}
+
+void ForecastEngine::ingest(int sensorId, const MeasurementSeries& series)
+{
+    HoltWintersModel model;
+    {
+        QMutexLocker locker(&mutex);
+        model = models.value(sensorId);
+    }
+
+    fit(model, series);
+    QVector<QPointF> points = project(model);
+
+    QMutexLocker locker(&mutex);
+    store(sensorId, std::move(model), std::move(points));
+}
+
+void ForecastEngine::ingestAll(const QVector<QPair<int, MeasurementSeries>>& batch)
+{
+    // Kopie modeli dopasowywane bez blokady - odczyt prognoz w tym czasie nie czeka
+    QVector<HoltWintersModel> fitted(batch.size());
+    {
+        QMutexLocker locker(&mutex);
+        for (int i = 0; i < batch.size(); ++i)
+            fitted[i] = models.value(batch[i].first);
+    }
+
+    QVector<QVector<QPointF>> points(batch.size());
+    HoltWintersModel* modelData = fitted.data();
+    QVector<QPointF>* pointData = points.data();
+    Parallel::forEach(int(batch.size()), [&batch, modelData, pointData](int i) {
+        fit(modelData[i], batch[i].second);
+        pointData[i] = project(modelData[i]);
+        });
+
+    QMutexLocker locker(&mutex);
+    for (int i = 0; i < batch.size(); ++i)
+        store(batch[i].first, std::move(fitted[i]), std::move(points[i]));
+}
+
+void ForecastEngine::store(int sensorId, HoltWintersModel&& model, QVector<QPointF>&& points)
+{
+    // Równoległe dopasowanie tego samego sensora - zostaje model, który widział więcej godzin
+    const auto current = models.constFind(sensorId);
+    if (current != models.constEnd() && current->lastMs > model.lastMs)
+        return;
+
+    models.insert(sensorId, std::move(model));
+    forecasts.insert(sensorId, std::move(points));
+}
+
+QVector<QPointF> ForecastEngine::forecast(int sensorId) const
+{
+    // Blokada trzymana jest tylko przy kopiowaniu i podmianie modeli, nigdy w trakcie dopasowania
+    QMutexLocker locker(&mutex);
+    return forecasts.value(sensorId);
+}
@@ -0,0 +1,105 @@
+﻿/**
+ * @file Forecast.h
+ * @brief Krótkoterminowa prognoza stężeń metodą Holta-Wintersa.
+ *
+ * Dla każdego sensora utrzymywany jest lekki model sezonowy (sezon dobowy,
+ * 24 godziny) aktualizowany przyrostowo - każda nowa godzina kosztuje O(1).
+ * Modele wielu sensorów dopasowywane są równolegle, a prognozy na kolejne
+ * 24 godziny przechowywane w pamięci podręcznej.
+ *
+ * @author Jakub Frąckowiak
+ * @date Maj 2025
+ */
+
+#pragma once
+
+#include "GapAnalysis.h"
+#include <QHash>
+#include <QMutex>
+#include <QPair>
+#include <QPointF>
+#include <QVector>
+#include <array>
+
+/**
+ * @brief Addytywny model Holta-Wintersa z sezonem dobowym.
+ */
+struct HoltWintersModel
+{
+    static constexpr int kSeason = 24;  ///< Długość sezonu w godzinach
+
+    double alpha = 0.3;     ///< Współczynnik wygładzania poziomu
+    double beta = 0.01;     ///< Współczynnik wygładzania trendu
+    double gamma = 0.2;     ///< Współczynnik wygładzania sezonowości
+
+    double level = 0.0;                     ///< Aktualny poziom
+    double trend = 0.0;                     ///< Aktualny trend (na godzinę)
+    std::array<double, kSeason> season{};   ///< Składowe sezonowe dla godzin doby
+    qint64 lastMs = 0;                      ///< Czas ostatniej przetworzonej godziny
+    int lastHour = 0;                       ///< Godzina doby ostatniego kroku
+    bool initialized = false;               ///< Czy model przeszedł rozgrzewkę
+    QVector<double> warmup;                 ///< Wartości zbierane przed inicjalizacją
+
+    /**
+     * @brief Przetwarza kolejną godzinę serii.
+     * @param ms Czas godziny (ms od epoki).
+     * @param hour Godzina doby (0-23).
+     * @param value Wartość lub NaN, gdy brak pomiaru.
+     */
+    void step(qint64 ms, int hour, double value);
+
+    /**
+     * @brief Zwraca prognozę na h godzin naprzód od ostatniego kroku.
+     */
+    double predict(int h) const;
+};
+
+/**
+ * @class ForecastEngine
+ * @brief Zarządza modelami prognoz wszystkich sensorów.
+ *
+ * Metody są bezpieczne wątkowo. Dopasowanie odbywa się na kopiach modeli
+ * poza blokadą (wiele sensorów równolegle), a wyniki podmieniane są pod
+ * krótką blokadą, więc forecast() wywołane z wątku interfejsu nie czeka
+ * na trwające dopasowanie.
+ */
+class ForecastEngine
+{
+public:
+    static constexpr int kHorizonHours = 24;    ///< Horyzont prognozy w godzinach
+
+    /**
+     * @brief Aktualizuje model sensora nowymi godzinami serii.
+     * @param sensorId ID sensora.
+     * @param series Seria godzinowa; przetwarzane są tylko godziny nowsze niż poprzednio.
+     */
+    void ingest(int sensorId, const MeasurementSeries& series);
+
+    /**
+     * @brief Aktualizuje modele wielu sensorów równolegle.
+     * @param batch Pary (ID sensora, seria godzinowa).
+     */
+    void ingestAll(const QVector<QPair<int, MeasurementSeries>>& batch);
+
+    /**
+     * @brief Zwraca zapamiętaną prognozę sensora (bez czekania na dopasowanie).
+     * @param sensorId ID sensora.
+     * @return Punkty (ms od epoki, wartość) lub pusta lista, gdy model nie jest gotowy.
+     */
+    QVector<QPointF> forecast(int sensorId) const;
+
+private:
+    static void fit(HoltWintersModel& model, const MeasurementSeries& series);
+    static QVector<QPointF> project(const HoltWintersModel& model);
+
+    /**
+     * @brief Zapisuje dopasowany model i jego prognozę (wywoływana pod blokadą).
+     *
+     * Model starszy niż zapisany (dopasowany równolegle do krótszej serii) jest odrzucany.
+     */
+    void store(int sensorId, HoltWintersModel&& model, QVector<QPointF>&& points);
+
+    mutable QMutex mutex;                       ///< Chroni mapy modeli i prognoz (tylko na czas kopii i podmiany)
+    QHash<int, HoltWintersModel> models;        ///< Modele według ID sensora
+    QHash<int, QVector<QPointF>> forecasts;     ///< Prognozy według ID sensora
+};
@@ -0,0 +1,227 @@
+﻿/**
+ * @file GapAnalysis.cpp
+ * @brief Implementacja wykrywania i uzupełniania przerw w seriach pomiarowych.
+ */
+
+#include "GapAnalysis.h"
+#include <QDateTime>
+#include <QJsonObject>
+#include <QTime>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+    constexpr int kHoursPerDay = 24;
+
+    /**
+     * @brief Parsuje datę w formacie API ("yyyy-MM-dd HH:mm:ss") lub ISO.
+     */
+    QDateTime parseApiDate(const QString& text)
+    {
+        QDateTime dt = QDateTime::fromString(text, "yyyy-MM-dd HH:mm:ss");
+        if (!dt.isValid())
+            dt = QDateTime::fromString(text, Qt::ISODate);
+        return dt;
+    }
+}
+
+MeasurementSeries GapAnalysis::fromJson(const QJsonArray& values)
+{
+    MeasurementSeries series;
+
+    // Zbierz pary (czas, wartość); null zapisujemy jako NaN
+    QVector<QPair<qint64, double>> points;
+    points.reserve(values.size());
+    for (const QJsonValue& val : values) {
+        QJsonObject obj = val.toObject();
+        QDateTime dt = parseApiDate(obj.value("date").toString());
+        if (!dt.isValid())
+            continue;
+
+        QJsonValue value = obj.value("value");
+        double v = value.isNull() || value.isUndefined()
+            ? std::numeric_limits<double>::quiet_NaN()
+            : value.toDouble();
+        points.append(qMakePair(dt.toMSecsSinceEpoch(), v));
+    }
+
+    if (points.isEmpty())
+        return series;
+
+    std::sort(points.begin(), points.end(),
+        [](const QPair<qint64, double>& a, const QPair<qint64, double>& b) { return a.first < b.first; });
+
+    series.startMs = points.first().first;
+    const int count = series.indexOf(points.last().first) + 1;
+
+    series.values.fill(std::numeric_limits<double>::quiet_NaN(), count);
+    series.origin.fill(PointOrigin::Missing, count);
+    series.validity.resize(count);
+
+    for (const auto& point : points) {
+        const int i = series.indexOf(point.first);
+        // Duplikaty godzin (np. zmiana czasu) - zachowujemy wartość zmierzoną
+        if (std::isnan(point.second) || series.validity.testBit(i))
+            continue;
+
+        series.values[i] = point.second;
+        series.origin[i] = PointOrigin::Measured;
+        series.validity.setBit(i);
+        ++series.measuredCount;
+    }
+
+    return series;
+}
+
+QVector<GapInterval> GapAnalysis::findGaps(const MeasurementSeries& series)
+{
+    QVector<GapInterval> gaps;
+    const int n = series.size();
+
+    int i = 0;
+    while (i < n) {
+        if (series.validity.testBit(i)) {
+            ++i;
+            continue;
+        }
+
+        int j = i;
+        bool filled = true;
+        while (j < n && !series.validity.testBit(j)) {
+            filled = filled && series.hasValue(j);
+            ++j;
+        }
+
+        GapInterval gap;
+        gap.startMs = series.timeAt(i);
+        gap.endMs = series.timeAt(j - 1);
+        gap.missingHours = j - i;
+        gap.filled = filled;
+        gaps.append(gap);
+
+        i = j;
+    }
+
+    return gaps;
+}
+
+QVector<int> GapAnalysis::hoursOfDay(const MeasurementSeries& series)
+{
+    QVector<int> hours(series.size());
+    for (int i = 0; i < series.size(); ++i)
+        hours[i] = QDateTime::fromMSecsSinceEpoch(series.timeAt(i)).time().hour();
+    return hours;
+}
+
+QVector<double> GapAnalysis::dailyProfile(const MeasurementSeries& series, const QVector<int>& hourOfDay)
+{
+    // Odchylenie średniej dla danej godziny doby od średniej całkowitej
+    QVector<double> sums(kHoursPerDay, 0.0);
+    QVector<int> counts(kHoursPerDay, 0);
+    double total = 0.0;
+
+    for (int i = 0; i < series.size(); ++i) {
+        if (!series.validity.testBit(i))
+            continue;
+        sums[hourOfDay[i]] += series.values[i];
+        counts[hourOfDay[i]] += 1;
+        total += series.values[i];
+    }
+
+    QVector<double> profile(kHoursPerDay, 0.0);
+    if (series.measuredCount == 0)
+        return profile;
+
+    const double mean = total / series.measuredCount;
+    for (int h = 0; h < kHoursPerDay; ++h) {
+        if (counts[h] > 0)
+            profile[h] = sums[h] / counts[h] - mean;
+    }
+    return profile;
+}
+
+void GapAnalysis::fillGaps(MeasurementSeries& series, FillMethod method, int maxGapHours)
+{
+    const int n = series.size();
+
+    // Poprzednie uzupełnienia nie są pomiarami - liczone są od nowa
+    for (int i = 0; i < n; ++i) {
+        if (!series.validity.testBit(i)) {
+            series.values[i] = std::numeric_limits<double>::quiet_NaN();
+            series.origin[i] = PointOrigin::Missing;
+        }
+    }
+    series.filledCount = 0;
+
+    if (method == FillMethod::None || n < 3 || maxGapHours <= 0)
+        return;
+
+    // Dwa przebiegi po bitmapie: najbliższy pomiar z lewej i z prawej
+    QVector<int> prev(n), next(n);
+    int last = -1;
+    for (int i = 0; i < n; ++i) {
+        if (series.validity.testBit(i))
+            last = i;
+        prev[i] = last;
+    }
+    last = -1;
+    for (int i = n - 1; i >= 0; --i) {
+        if (series.validity.testBit(i))
+            last = i;
+        next[i] = last;
+    }
+
+    QVector<double> profile;
+    QVector<int> hourOfDay;
+    const bool seasonal = method == FillMethod::Seasonal;
+    if (seasonal) {
+        // Ta sama godzina zegarowa przy budowie profilu i przy uzupełnianiu
+        hourOfDay = hoursOfDay(series);
+        profile = dailyProfile(series, hourOfDay);
+    }
+
+    const PointOrigin filledOrigin = seasonal ? PointOrigin::FilledSeasonal : PointOrigin::FilledLinear;
+    const double* v = series.values.constData();
+
+    // Jeden przebieg: każdy brakujący punkt liczony niezależnie od pozostałych
+    for (int i = 0; i < n; ++i) {
+        const int a = prev[i];
+        const int b = next[i];
+        if (a < 0 || b < 0 || a == i || b - a - 1 > maxGapHours)
+            continue;
+
+        const double t = double(i - a) / double(b - a);
+        double value = v[a] + (v[b] - v[a]) * t;
+        if (seasonal) {
+            const double edge = profile[hourOfDay[a]] + (profile[hourOfDay[b]] - profile[hourOfDay[a]]) * t;
+            value += profile[hourOfDay[i]] - edge;
+        }
+
+        series.values[i] = std::max(0.0, value);
+        series.origin[i] = filledOrigin;
+        ++series.filledCount;
+    }
+}
+
+QVector<QPair<int, int>> GapAnalysis::segments(const MeasurementSeries& series)
+{
+    QVector<QPair<int, int>> result;
+    const int n = series.size();
+
+    int i = 0;
+    while (i < n) {
+        if (!series.hasValue(i)) {
+            ++i;
+            continue;
+        }
+        int j = i;
+        while (j + 1 < n && series.hasValue(j + 1))
+            ++j;
+        result.append(qMakePair(i, j));
+        i = j + 1;
+    }
+
+    return result;
+}
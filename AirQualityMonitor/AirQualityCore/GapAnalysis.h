@@ -0,0 +1,142 @@
+﻿/**
+ * @file GapAnalysis.h
+ * @brief Wykrywanie przerw w seriach pomiarowych i ich uzupełnianie.
+ *
+ * API GIOŚ zwraca wiele godzin z wartością null. Moduł rozkłada surowe dane
+ * na regularną siatkę godzinową z mapą ważności (bitmapą), raportuje przerwy
+ * i opcjonalnie uzupełnia krótkie przerwy interpolacją liniową lub sezonową,
+ * zachowując informację o pochodzeniu każdego punktu.
+ *
+ * @author Jakub Frąckowiak
+ * @date Maj 2025
+ */
+
+#pragma once
+
+#include <QBitArray>
+#include <QJsonArray>
+#include <QPair>
+#include <QVector>
+
+/**
+ * @brief Pochodzenie punktu w serii pomiarowej.
+ */
+enum class PointOrigin : quint8
+{
+    Measured,       ///< Wartość zmierzona przez stację
+    Missing,        ///< Brak wartości (null lub brak godziny w danych)
+    FilledLinear,   ///< Wartość uzupełniona interpolacją liniową
+    FilledSeasonal  ///< Wartość uzupełniona interpolacją z profilem dobowym
+};
+
+/**
+ * @brief Metoda uzupełniania przerw.
+ */
+enum class FillMethod
+{
+    None,       ///< Bez uzupełniania
+    Linear,     ///< Interpolacja liniowa między krawędziami przerwy
+    Seasonal    ///< Interpolacja liniowa skorygowana o profil dobowy
+};
+
+/**
+ * @brief Przedział czasu bez danych pomiarowych.
+ */
+struct GapInterval
+{
+    qint64 startMs = 0;     ///< Pierwsza brakująca godzina (ms od epoki)
+    qint64 endMs = 0;       ///< Ostatnia brakująca godzina (ms od epoki)
+    int missingHours = 0;   ///< Liczba brakujących godzin
+    bool filled = false;    ///< Czy przerwa została uzupełniona
+};
+
+/**
+ * @brief Seria pomiarowa rozłożona na regularną siatkę godzinową.
+ *
+ * Wszystkie wektory mają tę samą długość; indeks i odpowiada godzinie
+ * startMs + i * kHourMs. Dla brakujących punktów values[i] jest NaN.
+ */
+struct MeasurementSeries
+{
+    static constexpr qint64 kHourMs = 3600 * 1000;  ///< Krok siatki w milisekundach
+
+    qint64 startMs = 0;             ///< Czas pierwszego punktu siatki
+    QVector<double> values;         ///< Wartości (NaN dla braków)
+    QBitArray validity;             ///< Bitmapa wartości zmierzonych
+    QVector<PointOrigin> origin;    ///< Pochodzenie każdego punktu
+    int measuredCount = 0;          ///< Liczba punktów zmierzonych
+    int filledCount = 0;            ///< Liczba punktów uzupełnionych
+
+    /**
+     * @brief Zwraca liczbę punktów siatki.
+     */
+    int size() const { return values.size(); }
+
+    /**
+     * @brief Zwraca czas punktu o podanym indeksie.
+     */
+    qint64 timeAt(int i) const { return startMs + i * kHourMs; }
+
+    /**
+     * @brief Sprawdza, czy punkt ma wartość (zmierzoną lub uzupełnioną).
+     */
+    bool hasValue(int i) const { return origin[i] != PointOrigin::Missing; }
+
+    /**
+     * @brief Zwraca indeks punktu dla podanego czasu (może wyjść poza zakres).
+     */
+    int indexOf(qint64 ms) const { return int((ms - startMs) / kHourMs); }
+};
+
+/**
+ * @class GapAnalysis
+ * @brief Zestaw funkcji analizy i uzupełniania przerw w pomiarach.
+ */
+class GapAnalysis
+{
+public:
+    /**
+     * @brief Buduje serię godzinową z tablicy JSON zwróconej przez API.
+     * @param values Tablica obiektów {"date", "value"} w dowolnej kolejności.
+     * @return Seria z bitmapą ważności; godziny nieobecne w danych są brakami.
+     */
+    static MeasurementSeries fromJson(const QJsonArray& values);
+
+    /**
+     * @brief Wyszukuje przerwy (ciągi brakujących godzin) w serii.
+     * @param series Seria pomiarowa.
+     * @return Lista przerw w kolejności chronologicznej.
+     */
+    static QVector<GapInterval> findGaps(const MeasurementSeries& series);
+
+    /**
+     * @brief Uzupełnia przerwy nie dłuższe niż maxGapHours.
+     * @param series Seria do uzupełnienia (modyfikowana w miejscu).
+     * @param method Metoda uzupełniania.
+     * @param maxGapHours Maksymalna długość przerwy, która zostanie uzupełniona.
+     *
+     * Wcześniejsze uzupełnienia są usuwane, więc wynik zależy tylko od pomiarów
+     * i argumentów - ponowne wywołanie niczego nie dubluje. Indeksy sąsiednich
+     * pomiarów wyznaczane są dwoma przebiegami po bitmapie, a każdy brakujący
+     * punkt liczony jest w jednym przebiegu niezależnie od pozostałych.
+     * Profil dobowy (Seasonal) indeksowany jest lokalną godziną zegarową
+     * punktów, także w dniach zmiany czasu. Przerwy na brzegach serii nie są
+     * uzupełniane.
+     */
+    static void fillGaps(MeasurementSeries& series, FillMethod method, int maxGapHours);
+
+    /**
+     * @brief Dzieli serię na ciągłe fragmenty z wartościami.
+     * @param series Seria pomiarowa.
+     * @return Pary [pierwszy, ostatni] indeksów kolejnych fragmentów.
+     */
+    static QVector<QPair<int, int>> segments(const MeasurementSeries& series);
+
+private:
+    /**
+     * @brief Zwraca lokalną godzinę zegarową (0-23) każdego punktu serii.
+     */
+    static QVector<int> hoursOfDay(const MeasurementSeries& series);
+
+    static QVector<double> dailyProfile(const MeasurementSeries& series, const QVector<int>& hourOfDay);
+};
@@ -0,0 +1,328 @@
+﻿/**
+ * @file GeoDistance.cpp
+ * @brief Implementacja zbiorczego obliczania odległości.
+ */
+
+#include "GeoDistance.h"
+#include "Parallel.h"
+#include <QtMath>
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define AQM_GEO_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    constexpr float kPi = 3.14159265358979323846f;          ///< Liczba pi
+    constexpr float kTwoPi = 2.0f * kPi;                    ///< 2 pi
+    constexpr float kHalfPi = 0.5f * kPi;                   ///< pi / 2
+    constexpr float kQuarterPi = 0.25f * kPi;               ///< pi / 4
+    constexpr float kTwoOverPi = 2.0f / kPi;                ///< Współczynnik dolnego ograniczenia sin(x) >= 2x / pi
+    constexpr float kDiameterKm = float(2.0 * GeoDistance::kEarthRadiusKm);  ///< Średnica Ziemi
+    constexpr int kParallelMinRows = 256;                   ///< Mniejsze macierze liczone są w bieżącym wątku
+
+    // Wielomiany minimaksowe (jak w bibliotece Cephes, pojedyncza precyzja):
+    // sin i cos na [-pi/4, pi/4], asin na [0, 1/2]
+    constexpr float kSin1 = -1.9515295891e-4f, kSin2 = 8.3321608736e-3f, kSin3 = -1.6666654611e-1f;
+    constexpr float kCos1 = 2.443315711809948e-5f, kCos2 = -1.388731625493765e-3f, kCos3 = 4.166664568298827e-2f;
+    constexpr float kAsin1 = 4.2163199048e-2f, kAsin2 = 2.4181311049e-2f, kAsin3 = 4.5470025998e-2f,
+        kAsin4 = 7.4953002686e-2f, kAsin5 = 1.6666752422e-1f;
+
+    /// Punkt początkowy w radianach
+    struct Origin
+    {
+        float lat;
+        float lon;
+        float cosLat;
+    };
+
+    Origin originOf(const GeoPoint& point)
+    {
+        const double lat = qDegreesToRadians(point.lat);
+        return { float(lat), float(qDegreesToRadians(point.lon)), float(std::cos(lat)) };
+    }
+
+    // ===== Wersja skalarna (końcówki tablic i procesory bez SSE2) =====
+
+    inline float wrapLon(float d)
+    {
+        if (d > kPi)
+            return d - kTwoPi;
+        if (d < -kPi)
+            return d + kTwoPi;
+        return d;
+    }
+
+    /// sin^2(x) dla |x| <= pi/2
+    inline float sinSquared(float x)
+    {
+        const float t = std::fabs(x);
+        float s;
+        if (t > kQuarterPi) {
+            const float r = kHalfPi - t;
+            const float z = r * r;
+            s = 1.0f - 0.5f * z + z * z * ((kCos1 * z + kCos2) * z + kCos3);
+        }
+        else {
+            const float z = t * t;
+            s = t + t * z * ((kSin1 * z + kSin2) * z + kSin3);
+        }
+        return s * s;
+    }
+
+    /// asin(sqrt(a)) dla a z [0, 1]
+    inline float asinSqrt(float a)
+    {
+        auto poly = [](float z) { return (((kAsin1 * z + kAsin2) * z + kAsin3) * z + kAsin4) * z + kAsin5; };
+        if (a > 0.25f) {
+            // asin(x) = pi/2 - 2 asin(sqrt((1 - x) / 2))
+            const float z = 0.5f * (1.0f - std::sqrt(a));
+            const float x = std::sqrt(z);
+            return kHalfPi - 2.0f * (x + x * z * poly(z));
+        }
+        const float x = std::sqrt(a);
+        return x + x * a * poly(a);
+    }
+
+    inline float pairKm(const Origin& o, float lat, float lon, float cosLat)
+    {
+        const float dLat = lat - o.lat;
+        const float dLon = wrapLon(lon - o.lon);
+        float a = sinSquared(0.5f * dLat) + o.cosLat * cosLat * sinSquared(0.5f * dLon);
+        a = std::min(std::max(a, 0.0f), 1.0f);
+        return kDiameterKm * asinSqrt(a);
+    }
+
+    /// Dolne ograniczenie kąta środkowego: max(|dLat|, 2/pi * sqrt(dLat^2 + cos1 cos2 dLon^2))
+    inline float lowerBoundAngle(const Origin& o, float lat, float lon, float cosLat)
+    {
+        const float dLat = lat - o.lat;
+        const float dLon = wrapLon(lon - o.lon);
+        const float flat = kTwoOverPi * std::sqrt(dLat * dLat + o.cosLat * cosLat * dLon * dLon);
+        return std::max(std::fabs(dLat), flat);
+    }
+
+#ifdef AQM_GEO_SSE2
+    // ===== Wersja SSE2 - cztery punkty naraz =====
+
+    inline __m128 select(__m128 mask, __m128 a, __m128 b)
+    {
+        return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+    }
+
+    inline __m128 abs4(__m128 x)
+    {
+        return _mm_andnot_ps(_mm_set1_ps(-0.0f), x);
+    }
+
+    inline __m128 wrapLon4(__m128 d)
+    {
+        const __m128 pi = _mm_set1_ps(kPi);
+        const __m128 twoPi = _mm_set1_ps(kTwoPi);
+        d = _mm_sub_ps(d, _mm_and_ps(_mm_cmpgt_ps(d, pi), twoPi));
+        d = _mm_add_ps(d, _mm_and_ps(_mm_cmplt_ps(d, _mm_sub_ps(_mm_setzero_ps(), pi)), twoPi));
+        return d;
+    }
+
+    inline __m128 sinSquared4(__m128 x)
+    {
+        const __m128 t = abs4(x);
+        const __m128 useCos = _mm_cmpgt_ps(t, _mm_set1_ps(kQuarterPi));
+        const __m128 r = select(useCos, _mm_sub_ps(_mm_set1_ps(kHalfPi), t), t);
+        const __m128 z = _mm_mul_ps(r, r);
+
+        __m128 sinPoly = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(kSin1), z), _mm_set1_ps(kSin2));
+        sinPoly = _mm_add_ps(_mm_mul_ps(sinPoly, z), _mm_set1_ps(kSin3));
+        const __m128 sinR = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(r, z), sinPoly));
+
+        __m128 cosPoly = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(kCos1), z), _mm_set1_ps(kCos2));
+        cosPoly = _mm_add_ps(_mm_mul_ps(cosPoly, z), _mm_set1_ps(kCos3));
+        const __m128 cosR = _mm_add_ps(_mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(_mm_set1_ps(0.5f), z)),
+            _mm_mul_ps(_mm_mul_ps(z, z), cosPoly));
+
+        const __m128 s = select(useCos, cosR, sinR);
+        return _mm_mul_ps(s, s);
+    }
+
+    inline __m128 asinPoly4(__m128 z)
+    {
+        __m128 p = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(kAsin1), z), _mm_set1_ps(kAsin2));
+        p = _mm_add_ps(_mm_mul_ps(p, z), _mm_set1_ps(kAsin3));
+        p = _mm_add_ps(_mm_mul_ps(p, z), _mm_set1_ps(kAsin4));
+        return _mm_add_ps(_mm_mul_ps(p, z), _mm_set1_ps(kAsin5));
+    }
+
+    inline __m128 asinSqrt4(__m128 a)
+    {
+        const __m128 large = _mm_cmpgt_ps(a, _mm_set1_ps(0.25f));
+        const __m128 root = _mm_sqrt_ps(a);
+        // Dla dużych argumentów asin(x) = pi/2 - 2 asin(sqrt((1 - x) / 2))
+        const __m128 z = select(large, _mm_mul_ps(_mm_set1_ps(0.5f), _mm_sub_ps(_mm_set1_ps(1.0f), root)), a);
+        const __m128 x = select(large, _mm_sqrt_ps(z), root);
+        const __m128 y = _mm_add_ps(x, _mm_mul_ps(_mm_mul_ps(x, z), asinPoly4(z)));
+        return select(large, _mm_sub_ps(_mm_set1_ps(kHalfPi), _mm_add_ps(y, y)), y);
+    }
+
+    inline __m128 pairKm4(const Origin& o, const float* lat, const float* lon, const float* cosLat)
+    {
+        const __m128 dLat = _mm_sub_ps(_mm_loadu_ps(lat), _mm_set1_ps(o.lat));
+        const __m128 dLon = wrapLon4(_mm_sub_ps(_mm_loadu_ps(lon), _mm_set1_ps(o.lon)));
+        const __m128 half = _mm_set1_ps(0.5f);
+        const __m128 cosProduct = _mm_mul_ps(_mm_set1_ps(o.cosLat), _mm_loadu_ps(cosLat));
+        __m128 a = _mm_add_ps(sinSquared4(_mm_mul_ps(half, dLat)), _mm_mul_ps(cosProduct, sinSquared4(_mm_mul_ps(half, dLon))));
+        a = _mm_min_ps(_mm_max_ps(a, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+        return _mm_mul_ps(_mm_set1_ps(kDiameterKm), asinSqrt4(a));
+    }
+
+    inline __m128 lowerBoundAngle4(const Origin& o, const float* lat, const float* lon, const float* cosLat)
+    {
+        const __m128 dLat = _mm_sub_ps(_mm_loadu_ps(lat), _mm_set1_ps(o.lat));
+        const __m128 dLon = wrapLon4(_mm_sub_ps(_mm_loadu_ps(lon), _mm_set1_ps(o.lon)));
+        const __m128 cosProduct = _mm_mul_ps(_mm_set1_ps(o.cosLat), _mm_loadu_ps(cosLat));
+        const __m128 squared = _mm_add_ps(_mm_mul_ps(dLat, dLat), _mm_mul_ps(cosProduct, _mm_mul_ps(dLon, dLon)));
+        const __m128 flat = _mm_mul_ps(_mm_set1_ps(kTwoOverPi), _mm_sqrt_ps(squared));
+        return _mm_max_ps(abs4(dLat), flat);
+    }
+#endif
+
+    void distanceRow(const Origin& o, const GeoCoordinates& coords, float* outKm)
+    {
+        const float* lat = coords.latRad.constData();
+        const float* lon = coords.lonRad.constData();
+        const float* cosLat = coords.cosLat.constData();
+        const int n = coords.size();
+        int i = 0;
+#ifdef AQM_GEO_SSE2
+        for (; i + 4 <= n; i += 4)
+            _mm_storeu_ps(outKm + i, pairKm4(o, lat + i, lon + i, cosLat + i));
+#endif
+        for (; i < n; ++i)
+            outKm[i] = pairKm(o, lat[i], lon[i], cosLat[i]);
+    }
+}
+
+void GeoCoordinates::append(const GeoPoint& point)
+{
+    const Origin origin = originOf(point);
+    latRad.append(origin.lat);
+    lonRad.append(origin.lon);
+    cosLat.append(origin.cosLat);
+}
+
+GeoCoordinates GeoCoordinates::fromPoints(const QVector<GeoPoint>& points)
+{
+    GeoCoordinates coords;
+    coords.latRad.reserve(points.size());
+    coords.lonRad.reserve(points.size());
+    coords.cosLat.reserve(points.size());
+    for (const GeoPoint& point : points)
+        coords.append(point);
+    return coords;
+}
+
+GeoCoordinates GeoCoordinates::fromStations(const QVector<StationRecord>& stations)
+{
+    GeoCoordinates coords;
+    coords.latRad.reserve(stations.size());
+    coords.lonRad.reserve(stations.size());
+    coords.cosLat.reserve(stations.size());
+    for (const StationRecord& station : stations)
+        coords.append({ station.lat, station.lon });
+    return coords;
+}
+
+double GeoDistance::haversineKm(const GeoPoint& a, const GeoPoint& b)
+{
+    const double dLat = qDegreesToRadians(b.lat - a.lat);
+    const double dLon = qDegreesToRadians(b.lon - a.lon);
+    const double sinLat = std::sin(dLat / 2.0);
+    const double sinLon = std::sin(dLon / 2.0);
+    const double h = sinLat * sinLat
+        + std::cos(qDegreesToRadians(a.lat)) * std::cos(qDegreesToRadians(b.lat)) * sinLon * sinLon;
+    return 2.0 * kEarthRadiusKm * std::asin(std::min(1.0, std::sqrt(h)));
+}
+
+void GeoDistance::distancesFrom(const GeoPoint& from, const GeoCoordinates& coords, float* outKm)
+{
+    distanceRow(originOf(from), coords, outKm);
+}
+
+QVector<float> GeoDistance::distancesFrom(const GeoPoint& from, const GeoCoordinates& coords)
+{
+    QVector<float> result(coords.size());
+    distancesFrom(from, coords, result.data());
+    return result;
+}
+
+QVector<int> GeoDistance::withinRadius(const GeoPoint& from, const GeoCoordinates& coords, double radiusKm,
+    QVector<float>* distancesKm)
+{
+    QVector<int> result;
+    if (distancesKm)
+        distancesKm->clear();
+    if (radiusKm < 0.0)
+        return result;
+
+    const Origin o = originOf(from);
+    const float* lat = coords.latRad.constData();
+    const float* lon = coords.lonRad.constData();
+    const float* cosLat = coords.cosLat.constData();
+    const int n = coords.size();
+    // Zapas na zaokrąglenia float, aby filtr nie odrzucił punktów na granicy
+    const float maxAngle = float(radiusKm / kEarthRadiusKm) * 1.0001f + 1e-6f;
+    const float radius = float(radiusKm);
+
+    auto accept = [&](int index, float km) {
+        if (km > radius)
+            return;
+        result.append(index);
+        if (distancesKm)
+            distancesKm->append(km);
+    };
+
+    int i = 0;
+#ifdef AQM_GEO_SSE2
+    const __m128 limit = _mm_set1_ps(maxAngle);
+    alignas(16) float km[4];
+    for (; i + 4 <= n; i += 4) {
+        const __m128 bound = lowerBoundAngle4(o, lat + i, lon + i, cosLat + i);
+        const int candidates = _mm_movemask_ps(_mm_cmple_ps(bound, limit));
+        if (candidates == 0)
+            continue;
+        _mm_store_ps(km, pairKm4(o, lat + i, lon + i, cosLat + i));
+        for (int lane = 0; lane < 4; ++lane) {
+            if (candidates & (1 << lane))
+                accept(i + lane, km[lane]);
+        }
+    }
+#endif
+    for (; i < n; ++i) {
+        if (lowerBoundAngle(o, lat[i], lon[i], cosLat[i]) <= maxAngle)
+            accept(i, pairKm(o, lat[i], lon[i], cosLat[i]));
+    }
+    return result;
+}
+
+QVector<float> GeoDistance::distanceMatrix(const GeoCoordinates& coords)
+{
+    const int n = coords.size();
+    QVector<float> matrix(qsizetype(n) * n);
+    float* out = matrix.data();
+
+    auto row = [&coords, out, n](int i) {
+        const Origin o{ coords.latRad[i], coords.lonRad[i], coords.cosLat[i] };
+        distanceRow(o, coords, out + qsizetype(i) * n);
+    };
+
+    if (n < kParallelMinRows) {
+        for (int i = 0; i < n; ++i)
+            row(i);
+    }
+    else {
+        Parallel::forEach(n, row);
+    }
+    return matrix;
+}
@@ -0,0 +1,95 @@
+﻿/**
+ * @file GeoDistance.h
+ * @brief Zbiorcze obliczanie odległości haversine na współrzędnych stacji.
+ *
+ * Współrzędne stacji przechowywane są jako struktura tablic (SoA): szerokość
+ * i długość w radianach oraz cosinus szerokości, liczone raz przy budowie.
+ * Odległości od punktu do wszystkich stacji i macierz odległości wszystkich
+ * par liczone są po cztery naraz (SSE2) z wielomianowymi przybliżeniami
+ * sinusa i arcusa sinusa. Zapytanie o promień najpierw odrzuca punkty,
+ * których dolne ograniczenie odległości (z różnic współrzędnych, bez funkcji
+ * trygonometrycznych) przekracza promień.
+ *
+ * Błąd przybliżenia względem dokładnej formuły haversine w podwójnej
+ * precyzji nie przekracza kMaxErrorKm + kMaxRelativeError * odległość.
+ *
+ * @author Jakub Frąckowiak
+ * @date Maj 2025
+ */
+
+#pragma once
+
+#include "Records.h"
+#include <QVector>
+
+/**
+ * @brief Współrzędne stacji w układzie struktury tablic.
+ */
+struct GeoCoordinates
+{
+    QVector<float> latRad;      ///< Szerokości geograficzne w radianach
+    QVector<float> lonRad;      ///< Długości geograficzne w radianach
+    QVector<float> cosLat;      ///< Cosinusy szerokości
+
+    /**
+     * @brief Zwraca liczbę punktów.
+     */
+    int size() const { return latRad.size(); }
+
+    /**
+     * @brief Dodaje punkt.
+     */
+    void append(const GeoPoint& point);
+
+    /**
+     * @brief Buduje współrzędne z listy punktów.
+     */
+    static GeoCoordinates fromPoints(const QVector<GeoPoint>& points);
+
+    /**
+     * @brief Buduje współrzędne stacji (w kolejności listy).
+     */
+    static GeoCoordinates fromStations(const QVector<StationRecord>& stations);
+};
+
+/**
+ * @brief Odległości po powierzchni Ziemi.
+ */
+namespace GeoDistance
+{
+    constexpr double kEarthRadiusKm = 6371.0;      ///< Promień Ziemi w kilometrach
+    constexpr double kMaxErrorKm = 0.003;          ///< Błąd bezwzględny przybliżenia (precyzja float współrzędnych w radianach przy długości ±180°)
+    constexpr double kMaxRelativeError = 1e-4;     ///< Błąd względny przybliżenia
+
+    /**
+     * @brief Dokładna odległość haversine (podwójna precyzja).
+     * @return Odległość w kilometrach.
+     */
+    double haversineKm(const GeoPoint& a, const GeoPoint& b);
+
+    /**
+     * @brief Liczy odległości od punktu do wszystkich współrzędnych.
+     * @param from Punkt początkowy.
+     * @param coords Współrzędne docelowe.
+     * @param outKm Bufor na coords.size() odległości w kilometrach.
+     */
+    void distancesFrom(const GeoPoint& from, const GeoCoordinates& coords, float* outKm);
+
+    /**
+     * @brief Liczy odległości od punktu do wszystkich współrzędnych.
+     */
+    QVector<float> distancesFrom(const GeoPoint& from, const GeoCoordinates& coords);
+
+    /**
+     * @brief Zwraca numery punktów w promieniu od punktu (w kolejności współrzędnych).
+     * @param distancesKm Opcjonalnie odległości znalezionych punktów.
+     */
+    QVector<int> withinRadius(const GeoPoint& from, const GeoCoordinates& coords, double radiusKm,
+        QVector<float>* distancesKm = nullptr);
+
+    /**
+     * @brief Liczy macierz odległości wszystkich par punktów.
+     * @return Macierz n x n wierszami; wiersze liczone są równolegle.
+     */
+    QVector<float> distanceMatrix(const GeoCoordinates& coords);
+}
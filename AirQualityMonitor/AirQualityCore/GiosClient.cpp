@@ -0,0 +1,134 @@
+﻿/**
+ * @file GiosClient.cpp
+ * @brief Implementacja klienta API GIOŚ.
+ */
+
+#include "GiosClient.h"
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+
+GiosClient::GiosClient(QObject* parent)
+    : QObject(parent),
+    network(new QNetworkAccessManager(this))
+{
+}
+
+GiosClient::GiosClient(QNetworkAccessManager* network, QObject* parent)
+    : QObject(parent),
+    network(network)
+{
+}
+
+QString GiosClient::baseUrl()
+{
+    return QStringLiteral("https://api.gios.gov.pl/pjp-api/rest/");
+}
+
+Async::Task<Async::NetworkResult> GiosClient::get(const QUrl& url, int timeoutMs, const Async::CancellationToken& cancel)
+{
+    QNetworkRequest request(url);
+    if (timeoutMs > 0)
+        request.setTransferTimeout(timeoutMs);
+    return Async::fetch(network, request, cancel);
+}
+
+ApiResult GiosClient::parse(const Async::NetworkResult& reply, QJsonDocument* doc)
+{
+    ApiResult result;
+    result.cancelled = reply.cancelled;
+    if (!reply.ok()) {
+        // Przerwanie bez anulowania oznacza przekroczenie limitu czasu
+        result.error = reply.code == QNetworkReply::OperationCanceledError && !reply.cancelled
+            ? QString("Serwer nie odpowiada w wymaganym czasie")
+            : reply.error;
+        return result;
+    }
+
+    *doc = QJsonDocument::fromJson(reply.data);
+    if (doc->isNull())
+        result.error = "Nieprawidłowy format danych z API";
+    return result;
+}
+
+void GiosClient::forward(const Async::Task<ApiResult>& task, const Handler& done)
+{
+    task.then([done](const ApiResult& result) {
+        done(result.data, result.error);
+        });
+}
+
+Async::Task<ApiResult> GiosClient::stations(Async::CancellationToken cancel)
+{
+    QJsonDocument doc;
+    ApiResult result = parse(co_await get(QUrl(baseUrl() + "station/findAll"), 0, cancel), &doc);
+    if (result.ok() && !doc.isArray())
+        result.error = "Nieprawidłowy format danych z API";
+    if (result.ok())
+        result.data = doc.array();
+    co_return result;
+}
+
+Async::Task<ApiResult> GiosClient::sensors(int stationId, Async::CancellationToken cancel)
+{
+    QJsonDocument doc;
+    ApiResult result = parse(co_await get(QUrl(QString(baseUrl() + "station/sensors/%1").arg(stationId)), 0, cancel), &doc);
+    if (result.ok() && !doc.isArray())
+        result.error = "Nieprawidłowy format danych z API";
+    if (!result.ok())
+        co_return result;
+
+    // Dodaj stationId do każdego obiektu sensora
+    for (const QJsonValue& value : doc.array()) {
+        QJsonObject sensor = value.toObject();
+        sensor.insert("stationId", stationId);
+        result.data.append(sensor);
+    }
+    co_return result;
+}
+
+Async::Task<ApiResult> GiosClient::measurements(int sensorId, int timeoutMs, Async::CancellationToken cancel)
+{
+    QJsonDocument doc;
+    ApiResult result = parse(co_await get(QUrl(QString(baseUrl() + "data/getData/%1").arg(sensorId)), timeoutMs, cancel), &doc);
+    if (result.ok() && !doc.isObject())
+        result.error = "Nieprawidłowy format danych z API";
+    if (!result.ok())
+        co_return result;
+
+    const QJsonArray values = doc.object().value("values").toArray();
+    for (const QJsonValue& val : values) {
+        const QJsonObject obj = val.toObject();
+        if (obj.contains("value") && !obj.value("value").isNull()) {
+            result.data = values;
+            co_return result;
+        }
+    }
+    result.error = "Serwer nie zwrócił żadnych ważnych danych pomiarowych";
+    co_return result;
+}
+
+Async::Task<bool> GiosClient::available(int timeoutMs)
+{
+    QNetworkRequest request(QUrl(baseUrl() + "station/findAll"));
+    request.setTransferTimeout(timeoutMs);
+    const Async::NetworkResult reply = co_await Async::fetch(network, request);
+    co_return reply.ok();
+}
+
+void GiosClient::fetchStations(const Handler& done)
+{
+    forward(stations(), done);
+}
+
+void GiosClient::fetchSensors(int stationId, const Handler& done)
+{
+    forward(sensors(stationId), done);
+}
+
+void GiosClient::fetchMeasurements(int sensorId, const Handler& done, int timeoutMs)
+{
+    forward(measurements(sensorId, timeoutMs), done);
+}
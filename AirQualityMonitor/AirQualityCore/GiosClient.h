@@ -0,0 +1,127 @@
+﻿/**
+ * @file GiosClient.h
+ * @brief Klient API GIOŚ (stacje, sensory, pomiary).
+ *
+ * Żądania wykonywane są asynchronicznie w pętli zdarzeń Qt. Wynik
+ * (tablica JSON albo opis błędu) dostępny jest jako zadanie Async::Task,
+ * na które można czekać przez co_await, albo w funkcji zwrotnej.
+ * Klient nie korzysta z interfejsu graficznego, więc może działać
+ * w aplikacji okienkowej, narzędziach wsadowych i usługach.
+ *
+ * @author Jakub Frąckowiak
+ * @date Maj 2025
+ */
+
+#pragma once
+
+#include "AsyncIo.h"
+#include <QJsonArray>
+#include <QObject>
+#include <QString>
+#include <QUrl>
+#include <functional>
+
+class QJsonDocument;
+class QNetworkAccessManager;
+
+/**
+ * @brief Wynik żądania do API GIOŚ.
+ */
+struct ApiResult
+{
+    QJsonArray data;            ///< Dane odpowiedzi
+    QString error;              ///< Opis błędu (pusty - powodzenie)
+    bool cancelled = false;     ///< Żądanie anulowano
+
+    bool ok() const { return error.isEmpty(); }
+};
+
+/**
+ * @class GiosClient
+ * @brief Asynchroniczne pobieranie danych z API GIOŚ.
+ */
+class GiosClient : public QObject
+{
+    Q_OBJECT
+
+public:
+    /// Wywoływane po zakończeniu żądania; niepusty error oznacza błąd
+    using Handler = std::function<void(const QJsonArray& data, const QString& error)>;
+
+    static constexpr int kAvailabilityTimeoutMs = 5000;     ///< Limit czasu sprawdzenia połączenia
+
+    /**
+     * @brief Tworzy klienta z własnym managerem sieci.
+     */
+    explicit GiosClient(QObject* parent = nullptr);
+
+    /**
+     * @brief Tworzy klienta korzystającego ze wspólnego managera sieci.
+     */
+    explicit GiosClient(QNetworkAccessManager* network, QObject* parent = nullptr);
+
+    /**
+     * @brief Zwraca bazowy URL API.
+     */
+    static QString baseUrl();
+
+    /**
+     * @brief Pobiera listę wszystkich stacji.
+     */
+    Async::Task<ApiResult> stations(Async::CancellationToken cancel = Async::CancellationToken());
+
+    /**
+     * @brief Pobiera sensory stacji; każdy sensor dostaje pole stationId.
+     */
+    Async::Task<ApiResult> sensors(int stationId, Async::CancellationToken cancel = Async::CancellationToken());
+
+    /**
+     * @brief Pobiera pomiary sensora (tablica "values" odpowiedzi).
+     *
+     * Odpowiedź bez żadnej wartości innej niż null traktowana jest jako błąd.
+     *
+     * @param timeoutMs Limit czasu żądania (0 - bez limitu).
+     */
+    Async::Task<ApiResult> measurements(int sensorId, int timeoutMs = 0,
+        Async::CancellationToken cancel = Async::CancellationToken());
+
+    /**
+     * @brief Sprawdza, czy API odpowiada w zadanym czasie.
+     */
+    Async::Task<bool> available(int timeoutMs = kAvailabilityTimeoutMs);
+
+    /**
+     * @brief Pobiera listę wszystkich stacji (wynik w funkcji zwrotnej).
+     */
+    void fetchStations(const Handler& done);
+
+    /**
+     * @brief Pobiera sensory stacji (wynik w funkcji zwrotnej).
+     */
+    void fetchSensors(int stationId, const Handler& done);
+
+    /**
+     * @brief Pobiera pomiary sensora (wynik w funkcji zwrotnej).
+     * @param timeoutMs Limit czasu żądania (0 - bez limitu).
+     */
+    void fetchMeasurements(int sensorId, const Handler& done, int timeoutMs = 0);
+
+private:
+    /**
+     * @brief Wysyła żądanie GET do API.
+     * @param timeoutMs Limit czasu żądania (0 - bez limitu).
+     */
+    Async::Task<Async::NetworkResult> get(const QUrl& url, int timeoutMs, const Async::CancellationToken& cancel);
+
+    /**
+     * @brief Wynik z odpowiedzią zawierającą dokument JSON lub błąd.
+     */
+    static ApiResult parse(const Async::NetworkResult& reply, QJsonDocument* doc);
+
+    /**
+     * @brief Przekazuje wynik zadania do funkcji zwrotnej.
+     */
+    static void forward(const Async::Task<ApiResult>& task, const Handler& done);
+
+    QNetworkAccessManager* network;     ///< Manager żądań sieciowych
+};
@@ -0,0 +1,415 @@
+﻿/**
+ * @file LocalApiServer.cpp
+ * @brief Implementacja lokalnego serwera HTTP.
+ */
+
+#include "LocalApiServer.h"
+#include <QCryptographicHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QUrlQuery>
+#include <QtEndian>
+#include <array>
+
+namespace
+{
+    const QByteArray kApiPrefix = "/pjp-api/rest";      ///< Prefiks ścieżek API GIOŚ (opcjonalny)
+
+    /**
+     * @brief Suma kontrolna CRC-32 wymagana przez format gzip.
+     */
+    quint32 crc32(const QByteArray& data)
+    {
+        static const std::array<quint32, 256> table = []() {
+            std::array<quint32, 256> t{};
+            for (quint32 i = 0; i < 256; ++i) {
+                quint32 c = i;
+                for (int k = 0; k < 8; ++k)
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                t[i] = c;
+            }
+            return t;
+        }();
+
+        quint32 crc = 0xFFFFFFFFu;
+        for (const char byte : data)
+            crc = table[(crc ^ quint8(byte)) & 0xFF] ^ (crc >> 8);
+        return crc ^ 0xFFFFFFFFu;
+    }
+
+    /**
+     * @brief Odczytuje liczbę z końca ścieżki po prefiksie (-1, gdy niepoprawna).
+     */
+    int idAfter(const QByteArray& path, const QByteArray& prefix)
+    {
+        if (!path.startsWith(prefix))
+            return -1;
+        bool ok = false;
+        const int id = path.mid(prefix.size()).toInt(&ok);
+        return ok ? id : -1;
+    }
+
+    /**
+     * @brief Uzupełnia samą datę do początku lub końca dnia.
+     */
+    QString rangeBound(const QString& text, bool end)
+    {
+        if (text.size() == 10)
+            return text + (end ? " 23:59:59" : " 00:00:00");
+        return text;
+    }
+
+    QByteArray statusText(int status)
+    {
+        switch (status) {
+        case 200: return "OK";
+        case 304: return "Not Modified";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 431: return "Request Header Fields Too Large";
+        default: return "Error";
+        }
+    }
+}
+
+LocalApiServer::LocalApiServer(DataRepository& repository, QObject* parent)
+    : QObject(parent),
+    repository(repository),
+    server(new QTcpServer(this))
+{
+    connect(server, &QTcpServer::newConnection, this, &LocalApiServer::onNewConnection);
+}
+
+bool LocalApiServer::listen(quint16 port, const QHostAddress& address)
+{
+    return server->listen(address, port);
+}
+
+void LocalApiServer::close()
+{
+    server->close();
+    for (QTcpSocket* socket : server->findChildren<QTcpSocket*>())
+        socket->disconnectFromHost();
+    buffers.clear();
+}
+
+bool LocalApiServer::isListening() const
+{
+    return server->isListening();
+}
+
+quint16 LocalApiServer::port() const
+{
+    return server->serverPort();
+}
+
+QString LocalApiServer::errorString() const
+{
+    return server->errorString();
+}
+
+void LocalApiServer::reload()
+{
+    stations = repository.loadStations();
+
+    sensorsByStation.clear();
+    paramCodes.clear();
+    sensorStations.clear();
+    for (const QJsonValue& value : repository.loadSensors()) {
+        const QJsonObject sensor = value.toObject();
+        const int id = sensor.value("id").toInt();
+        const int stationId = sensor.value("stationId").toInt();
+        sensorsByStation[stationId].append(sensor);
+        paramCodes.insert(id, sensor.value("param").toObject().value("paramCode").toString());
+        sensorStations.insert(id, stationId);
+    }
+
+    measurements.clear();
+    for (const QJsonValue& value : repository.loadMeasurements()) {
+        const QJsonObject obj = value.toObject();
+        measurements.insert(obj.value("id").toInt(), obj.value("values").toArray());
+    }
+
+    // Lista stacji pobierana jest przez każdego klienta - serializowana od razu
+    cache.clear();
+    cachedBody("/station/findAll");
+}
+
+void LocalApiServer::setStations(const QJsonArray& newStations)
+{
+    stations = newStations;
+    cache.remove("/station/findAll");
+}
+
+void LocalApiServer::setStationSensors(int stationId, const QJsonArray& sensors)
+{
+    sensorsByStation.insert(stationId, sensors);
+    for (const QJsonValue& value : sensors) {
+        const QJsonObject sensor = value.toObject();
+        const int id = sensor.value("id").toInt();
+        paramCodes.insert(id, sensor.value("param").toObject().value("paramCode").toString());
+        sensorStations.insert(id, stationId);
+        cache.remove("/data/getData/" + QByteArray::number(id));
+    }
+    cache.remove("/station/sensors/" + QByteArray::number(stationId));
+    cache.remove("/data/station/" + QByteArray::number(stationId));
+}
+
+void LocalApiServer::setMeasurements(int sensorId, const QJsonArray& values)
+{
+    measurements.insert(sensorId, values);
+    cache.remove("/data/getData/" + QByteArray::number(sensorId));
+    if (sensorStations.contains(sensorId))
+        cache.remove("/data/station/" + QByteArray::number(sensorStations.value(sensorId)));
+}
+
+QByteArray LocalApiServer::gzip(const QByteArray& data)
+{
+    // qCompress zwraca 4 bajty długości i strumień zlib (2 bajty nagłówka,
+    // deflate, 4 bajty Adler-32) - gzip potrzebuje samego strumienia deflate;
+    // dla pustych danych qCompress zwraca tylko długość, więc blok jest stały
+    const QByteArray zlib = qCompress(data, 6);
+    const QByteArray deflate = data.isEmpty() ? QByteArray("\x03\x00", 2) : zlib.mid(6, zlib.size() - 10);
+
+    QByteArray out;
+    out.reserve(deflate.size() + 18);
+    out.append("\x1f\x8b\x08\x00\x00\x00\x00\x00\x00\xff", 10);
+    out.append(deflate);
+
+    char trailer[8];
+    qToLittleEndian<quint32>(crc32(data), trailer);
+    qToLittleEndian<quint32>(quint32(data.size()), trailer + 4);
+    out.append(trailer, 8);
+    return out;
+}
+
+LocalApiServer::CachedBody LocalApiServer::makeBody(const QByteArray& body)
+{
+    CachedBody cached;
+    cached.body = body;
+    if (body.size() >= kMinGzipBytes)
+        cached.gzipBody = gzip(body);
+    cached.etag = '"' + QCryptographicHash::hash(body, QCryptographicHash::Md5).toHex().left(16) + '"';
+    return cached;
+}
+
+QJsonArray LocalApiServer::valuesInRange(int sensorId, const QString& from, const QString& to) const
+{
+    const QJsonArray values = measurements.value(sensorId);
+    if (from.isEmpty() && to.isEmpty())
+        return values;
+
+    // Daty "yyyy-MM-dd HH:mm:ss" porównywane tekstowo zachowują kolejność chronologiczną
+    const QString lower = rangeBound(from, false);
+    const QString upper = rangeBound(to, true);
+    QJsonArray filtered;
+    for (const QJsonValue& value : values) {
+        const QString date = value.toObject().value("date").toString();
+        if ((lower.isEmpty() || date >= lower) && (upper.isEmpty() || date <= upper))
+            filtered.append(value);
+    }
+    return filtered;
+}
+
+QByteArray LocalApiServer::measurementsBody(int sensorId, const QString& from, const QString& to) const
+{
+    QJsonObject obj;
+    obj["key"] = paramCodes.value(sensorId);
+    obj["values"] = valuesInRange(sensorId, from, to);
+    return QJsonDocument(obj).toJson(QJsonDocument::Compact);
+}
+
+QByteArray LocalApiServer::stationBody(int stationId, const QString& from, const QString& to) const
+{
+    QJsonArray result;
+    for (const QJsonValue& value : sensorsByStation.value(stationId)) {
+        const int sensorId = value.toObject().value("id").toInt();
+        QJsonObject obj;
+        obj["id"] = sensorId;
+        obj["key"] = paramCodes.value(sensorId);
+        obj["values"] = valuesInRange(sensorId, from, to);
+        result.append(obj);
+    }
+    return QJsonDocument(result).toJson(QJsonDocument::Compact);
+}
+
+const LocalApiServer::CachedBody* LocalApiServer::cachedBody(const QByteArray& path)
+{
+    auto it = cache.constFind(path);
+    if (it != cache.constEnd())
+        return &it.value();
+
+    QByteArray body;
+    int id = -1;
+    if (path == "/station/findAll") {
+        body = QJsonDocument(stations).toJson(QJsonDocument::Compact);
+    }
+    else if ((id = idAfter(path, "/station/sensors/")) != -1 && sensorsByStation.contains(id)) {
+        body = QJsonDocument(sensorsByStation.value(id)).toJson(QJsonDocument::Compact);
+    }
+    else if ((id = idAfter(path, "/data/getData/")) != -1 && measurements.contains(id)) {
+        body = measurementsBody(id, QString(), QString());
+    }
+    else if ((id = idAfter(path, "/data/station/")) != -1 && sensorsByStation.contains(id)) {
+        body = stationBody(id, QString(), QString());
+    }
+    else {
+        return nullptr;
+    }
+
+    return &cache.insert(path, makeBody(body)).value();
+}
+
+bool LocalApiServer::rangeBody(const QByteArray& path, const QByteArray& query, QByteArray& body)
+{
+    const QUrlQuery params(QString::fromUtf8(query));
+    const QString from = params.queryItemValue("from", QUrl::FullyDecoded);
+    const QString to = params.queryItemValue("to", QUrl::FullyDecoded);
+
+    int id = -1;
+    if ((id = idAfter(path, "/data/getData/")) != -1 && measurements.contains(id)) {
+        body = measurementsBody(id, from, to);
+        return true;
+    }
+    if ((id = idAfter(path, "/data/station/")) != -1 && sensorsByStation.contains(id)) {
+        body = stationBody(id, from, to);
+        return true;
+    }
+    return false;
+}
+
+void LocalApiServer::onNewConnection()
+{
+    while (server->hasPendingConnections()) {
+        QTcpSocket* socket = server->nextPendingConnection();
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]() { onReadyRead(socket); });
+        connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+            buffers.remove(socket);
+            socket->deleteLater();
+            });
+    }
+}
+
+int LocalApiServer::parseRequest(QByteArray& buffer, Request& request)
+{
+    const int end = buffer.indexOf("\r\n\r\n");
+    if (end == -1)
+        return buffer.size() > kMaxRequestBytes ? -1 : 0;
+
+    const QList<QByteArray> lines = buffer.left(end).split('\n');
+    buffer.remove(0, end + 4);
+
+    const QList<QByteArray> requestLine = lines.first().trimmed().split(' ');
+    if (requestLine.size() != 3 || !requestLine[2].startsWith("HTTP/1."))
+        return -1;
+    request.method = requestLine[0];
+    request.target = requestLine[1];
+    request.keepAlive = requestLine[2] != "HTTP/1.0";
+
+    for (int i = 1; i < lines.size(); ++i) {
+        const int colon = lines[i].indexOf(':');
+        if (colon <= 0)
+            continue;
+        const QByteArray name = lines[i].left(colon).trimmed().toLower();
+        const QByteArray value = lines[i].mid(colon + 1).trimmed();
+        if (name == "connection")
+            request.keepAlive = value.toLower() != "close" && (request.keepAlive || value.toLower() == "keep-alive");
+        else if (name == "accept-encoding")
+            request.acceptsGzip = value.toLower().contains("gzip");
+        else if (name == "if-none-match")
+            request.ifNoneMatch = value;
+        else if (name == "content-length" && value.toInt() > 0)
+            return -1;  // Serwer obsługuje tylko żądania bez treści
+    }
+    return 1;
+}
+
+void LocalApiServer::onReadyRead(QTcpSocket* socket)
+{
+    QByteArray buffer = buffers.take(socket) + socket->readAll();
+
+    // Klient może wysłać kilka żądań naraz (potokowanie) - odpowiedzi w kolejności
+    for (;;) {
+        Request request;
+        const int parsed = parseRequest(buffer, request);
+        if (parsed == 0)
+            break;
+        if (parsed < 0) {
+            request.keepAlive = false;
+            send(socket, request, buffer.size() > kMaxRequestBytes ? 431 : 400, "{\"error\":\"Nieprawidłowe żądanie\"}");
+            return;
+        }
+
+        handle(socket, request);
+        if (!request.keepAlive)
+            return;
+    }
+
+    if (socket->state() == QAbstractSocket::ConnectedState)
+        buffers.insert(socket, buffer);
+}
+
+void LocalApiServer::handle(QTcpSocket* socket, const Request& request)
+{
+    ++requests;
+    if (request.method != "GET" && request.method != "HEAD") {
+        send(socket, request, 405, "{\"error\":\"Obsługiwane są tylko żądania GET\"}");
+        return;
+    }
+
+    const int queryStart = request.target.indexOf('?');
+    QByteArray path = queryStart == -1 ? request.target : request.target.left(queryStart);
+    const QByteArray query = queryStart == -1 ? QByteArray() : request.target.mid(queryStart + 1);
+    if (path.startsWith(kApiPrefix))
+        path.remove(0, kApiPrefix.size());
+
+    // Pełne odpowiedzi z pamięci, zapytania o zakres budowane na bieżąco
+    if (query.isEmpty()) {
+        if (const CachedBody* cached = cachedBody(path)) {
+            if (!request.ifNoneMatch.isEmpty() && request.ifNoneMatch == cached->etag) {
+                send(socket, request, 304, QByteArray(), cached->etag);
+                return;
+            }
+            const bool gzipped = request.acceptsGzip && !cached->gzipBody.isEmpty();
+            send(socket, request, 200, gzipped ? cached->gzipBody : cached->body, cached->etag, gzipped);
+            return;
+        }
+    }
+    else {
+        QByteArray body;
+        if (rangeBody(path, query, body)) {
+            const bool gzipped = request.acceptsGzip && body.size() >= kMinGzipBytes;
+            send(socket, request, 200, gzipped ? gzip(body) : body, QByteArray(), gzipped);
+            return;
+        }
+    }
+
+    send(socket, request, 404, "{\"error\":\"Nie znaleziono\"}");
+}
+
+void LocalApiServer::send(QTcpSocket* socket, const Request& request, int status, const QByteArray& body,
+    const QByteArray& etag, bool gzipped)
+{
+    QByteArray head;
+    head.reserve(256);
+    head += "HTTP/1.1 " + QByteArray::number(status) + ' ' + statusText(status) + "\r\n";
+    head += "Content-Type: application/json; charset=utf-8\r\n";
+    head += "Access-Control-Allow-Origin: *\r\n";
+    head += "Vary: Accept-Encoding\r\n";
+    if (status != 304)
+        head += "Content-Length: " + QByteArray::number(body.size()) + "\r\n";
+    if (!etag.isEmpty())
+        head += "ETag: " + etag + "\r\n";
+    if (gzipped)
+        head += "Content-Encoding: gzip\r\n";
+    head += request.keepAlive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+
+    socket->write(head);
+    if (status != 304 && request.method != "HEAD")
+        socket->write(body);
+    if (!request.keepAlive)
+        socket->disconnectFromHost();
+}
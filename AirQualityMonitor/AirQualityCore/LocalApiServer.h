@@ -0,0 +1,164 @@
+﻿/**
+ * @file LocalApiServer.h
+ * @brief Lokalny serwer HTTP udostępniający zapisane dane stacji, sensorów i pomiarów.
+ *
+ * Serwer odpowiada na te same ścieżki co API GIOŚ (station/findAll,
+ * station/sensors/{id}, data/getData/{id}), więc klienci w sieci lokalnej
+ * mogą korzystać z jednej kopii danych zamiast odpytywać API osobno.
+ * Dodatkowo obsługiwane są zapytania o zakres dat (?from=&to=) dla sensora
+ * i dla wszystkich sensorów stacji (data/station/{id}).
+ *
+ * Odpowiedzi zawierają nagłówek Access-Control-Allow-Origin: *, więc
+ * może je odczytać dowolna strona otwarta w przeglądarce. Dlatego serwer
+ * domyślnie nasłuchuje tylko na adresie lokalnym, a udostępnienie w sieci
+ * wymaga jawnego podania adresu (np. QHostAddress::Any).
+ *
+ * Odpowiedzi pełne są serializowane raz (wraz z wersją gzip i ETag)
+ * i wysyłane z pamięci do czasu zmiany danych. Połączenia obsługiwane są
+ * w pętli zdarzeń z utrzymywaniem połączenia (keep-alive) i potokowaniem.
+ *
+ * @author Jakub Frąckowiak
+ * @date Maj 2025
+ */
+
+#pragma once
+
+#include "DataRepository.h"
+#include <QByteArray>
+#include <QHash>
+#include <QHostAddress>
+#include <QJsonArray>
+#include <QObject>
+
+class QTcpServer;
+class QTcpSocket;
+
+/**
+ * @class LocalApiServer
+ * @brief Serwer HTTP/1.1 z danymi z repozytorium w pamięci.
+ */
+class LocalApiServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr quint16 kDefaultPort = 8080;           ///< Domyślny port serwera
+    static constexpr int kMaxRequestBytes = 16 * 1024;      ///< Limit nagłówków jednego żądania
+    static constexpr int kMinGzipBytes = 1024;              ///< Mniejsze odpowiedzi wysyłane są bez kompresji
+
+    /**
+     * @brief Tworzy serwer dla repozytorium (dane wczytywane są przez reload()).
+     */
+    explicit LocalApiServer(DataRepository& repository, QObject* parent = nullptr);
+
+    /**
+     * @brief Uruchamia nasłuchiwanie.
+     * @param port Port nasłuchiwania.
+     * @param address Adres nasłuchiwania (domyślnie tylko ten komputer).
+     * @return False, jeśli port jest zajęty lub niedostępny.
+     */
+    bool listen(quint16 port = kDefaultPort, const QHostAddress& address = QHostAddress::LocalHost);
+
+    /**
+     * @brief Zatrzymuje serwer i zamyka połączenia.
+     */
+    void close();
+
+    bool isListening() const;
+    quint16 port() const;
+    QString errorString() const;
+
+    /**
+     * @brief Wczytuje wszystkie dane z repozytorium i unieważnia odpowiedzi.
+     */
+    void reload();
+
+    /**
+     * @brief Ustawia listę stacji.
+     */
+    void setStations(const QJsonArray& stations);
+
+    /**
+     * @brief Ustawia sensory stacji.
+     */
+    void setStationSensors(int stationId, const QJsonArray& sensors);
+
+    /**
+     * @brief Ustawia historię pomiarów sensora (np. po scaleniu nowych danych).
+     */
+    void setMeasurements(int sensorId, const QJsonArray& values);
+
+    /**
+     * @brief Zwraca liczbę obsłużonych żądań.
+     */
+    quint64 requestCount() const { return requests; }
+
+    /**
+     * @brief Kompresuje dane do formatu gzip (RFC 1952).
+     */
+    static QByteArray gzip(const QByteArray& data);
+
+private:
+    /**
+     * @brief Gotowa odpowiedź: treść, wersja gzip i znacznik ETag.
+     */
+    struct CachedBody
+    {
+        QByteArray body;        ///< Treść JSON
+        QByteArray gzipBody;    ///< Treść skompresowana (pusta, gdy treść jest mała)
+        QByteArray etag;        ///< Znacznik wersji treści
+    };
+
+    /**
+     * @brief Odczytane żądanie HTTP.
+     */
+    struct Request
+    {
+        QByteArray method;          ///< GET lub HEAD
+        QByteArray target;          ///< Ścieżka z zapytaniem
+        bool keepAlive = true;      ///< Czy utrzymać połączenie
+        bool acceptsGzip = false;   ///< Czy klient przyjmuje gzip
+        QByteArray ifNoneMatch;     ///< ETag z poprzedniej odpowiedzi
+    };
+
+    void onNewConnection();
+    void onReadyRead(QTcpSocket* socket);
+
+    /**
+     * @brief Odczytuje jedno pełne żądanie z bufora połączenia.
+     * @return 1 - odczytano, 0 - potrzeba więcej danych, -1 - błędne żądanie.
+     */
+    static int parseRequest(QByteArray& buffer, Request& request);
+
+    void handle(QTcpSocket* socket, const Request& request);
+
+    /**
+     * @brief Zwraca gotową odpowiedź dla ścieżki bez zapytania (nullptr, gdy brak).
+     */
+    const CachedBody* cachedBody(const QByteArray& path);
+
+    /**
+     * @brief Buduje odpowiedź na zapytanie o zakres dat.
+     * @return False, gdy ścieżka lub obiekt są nieznane.
+     */
+    bool rangeBody(const QByteArray& path, const QByteArray& query, QByteArray& body);
+
+    QByteArray measurementsBody(int sensorId, const QString& from, const QString& to) const;
+    QByteArray stationBody(int stationId, const QString& from, const QString& to) const;
+    QJsonArray valuesInRange(int sensorId, const QString& from, const QString& to) const;
+
+    static CachedBody makeBody(const QByteArray& body);
+    static void send(QTcpSocket* socket, const Request& request, int status, const QByteArray& body,
+        const QByteArray& etag = QByteArray(), bool gzipped = false);
+
+    DataRepository& repository;                     ///< Pliki danych
+    QTcpServer* server;                             ///< Gniazdo nasłuchujące
+    QHash<QTcpSocket*, QByteArray> buffers;         ///< Nieprzetworzone dane połączeń
+    QJsonArray stations;                            ///< Lista stacji
+    QHash<int, QJsonArray> sensorsByStation;        ///< Sensory według ID stacji
+    QHash<int, QString> paramCodes;                 ///< Kod parametru według ID sensora
+    QHash<int, int> sensorStations;                 ///< ID stacji według ID sensora
+    QHash<int, QJsonArray> measurements;            ///< Historia pomiarów według ID sensora
+    QHash<QByteArray, CachedBody> cache;            ///< Gotowe odpowiedzi według ścieżki
+    quint64 requests = 0;                           ///< Liczba obsłużonych żądań
+};
@@ -0,0 +1,92 @@
+﻿/**
+ * @file MeasurementIngest.cpp
+ * @brief Implementacja przyjmowania nowych pomiarów.
+ */
+
+#include "MeasurementIngest.h"
+#include <QJsonObject>
+#include <QtConcurrent/QtConcurrentRun>
+
+MeasurementIngest::MeasurementIngest(DataRepository& repository)
+    : repository(repository)
+{
+}
+
+MeasurementIngest::~MeasurementIngest()
+{
+    forecastFuture.waitForFinished();
+}
+
+MeasurementSeries MeasurementIngest::filledSeries(const QJsonArray& values)
+{
+    MeasurementSeries series = GapAnalysis::fromJson(values);
+    GapAnalysis::fillGaps(series, FillMethod::Seasonal, kMaxFilledGapHours);
+    return series;
+}
+
+void MeasurementIngest::loadFromRepository()
+{
+    // Przypisanie sensorów do stacji z sensors.json
+    QVector<SensorRecord> sensors;
+    for (const QJsonValue& value : repository.loadSensors())
+        sensors.append(SensorRecord::fromJson(value.toObject()));
+    index.addSensors(sensors);
+
+    // Najnowsza zmierzona wartość każdego sensora z measurements.json
+    const QJsonArray allMeasurements = repository.loadMeasurements();
+    StationReadingChange change;
+    for (const QJsonValue& value : allMeasurements) {
+        const QJsonObject obj = value.toObject();
+        index.update(obj.value("id").toInt(), GapAnalysis::fromJson(obj.value("values").toArray()), change);
+    }
+
+    if (allMeasurements.isEmpty())
+        return;
+
+    // Modele prognoz dopasowywane w tle, równolegle dla wszystkich sensorów
+    forecastFuture = QtConcurrent::run([this, allMeasurements]() {
+        fitForecasts(allMeasurements);
+        });
+}
+
+void MeasurementIngest::restore(const QVector<SensorRecord>& sensors, const QVector<StationReadingChange>& readings)
+{
+    index.addSensors(sensors);
+    for (const StationReadingChange& entry : readings)
+        index.setReading(entry);
+
+    forecastFuture = QtConcurrent::run([this]() {
+        fitForecasts(repository.loadMeasurements());
+        });
+}
+
+void MeasurementIngest::fitForecasts(const QJsonArray& allMeasurements)
+{
+    QVector<QPair<int, MeasurementSeries>> batch;
+    batch.reserve(allMeasurements.size());
+    for (const QJsonValue& value : allMeasurements) {
+        const QJsonObject obj = value.toObject();
+        batch.append(qMakePair(obj.value("id").toInt(), filledSeries(obj.value("values").toArray())));
+    }
+    forecastEngine.ingestAll(batch);
+}
+
+QVector<RollupBucket> MeasurementIngest::rollupRange(int sensorId, RollupResolution resolution, qint64 fromMs, qint64 toMs)
+{
+    if (!rollupStore.contains(sensorId))
+        rollupStore.rebuild(sensorId, GapAnalysis::fromJson(repository.loadMeasurements(sensorId)));
+    return rollupStore.range(sensorId, resolution, fromMs, toMs);
+}
+
+IngestResult MeasurementIngest::ingest(int sensorId, const QJsonArray& values)
+{
+    IngestResult result;
+    result.merged = repository.mergeMeasurements(sensorId, values, &result.changes, &result.saved);
+    result.series = GapAnalysis::fromJson(result.merged);
+
+    // Agregaty aktualizowane przyrostowo (lub budowane przy pierwszym użyciu)
+    rollupStore.update(sensorId, result.changes, result.series);
+
+    result.stationChanged = index.update(sensorId, result.series, result.stationChange);
+    return result;
+}
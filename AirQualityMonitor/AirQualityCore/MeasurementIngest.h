@@ -0,0 +1,113 @@
+﻿/**
+ * @file MeasurementIngest.h
+ * @brief Przyjmowanie nowych pomiarów i utrzymanie pochodnych struktur.
+ *
+ * Pomiary pobrane z API są scalane z historią w repozytorium, a następnie
+ * przyrostowo aktualizowane są agregaty dzienne i miesięczne, najnowsze
+ * klasy indeksu stacji i modele prognoz. Przy starcie struktury budowane
+ * są z plików repozytorium (prognozy w tle).
+ *
+ * @author Jakub Frąckowiak
+ * @date Maj 2025
+ */
+
+#pragma once
+
+#include "AirQualityIndex.h"
+#include "DataRepository.h"
+#include "Forecast.h"
+#include "GapAnalysis.h"
+#include "Rollups.h"
+#include <QFuture>
+#include <QJsonArray>
+
+/**
+ * @brief Wynik przyjęcia pomiarów sensora.
+ */
+struct IngestResult
+{
+    QJsonArray merged;                  ///< Pełna historia sensora po scaleniu (od najnowszych)
+    MeasurementSeries series;           ///< Historia na siatce godzinowej (bez uzupełnień)
+    QVector<MeasurementChange> changes; ///< Dodane i zmienione pomiary
+    bool saved = false;                 ///< Czy plik pomiarów został zapisany
+    bool stationChanged = false;        ///< Czy zmienił się najnowszy pomiar stacji
+    StationReadingChange stationChange; ///< Zmiana pomiaru stacji (gdy stationChanged)
+};
+
+/**
+ * @class MeasurementIngest
+ * @brief Scalanie pomiarów i aktualizacja agregatów, indeksu i prognoz.
+ */
+class MeasurementIngest
+{
+public:
+    static constexpr int kMaxFilledGapHours = 3;    ///< Najdłuższa przerwa (w godzinach) uzupełniana interpolacją
+
+    /**
+     * @brief Tworzy obsługę pomiarów dla repozytorium.
+     */
+    explicit MeasurementIngest(DataRepository& repository);
+
+    /**
+     * @brief Czeka na zakończenie dopasowania prognoz w tle.
+     */
+    ~MeasurementIngest();
+
+    MeasurementIngest(const MeasurementIngest&) = delete;
+    MeasurementIngest& operator=(const MeasurementIngest&) = delete;
+
+    /**
+     * @brief Buduje indeks stacji z plików i rozpoczyna w tle dopasowanie prognoz.
+     */
+    void loadFromRepository();
+
+    /**
+     * @brief Odtwarza indeks stacji z migawki stanu i rozpoczyna w tle dopasowanie prognoz.
+     *
+     * Plik pomiarów czytany jest dopiero w wątku prognoz, więc start
+     * aplikacji nie zależy od liczby zapisanych pomiarów.
+     *
+     * @param sensors Sensory wszystkich stacji.
+     * @param readings Najnowsze pomiary stacji.
+     */
+    void restore(const QVector<SensorRecord>& sensors, const QVector<StationReadingChange>& readings);
+
+    /**
+     * @brief Rejestruje sensory stacji w indeksie.
+     */
+    void addSensors(const QVector<SensorRecord>& sensors) { index.addSensors(sensors); }
+
+    /**
+     * @brief Scala nowe pomiary sensora z historią i aktualizuje struktury pochodne.
+     */
+    IngestResult ingest(int sensorId, const QJsonArray& values);
+
+    /**
+     * @brief Zwraca serię sensora z uzupełnionymi krótkimi przerwami.
+     */
+    static MeasurementSeries filledSeries(const QJsonArray& values);
+
+    /**
+     * @brief Zwraca agregaty sensora z zakresu dat.
+     *
+     * Przy pierwszym użyciu agregaty budowane są z pełnej historii sensora
+     * w repozytorium (a nie z serii wyświetlanej, która może obejmować
+     * tylko ostatnią odpowiedź API); później aktualizuje je ingest().
+     */
+    QVector<RollupBucket> rollupRange(int sensorId, RollupResolution resolution, qint64 fromMs, qint64 toMs);
+
+    ForecastEngine& forecasts() { return forecastEngine; }
+    const StationIndexMap& stationIndex() const { return index; }
+
+private:
+    /**
+     * @brief Dopasowuje modele prognoz wszystkich sensorów z historii pomiarów.
+     */
+    void fitForecasts(const QJsonArray& allMeasurements);
+
+    DataRepository& repository;     ///< Pliki danych
+    RollupStore rollupStore;        ///< Agregaty dzienne i miesięczne
+    ForecastEngine forecastEngine;  ///< Modele prognoz sensorów
+    StationIndexMap index;          ///< Najnowsze pomiary i klasy indeksu stacji
+    QFuture<void> forecastFuture;   ///< Dopasowanie prognoz w tle
+};
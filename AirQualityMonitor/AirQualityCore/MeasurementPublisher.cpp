@@ -0,0 +1,175 @@
+﻿/**
+ * @file MeasurementPublisher.cpp
+ * @brief Implementacja powiadamiania klientów WebSocket.
+ */
+
+#include "MeasurementPublisher.h"
+#include "AirQualityIndex.h"
+#include <QDateTime>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QTimer>
+#include <QWebSocket>
+#include <QWebSocketServer>
+#include <cmath>
+
+MeasurementPublisher::MeasurementPublisher(QObject* parent)
+    : QObject(parent),
+    server(new QWebSocketServer(QStringLiteral("AirQualityMonitor"), QWebSocketServer::NonSecureMode, this)),
+    batchTimer(new QTimer(this))
+{
+    batchTimer->setSingleShot(true);
+    batchTimer->setInterval(kBatchWindowMs);
+    connect(batchTimer, &QTimer::timeout, this, &MeasurementPublisher::flush);
+    connect(server, &QWebSocketServer::newConnection, this, &MeasurementPublisher::onNewConnection);
+}
+
+MeasurementPublisher::~MeasurementPublisher()
+{
+    server->close();
+}
+
+bool MeasurementPublisher::listen(quint16 port, const QHostAddress& address)
+{
+    return server->listen(address, port);
+}
+
+quint16 MeasurementPublisher::port() const
+{
+    return server->serverPort();
+}
+
+QString MeasurementPublisher::errorString() const
+{
+    return server->errorString();
+}
+
+void MeasurementPublisher::addSensors(const QVector<SensorRecord>& newSensors)
+{
+    for (const SensorRecord& sensor : newSensors)
+        sensors.insert(sensor.id, sensor);
+}
+
+void MeasurementPublisher::onNewConnection()
+{
+    while (server->hasPendingConnections()) {
+        QWebSocket* socket = server->nextPendingConnection();
+        clients.insert(socket, Client());
+
+        connect(socket, &QWebSocket::textMessageReceived, this, [this, socket](const QString& message) {
+            onTextMessage(socket, message);
+            });
+        connect(socket, &QWebSocket::bytesWritten, this, [this, socket](qint64 bytes) {
+            auto it = clients.find(socket);
+            if (it != clients.end())
+                it->pendingBytes = qMax<qint64>(0, it->pendingBytes - bytes);
+            });
+        connect(socket, &QWebSocket::disconnected, this, [this, socket]() {
+            clients.remove(socket);
+            socket->deleteLater();
+            });
+    }
+}
+
+void MeasurementPublisher::onTextMessage(QWebSocket* socket, const QString& message)
+{
+    auto it = clients.find(socket);
+    if (it == clients.end())
+        return;
+
+    const QJsonObject request = QJsonDocument::fromJson(message.toUtf8()).object();
+    for (const QJsonValue& topic : request.value("subscribe").toArray())
+        it->topics.insert(topic.toString());
+    for (const QJsonValue& topic : request.value("unsubscribe").toArray())
+        it->topics.remove(topic.toString());
+}
+
+void MeasurementPublisher::publish(int sensorId, const QVector<MeasurementChange>& changes, const MeasurementSeries& series)
+{
+    if (clients.isEmpty() || changes.isEmpty())
+        return;
+
+    const SensorRecord sensor = sensors.value(sensorId);
+    const QString sensorTopic = QString("sensor/%1").arg(sensorId);
+    const QString stationTopic = sensor.stationId != -1 ? QString("station/%1").arg(sensor.stationId) : QString();
+
+    for (const MeasurementChange& change : changes) {
+        if (std::isnan(change.newValue))
+            continue;
+
+        QJsonObject event;
+        event["type"] = "point";
+        event["sensorId"] = sensorId;
+        event["stationId"] = sensor.stationId;
+        event["paramCode"] = sensor.paramCode;
+        event["date"] = QDateTime::fromMSecsSinceEpoch(change.ms).toString("yyyy-MM-dd HH:mm:ss");
+        event["value"] = change.newValue;
+        if (!std::isnan(change.oldValue))
+            event["previous"] = change.oldValue;
+        enqueue(sensorTopic, stationTopic, event);
+
+        // Przekroczenie progu: inna klasa indeksu niż w poprzedniej zmierzonej godzinie
+        const int index = series.indexOf(change.ms) - 1;
+        if (index < 0 || index >= series.size() || series.origin[index] != PointOrigin::Measured)
+            continue;
+        const int level = AirQualityIndex::level(sensor.paramCode, change.newValue);
+        const int previousLevel = AirQualityIndex::level(sensor.paramCode, series.values[index]);
+        if (level == AirQualityIndex::kNoLevel || level == previousLevel)
+            continue;
+
+        event["type"] = "threshold";
+        event["level"] = level;
+        event["previousLevel"] = previousLevel;
+        event.remove("previous");
+        enqueue(sensorTopic, stationTopic, event);
+    }
+
+    if (!batchTimer->isActive())
+        batchTimer->start();
+}
+
+void MeasurementPublisher::enqueue(const QString& sensorTopic, const QString& stationTopic, const QJsonObject& event)
+{
+    for (Client& client : clients) {
+        if (!client.topics.contains(sensorTopic) && !client.topics.contains(stationTopic))
+            continue;
+
+        // Pełna kolejka - najstarsze zdarzenie ustępuje nowemu
+        if (client.queue.size() >= kMaxQueuedEvents) {
+            client.queue.dequeue();
+            ++client.dropped;
+        }
+        client.queue.enqueue(event);
+    }
+}
+
+void MeasurementPublisher::flush()
+{
+    bool waiting = false;
+    for (auto it = clients.begin(); it != clients.end(); ++it) {
+        Client& client = it.value();
+        if (client.queue.isEmpty())
+            continue;
+
+        // Klient nie odebrał poprzednich wiadomości - zdarzenia czekają w kolejce
+        if (client.pendingBytes > kMaxPendingBytes) {
+            waiting = true;
+            continue;
+        }
+
+        QJsonArray events;
+        while (!client.queue.isEmpty())
+            events.append(client.queue.dequeue());
+
+        QJsonObject message;
+        message["events"] = events;
+        message["dropped"] = client.dropped;
+        client.dropped = 0;
+
+        const QString text = QString::fromUtf8(QJsonDocument(message).toJson(QJsonDocument::Compact));
+        client.pendingBytes += it.key()->sendTextMessage(text);
+    }
+
+    if (waiting)
+        batchTimer->start();
+}
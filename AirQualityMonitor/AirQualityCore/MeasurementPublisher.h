@@ -0,0 +1,107 @@
+﻿/**
+ * @file MeasurementPublisher.h
+ * @brief Powiadamianie klientów WebSocket o nowych pomiarach.
+ *
+ * Klient subskrybuje tematy sensorów i stacji, wysyłając
+ * {"subscribe": ["sensor/92", "station/14"]} (analogicznie "unsubscribe").
+ * Po zapisaniu nowych pomiarów klienci dostają zdarzenia "point" (nowa lub
+ * zmieniona wartość) oraz "threshold" (zmiana klasy indeksu jakości
+ * powietrza względem poprzedniej godziny).
+ *
+ * Zdarzenia zbierane są przez krótkie okno czasowe i wysyłane jedną
+ * wiadomością {"events": [...], "dropped": n}. Kolejka każdego klienta jest
+ * ograniczona - przy jej przepełnieniu odrzucane są najstarsze zdarzenia,
+ * a klient, który nie odbiera danych, nie dostaje kolejnych wiadomości,
+ * dopóki nie odbierze poprzednich.
+ *
+ * Serwer WebSocket nie sprawdza nagłówka Origin, więc domyślnie nasłuchuje
+ * tylko na adresie lokalnym; udostępnienie w sieci wymaga jawnego adresu.
+ *
+ * @author Jakub Frąckowiak
+ * @date Maj 2025
+ */
+
+#pragma once
+
+#include "GapAnalysis.h"
+#include "Records.h"
+#include "Rollups.h"
+#include <QHash>
+#include <QHostAddress>
+#include <QJsonObject>
+#include <QObject>
+#include <QQueue>
+#include <QSet>
+
+class QTimer;
+class QWebSocket;
+class QWebSocketServer;
+
+/**
+ * @class MeasurementPublisher
+ * @brief Serwer WebSocket publikujący nowe pomiary według tematów.
+ */
+class MeasurementPublisher : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr quint16 kDefaultPort = 8081;               ///< Domyślny port serwera
+    static constexpr int kBatchWindowMs = 250;                  ///< Okno zbierania zdarzeń w jedną wiadomość
+    static constexpr int kMaxQueuedEvents = 1000;               ///< Limit zdarzeń oczekujących na klienta
+    static constexpr qint64 kMaxPendingBytes = 1024 * 1024;     ///< Limit danych niewysłanych do klienta
+
+    explicit MeasurementPublisher(QObject* parent = nullptr);
+    ~MeasurementPublisher();
+
+    /**
+     * @brief Uruchamia nasłuchiwanie.
+     * @param port Port nasłuchiwania.
+     * @param address Adres nasłuchiwania (domyślnie tylko ten komputer).
+     * @return False, jeśli port jest zajęty lub niedostępny.
+     */
+    bool listen(quint16 port = kDefaultPort, const QHostAddress& address = QHostAddress::LocalHost);
+
+    quint16 port() const;
+    QString errorString() const;
+
+    /**
+     * @brief Rejestruje sensory (stacja i parametr w zdarzeniach, tematy stacji).
+     */
+    void addSensors(const QVector<SensorRecord>& sensors);
+
+    /**
+     * @brief Publikuje zapisane zmiany pomiarów sensora.
+     * @param sensorId ID sensora.
+     * @param changes Dodane i zmienione pomiary.
+     * @param series Historia sensora po scaleniu (do wykrycia przekroczeń progów).
+     */
+    void publish(int sensorId, const QVector<MeasurementChange>& changes, const MeasurementSeries& series);
+
+    /**
+     * @brief Zwraca liczbę podłączonych klientów.
+     */
+    int clientCount() const { return clients.size(); }
+
+private:
+    /**
+     * @brief Stan połączonego klienta.
+     */
+    struct Client
+    {
+        QSet<QString> topics;           ///< Subskrybowane tematy
+        QQueue<QJsonObject> queue;      ///< Zdarzenia czekające na wysłanie
+        int dropped = 0;                ///< Zdarzenia odrzucone od ostatniej wiadomości
+        qint64 pendingBytes = 0;        ///< Dane wysłane, ale jeszcze nie zapisane do gniazda
+    };
+
+    void onNewConnection();
+    void onTextMessage(QWebSocket* socket, const QString& message);
+    void enqueue(const QString& sensorTopic, const QString& stationTopic, const QJsonObject& event);
+    void flush();
+
+    QWebSocketServer* server;           ///< Gniazdo nasłuchujące
+    QTimer* batchTimer;                 ///< Okno zbierania zdarzeń
+    QHash<QWebSocket*, Client> clients; ///< Połączeni klienci
+    QHash<int, SensorRecord> sensors;   ///< Sensory według ID
+};
@@ -0,0 +1,53 @@
+﻿/**
+ * @file MeasurementStatistics.cpp
+ * @brief Implementacja statystyk pomiarów.
+ */
+
+#include "MeasurementStatistics.h"
+
+Trend RangeSummary::trend() const
+{
+    const double avgFirst = firstHalf.mean();
+    const double avgLast = secondHalf.mean();
+
+    if (firstHalf.count == 0 || avgLast == avgFirst)
+        return Trend::Stable;
+    return avgLast > avgFirst ? Trend::Rising : Trend::Falling;
+}
+
+RangeSummary MeasurementStatistics::summarize(const MeasurementSeries& series, qint64 fromMs, qint64 toMs)
+{
+    // Statystyki liczone wyłącznie z wartości zmierzonych
+    QVector<double> values;
+    for (int i = 0; i < series.size(); ++i) {
+        const qint64 ms = series.timeAt(i);
+        if (ms >= fromMs && ms <= toMs && series.origin[i] == PointOrigin::Measured)
+            values.append(series.values[i]);
+    }
+
+    RangeSummary summary;
+    for (int i = 0; i < values.size(); ++i) {
+        summary.total.add(values[i]);
+        (i < values.size() / 2 ? summary.firstHalf : summary.secondHalf).add(values[i]);
+    }
+    return summary;
+}
+
+RangeSummary MeasurementStatistics::summarize(const QVector<RollupBucket>& buckets)
+{
+    RangeSummary summary;
+    for (int i = 0; i < buckets.size(); ++i) {
+        summary.total.merge(buckets[i]);
+        (i < buckets.size() / 2 ? summary.firstHalf : summary.secondHalf).merge(buckets[i]);
+    }
+    return summary;
+}
+
+QString MeasurementStatistics::trendName(Trend trend)
+{
+    switch (trend) {
+    case Trend::Rising: return "Rosnący";
+    case Trend::Falling: return "Malejący";
+    default: return "Stabilny";
+    }
+}
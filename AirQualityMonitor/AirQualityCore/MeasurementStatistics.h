@@ -0,0 +1,67 @@
+﻿/**
+ * @file MeasurementStatistics.h
+ * @brief Statystyki pomiarów w zakresie dat.
+ *
+ * Minimum, maksimum i średnia liczone są z wartości zmierzonych (bez
+ * uzupełnień) albo z agregatów dziennych i miesięcznych. Trend wyznaczany
+ * jest przez porównanie średnich pierwszej i drugiej połowy zakresu.
+ *
+ * @author Jakub Frąckowiak
+ * @date Maj 2025
+ */
+
+#pragma once
+
+#include "GapAnalysis.h"
+#include "Rollups.h"
+#include <QString>
+#include <QVector>
+
+/**
+ * @brief Kierunek zmian w zakresie.
+ */
+enum class Trend
+{
+    Stable,     ///< Średnie połówek równe (lub za mało danych)
+    Rising,     ///< Druga połowa wyższa
+    Falling     ///< Druga połowa niższa
+};
+
+/**
+ * @brief Podsumowanie zakresu pomiarów.
+ */
+struct RangeSummary
+{
+    RollupBucket total;         ///< Cały zakres
+    RollupBucket firstHalf;     ///< Pierwsza połowa wartości
+    RollupBucket secondHalf;    ///< Druga połowa (może być o jedną wartość dłuższa)
+
+    /**
+     * @brief Wyznacza trend z połówek zakresu.
+     */
+    Trend trend() const;
+};
+
+/**
+ * @brief Statystyki serii pomiarowych.
+ */
+namespace MeasurementStatistics
+{
+    /**
+     * @brief Podsumowuje wartości zmierzone serii w zakresie czasu.
+     * @param series Seria godzinowa.
+     * @param fromMs Początek zakresu (ms od epoki).
+     * @param toMs Koniec zakresu (ms od epoki).
+     */
+    RangeSummary summarize(const MeasurementSeries& series, qint64 fromMs, qint64 toMs);
+
+    /**
+     * @brief Podsumowuje agregaty (chronologicznie).
+     */
+    RangeSummary summarize(const QVector<RollupBucket>& buckets);
+
+    /**
+     * @brief Zwraca nazwę trendu wyświetlaną użytkownikowi.
+     */
+    QString trendName(Trend trend);
+}
@@ -0,0 +1,44 @@
+﻿/**
+ * @file Parallel.cpp
+ * @brief Implementacja równoległej pętli z podziałem fork/join.
+ */
+
+#include "Parallel.h"
+#include <algorithm>
+
+namespace
+{
+    constexpr int kChunksPerWorker = 4;     ///< Fragmenty na wątek przy automatycznym podziale
+
+    /**
+     * @brief Dzieli zakres na połowy, oddając prawą do kradzieży, i wykonuje resztę.
+     */
+    void split(TaskGroup& group, int begin, int end, int grain, const std::function<void(int)>& body)
+    {
+        while (end - begin > grain) {
+            const int mid = begin + (end - begin) / 2;
+            group.run([&group, mid, end, grain, &body]() { split(group, mid, end, grain, body); });
+            end = mid;
+        }
+        for (int i = begin; i < end && !group.isCancelled(); ++i)
+            body(i);
+    }
+}
+
+namespace Parallel
+{
+    void forEach(int count, const std::function<void(int)>& body, const Options& options)
+    {
+        if (count <= 0)
+            return;
+
+        TaskScheduler& scheduler = TaskScheduler::instance();
+        const int grain = options.grain > 0
+            ? options.grain
+            : std::max(1, count / (scheduler.workerCount() * kChunksPerWorker));
+
+        TaskGroup group(TaskScheduler::currentPriority(), options.cancel, scheduler);
+        split(group, 0, count, grain, body);
+        group.wait();
+    }
+}
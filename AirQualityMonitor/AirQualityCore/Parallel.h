@@ -0,0 +1,87 @@
+﻿/**
+ * @file Parallel.h
+ * @brief Równoległe pętle i mapowanie na planiście TaskScheduler.
+ *
+ * Zakres dzielony jest rekurencyjnie na połowy; jedna połowa trafia do
+ * kolejki bieżącego wątku (skąd mogą ją ukraść inne wątki), drugą wątek
+ * dzieli dalej sam. Wywołania zagnieżdżone (np. korelacje wielu stacji,
+ * z których każda liczy pary kolumn równolegle) korzystają z tych samych
+ * wątków bez ryzyka ich wyczerpania.
+ *
+ * @author Jakub Frąckowiak
+ * @date Maj 2025
+ */
+
+#pragma once
+
+#include "TaskScheduler.h"
+#include <QVector>
+#include <functional>
+#include <type_traits>
+
+namespace Parallel
+{
+    /**
+     * @brief Opcje równoległej pętli.
+     */
+    struct Options
+    {
+        int grain = 0;                      ///< Najmniejszy fragment zakresu (0 - dobierany do liczby wątków)
+        Async::CancellationToken cancel;    ///< Anulowanie - pozostałe indeksy są pomijane
+    };
+
+    /**
+     * @brief Wykonuje body(i) dla i z [0, count) i czeka na zakończenie.
+     *
+     * Zadania mają priorytet zadania bieżącego (TaskScheduler::currentPriority).
+     */
+    void forEach(int count, const std::function<void(int)>& body, const Options& options = Options());
+
+    /**
+     * @brief Zwraca wyniki funkcji dla kolejnych elementów, w ich kolejności.
+     */
+    template<typename Sequence, typename Function>
+    auto map(const Sequence& items, Function function, const Options& options = Options())
+    {
+        using Result = std::decay_t<std::invoke_result_t<Function&, const typename Sequence::value_type&>>;
+        QVector<Result> results(items.size());
+        Result* out = results.data();
+        forEach(int(items.size()), [&items, &function, out](int i) {
+            out[i] = std::invoke(function, items[i]);
+            }, options);
+        return results;
+    }
+
+    /**
+     * @brief Wykonuje funkcję w planiście; wynik odbierany jest w wątku aplikacji.
+     *
+     * @code
+     * const CorrelationResult result = co_await Parallel::run([columns]() {
+     *     return CorrelationAnalysis::correlate(columns);
+     *     }, TaskPriority::Interactive);
+     * @endcode
+     */
+    template<typename Function>
+    auto run(Function function, TaskPriority priority = TaskPriority::Normal)
+    {
+        using Result = std::invoke_result_t<Function&>;
+        Async::TaskSource<Result> source;
+        TaskScheduler::instance().submit([source, function]() mutable {
+            try {
+                if constexpr (std::is_void_v<Result>) {
+                    function();
+                    Async::detail::post([source]() { source.complete(); });
+                }
+                else {
+                    Result result = function();
+                    Async::detail::post([source, result]() { source.complete(result); });
+                }
+            }
+            catch (...) {
+                const std::exception_ptr error = std::current_exception();
+                Async::detail::post([source, error]() { source.fail(error); });
+            }
+            }, priority);
+        return source.task();
+    }
+}
@@ -0,0 +1,102 @@
+﻿/**
+ * @file Records.h
+ * @brief Typowane rekordy stacji i sensorów.
+ *
+ * Dane z API GIOŚ są przechowywane jako JSON; widoki list i wyszukiwanie
+ * korzystają z tych lekkich struktur zamiast odczytywać pola obiektów JSON
+ * przy każdym wierszu.
+ *
+ * @author Jakub Frąckowiak
+ * @date Maj 2025
+ */
+
+#pragma once
+
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QString>
+#include <QVector>
+
+/**
+ * @brief Punkt na powierzchni Ziemi.
+ */
+struct GeoPoint
+{
+    double lat = 0.0;   ///< Szerokość geograficzna
+    double lon = 0.0;   ///< Długość geograficzna
+};
+
+/**
+ * @brief Stacja pomiarowa.
+ */
+struct StationRecord
+{
+    int id = -1;            ///< ID stacji
+    QString name;           ///< Nazwa stacji
+    double lat = 0.0;       ///< Szerokość geograficzna
+    double lon = 0.0;       ///< Długość geograficzna
+    QString city;           ///< Miejscowość
+    QString commune;        ///< Gmina
+    QString district;       ///< Powiat
+    QString street;         ///< Ulica
+
+    /**
+     * @brief Tworzy rekord z obiektu JSON zwracanego przez API.
+     */
+    static StationRecord fromJson(const QJsonObject& obj)
+    {
+        StationRecord record;
+        record.id = obj.value("id").toInt();
+        record.name = obj.value("stationName").toString();
+        record.lat = obj.value("gegrLat").toString().toDouble();
+        record.lon = obj.value("gegrLon").toString().toDouble();
+        const QJsonObject city = obj.value("city").toObject();
+        const QJsonObject commune = city.value("commune").toObject();
+        record.city = city.value("name").toString();
+        record.commune = commune.value("communeName").toString();
+        record.district = commune.value("districtName").toString();
+        record.street = obj.value("addressStreet").toString();
+        return record;
+    }
+
+    /**
+     * @brief Tworzy rekordy wszystkich stacji z tablicy JSON.
+     */
+    static QVector<StationRecord> fromJson(const QJsonArray& array)
+    {
+        QVector<StationRecord> records;
+        records.reserve(array.size());
+        for (const QJsonValue& value : array)
+            records.append(fromJson(value.toObject()));
+        return records;
+    }
+};
+
+/**
+ * @brief Sensor stacji pomiarowej.
+ */
+struct SensorRecord
+{
+    int id = -1;            ///< ID sensora
+    int stationId = -1;     ///< ID stacji sensora
+    QString paramName;      ///< Nazwa mierzonego parametru
+    QString paramCode;      ///< Kod parametru (np. PM10)
+
+    /**
+     * @brief Zwraca nazwę wyświetlaną w formacie "nazwa (kod)".
+     */
+    QString displayName() const { return QString("%1 (%2)").arg(paramName, paramCode); }
+
+    /**
+     * @brief Tworzy rekord z obiektu JSON zwracanego przez API.
+     */
+    static SensorRecord fromJson(const QJsonObject& obj)
+    {
+        SensorRecord record;
+        record.id = obj.value("id").toInt();
+        record.stationId = obj.value("stationId").toInt(-1);
+        record.paramName = obj.value("param").toObject().value("paramName").toString();
+        record.paramCode = obj.value("param").toObject().value("paramCode").toString();
+        return record;
+    }
+};
@@ -0,0 +1,193 @@
+﻿/**
+ * @file Rollups.cpp
+ * @brief Implementacja agregatów dziennych i miesięcznych.
+ */
+
+#include "Rollups.h"
+#include <QDateTime>
+#include <QSet>
+#include <algorithm>
+#include <cmath>
+
+void RollupBucket::add(double value)
+{
+    if (count == 0) {
+        min = value;
+        max = value;
+    }
+    else {
+        min = std::min(min, value);
+        max = std::max(max, value);
+    }
+    ++count;
+    sum += value;
+    sumSquares += value * value;
+}
+
+void RollupBucket::merge(const RollupBucket& other)
+{
+    if (other.count == 0)
+        return;
+    if (count == 0) {
+        *this = other;
+        return;
+    }
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+    count += other.count;
+    sum += other.sum;
+    sumSquares += other.sumSquares;
+}
+
+qint64 RollupStore::dayKey(qint64 ms)
+{
+    return QDateTime::fromMSecsSinceEpoch(ms).date().toJulianDay();
+}
+
+qint64 RollupStore::monthKey(qint64 ms)
+{
+    const QDate date = QDateTime::fromMSecsSinceEpoch(ms).date();
+    return qint64(date.year()) * 12 + date.month() - 1;
+}
+
+void RollupStore::addPoint(SensorRollups& rollups, qint64 ms, double value)
+{
+    const QDate date = QDateTime::fromMSecsSinceEpoch(ms).date();
+
+    RollupBucket& day = rollups.daily[date.toJulianDay()];
+    if (day.count == 0)
+        day.startMs = date.startOfDay().toMSecsSinceEpoch();
+    day.add(value);
+
+    RollupBucket& month = rollups.monthly[qint64(date.year()) * 12 + date.month() - 1];
+    if (month.count == 0)
+        month.startMs = QDate(date.year(), date.month(), 1).startOfDay().toMSecsSinceEpoch();
+    month.add(value);
+}
+
+bool RollupStore::removePoint(QMap<qint64, RollupBucket>& table, qint64 key, double value)
+{
+    auto it = table.find(key);
+    if (it == table.end())
+        return true;
+
+    RollupBucket& bucket = it.value();
+    // Usunięcie skrajnej wartości wymaga przeliczenia przedziału
+    if (bucket.count <= 1 || value <= bucket.min || value >= bucket.max)
+        return false;
+
+    --bucket.count;
+    bucket.sum -= value;
+    bucket.sumSquares -= value * value;
+    return true;
+}
+
+void RollupStore::recompute(QMap<qint64, RollupBucket>& table, qint64 key, bool monthly, const MeasurementSeries& merged)
+{
+    QDate first = monthly
+        ? QDate(int(key / 12), int(key % 12) + 1, 1)
+        : QDate::fromJulianDay(key);
+    QDate last = monthly ? first.addMonths(1) : first.addDays(1);
+
+    const qint64 fromMs = first.startOfDay().toMSecsSinceEpoch();
+    const qint64 toMs = last.startOfDay().toMSecsSinceEpoch();
+
+    RollupBucket bucket;
+    bucket.startMs = fromMs;
+    const int begin = std::max(0, merged.indexOf(fromMs));
+    const int end = std::min(merged.size(), merged.indexOf(toMs) + 1);
+    for (int i = begin; i < end; ++i) {
+        const qint64 ms = merged.timeAt(i);
+        if (ms >= fromMs && ms < toMs && merged.validity.testBit(i))
+            bucket.add(merged.values[i]);
+    }
+
+    if (bucket.count == 0)
+        table.remove(key);
+    else
+        table.insert(key, bucket);
+}
+
+void RollupStore::rebuild(int sensorId, const MeasurementSeries& series)
+{
+    SensorRollups rollups;
+    for (int i = 0; i < series.size(); ++i) {
+        if (series.validity.testBit(i))
+            addPoint(rollups, series.timeAt(i), series.values[i]);
+    }
+    sensors.insert(sensorId, rollups);
+}
+
+void RollupStore::update(int sensorId, const QVector<MeasurementChange>& changes, const MeasurementSeries& merged)
+{
+    if (!sensors.contains(sensorId)) {
+        rebuild(sensorId, merged);
+        return;
+    }
+
+    SensorRollups& rollups = sensors[sensorId];
+    QSet<qint64> dirtyDays;
+    QSet<qint64> dirtyMonths;
+
+    for (const MeasurementChange& change : changes) {
+        const qint64 day = dayKey(change.ms);
+        const qint64 month = monthKey(change.ms);
+
+        if (!std::isnan(change.oldValue)) {
+            if (!dirtyDays.contains(day) && !removePoint(rollups.daily, day, change.oldValue))
+                dirtyDays.insert(day);
+            if (!dirtyMonths.contains(month) && !removePoint(rollups.monthly, month, change.oldValue))
+                dirtyMonths.insert(month);
+        }
+
+        if (std::isnan(change.newValue))
+            continue;
+
+        // Przedziały oznaczone do przeliczenia i tak uwzględnią nową wartość
+        if (!dirtyDays.contains(day)) {
+            RollupBucket& bucket = rollups.daily[day];
+            if (bucket.count == 0)
+                bucket.startMs = QDate::fromJulianDay(day).startOfDay().toMSecsSinceEpoch();
+            bucket.add(change.newValue);
+        }
+        if (!dirtyMonths.contains(month)) {
+            RollupBucket& bucket = rollups.monthly[month];
+            if (bucket.count == 0)
+                bucket.startMs = QDate(int(month / 12), int(month % 12) + 1, 1).startOfDay().toMSecsSinceEpoch();
+            bucket.add(change.newValue);
+        }
+    }
+
+    for (qint64 day : dirtyDays)
+        recompute(rollups.daily, day, false, merged);
+    for (qint64 month : dirtyMonths)
+        recompute(rollups.monthly, month, true, merged);
+}
+
+QVector<RollupBucket> RollupStore::range(int sensorId, RollupResolution resolution, qint64 fromMs, qint64 toMs) const
+{
+    QVector<RollupBucket> result;
+    auto sensor = sensors.constFind(sensorId);
+    if (sensor == sensors.constEnd() || resolution == RollupResolution::Hourly)
+        return result;
+
+    const bool monthly = resolution == RollupResolution::Monthly;
+    const QMap<qint64, RollupBucket>& table = monthly ? sensor->monthly : sensor->daily;
+    const qint64 fromKey = monthly ? monthKey(fromMs) : dayKey(fromMs);
+    const qint64 toKey = monthly ? monthKey(toMs) : dayKey(toMs);
+
+    for (auto it = table.lowerBound(fromKey); it != table.constEnd() && it.key() <= toKey; ++it)
+        result.append(it.value());
+
+    return result;
+}
+
+RollupResolution RollupStore::resolutionFor(qint64 spanMs, int maxRows)
+{
+    const qint64 hours = spanMs / MeasurementSeries::kHourMs + 1;
+    if (hours <= maxRows)
+        return RollupResolution::Hourly;
+    if (hours / 24 + 1 <= maxRows)
+        return RollupResolution::Daily;
+    return RollupResolution::Monthly;
+}
@@ -0,0 +1,129 @@
+﻿/**
+ * @file Rollups.h
+ * @brief Zmaterializowane agregaty dzienne i miesięczne pomiarów.
+ *
+ * Dla każdego sensora przechowywane są tabele agregatów (liczność, suma,
+ * minimum, maksimum, suma kwadratów) aktualizowane przyrostowo przy scalaniu
+ * nowych pomiarów. Warstwa prezentacji wybiera rozdzielczość odpowiednią
+ * do zakresu dat, dzięki czemu widok roczny dotyka setek wierszy zamiast
+ * dziesiątek tysięcy pomiarów godzinowych.
+ *
+ * @author Jakub Frąckowiak
+ * @date Maj 2025
+ */
+
+#pragma once
+
+#include "GapAnalysis.h"
+#include <QHash>
+#include <QMap>
+#include <QVector>
+
+/**
+ * @brief Rozdzielczość danych używana do prezentacji.
+ */
+enum class RollupResolution
+{
+    Hourly,     ///< Surowe pomiary godzinowe
+    Daily,      ///< Agregaty dobowe
+    Monthly     ///< Agregaty miesięczne
+};
+
+/**
+ * @brief Agregat pomiarów z jednego przedziału czasu.
+ */
+struct RollupBucket
+{
+    qint64 startMs = 0;         ///< Początek przedziału (ms od epoki)
+    int count = 0;              ///< Liczba pomiarów
+    double sum = 0.0;           ///< Suma wartości
+    double min = 0.0;           ///< Wartość minimalna
+    double max = 0.0;           ///< Wartość maksymalna
+    double sumSquares = 0.0;    ///< Suma kwadratów wartości
+
+    /**
+     * @brief Dodaje pomiar do agregatu.
+     */
+    void add(double value);
+
+    /**
+     * @brief Dołącza inny agregat (np. przy sumowaniu przedziałów).
+     */
+    void merge(const RollupBucket& other);
+
+    /**
+     * @brief Zwraca średnią wartość w przedziale.
+     */
+    double mean() const { return count > 0 ? sum / count : 0.0; }
+};
+
+/**
+ * @brief Zmiana pojedynczego pomiaru podczas scalania.
+ */
+struct MeasurementChange
+{
+    qint64 ms = 0;              ///< Czas pomiaru
+    double oldValue = 0.0;      ///< Poprzednia wartość (NaN, gdy jej nie było)
+    double newValue = 0.0;      ///< Nowa wartość (NaN, gdy pomiar usunięto)
+};
+
+/**
+ * @class RollupStore
+ * @brief Tabele agregatów wszystkich sensorów.
+ */
+class RollupStore
+{
+public:
+    /**
+     * @brief Sprawdza, czy agregaty sensora zostały już zbudowane.
+     */
+    bool contains(int sensorId) const { return sensors.contains(sensorId); }
+
+    /**
+     * @brief Buduje agregaty sensora od zera na podstawie serii.
+     * @param sensorId ID sensora.
+     * @param series Seria godzinowa; brane są tylko wartości zmierzone.
+     */
+    void rebuild(int sensorId, const MeasurementSeries& series);
+
+    /**
+     * @brief Aktualizuje agregaty sensora przyrostowo.
+     * @param sensorId ID sensora.
+     * @param changes Pomiary dodane lub zmienione podczas scalania.
+     * @param merged Seria po scaleniu, używana do przeliczenia przedziałów,
+     *        w których zmieniona wartość była minimum lub maksimum.
+     */
+    void update(int sensorId, const QVector<MeasurementChange>& changes, const MeasurementSeries& merged);
+
+    /**
+     * @brief Zwraca agregaty sensora w zakresie czasu.
+     * @param sensorId ID sensora.
+     * @param resolution Rozdzielczość Daily lub Monthly.
+     * @param fromMs Początek zakresu (ms od epoki).
+     * @param toMs Koniec zakresu (ms od epoki).
+     * @return Agregaty przedziałów zaczynających się w zakresie, chronologicznie.
+     */
+    QVector<RollupBucket> range(int sensorId, RollupResolution resolution, qint64 fromMs, qint64 toMs) const;
+
+    /**
+     * @brief Wybiera najdokładniejszą rozdzielczość mieszczącą się w limicie wierszy.
+     * @param spanMs Długość wybranego zakresu dat.
+     * @param maxRows Największa dopuszczalna liczba wierszy.
+     */
+    static RollupResolution resolutionFor(qint64 spanMs, int maxRows);
+
+private:
+    struct SensorRollups
+    {
+        QMap<qint64, RollupBucket> daily;     ///< Klucz: numer dnia juliańskiego
+        QMap<qint64, RollupBucket> monthly;   ///< Klucz: rok * 12 + miesiąc - 1
+    };
+
+    static qint64 dayKey(qint64 ms);
+    static qint64 monthKey(qint64 ms);
+    static void addPoint(SensorRollups& rollups, qint64 ms, double value);
+    static bool removePoint(QMap<qint64, RollupBucket>& table, qint64 key, double value);
+    static void recompute(QMap<qint64, RollupBucket>& table, qint64 key, bool monthly, const MeasurementSeries& merged);
+
+    QHash<int, SensorRollups> sensors;        ///< Agregaty według ID sensora
+};
@@ -0,0 +1,233 @@
+﻿/**
+ * @file RouteExposure.cpp
+ * @brief Implementacja obliczania narażenia wzdłuż trasy.
+ */
+
+#include "RouteExposure.h"
+#include "GeoDistance.h"
+#include "Parallel.h"
+#include <QXmlStreamReader>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+    constexpr double kSnapKm = 0.01;            ///< Bliżej stacji przyjmowana jest jej wartość
+    constexpr int kParallelMinRoutes = 2;       ///< Pojedyncza trasa liczona jest w bieżącym wątku
+    const double kNaN = std::numeric_limits<double>::quiet_NaN();
+
+    /// Najbliższe stacje ostatniego zapytania do drzewa
+    struct Neighbourhood
+    {
+        QVector<int> rows;      ///< k najbliższych stacji
+        double slackKm = -1.0;  ///< Droga, po której zbiór może się zmienić
+    };
+
+    GeoPoint lerp(const GeoPoint& a, const GeoPoint& b, double t)
+    {
+        return { a.lat + (b.lat - a.lat) * t, a.lon + (b.lon - a.lon) * t };
+    }
+}
+
+void RouteExposure::build(const QVector<StationRecord>& stations, const QHash<int, StationReading>& readings)
+{
+    QVector<StationRecord> measured;
+    points.clear();
+    values.clear();
+    for (const StationRecord& station : stations) {
+        const auto it = readings.constFind(station.id);
+        if (it == readings.constEnd() || std::isnan(it->value))
+            continue;
+        measured.append(station);
+        points.append({ station.lat, station.lon });
+        values.append(it->value);
+    }
+    tree.build(measured);
+}
+
+double RouteExposure::concentrationAt(const GeoPoint& point, const RouteExposureOptions& options) const
+{
+    QVector<GeoPoint> route{ point };
+    RouteExposureOptions single = options;
+    single.keepSamples = true;
+    const RouteExposureResult result = evaluate(route, single);
+    return result.samples.isEmpty() ? kNaN : result.samples.first().concentration;
+}
+
+RouteExposureResult RouteExposure::evaluate(const QVector<GeoPoint>& route, const RouteExposureOptions& options) const
+{
+    RouteExposureResult result;
+    QVector<double> distances;
+    const QVector<GeoPoint> samples = resample(route, options.spacingKm, &distances);
+    result.sampleCount = samples.size();
+    result.lengthKm = distances.isEmpty() ? 0.0 : distances.last();
+    result.hours = options.speedKmh > 0.0 ? result.lengthKm / options.speedKmh : 0.0;
+    if (samples.isEmpty() || tree.size() == 0)
+        return result;
+
+    const int k = std::max(1, std::min(options.neighbours, tree.size()));
+    Neighbourhood neighbourhood;
+    QVector<double> concentrations(samples.size(), kNaN);
+    if (options.keepSamples)
+        result.samples.resize(samples.size());
+
+    for (int i = 0; i < samples.size(); ++i) {
+        // Droga od poprzedniej próbki ogranicza zmianę odległości do każdej stacji
+        neighbourhood.slackKm -= i > 0 ? distances[i] - distances[i - 1] : 0.0;
+        if (neighbourhood.slackKm < 0.0) {
+            const QVector<StationDistance> found = tree.nearest(samples[i], k + 1);
+            neighbourhood.rows.clear();
+            for (int j = 0; j < std::min(k, int(found.size())); ++j)
+                neighbourhood.rows.append(found[j].row);
+            neighbourhood.slackKm = found.size() > k
+                ? (found[k].km - found[k - 1].km) / 2.0
+                : std::numeric_limits<double>::infinity();
+        }
+
+        double weighted = 0.0;
+        double weights = 0.0;
+        double nearestKm = std::numeric_limits<double>::infinity();
+        double snapped = kNaN;
+        for (int row : neighbourhood.rows) {
+            const double km = GeoDistance::haversineKm(samples[i], points[row]);
+            if (km > options.maxDistanceKm)
+                continue;
+            if (km < nearestKm) {
+                nearestKm = km;
+                if (km < kSnapKm)
+                    snapped = values[row];
+            }
+            const double w = 1.0 / std::pow(std::max(km, kSnapKm), options.power);
+            weighted += w * values[row];
+            weights += w;
+        }
+        if (weights > 0.0)
+            concentrations[i] = std::isnan(snapped) ? weighted / weights : snapped;
+
+        if (options.keepSamples)
+            result.samples[i] = { samples[i], distances[i], concentrations[i], weights > 0.0 ? nearestKm : kNaN };
+    }
+
+    // Całkowanie metodą trapezów; odcinek z jednym znanym końcem liczony jest w połowie
+    double coveredHours = 0.0;
+    for (int i = 0; i < samples.size(); ++i) {
+        if (!std::isnan(concentrations[i]))
+            result.peakConcentration = std::max(result.peakConcentration, concentrations[i]);
+        if (i == 0 || options.speedKmh <= 0.0)
+            continue;
+        const double segmentKm = distances[i] - distances[i - 1];
+        const double a = concentrations[i - 1];
+        const double b = concentrations[i];
+        if (std::isnan(a) && std::isnan(b))
+            continue;
+        double km = segmentKm;
+        double mean = 0.5 * (a + b);
+        if (std::isnan(a) || std::isnan(b)) {
+            km = segmentKm / 2.0;
+            mean = std::isnan(a) ? b : a;
+        }
+        result.coveredKm += km;
+        coveredHours += km / options.speedKmh;
+        result.dose += mean * km / options.speedKmh;
+    }
+
+    if (coveredHours > 0.0)
+        result.meanConcentration = result.dose / coveredHours;
+    else if (!std::isnan(concentrations.first()))
+        result.meanConcentration = concentrations.first();
+    result.inhaledUg = result.dose * options.ventilationM3h;
+    return result;
+}
+
+QVector<RouteExposureResult> RouteExposure::evaluate(const QVector<QVector<GeoPoint>>& routes,
+    const RouteExposureOptions& options) const
+{
+    auto evaluateRoute = [this, options](const QVector<GeoPoint>& route) { return evaluate(route, options); };
+    if (routes.size() < kParallelMinRoutes) {
+        QVector<RouteExposureResult> results;
+        for (const QVector<GeoPoint>& route : routes)
+            results.append(evaluateRoute(route));
+        return results;
+    }
+    return Parallel::map(routes, evaluateRoute);
+}
+
+QVector<GeoPoint> RouteExposure::resample(const QVector<GeoPoint>& route, double spacingKm, QVector<double>* distancesKm)
+{
+    QVector<GeoPoint> samples;
+    QVector<double> distances;
+    if (route.isEmpty()) {
+        if (distancesKm)
+            distancesKm->clear();
+        return samples;
+    }
+
+    samples.append(route.first());
+    distances.append(0.0);
+
+    double walkedKm = 0.0;
+    int next = 1;
+    for (int i = 1; i < route.size(); ++i) {
+        const double segmentKm = GeoDistance::haversineKm(route[i - 1], route[i]);
+        if (segmentKm <= 0.0)
+            continue;
+        if (spacingKm > 0.0) {
+            // Odległość próbki liczona od początku trasy - bez kumulacji błędu zaokrągleń
+            while (next * spacingKm < walkedKm + segmentKm) {
+                const double t = (next * spacingKm - walkedKm) / segmentKm;
+                samples.append(lerp(route[i - 1], route[i], t));
+                distances.append(next * spacingKm);
+                ++next;
+            }
+        }
+        else {
+            samples.append(route[i]);
+            distances.append(walkedKm + segmentKm);
+        }
+        walkedKm += segmentKm;
+    }
+
+    if (walkedKm > distances.last()) {
+        samples.append(route.last());
+        distances.append(walkedKm);
+    }
+
+    if (distancesKm)
+        *distancesKm = distances;
+    return samples;
+}
+
+QVector<QVector<GeoPoint>> RouteExposure::fromGpx(const QByteArray& gpx)
+{
+    QVector<QVector<GeoPoint>> routes;
+    QVector<GeoPoint> current;
+    QXmlStreamReader xml(gpx);
+
+    while (!xml.atEnd()) {
+        xml.readNext();
+        if (xml.isStartElement()) {
+            const auto name = xml.name();
+            if (name == QLatin1String("trkseg") || name == QLatin1String("rte")) {
+                current.clear();
+            }
+            else if (name == QLatin1String("trkpt") || name == QLatin1String("rtept")) {
+                bool latOk = false;
+                bool lonOk = false;
+                const double lat = xml.attributes().value(QLatin1String("lat")).toDouble(&latOk);
+                const double lon = xml.attributes().value(QLatin1String("lon")).toDouble(&lonOk);
+                if (latOk && lonOk)
+                    current.append({ lat, lon });
+            }
+        }
+        else if (xml.isEndElement()) {
+            const auto name = xml.name();
+            if ((name == QLatin1String("trkseg") || name == QLatin1String("rte")) && current.size() >= 2)
+                routes.append(current);
+        }
+    }
+
+    if (xml.hasError())
+        qWarning("Błąd odczytu GPX: %s", qPrintable(xml.errorString()));
+    return routes;
+}
@@ -0,0 +1,123 @@
+﻿/**
+ * @file RouteExposure.h
+ * @brief Narażenie na zanieczyszczenie wzdłuż trasy.
+ *
+ * Trasa (łamana zaimportowana z pliku GPX lub narysowana na mapie) jest
+ * próbkowana co stały odcinek. Stężenie w każdej próbce szacowane jest
+ * metodą odwrotnych odległości (IDW) z k najbliższych stacji mierzących
+ * parametr, a dawka to całka stężenia po czasie przejazdu (metoda trapezów).
+ *
+ * Kolejne próbki leżą blisko siebie, więc zbiór najbliższych stacji zmienia
+ * się rzadko: drzewo k-d pytane jest o k + 1 stacji, a dopóki przebyta droga
+ * jest mniejsza niż połowa różnicy odległości stacji k-tej i (k+1)-szej,
+ * wynik zapytania pozostaje ważny i przeliczane są tylko odległości do
+ * k znanych stacji. Wiele tras (np. alternatywnych) liczonych jest równolegle.
+ *
+ * @author Jakub Frąckowiak
+ * @date Maj 2025
+ */
+
+#pragma once
+
+#include "AirQualityIndex.h"
+#include "Records.h"
+#include "StationKdTree.h"
+#include <QByteArray>
+#include <QHash>
+#include <QVector>
+
+/**
+ * @brief Parametry obliczania narażenia.
+ */
+struct RouteExposureOptions
+{
+    double spacingKm = 0.1;         ///< Odstęp próbek wzdłuż trasy
+    double speedKmh = 15.0;         ///< Prędkość przejazdu
+    int neighbours = 4;             ///< Liczba stacji uśrednianych w próbce
+    double maxDistanceKm = 25.0;    ///< Stacje dalsze nie są brane pod uwagę
+    double power = 2.0;             ///< Wykładnik wag odwrotnych odległości
+    double ventilationM3h = 1.0;    ///< Wentylacja płuc (ok. 1 m³/h przy marszu lub jeździe rowerem)
+    bool keepSamples = false;       ///< Czy zwracać profil stężenia wzdłuż trasy
+};
+
+/**
+ * @brief Próbka trasy z oszacowanym stężeniem.
+ */
+struct RouteSample
+{
+    GeoPoint point;             ///< Położenie próbki
+    double km = 0.0;            ///< Odległość od początku trasy
+    double concentration = 0.0; ///< Stężenie w µg/m³ (NaN, gdy brak stacji w zasięgu)
+    double nearestKm = 0.0;     ///< Odległość do najbliższej użytej stacji
+};
+
+/**
+ * @brief Narażenie na trasie.
+ */
+struct RouteExposureResult
+{
+    double lengthKm = 0.0;          ///< Długość trasy
+    double hours = 0.0;             ///< Czas przejazdu
+    double coveredKm = 0.0;         ///< Długość odcinków z oszacowanym stężeniem
+    double dose = 0.0;              ///< Całka stężenia po czasie w µg·h/m³
+    double inhaledUg = 0.0;         ///< Wdychana masa zanieczyszczenia w µg
+    double meanConcentration = 0.0; ///< Średnie stężenie na pokrytych odcinkach
+    double peakConcentration = 0.0; ///< Najwyższe stężenie w próbce
+    int sampleCount = 0;            ///< Liczba próbek
+    QVector<RouteSample> samples;   ///< Profil trasy (gdy keepSamples)
+};
+
+/**
+ * @class RouteExposure
+ * @brief Pole stężenia jednego parametru i całkowanie go wzdłuż tras.
+ */
+class RouteExposure
+{
+public:
+    /**
+     * @brief Buduje pole stężenia ze stacji mających pomiar parametru.
+     * @param stations Stacje.
+     * @param readings Najnowsze pomiary parametru (ID stacji -> pomiar).
+     */
+    void build(const QVector<StationRecord>& stations, const QHash<int, StationReading>& readings);
+
+    /**
+     * @brief Zwraca liczbę stacji z pomiarem.
+     */
+    int stationCount() const { return values.size(); }
+
+    /**
+     * @brief Szacuje stężenie w punkcie.
+     * @return Stężenie w µg/m³ lub NaN, gdy w zasięgu nie ma stacji.
+     */
+    double concentrationAt(const GeoPoint& point, const RouteExposureOptions& options = RouteExposureOptions()) const;
+
+    /**
+     * @brief Liczy narażenie na trasie.
+     */
+    RouteExposureResult evaluate(const QVector<GeoPoint>& route, const RouteExposureOptions& options = RouteExposureOptions()) const;
+
+    /**
+     * @brief Liczy narażenie na wielu trasach naraz (równolegle).
+     */
+    QVector<RouteExposureResult> evaluate(const QVector<QVector<GeoPoint>>& routes,
+        const RouteExposureOptions& options = RouteExposureOptions()) const;
+
+    /**
+     * @brief Próbkuje łamaną co stały odcinek (z oboma końcami).
+     * @param distancesKm Opcjonalnie odległości próbek od początku trasy.
+     */
+    static QVector<GeoPoint> resample(const QVector<GeoPoint>& route, double spacingKm,
+        QVector<double>* distancesKm = nullptr);
+
+    /**
+     * @brief Odczytuje trasy z pliku GPX.
+     * @return Punkty każdego segmentu śladu (trkseg) i każdej trasy (rte).
+     */
+    static QVector<QVector<GeoPoint>> fromGpx(const QByteArray& gpx);
+
+private:
+    StationKdTree tree;         ///< Drzewo stacji z pomiarem
+    QVector<GeoPoint> points;   ///< Położenia stacji (numeracja drzewa)
+    QVector<double> values;     ///< Stężenia stacji (numeracja drzewa)
+};
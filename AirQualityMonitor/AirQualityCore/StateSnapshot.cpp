@@ -0,0 +1,367 @@
+﻿/**
+ * @file StateSnapshot.cpp
+ * @brief Implementacja zapisu i odczytu migawki stanu aplikacji.
+ */
+
+#include "StateSnapshot.h"
+#include <QBitArray>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <cstring>
+#include <type_traits>
+
+namespace
+{
+    constexpr char kMagic[4] = { 'A', 'Q', 'S', 'S' };
+    constexpr quint64 kFnvOffset = 14695981039346656037ULL;
+    constexpr quint64 kFnvPrime = 1099511628211ULL;
+
+    /**
+     * @brief Nagłówek pliku migawki (przed danymi).
+     */
+    struct Header
+    {
+        char magic[4];          ///< Znacznik formatu
+        quint32 version;        ///< Wersja formatu
+        quint64 sourceStamp;    ///< Odcisk plików JSON w chwili zapisu
+        quint64 payloadSize;    ///< Rozmiar danych za nagłówkiem
+        quint64 checksum;       ///< Skrót FNV-1a danych
+    };
+
+    /**
+     * @brief Skrót FNV-1a 64 (kontynuowany od podanej wartości).
+     */
+    quint64 fnv1a(const uchar* data, qint64 size, quint64 hash = kFnvOffset)
+    {
+        for (qint64 i = 0; i < size; ++i) {
+            hash ^= data[i];
+            hash *= kFnvPrime;
+        }
+        return hash;
+    }
+
+    /**
+     * @brief Zapis wartości i tablic w postaci binarnej.
+     */
+    class Writer
+    {
+    public:
+        template<typename T>
+        void value(const T& v)
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            buffer.append(reinterpret_cast<const char*>(&v), qsizetype(sizeof(T)));
+        }
+
+        template<typename T>
+        void array(const QVector<T>& v)
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            value<qint32>(qint32(v.size()));
+            buffer.append(reinterpret_cast<const char*>(v.constData()), qsizetype(v.size() * sizeof(T)));
+        }
+
+        void string(const QString& s)
+        {
+            value<qint32>(qint32(s.size()));
+            buffer.append(reinterpret_cast<const char*>(s.constData()), qsizetype(s.size() * sizeof(QChar)));
+        }
+
+        void bits(const QBitArray& b)
+        {
+            value<qint32>(qint32(b.size()));
+            buffer.append(b.bits(), (b.size() + 7) / 8);
+        }
+
+        QByteArray buffer;  ///< Zapisane dane
+    };
+
+    /**
+     * @brief Odczyt danych zapisanych przez Writer z obszaru pamięci.
+     *
+     * Każda długość sprawdzana jest względem pozostałych danych przed
+     * alokacją, więc uszkodzony plik kończy odczyt błędem, a nie awarią.
+     */
+    class Reader
+    {
+    public:
+        Reader(const uchar* data, qint64 size) : data(data), size(size) {}
+
+        /**
+         * @brief Czy odczyt się powiódł i zużył wszystkie dane.
+         */
+        bool ok() const { return !failed && pos == size; }
+
+        /**
+         * @brief Czy dotychczasowy odczyt się powiódł.
+         */
+        bool good() const { return !failed; }
+
+        void fail() { failed = true; }
+
+        template<typename T>
+        T value()
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            T v{};
+            read(&v, sizeof(T));
+            return v;
+        }
+
+        template<typename T>
+        QVector<T> array()
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            const qint32 n = count(sizeof(T));
+            QVector<T> v(n);
+            read(v.data(), n * qint64(sizeof(T)));
+            return v;
+        }
+
+        QString string()
+        {
+            const qint32 n = count(sizeof(QChar));
+            QString s(n, Qt::Uninitialized);
+            read(s.data(), n * qint64(sizeof(QChar)));
+            return s;
+        }
+
+        QBitArray bits()
+        {
+            const qint32 n = value<qint32>();
+            const qint64 bytes = (qint64(n) + 7) / 8;
+            if (failed || n < 0 || bytes > size - pos) {
+                failed = true;
+                return QBitArray();
+            }
+            const QBitArray b = QBitArray::fromBits(reinterpret_cast<const char*>(data + pos), n);
+            pos += bytes;
+            return b;
+        }
+
+    private:
+        qint32 count(qint64 elementSize)
+        {
+            const qint32 n = value<qint32>();
+            if (failed || n < 0 || n * elementSize > size - pos) {
+                failed = true;
+                return 0;
+            }
+            return n;
+        }
+
+        void read(void* target, qint64 bytes)
+        {
+            if (failed || bytes > size - pos) {
+                failed = true;
+                return;
+            }
+            if (bytes > 0)
+                std::memcpy(target, data + pos, size_t(bytes));
+            pos += bytes;
+        }
+
+        const uchar* data;      ///< Początek danych
+        qint64 size;            ///< Rozmiar danych
+        qint64 pos = 0;         ///< Pozycja odczytu
+        bool failed = false;    ///< Czy dane okazały się niepoprawne
+    };
+
+    void writeState(Writer& w, const AppState& state)
+    {
+        w.value<qint32>(qint32(state.stations.size()));
+        for (const StationRecord& station : state.stations) {
+            w.value(station.id);
+            w.string(station.name);
+            w.value(station.lat);
+            w.value(station.lon);
+            w.string(station.city);
+            w.string(station.commune);
+            w.string(station.district);
+            w.string(station.street);
+        }
+
+        w.value<qint32>(qint32(state.sensors.size()));
+        for (const SensorRecord& sensor : state.sensors) {
+            w.value(sensor.id);
+            w.value(sensor.stationId);
+            w.string(sensor.paramName);
+            w.string(sensor.paramCode);
+        }
+
+        w.value<qint32>(qint32(state.readings.size()));
+        for (const StationReadingChange& entry : state.readings) {
+            w.value(entry.stationId);
+            w.string(entry.paramCode);
+            w.value(entry.reading);
+        }
+
+        w.value(state.stationId);
+        w.value(state.sensorId);
+        w.value(state.rangeStartMs);
+        w.value(state.rangeEndMs);
+
+        const MeasurementSeries& series = state.series;
+        w.value(series.startMs);
+        w.array(series.values);
+        w.array(series.origin);
+        w.bits(series.validity);
+        w.value(series.measuredCount);
+        w.value(series.filledCount);
+
+        w.value<qint32>(qint32(state.pyramids.size()));
+        for (const DownsamplePyramid& pyramid : state.pyramids) {
+            w.value(pyramid.reductionMode());
+            w.value<qint32>(qint32(pyramid.levelPoints().size()));
+            for (const QVector<QPointF>& level : pyramid.levelPoints())
+                w.array(level);
+        }
+    }
+
+    void readState(Reader& r, AppState& state)
+    {
+        // Pętle kończą się przy pierwszym błędzie, więc błędna liczba rekordów nie wydłuża odczytu
+        const qint32 stationCount = r.value<qint32>();
+        for (qint32 i = 0; i < stationCount && r.good(); ++i) {
+            StationRecord station;
+            station.id = r.value<int>();
+            station.name = r.string();
+            station.lat = r.value<double>();
+            station.lon = r.value<double>();
+            station.city = r.string();
+            station.commune = r.string();
+            station.district = r.string();
+            station.street = r.string();
+            state.stations.append(station);
+        }
+
+        const qint32 sensorCount = r.value<qint32>();
+        for (qint32 i = 0; i < sensorCount && r.good(); ++i) {
+            SensorRecord sensor;
+            sensor.id = r.value<int>();
+            sensor.stationId = r.value<int>();
+            sensor.paramName = r.string();
+            sensor.paramCode = r.string();
+            state.sensors.append(sensor);
+        }
+
+        const qint32 readingCount = r.value<qint32>();
+        for (qint32 i = 0; i < readingCount && r.good(); ++i) {
+            StationReadingChange entry;
+            entry.stationId = r.value<int>();
+            entry.paramCode = r.string();
+            entry.reading = r.value<StationReading>();
+            state.readings.append(entry);
+        }
+
+        state.stationId = r.value<int>();
+        state.sensorId = r.value<int>();
+        state.rangeStartMs = r.value<qint64>();
+        state.rangeEndMs = r.value<qint64>();
+
+        MeasurementSeries& series = state.series;
+        series.startMs = r.value<qint64>();
+        series.values = r.array<double>();
+        series.origin = r.array<PointOrigin>();
+        series.validity = r.bits();
+        series.measuredCount = r.value<int>();
+        series.filledCount = r.value<int>();
+        if (series.origin.size() != series.values.size() || series.validity.size() != series.values.size())
+            r.fail();
+
+        const qint32 pyramidCount = r.value<qint32>();
+        for (qint32 i = 0; i < pyramidCount && r.good(); ++i) {
+            const DownsampleMode mode = r.value<DownsampleMode>();
+            if (mode != DownsampleMode::Lttb && mode != DownsampleMode::MinMax)
+                r.fail();
+
+            const qint32 levelCount = r.value<qint32>();
+            QVector<QVector<QPointF>> levels;
+            for (qint32 level = 0; level < levelCount && r.good(); ++level)
+                levels.append(r.array<QPointF>());
+
+            DownsamplePyramid pyramid;
+            pyramid.restore(levels, mode);
+            state.pyramids.append(pyramid);
+        }
+    }
+}
+
+bool StateSnapshot::save(const DataRepository& repository, const AppState& state, QString* error)
+{
+    Writer writer;
+    writeState(writer, state);
+
+    Header header;
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.sourceStamp = sourceStamp(repository);
+    header.payloadSize = quint64(writer.buffer.size());
+    header.checksum = fnv1a(reinterpret_cast<const uchar*>(writer.buffer.constData()), writer.buffer.size());
+
+    // Plik podmieniany dopiero po pełnym zapisie
+    QSaveFile file(repository.filePath(kFileName));
+    if (!file.open(QIODevice::WriteOnly)) {
+        if (error)
+            *error = file.errorString();
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(writer.buffer);
+    if (!file.commit()) {
+        if (error)
+            *error = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool StateSnapshot::load(const DataRepository& repository, AppState& state)
+{
+    QFile file(repository.filePath(kFileName));
+    if (!file.open(QIODevice::ReadOnly) || file.size() < qint64(sizeof(Header)))
+        return false;
+
+    // Plik mapowany do pamięci - sprawdzany i dekodowany bez kopii pośrednich
+    const uchar* data = file.map(0, file.size());
+    if (!data)
+        return false;
+
+    Header header;
+    std::memcpy(&header, data, sizeof(header));
+    const qint64 payloadSize = file.size() - qint64(sizeof(Header));
+    const uchar* payload = data + sizeof(Header);
+
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion
+        || header.payloadSize != quint64(payloadSize))
+        return false;
+    if (header.sourceStamp != sourceStamp(repository))
+        return false;
+    if (header.checksum != fnv1a(payload, payloadSize))
+        return false;
+
+    Reader reader(payload, payloadSize);
+    AppState loaded;
+    readState(reader, loaded);
+    if (!reader.ok())
+        return false;
+
+    state = std::move(loaded);
+    return true;
+}
+
+quint64 StateSnapshot::sourceStamp(const DataRepository& repository)
+{
+    quint64 stamp = kFnvOffset;
+    for (const char* name : { DataRepository::kStationsFile, DataRepository::kSensorsFile, DataRepository::kMeasurementsFile }) {
+        const QFileInfo info(repository.filePath(name));
+        const qint64 parts[] = {
+            info.exists() ? info.size() : -1,
+            info.exists() ? info.lastModified().toMSecsSinceEpoch() : 0
+        };
+        stamp = fnv1a(reinterpret_cast<const uchar*>(parts), sizeof(parts), stamp);
+    }
+    return stamp;
+}
@@ -0,0 +1,75 @@
+﻿/**
+ * @file StateSnapshot.h
+ * @brief Migawka stanu aplikacji do szybkiego uruchomienia.
+ *
+ * Przy zamknięciu okna zapisywane są w jednym pliku binarnym przetworzone
+ * stacje i sensory, najnowsze pomiary stacji, ostatnio oglądana stacja
+ * i sensor, zakres dat oraz gotowa seria i piramidy wykresu. Przy starcie
+ * plik jest mapowany do pamięci, sprawdzany (nagłówek, wersja, suma
+ * kontrolna, zgodność z plikami JSON) i odtwarzany bez parsowania JSON,
+ * więc czas do pierwszego użytecznego widoku nie zależy od liczby
+ * zapisanych pomiarów.
+ *
+ * Migawka jest tylko pamięcią podręczną - przy zmianie któregokolwiek
+ * pliku JSON (np. po synchronizacji z wiersza poleceń), innej wersji
+ * formatu lub uszkodzeniu pliku jest pomijana, a dane wczytywane zwykłą
+ * drogą. Format zależy od architektury (zapis bez konwersji kolejności
+ * bajtów), bo plik nie opuszcza komputera, na którym powstał.
+ *
+ * @author Jakub Frąckowiak
+ * @date Maj 2025
+ */
+
+#pragma once
+
+#include "AirQualityIndex.h"
+#include "DataRepository.h"
+#include "Downsampling.h"
+#include "GapAnalysis.h"
+#include "Records.h"
+#include <QVector>
+
+/**
+ * @brief Stan aplikacji zapisywany w migawce.
+ */
+struct AppState
+{
+    QVector<StationRecord> stations;            ///< Wszystkie stacje
+    QVector<SensorRecord> sensors;              ///< Sensory wszystkich stacji
+    QVector<StationReadingChange> readings;     ///< Najnowsze pomiary stacji według parametru
+    int stationId = -1;                         ///< Ostatnio oglądana stacja
+    int sensorId = -1;                          ///< Ostatnio oglądany sensor
+    qint64 rangeStartMs = 0;                    ///< Początek wybranego zakresu dat
+    qint64 rangeEndMs = 0;                      ///< Koniec wybranego zakresu dat
+    MeasurementSeries series;                   ///< Seria ostatnio oglądanego sensora
+    QVector<DownsamplePyramid> pyramids;        ///< Piramidy ciągłych fragmentów serii
+};
+
+/**
+ * @class StateSnapshot
+ * @brief Zapis i odczyt migawki stanu w katalogu danych.
+ */
+class StateSnapshot
+{
+public:
+    static constexpr const char* kFileName = "state.snapshot";  ///< Plik migawki
+    static constexpr quint32 kVersion = 1;                      ///< Wersja formatu
+
+    /**
+     * @brief Zapisuje migawkę (atomowo - przerwany zapis nie niszczy poprzedniej).
+     * @param error Opcjonalnie opis błędu.
+     */
+    static bool save(const DataRepository& repository, const AppState& state, QString* error = nullptr);
+
+    /**
+     * @brief Odczytuje migawkę.
+     * @return False, gdy brak pliku, jest uszkodzony, ma inną wersję
+     *         albo pliki JSON zmieniły się od jej zapisu.
+     */
+    static bool load(const DataRepository& repository, AppState& state);
+
+    /**
+     * @brief Zwraca odcisk plików JSON (rozmiary i czasy modyfikacji).
+     */
+    static quint64 sourceStamp(const DataRepository& repository);
+};
@@ -0,0 +1,148 @@
+﻿/**
+ * @file StationGrid.cpp
+ * @brief Implementacja siatkowego indeksu stacji.
+ */
+
+#include "StationGrid.h"
+#include <algorithm>
+#include <cmath>
+
+quint64 StationGridIndex::cellKey(int latIndex, int lonIndex)
+{
+    return (quint64(quint32(latIndex)) << 32) | quint32(lonIndex);
+}
+
+void StationGridIndex::build(const QVector<StationRecord>& stations)
+{
+    records = stations;
+    cells.clear();
+
+    for (int row = 0; row < records.size(); ++row) {
+        const StationRecord& station = records[row];
+        Cell& cell = cells[cellKey(cellIndex(station.lat), cellIndex(station.lon))];
+        cell.rows.append(row);
+        cell.sumLat += station.lat;
+        cell.sumLon += station.lon;
+    }
+}
+
+template <typename Visitor>
+void StationGridIndex::visitCells(const MapViewport& view, Visitor visit) const
+{
+    const int latFrom = cellIndex(view.south);
+    const int latTo = cellIndex(view.north);
+    const int lonFrom = cellIndex(view.west);
+    const int lonTo = cellIndex(view.east);
+    if (latTo < latFrom || lonTo < lonFrom)
+        return;
+
+    // Komórka leży w całości w obszarze - jej stacji nie trzeba sprawdzać pojedynczo
+    auto inside = [&](int latIndex, int lonIndex) {
+        return latIndex > latFrom && latIndex < latTo && lonIndex > lonFrom && lonIndex < lonTo;
+    };
+
+    const qint64 viewCells = qint64(latTo - latFrom + 1) * (lonTo - lonFrom + 1);
+    if (viewCells > cells.size()) {
+        // Duży obszar (małe przybliżenie) - taniej przejrzeć niepuste komórki
+        for (auto it = cells.constBegin(); it != cells.constEnd(); ++it) {
+            const int latIndex = int(qint32(it.key() >> 32));
+            const int lonIndex = int(qint32(it.key() & 0xffffffffu));
+            if (latIndex >= latFrom && latIndex <= latTo && lonIndex >= lonFrom && lonIndex <= lonTo)
+                visit(it.value(), inside(latIndex, lonIndex));
+        }
+        return;
+    }
+
+    for (int latIndex = latFrom; latIndex <= latTo; ++latIndex) {
+        for (int lonIndex = lonFrom; lonIndex <= lonTo; ++lonIndex) {
+            auto it = cells.constFind(cellKey(latIndex, lonIndex));
+            if (it != cells.constEnd())
+                visit(it.value(), inside(latIndex, lonIndex));
+        }
+    }
+}
+
+QVector<int> StationGridIndex::query(const MapViewport& view) const
+{
+    QVector<int> result;
+    visitCells(view, [&](const Cell& cell, bool inside) {
+        for (int row : cell.rows) {
+            if (inside || view.contains(records[row].lat, records[row].lon))
+                result.append(row);
+        }
+        });
+    return result;
+}
+
+int StationGridIndex::count(const MapViewport& view) const
+{
+    int total = 0;
+    visitCells(view, [&](const Cell& cell, bool inside) {
+        if (inside) {
+            total += cell.rows.size();
+            return;
+        }
+        for (int row : cell.rows) {
+            if (view.contains(records[row].lat, records[row].lon))
+                ++total;
+        }
+        });
+    return total;
+}
+
+QVector<StationCluster> StationGridIndex::clusters(const MapViewport& view, double clusterDegrees,
+    const QVector<int>& levels) const
+{
+    struct Bucket
+    {
+        double sumLat = 0.0;
+        double sumLon = 0.0;
+        int count = 0;
+        int row = -1;
+        int level = -1;
+    };
+    QHash<quint64, Bucket> buckets;
+
+    auto bucketFor = [&](double lat, double lon) -> Bucket& {
+        return buckets[cellKey(int(std::floor(lat / clusterDegrees)), int(std::floor(lon / clusterDegrees)))];
+    };
+    auto addLevel = [&levels](Bucket& bucket, int row) {
+        if (row < levels.size())
+            bucket.level = std::max(bucket.level, levels[row]);
+    };
+
+    visitCells(view, [&](const Cell& cell, bool inside) {
+        if (inside && clusterDegrees >= kCellDegrees) {
+            // Cała komórka trafia do jednej grupy - wystarczą jej sumy
+            const double centerLat = cell.sumLat / cell.rows.size();
+            const double centerLon = cell.sumLon / cell.rows.size();
+            Bucket& bucket = bucketFor(centerLat, centerLon);
+            bucket.sumLat += cell.sumLat;
+            bucket.sumLon += cell.sumLon;
+            bucket.count += cell.rows.size();
+            bucket.row = cell.rows.first();
+            for (int row : cell.rows)
+                addLevel(bucket, row);
+            return;
+        }
+        for (int row : cell.rows) {
+            const StationRecord& station = records[row];
+            if (!view.contains(station.lat, station.lon))
+                continue;
+            Bucket& bucket = bucketFor(station.lat, station.lon);
+            bucket.sumLat += station.lat;
+            bucket.sumLon += station.lon;
+            ++bucket.count;
+            bucket.row = row;
+            addLevel(bucket, row);
+        }
+        });
+
+    QVector<StationCluster> result;
+    result.reserve(buckets.size());
+    for (const Bucket& bucket : buckets) {
+        result.append({ bucket.sumLat / bucket.count, bucket.sumLon / bucket.count, bucket.count,
+            bucket.count == 1 ? bucket.row : -1, bucket.level });
+    }
+    return result;
+}
@@ -0,0 +1,108 @@
+﻿/**
+ * @file StationGrid.h
+ * @brief Siatkowy indeks przestrzenny stacji dla widocznego obszaru mapy.
+ *
+ * Stacje są rozłożone w komórkach siatki o stałym rozmiarze w stopniach.
+ * Zapytanie o prostokąt widoku odwiedza tylko komórki, które go przecinają,
+ * a przy małym przybliżeniu zwraca zamiast pojedynczych stacji grupy
+ * (liczność, środek i najgorsza klasa indeksu), liczone z sum
+ * przechowywanych w komórkach.
+ *
+ * @author Jakub Frąckowiak
+ * @date Maj 2025
+ */
+
+#pragma once
+
+#include "Records.h"
+#include <QHash>
+#include <QVector>
+#include <cmath>
+
+/**
+ * @brief Widoczny obszar mapy.
+ */
+struct MapViewport
+{
+    double south = 0.0;     ///< Południowa krawędź (szerokość geograficzna)
+    double west = 0.0;      ///< Zachodnia krawędź (długość geograficzna)
+    double north = 0.0;     ///< Północna krawędź
+    double east = 0.0;      ///< Wschodnia krawędź
+    int zoom = -1;          ///< Poziom przybliżenia (-1, gdy mapa nie zgłosiła widoku)
+
+    /**
+     * @brief Sprawdza, czy punkt leży w obszarze.
+     */
+    bool contains(double lat, double lon) const
+    {
+        return lat >= south && lat <= north && lon >= west && lon <= east;
+    }
+};
+
+/**
+ * @brief Grupa stacji wyświetlana jako jeden znacznik.
+ */
+struct StationCluster
+{
+    double lat = 0.0;       ///< Środek grupy
+    double lon = 0.0;       ///< Środek grupy
+    int count = 0;          ///< Liczba stacji w grupie
+    int row = -1;           ///< Numer stacji, gdy grupa ma tylko jedną
+    int level = -1;         ///< Najgorsza klasa indeksu stacji grupy (-1, gdy żadna nie jest znana)
+};
+
+/**
+ * @class StationGridIndex
+ * @brief Indeks stacji w siatce komórek o stałym rozmiarze.
+ */
+class StationGridIndex
+{
+public:
+    static constexpr double kCellDegrees = 0.1;    ///< Rozmiar komórki siatki w stopniach
+
+    /**
+     * @brief Buduje indeks dla zestawu stacji.
+     */
+    void build(const QVector<StationRecord>& stations);
+
+    /**
+     * @brief Zwraca zestaw stacji, dla którego zbudowano indeks.
+     */
+    const QVector<StationRecord>& stations() const { return records; }
+
+    /**
+     * @brief Zwraca numery stacji leżących w obszarze.
+     */
+    QVector<int> query(const MapViewport& view) const;
+
+    /**
+     * @brief Liczy stacje w obszarze.
+     */
+    int count(const MapViewport& view) const;
+
+    /**
+     * @brief Grupuje stacje obszaru w kratki o zadanym rozmiarze.
+     * @param view Obszar mapy.
+     * @param clusterDegrees Rozmiar kratki grupowania w stopniach.
+     * @param levels Klasy indeksu stacji według numeru (pusta - grupy bez klasy).
+     */
+    QVector<StationCluster> clusters(const MapViewport& view, double clusterDegrees,
+        const QVector<int>& levels = QVector<int>()) const;
+
+private:
+    struct Cell
+    {
+        QVector<int> rows;      ///< Numery stacji w komórce
+        double sumLat = 0.0;    ///< Suma szerokości (do środka grupy)
+        double sumLon = 0.0;    ///< Suma długości
+    };
+
+    static int cellIndex(double degrees) { return int(std::floor(degrees / kCellDegrees)); }
+    static quint64 cellKey(int latIndex, int lonIndex);
+
+    template <typename Visitor>
+    void visitCells(const MapViewport& view, Visitor visit) const;
+
+    QVector<StationRecord> records;     ///< Zaindeksowane stacje
+    QHash<quint64, Cell> cells;         ///< Niepuste komórki siatki
+};
@@ -0,0 +1,215 @@
+﻿/**
+ * @file StationKdTree.cpp
+ * @brief Implementacja drzewa k-d stacji.
+ */
+
+#include "StationKdTree.h"
+#include "Parallel.h"
+#include <QtMath>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <queue>
+#include <utility>
+
+namespace
+{
+    constexpr double kPi = 3.14159265358979323846;  ///< Liczba pi
+    constexpr int kParallelMinQueries = 4;          ///< Mniej punktów zapytania liczonych jest w bieżącym wątku
+}
+
+StationKdTree::Vec StationKdTree::unitVector(const GeoPoint& point)
+{
+    const double lat = qDegreesToRadians(point.lat);
+    const double lon = qDegreesToRadians(point.lon);
+    const double cosLat = std::cos(lat);
+    return { cosLat * std::cos(lon), cosLat * std::sin(lon), std::sin(lat) };
+}
+
+double StationKdTree::chord2(const Vec& a, const Vec& b)
+{
+    const double dx = a[0] - b[0];
+    const double dy = a[1] - b[1];
+    const double dz = a[2] - b[2];
+    return dx * dx + dy * dy + dz * dz;
+}
+
+double StationKdTree::kmToChord2(double km)
+{
+    const double angle = std::min(km / kEarthRadiusKm, kPi);
+    const double chord = 2.0 * std::sin(angle / 2.0);
+    return chord * chord;
+}
+
+double StationKdTree::chord2ToKm(double chord2)
+{
+    // Cięciwa c odpowiada kątowi środkowemu 2 * asin(c / 2)
+    return 2.0 * kEarthRadiusKm * std::asin(std::min(1.0, std::sqrt(chord2) / 2.0));
+}
+
+void StationKdTree::build(const QVector<StationRecord>& stations)
+{
+    points.clear();
+    points.reserve(stations.size());
+    for (int row = 0; row < stations.size(); ++row)
+        points.append({ unitVector({ stations[row].lat, stations[row].lon }), row });
+
+    axes.fill(0, points.size());
+    buildRange(0, points.size());
+}
+
+void StationKdTree::buildRange(int lo, int hi)
+{
+    if (hi - lo <= 1)
+        return;
+
+    // Podział wzdłuż osi o największym rozrzucie
+    Vec low = points[lo].v;
+    Vec high = points[lo].v;
+    for (int i = lo + 1; i < hi; ++i) {
+        for (int d = 0; d < 3; ++d) {
+            low[d] = std::min(low[d], points[i].v[d]);
+            high[d] = std::max(high[d], points[i].v[d]);
+        }
+    }
+    int axis = 0;
+    for (int d = 1; d < 3; ++d) {
+        if (high[d] - low[d] > high[axis] - low[axis])
+            axis = d;
+    }
+
+    const int mid = (lo + hi) / 2;
+    std::nth_element(points.begin() + lo, points.begin() + mid, points.begin() + hi,
+        [axis](const Point& a, const Point& b) { return a.v[axis] < b.v[axis]; });
+    axes[mid] = quint8(axis);
+
+    buildRange(lo, mid);
+    buildRange(mid + 1, hi);
+}
+
+void StationKdTree::searchRadius(int lo, int hi, const Vec& q, double maxChord2, QVector<StationDistance>& out) const
+{
+    if (lo >= hi)
+        return;
+
+    const int mid = (lo + hi) / 2;
+    const Point& point = points[mid];
+    const double d2 = chord2(point.v, q);
+    if (d2 <= maxChord2)
+        out.append({ point.row, d2 });
+
+    const int axis = axes[mid];
+    const double diff = q[axis] - point.v[axis];
+    const bool leftFirst = diff <= 0.0;
+    searchRadius(leftFirst ? lo : mid + 1, leftFirst ? mid : hi, q, maxChord2, out);
+    if (diff * diff <= maxChord2)
+        searchRadius(leftFirst ? mid + 1 : lo, leftFirst ? hi : mid, q, maxChord2, out);
+}
+
+template <typename Visit>
+void StationKdTree::searchNearest(int lo, int hi, const Vec& q, double& bound2, Visit visit) const
+{
+    if (lo >= hi)
+        return;
+
+    const int mid = (lo + hi) / 2;
+    const Point& point = points[mid];
+    const double d2 = chord2(point.v, q);
+    if (d2 < bound2)
+        visit(point, d2);
+
+    // Najpierw strona punktu zapytania; druga tylko, gdy może zawierać bliższą stację
+    const int axis = axes[mid];
+    const double diff = q[axis] - point.v[axis];
+    const bool leftFirst = diff <= 0.0;
+    searchNearest(leftFirst ? lo : mid + 1, leftFirst ? mid : hi, q, bound2, visit);
+    if (diff * diff < bound2)
+        searchNearest(leftFirst ? mid + 1 : lo, leftFirst ? hi : mid, q, bound2, visit);
+}
+
+QVector<StationDistance> StationKdTree::withinRadius(const GeoPoint& center, double radiusKm) const
+{
+    QVector<StationDistance> result;
+    if (points.isEmpty() || radiusKm < 0.0)
+        return result;
+
+    searchRadius(0, points.size(), unitVector(center), kmToChord2(radiusKm), result);
+
+    // Odległości przechowywane dotąd jako kwadraty cięciw
+    std::sort(result.begin(), result.end(),
+        [](const StationDistance& a, const StationDistance& b) { return a.km < b.km; });
+    for (StationDistance& found : result)
+        found.km = chord2ToKm(found.km);
+    return result;
+}
+
+QVector<StationDistance> StationKdTree::nearest(const GeoPoint& center, int k) const
+{
+    QVector<StationDistance> result;
+    if (points.isEmpty() || k <= 0)
+        return result;
+
+    using Candidate = std::pair<double, int>;
+    std::priority_queue<Candidate> heap;    // Najdalszy z k kandydatów na szczycie
+    double bound2 = std::numeric_limits<double>::infinity();
+
+    searchNearest(0, points.size(), unitVector(center), bound2, [&](const Point& point, double d2) {
+        heap.emplace(d2, point.row);
+        if (int(heap.size()) > k)
+            heap.pop();
+        if (int(heap.size()) == k)
+            bound2 = heap.top().first;
+        });
+
+    result.resize(int(heap.size()));
+    for (int i = result.size() - 1; i >= 0; --i) {
+        result[i] = { heap.top().second, chord2ToKm(heap.top().first) };
+        heap.pop();
+    }
+    return result;
+}
+
+StationDistance StationKdTree::nearestMatching(const GeoPoint& center, const RowFilter& accept, double maxKm) const
+{
+    StationDistance best;
+    if (maxKm < 0.0)
+        return best;
+
+    // Promień przycina gałęzie, których nie przytną odrzucone stacje (granica włącznie)
+    double bound2 = std::nextafter(kmToChord2(maxKm), std::numeric_limits<double>::infinity());
+
+    searchNearest(0, points.size(), unitVector(center), bound2, [&](const Point& point, double d2) {
+        if (!accept(point.row))
+            return;
+        best.row = point.row;
+        bound2 = d2;
+        });
+
+    if (best.row != -1)
+        best.km = chord2ToKm(bound2);
+    return best;
+}
+
+QVector<QVector<StationDistance>> StationKdTree::withinRadius(const QVector<GeoPoint>& centers, double radiusKm) const
+{
+    auto query = [this, radiusKm](const GeoPoint& center) { return withinRadius(center, radiusKm); };
+    if (centers.size() < kParallelMinQueries) {
+        QVector<QVector<StationDistance>> results;
+        for (const GeoPoint& center : centers)
+            results.append(query(center));
+        return results;
+    }
+    return Parallel::map(centers, query);
+}
+
+QVector<QVector<StationDistance>> StationKdTree::nearest(const QVector<GeoPoint>& centers, int k) const
+{
+    auto query = [this, k](const GeoPoint& center) { return nearest(center, k); };
+    if (centers.size() < kParallelMinQueries) {
+        QVector<QVector<StationDistance>> results;
+        for (const GeoPoint& center : centers)
+            results.append(query(center));
+        return results;
+    }
+    return Parallel::map(centers, query);
+}
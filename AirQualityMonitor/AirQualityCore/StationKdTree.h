@@ -0,0 +1,110 @@
+﻿/**
+ * @file StationKdTree.h
+ * @brief Drzewo k-d stacji do zapytań o promień i najbliższych sąsiadów.
+ *
+ * Współrzędne stacji są raz zamieniane na wektory jednostkowe 3D, a drzewo
+ * dzieli je wzdłuż osi o największym rozrzucie. Odległość cięciwy na sferze
+ * jest monotoniczna względem odległości po łuku, więc porównania odbywają
+ * się bez funkcji trygonometrycznych, a wynik przeliczany jest na kilometry
+ * tylko dla znalezionych stacji. Zapytania zbiorcze (wiele punktów naraz)
+ * wykonywane są równolegle.
+ *
+ * @author Jakub Frąckowiak
+ * @date Maj 2025
+ */
+
+#pragma once
+
+#include "Records.h"
+#include <QVector>
+#include <array>
+#include <functional>
+#include <limits>
+
+/**
+ * @brief Stacja znaleziona w zapytaniu wraz z odległością.
+ */
+struct StationDistance
+{
+    int row = -1;       ///< Numer stacji w zestawie, dla którego zbudowano drzewo (-1, gdy brak)
+    double km = 0.0;    ///< Odległość po powierzchni Ziemi w kilometrach
+};
+
+/**
+ * @class StationKdTree
+ * @brief Drzewo k-d stacji na wektorach jednostkowych.
+ */
+class StationKdTree
+{
+public:
+    static constexpr double kEarthRadiusKm = 6371.0;   ///< Promień Ziemi w kilometrach
+
+    /// Warunek dla numeru stacji (np. stacja mierzy wybrany parametr)
+    using RowFilter = std::function<bool(int row)>;
+
+    /**
+     * @brief Buduje drzewo dla zestawu stacji.
+     */
+    void build(const QVector<StationRecord>& stations);
+
+    /**
+     * @brief Zwraca liczbę stacji w drzewie.
+     */
+    int size() const { return points.size(); }
+
+    /**
+     * @brief Zwraca stacje w promieniu od punktu, od najbliższej.
+     */
+    QVector<StationDistance> withinRadius(const GeoPoint& center, double radiusKm) const;
+
+    /**
+     * @brief Zwraca k najbliższych stacji, od najbliższej.
+     */
+    QVector<StationDistance> nearest(const GeoPoint& center, int k) const;
+
+    /**
+     * @brief Zwraca najbliższą stację spełniającą warunek.
+     * @param center Punkt zapytania.
+     * @param accept Warunek dla numeru stacji.
+     * @param maxKm Największa odległość szukanej stacji.
+     * @return Stacja lub wynik z row == -1, gdy żadna w promieniu nie spełnia warunku.
+     *
+     * Odrzucone stacje nie zawężają przeszukiwania, więc przy rzadko
+     * spełnianym warunku odwiedzane są wszystkie węzły w promieniu maxKm
+     * (bez ograniczenia - całe drzewo), a warunek wywoływany jest dla każdego.
+     */
+    StationDistance nearestMatching(const GeoPoint& center, const RowFilter& accept,
+        double maxKm = std::numeric_limits<double>::infinity()) const;
+
+    /**
+     * @brief Zapytanie o promień dla wielu punktów naraz (równolegle).
+     */
+    QVector<QVector<StationDistance>> withinRadius(const QVector<GeoPoint>& centers, double radiusKm) const;
+
+    /**
+     * @brief Zapytanie o k najbliższych dla wielu punktów naraz (równolegle).
+     */
+    QVector<QVector<StationDistance>> nearest(const QVector<GeoPoint>& centers, int k) const;
+
+private:
+    using Vec = std::array<double, 3>;
+
+    struct Point
+    {
+        Vec v;          ///< Wektor jednostkowy stacji
+        int row;        ///< Numer stacji
+    };
+
+    static Vec unitVector(const GeoPoint& point);
+    static double chord2(const Vec& a, const Vec& b);
+    static double kmToChord2(double km);
+    static double chord2ToKm(double chord2);
+
+    void buildRange(int lo, int hi);
+    void searchRadius(int lo, int hi, const Vec& q, double maxChord2, QVector<StationDistance>& out) const;
+    template <typename Visit>
+    void searchNearest(int lo, int hi, const Vec& q, double& bound2, Visit visit) const;
+
+    QVector<Point> points;      ///< Stacje w kolejności drzewa (węzeł to środek zakresu)
+    QVector<quint8> axes;       ///< Oś podziału węzła
+};
@@ -0,0 +1,162 @@
+﻿/**
+ * @file StationSearch.cpp
+ * @brief Implementacja indeksu wyszukiwania stacji.
+ */
+
+#include "StationSearch.h"
+#include <algorithm>
+#include <iterator>
+
+QString StationSearchIndex::fold(const QString& text)
+{
+    QString result;
+    result.reserve(text.size());
+
+    for (QChar c : text.toLower()) {
+        switch (c.unicode()) {
+        case u'ą': result.append(u'a'); break;
+        case u'ć': result.append(u'c'); break;
+        case u'ę': result.append(u'e'); break;
+        case u'ł': result.append(u'l'); break;
+        case u'ń': result.append(u'n'); break;
+        case u'ó': result.append(u'o'); break;
+        case u'ś': result.append(u's'); break;
+        case u'ź':
+        case u'ż': result.append(u'z'); break;
+        default:
+            if (!c.isLetterOrNumber())
+                result.append(u' ');
+            else if (c.decompositionTag() == QChar::Canonical)
+                result.append(c.decomposition().at(0));   // Pozostałe litery z akcentami
+            else
+                result.append(c);
+        }
+    }
+    return result.simplified();
+}
+
+quint64 StationSearchIndex::trigramKey(const QChar* chars)
+{
+    return (quint64(chars[0].unicode()) << 32) | (quint64(chars[1].unicode()) << 16) | chars[2].unicode();
+}
+
+void StationSearchIndex::build(const QVector<StationRecord>& records)
+{
+    entries.clear();
+    entries.reserve(records.size());
+    trigrams.clear();
+    lastQuery.clear();
+    lastMatches.clear();
+
+    for (int row = 0; row < records.size(); ++row) {
+        const StationRecord& record = records[row];
+        Entry entry;
+        entry.name = fold(record.name);
+        entry.nameWords = entry.name.split(u' ', Qt::SkipEmptyParts);
+        entry.city = fold(record.city);
+        entry.other = fold(record.city + ' ' + record.commune + ' ' + record.district + ' ' + record.street);
+
+        const QString text = entry.name + ' ' + entry.other;
+        for (int i = 0; i + 3 <= text.size(); ++i) {
+            QVector<int>& posting = trigrams[trigramKey(text.constData() + i)];
+            if (posting.isEmpty() || posting.last() != row)
+                posting.append(row);
+        }
+        entries.append(entry);
+    }
+}
+
+int StationSearchIndex::score(const Entry& entry, const QStringList& terms)
+{
+    int total = 0;
+    for (const QString& term : terms) {
+        int best = 0;
+        if (entry.name == term)
+            best = 100;
+        else if (entry.name.startsWith(term))
+            best = 80;
+        else if (std::any_of(entry.nameWords.cbegin(), entry.nameWords.cend(),
+            [&term](const QString& word) { return word.startsWith(term); }))
+            best = 60;
+        else if (entry.city.startsWith(term))
+            best = 50;
+        else if (entry.name.contains(term))
+            best = 40;
+        else if (entry.other.contains(term))
+            best = 20;
+
+        // Każde słowo zapytania musi pasować
+        if (best == 0)
+            return 0;
+        total += best;
+    }
+    return total;
+}
+
+QVector<int> StationSearchIndex::search(const QString& query)
+{
+    const QString folded = fold(query);
+    const QStringList terms = folded.split(u' ', Qt::SkipEmptyParts);
+
+    QVector<int> result;
+    if (terms.isEmpty()) {
+        lastQuery.clear();
+        lastMatches.clear();
+        result.reserve(entries.size());
+        for (int row = 0; row < entries.size(); ++row)
+            result.append(row);
+        return result;
+    }
+
+    QVector<int> candidates;
+    if (!lastQuery.isEmpty() && folded.startsWith(lastQuery)) {
+        // Zapytanie rozszerzone - pasować mogą tylko poprzednie wyniki
+        candidates = lastMatches;
+    }
+    else {
+        const QString longest = *std::max_element(terms.cbegin(), terms.cend(),
+            [](const QString& a, const QString& b) { return a.size() < b.size(); });
+
+        if (longest.size() < 3) {
+            candidates.reserve(entries.size());
+            for (int row = 0; row < entries.size(); ++row)
+                candidates.append(row);
+        }
+        else {
+            // Przecięcie list trigramów najdłuższego słowa
+            for (int i = 0; i + 3 <= longest.size(); ++i) {
+                const QVector<int> posting = trigrams.value(trigramKey(longest.constData() + i));
+                if (i == 0) {
+                    candidates = posting;
+                }
+                else {
+                    QVector<int> common;
+                    std::set_intersection(candidates.cbegin(), candidates.cend(),
+                        posting.cbegin(), posting.cend(), std::back_inserter(common));
+                    candidates.swap(common);
+                }
+                if (candidates.isEmpty())
+                    break;
+            }
+        }
+    }
+
+    QVector<QPair<int, int>> hits;  // (wynik, wiersz)
+    lastMatches.clear();
+    for (int row : candidates) {
+        const int value = score(entries[row], terms);
+        if (value > 0) {
+            hits.append(qMakePair(value, row));
+            lastMatches.append(row);
+        }
+    }
+    lastQuery = folded;
+
+    std::stable_sort(hits.begin(), hits.end(),
+        [](const QPair<int, int>& a, const QPair<int, int>& b) { return a.first > b.first; });
+
+    result.reserve(hits.size());
+    for (const auto& hit : hits)
+        result.append(hit.second);
+    return result;
+}
@@ -0,0 +1,65 @@
+﻿/**
+ * @file StationSearch.h
+ * @brief Indeks wyszukiwania stacji niewrażliwy na polskie znaki.
+ *
+ * Nazwa stacji, miejscowość, gmina, powiat i ulica są sprowadzane do małych
+ * liter bez znaków diakrytycznych ("Łódź" -> "lodz") i indeksowane
+ * trigramami. Wyniki są sortowane według trafności, a zapytanie będące
+ * rozszerzeniem poprzedniego przeszukuje tylko poprzednie wyniki.
+ *
+ * @author Jakub Frąckowiak
+ * @date Maj 2025
+ */
+
+#pragma once
+
+#include "Records.h"
+#include <QHash>
+#include <QStringList>
+#include <QVector>
+
+/**
+ * @class StationSearchIndex
+ * @brief Indeks trigramowy stacji z rankingiem wyników.
+ */
+class StationSearchIndex
+{
+public:
+    /**
+     * @brief Buduje indeks dla listy stacji.
+     * @param records Stacje; wyniki wyszukiwania to numery wierszy tej listy.
+     */
+    void build(const QVector<StationRecord>& records);
+
+    /**
+     * @brief Wyszukuje stacje pasujące do zapytania.
+     * @param query Tekst wpisany przez użytkownika (dowolne słowa, w dowolnej kolejności).
+     * @return Numery wierszy stacji od najlepiej dopasowanej; dla pustego
+     *         zapytania wszystkie stacje w oryginalnej kolejności.
+     */
+    QVector<int> search(const QString& query);
+
+    /**
+     * @brief Sprowadza tekst do małych liter bez znaków diakrytycznych.
+     *
+     * Znaki inne niż litery i cyfry zamieniane są na spacje.
+     */
+    static QString fold(const QString& text);
+
+private:
+    struct Entry
+    {
+        QString name;           ///< Znormalizowana nazwa stacji
+        QStringList nameWords;  ///< Słowa nazwy
+        QString city;           ///< Znormalizowana miejscowość
+        QString other;          ///< Miejscowość, gmina, powiat i ulica
+    };
+
+    static quint64 trigramKey(const QChar* chars);
+    static int score(const Entry& entry, const QStringList& terms);
+
+    QVector<Entry> entries;                 ///< Stacje w kolejności wierszy
+    QHash<quint64, QVector<int>> trigrams;  ///< Trigram -> rosnące numery wierszy
+    QString lastQuery;                      ///< Poprzednie zapytanie (znormalizowane)
+    QVector<int> lastMatches;               ///< Wiersze pasujące do poprzedniego zapytania
+};
@@ -0,0 +1,385 @@
+﻿/**
+ * @file Task.h
+ * @brief Zadania asynchroniczne oparte na korutynach C++20 i pętli zdarzeń Qt.
+ *
+ * Funkcja zwracająca Task<T> i używająca co_await/co_return startuje od
+ * razu (bez czekania na co_await) i działa do pierwszego zawieszenia.
+ * Wynik zapisywany jest we wspólnym stanie, więc zadanie może zakończyć się
+ * przed albo po tym, jak ktoś na nie poczeka. Oczekujący wznawiani są przez
+ * pętlę zdarzeń Qt (w następnym obiegu), a nie wewnątrz kończącego się
+ * zadania, dzięki czemu nie powstaje zagnieżdżona pętla zdarzeń ani głęboki
+ * stos wywołań.
+ *
+ * Wynik z operacji zgłaszanych sygnałami (np. QNetworkReply::finished)
+ * przekazuje TaskSource. Anulowanie zgłaszane jest przez CancellationSource
+ * i sprawdzane przez operacje, które dostały jego CancellationToken.
+ *
+ * Korutyny składowe muszą przyjmować argumenty przez wartość - referencja
+ * przestaje być ważna po pierwszym zawieszeniu korutyny.
+ *
+ * @code
+ * Async::Task<int> count(GiosClient* gios)
+ * {
+ *     const QVector<ApiResult> results = co_await Async::whenAll(QVector<Async::Task<ApiResult>>{
+ *         gios->sensors(114), gios->sensors(117) });
+ *     co_return results[0].data.size() + results[1].data.size();
+ * }
+ * @endcode
+ *
+ * @author Jakub Frąckowiak
+ * @date Maj 2025
+ */
+
+#pragma once
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QMetaObject>
+#include <QVector>
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace Async
+{
+    template<typename T> class Task;
+    template<typename T> class TaskSource;
+
+    namespace detail
+    {
+        /**
+         * @brief Wykonuje funkcję w następnym obiegu pętli zdarzeń wątku aplikacji.
+         */
+        inline void post(std::function<void()> fn)
+        {
+            QMetaObject::invokeMethod(QCoreApplication::instance(), std::move(fn), Qt::QueuedConnection);
+        }
+
+        /**
+         * @brief Stan zadania wspólny dla korutyny, obiektów Task i oczekujących.
+         */
+        struct StateBase
+        {
+            std::exception_ptr error;                       ///< Wyjątek zgłoszony przez zadanie
+            bool done = false;                              ///< Czy zadanie się zakończyło
+            std::vector<std::function<void()>> waiters;     ///< Oczekujący na zakończenie
+
+            void finish()
+            {
+                done = true;
+                std::vector<std::function<void()>> ready;
+                ready.swap(waiters);
+                for (std::function<void()>& waiter : ready)
+                    post(std::move(waiter));
+            }
+
+            void onDone(std::function<void()> waiter)
+            {
+                if (done)
+                    post(std::move(waiter));
+                else
+                    waiters.push_back(std::move(waiter));
+            }
+        };
+
+        template<typename T>
+        struct State : StateBase
+        {
+            std::optional<T> value;     ///< Wynik zadania
+        };
+
+        template<>
+        struct State<void> : StateBase
+        {
+        };
+
+        template<typename T>
+        struct PromiseBase
+        {
+            std::shared_ptr<State<T>> state = std::make_shared<State<T>>();
+
+            // Zadanie startuje od razu, a ramka korutyny zwalnia się sama po zakończeniu
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+
+            void unhandled_exception()
+            {
+                state->error = std::current_exception();
+                state->finish();
+            }
+        };
+
+        /**
+         * @brief Część wspólna Task<T> i Task<void>: oczekiwanie i stan.
+         */
+        template<typename T>
+        class TaskBase
+        {
+        public:
+            /**
+             * @brief Czy zadanie już się zakończyło.
+             */
+            bool isDone() const { return state->done; }
+
+            bool await_ready() const noexcept { return state->done; }
+
+            void await_suspend(std::coroutine_handle<> handle) const
+            {
+                state->onDone([handle]() { handle.resume(); });
+            }
+
+        protected:
+            explicit TaskBase(std::shared_ptr<State<T>> state) : state(std::move(state)) {}
+
+            void rethrowIfFailed() const
+            {
+                if (state->error)
+                    std::rethrow_exception(state->error);
+            }
+
+            std::shared_ptr<State<T>> state;
+        };
+    }
+
+    /**
+     * @class Task
+     * @brief Wynik operacji asynchronicznej, na który można czekać przez co_await.
+     */
+    template<typename T>
+    class Task : public detail::TaskBase<T>
+    {
+    public:
+        struct promise_type : detail::PromiseBase<T>
+        {
+            Task get_return_object() { return Task(this->state); }
+
+            void return_value(T value)
+            {
+                this->state->value = std::move(value);
+                this->state->finish();
+            }
+        };
+
+        /**
+         * @brief Zwraca wynik (lub zgłasza wyjątek zadania) po wznowieniu.
+         */
+        T await_resume() const
+        {
+            this->rethrowIfFailed();
+            return *this->state->value;
+        }
+
+        /**
+         * @brief Wywołuje funkcję z wynikiem po zakończeniu zadania (dla kodu poza korutynami).
+         */
+        void then(std::function<void(const T&)> done) const
+        {
+            auto state = this->state;
+            state->onDone([state, done]() {
+                if (state->error) {
+                    qWarning() << "Zadanie asynchroniczne zakończone wyjątkiem";
+                    return;
+                }
+                done(*state->value);
+                });
+        }
+
+    private:
+        friend class TaskSource<T>;
+        explicit Task(std::shared_ptr<detail::State<T>> state) : detail::TaskBase<T>(std::move(state)) {}
+    };
+
+    /**
+     * @brief Zadanie bez wyniku.
+     */
+    template<>
+    class Task<void> : public detail::TaskBase<void>
+    {
+    public:
+        struct promise_type : detail::PromiseBase<void>
+        {
+            Task get_return_object() { return Task(this->state); }
+
+            void return_void() { this->state->finish(); }
+        };
+
+        void await_resume() const { rethrowIfFailed(); }
+
+        void then(std::function<void()> done) const
+        {
+            auto state = this->state;
+            state->onDone([state, done]() {
+                if (state->error) {
+                    qWarning() << "Zadanie asynchroniczne zakończone wyjątkiem";
+                    return;
+                }
+                done();
+                });
+        }
+
+    private:
+        friend class TaskSource<void>;
+        explicit Task(std::shared_ptr<detail::State<void>> state) : detail::TaskBase<void>(std::move(state)) {}
+    };
+
+    /**
+     * @class TaskSource
+     * @brief Zadanie kończone ręcznie, np. z obsługi sygnału Qt.
+     *
+     * Kopie źródła wskazują to samo zadanie; kolejne wywołania complete()
+     * po pierwszym są pomijane.
+     */
+    template<typename T>
+    class TaskSource
+    {
+    public:
+        TaskSource() : state(std::make_shared<detail::State<T>>()) {}
+
+        Task<T> task() const { return Task<T>(state); }
+
+        void complete(T value) const
+        {
+            if (state->done)
+                return;
+            state->value = std::move(value);
+            state->finish();
+        }
+
+        /**
+         * @brief Kończy zadanie wyjątkiem zgłaszanym oczekującym.
+         */
+        void fail(std::exception_ptr error) const
+        {
+            if (state->done)
+                return;
+            state->error = error;
+            state->finish();
+        }
+
+    private:
+        std::shared_ptr<detail::State<T>> state;
+    };
+
+    template<>
+    class TaskSource<void>
+    {
+    public:
+        TaskSource() : state(std::make_shared<detail::State<void>>()) {}
+
+        Task<void> task() const { return Task<void>(state); }
+
+        void complete() const
+        {
+            if (!state->done)
+                state->finish();
+        }
+
+        void fail(std::exception_ptr error) const
+        {
+            if (state->done)
+                return;
+            state->error = error;
+            state->finish();
+        }
+
+    private:
+        std::shared_ptr<detail::State<void>> state;
+    };
+
+    /**
+     * @brief Czeka na wszystkie zadania i zwraca ich wyniki w kolejności.
+     *
+     * Zadania działają równolegle od chwili utworzenia, więc kolejne co_await
+     * czeka tylko na te, które jeszcze się nie zakończyły.
+     */
+    template<typename T>
+    Task<QVector<T>> whenAll(QVector<Task<T>> tasks)
+    {
+        QVector<T> results;
+        results.reserve(tasks.size());
+        for (const Task<T>& task : tasks)
+            results.append(co_await task);
+        co_return results;
+    }
+
+    /**
+     * @brief Czeka na wszystkie zadania bez wyniku.
+     */
+    inline Task<void> whenAll(QVector<Task<void>> tasks)
+    {
+        for (const Task<void>& task : tasks)
+            co_await task;
+    }
+
+    /**
+     * @class CancellationToken
+     * @brief Informacja o anulowaniu przekazywana operacjom asynchronicznym.
+     *
+     * Domyślnie utworzony token nigdy nie zostaje anulowany. isCancelled()
+     * można sprawdzać w dowolnym wątku (np. w obliczeniach TaskScheduler),
+     * funkcje onCancel() rejestruje się i wywołuje w wątku anulującym.
+     */
+    class CancellationToken
+    {
+    public:
+        CancellationToken() = default;
+
+        bool isCancelled() const { return state && state->cancelled; }
+
+        /**
+         * @brief Rejestruje funkcję wywoływaną przy anulowaniu (od razu, gdy już anulowano).
+         */
+        void onCancel(std::function<void()> callback) const
+        {
+            if (!state)
+                return;
+            if (state->cancelled)
+                callback();
+            else
+                state->callbacks.push_back(std::move(callback));
+        }
+
+    private:
+        friend class CancellationSource;
+
+        struct State
+        {
+            std::atomic<bool> cancelled = false;
+            std::vector<std::function<void()>> callbacks;
+        };
+
+        explicit CancellationToken(std::shared_ptr<State> state) : state(std::move(state)) {}
+
+        std::shared_ptr<State> state;
+    };
+
+    /**
+     * @class CancellationSource
+     * @brief Anuluje operacje, które dostały jego token.
+     */
+    class CancellationSource
+    {
+    public:
+        CancellationSource() : state(std::make_shared<CancellationToken::State>()) {}
+
+        CancellationToken token() const { return CancellationToken(state); }
+
+        void cancel() const
+        {
+            if (state->cancelled.exchange(true))
+                return;
+            std::vector<std::function<void()>> callbacks;
+            callbacks.swap(state->callbacks);
+            for (std::function<void()>& callback : callbacks)
+                callback();
+        }
+
+    private:
+        std::shared_ptr<CancellationToken::State> state;
+    };
+}
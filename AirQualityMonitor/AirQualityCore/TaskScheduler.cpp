@@ -0,0 +1,284 @@
+﻿/**
+ * @file TaskScheduler.cpp
+ * @brief Implementacja planisty z kradzieżą zadań i grup fork/join.
+ */
+
+#include "TaskScheduler.h"
+#include <algorithm>
+
+namespace
+{
+    thread_local const TaskScheduler* currentScheduler = nullptr;   ///< Planista wątku roboczego
+    thread_local int currentWorkerIndex = -1;                       ///< Indeks wątku roboczego
+    thread_local TaskPriority currentLane = TaskPriority::Normal;   ///< Priorytet bieżącego zadania
+
+    int defaultWorkerCount = 0;     ///< Liczba wątków wspólnego planisty (0 - liczba rdzeni)
+}
+
+TaskScheduler& TaskScheduler::instance()
+{
+    static TaskScheduler scheduler(defaultWorkerCount);
+    return scheduler;
+}
+
+void TaskScheduler::setDefaultWorkerCount(int count)
+{
+    defaultWorkerCount = count;
+}
+
+TaskPriority TaskScheduler::currentPriority()
+{
+    return currentLane;
+}
+
+TaskScheduler::TaskScheduler(int workerCount)
+{
+    const int count = workerCount > 0 ? workerCount : std::max(1, int(std::thread::hardware_concurrency()));
+
+    // Kolejki wszystkich wątków muszą istnieć, zanim którykolwiek zacznie kraść
+    for (int i = 0; i < count; ++i)
+        workers.push_back(std::make_unique<Worker>());
+    for (int i = 0; i < count; ++i)
+        workers[i]->thread = std::thread(&TaskScheduler::workerLoop, this, i);
+}
+
+TaskScheduler::~TaskScheduler()
+{
+    {
+        std::lock_guard<std::mutex> locker(sleepMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (const auto& worker : workers)
+        worker->thread.join();
+}
+
+int TaskScheduler::currentWorker() const
+{
+    return currentScheduler == this ? currentWorkerIndex : -1;
+}
+
+void TaskScheduler::submit(Job job, TaskPriority priority)
+{
+    const int lane = int(priority);
+    const int self = currentWorker();
+    if (self >= 0) {
+        Worker& own = *workers[self];
+        std::lock_guard<std::mutex> locker(own.mutex);
+        own.lanes[lane].push_back(std::move(job));
+    }
+    else {
+        std::lock_guard<std::mutex> locker(injectedMutex);
+        injected[lane].push_back(std::move(job));
+    }
+    ++queued;
+
+    // Blokada przed powiadomieniem - wątek nie zaśnie między sprawdzeniem licznika a czekaniem
+    {
+        std::lock_guard<std::mutex> locker(sleepMutex);
+    }
+    wake.notify_one();
+}
+
+bool TaskScheduler::take(int self, int laneCount, Job* job, TaskPriority* priority)
+{
+    if (queued.load() == 0)
+        return false;
+
+    const int count = workerCount();
+    for (int lane = 0; lane < laneCount; ++lane) {
+        // Własna kolejka od końca - najświeższe zadania mają dane w pamięci podręcznej
+        if (self >= 0) {
+            Worker& own = *workers[self];
+            std::lock_guard<std::mutex> locker(own.mutex);
+            if (!own.lanes[lane].empty()) {
+                *job = std::move(own.lanes[lane].back());
+                own.lanes[lane].pop_back();
+                *priority = TaskPriority(lane);
+                --queued;
+                return true;
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> locker(injectedMutex);
+            if (!injected[lane].empty()) {
+                *job = std::move(injected[lane].front());
+                injected[lane].pop_front();
+                *priority = TaskPriority(lane);
+                --queued;
+                return true;
+            }
+        }
+
+        // Kradzież od początku cudzych kolejek - najstarsze zadania to zwykle największe fragmenty pracy
+        const int start = self >= 0 ? self + 1 : int(nextVictim++ % unsigned(count));
+        for (int k = 0; k < count; ++k) {
+            const int victim = (start + k) % count;
+            if (victim == self)
+                continue;
+            Worker& other = *workers[victim];
+            std::lock_guard<std::mutex> locker(other.mutex);
+            if (!other.lanes[lane].empty()) {
+                *job = std::move(other.lanes[lane].front());
+                other.lanes[lane].pop_front();
+                *priority = TaskPriority(lane);
+                --queued;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void TaskScheduler::execute(Job& job, TaskPriority priority)
+{
+    const TaskPriority previous = currentLane;
+    currentLane = priority;
+    job();
+    currentLane = previous;
+}
+
+bool TaskScheduler::runOne(TaskPriority lowest)
+{
+    Job job;
+    TaskPriority priority;
+    if (!take(currentWorker(), int(lowest) + 1, &job, &priority))
+        return false;
+    execute(job, priority);
+    return true;
+}
+
+void TaskScheduler::workerLoop(int index)
+{
+    currentScheduler = this;
+    currentWorkerIndex = index;
+
+    Job job;
+    TaskPriority priority;
+    for (;;) {
+        if (take(index, kLaneCount, &job, &priority)) {
+            execute(job, priority);
+            job = nullptr;
+            continue;
+        }
+
+        // Kolejki opróżniane są także przy zamykaniu
+        std::unique_lock<std::mutex> locker(sleepMutex);
+        if (stopping && queued.load() == 0)
+            return;
+        wake.wait(locker, [this]() { return stopping || queued.load() > 0; });
+    }
+}
+
+TaskGroup::TaskGroup(TaskPriority priority, Async::CancellationToken cancel, TaskScheduler& scheduler)
+    : state(std::make_shared<State>()),
+    priority(priority),
+    token(std::move(cancel)),
+    scheduler(scheduler)
+{
+}
+
+TaskGroup::~TaskGroup()
+{
+    help();
+}
+
+void TaskGroup::run(std::function<void()> job)
+{
+    ++state->pending;
+    {
+        std::lock_guard<std::mutex> locker(state->mutex);
+        state->queue.push_back(std::move(job));
+    }
+    state->changed.notify_all();
+
+    // Bilet może nie zastać zadania - wykonał je już wątek czekający na grupę
+    scheduler.submit([state = state, token = token]() { runQueued(*state, token); }, priority);
+}
+
+bool TaskGroup::runQueued(State& state, const Async::CancellationToken& token)
+{
+    std::function<void()> job;
+    {
+        std::lock_guard<std::mutex> locker(state.mutex);
+        if (state.queue.empty())
+            return false;
+        job = std::move(state.queue.front());
+        state.queue.pop_front();
+    }
+
+    if (!state.cancelled && !token.isCancelled()) {
+        try {
+            job();
+        }
+        catch (...) {
+            std::lock_guard<std::mutex> locker(state.mutex);
+            if (!state.error)
+                state.error = std::current_exception();
+            state.cancelled = true;
+        }
+    }
+
+    // Powiadomienie pod blokadą - czekający nie zaśnie między sprawdzeniem licznika a czekaniem
+    if (--state.pending == 0) {
+        std::lock_guard<std::mutex> locker(state.mutex);
+        state.changed.notify_all();
+    }
+    return true;
+}
+
+void TaskGroup::help()
+{
+    // Zadania grupy wykonywane w tym wątku dziedziczą jej priorytet
+    const TaskPriorityScope scope(priority);
+    const bool worker = scheduler.isWorkerThread();
+
+    while (state->pending.load() > 0) {
+        if (runQueued(*state, token))
+            continue;
+
+        // Wątek roboczy pomaga innym zadaniom, aby zagnieżdżone grupy nie wyczerpały wątków;
+        // wątek obcy (np. interfejsu) nie może wziąć cudzego, być może długiego zadania
+        if (worker && scheduler.runOne(priority))
+            continue;
+
+        // Pozostałe zadania grupy wykonują się w innych wątkach - czekanie bez zajmowania rdzenia
+        std::unique_lock<std::mutex> locker(state->mutex);
+        state->changed.wait(locker, [this]() { return state->pending.load() == 0 || !state->queue.empty(); });
+    }
+}
+
+void TaskGroup::wait()
+{
+    help();
+
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> locker(state->mutex);
+        std::swap(error, state->error);
+    }
+    if (error)
+        std::rethrow_exception(error);
+}
+
+void TaskGroup::cancel()
+{
+    state->cancelled = true;
+}
+
+bool TaskGroup::isCancelled() const
+{
+    return state->cancelled || token.isCancelled();
+}
+
+TaskPriorityScope::TaskPriorityScope(TaskPriority priority)
+    : previous(currentLane)
+{
+    currentLane = priority;
+}
+
+TaskPriorityScope::~TaskPriorityScope()
+{
+    currentLane = previous;
+}
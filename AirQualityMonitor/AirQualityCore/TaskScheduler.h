@@ -0,0 +1,240 @@
+﻿/**
+ * @file TaskScheduler.h
+ * @brief Planista obliczeń z kradzieżą zadań, priorytetami i podziałem fork/join.
+ *
+ * Każdy wątek roboczy ma własne kolejki zadań (po jednej na priorytet).
+ * Zadania tworzone wewnątrz zadania trafiają na koniec kolejki bieżącego
+ * wątku i są z niej zdejmowane od końca, a bezczynne wątki kradną zadania
+ * z początku kolejek innych wątków. Zadania zgłaszane spoza planisty
+ * trafiają do wspólnej kolejki wejściowej.
+ *
+ * Priorytety są ścisłe: wątek bierze zadanie niższego priorytetu dopiero
+ * wtedy, gdy nigdzie nie czeka zadanie wyższego. Zadania potomne dziedziczą
+ * priorytet zadania, w którym powstały, więc obliczenia wywołane z wykresu
+ * wyprzedzają eksport czy statystyki wsadowe.
+ *
+ * Zadania grupy (TaskGroup) czekają we własnej kolejce grupy, a planista
+ * dostaje jedynie "bilety" pobierające z niej kolejne zadanie. Wątek
+ * czekający na grupę wykonuje w tym czasie zadania tej grupy; wątek roboczy
+ * pomaga także innym zadaniom planisty, dzięki czemu zagnieżdżony podział
+ * pracy nie wyczerpuje wątków. Wątek spoza planisty (np. wątek interfejsu)
+ * nigdy nie wykonuje cudzych zadań, a gdy nie ma już czego wykonać, usypia
+ * do zakończenia grupy zamiast kręcić się w pętli. Anulowanie jest
+ * kooperacyjne: zadania grupy, które jeszcze nie wystartowały, są pomijane,
+ * a trwające mogą sprawdzać TaskGroup::isCancelled().
+ *
+ * @author Jakub Frąckowiak
+ * @date Maj 2025
+ */
+
+#pragma once
+
+#include "Task.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Priorytet zadań planisty (od najwyższego).
+ */
+enum class TaskPriority
+{
+    Interactive = 0,    ///< Obliczenia, na które czeka interfejs (wykres, korelacje)
+    Normal = 1,         ///< Domyślny
+    Batch = 2           ///< Zadania wsadowe (eksport, statystyki, synchronizacja)
+};
+
+/**
+ * @class TaskScheduler
+ * @brief Pula wątków z kolejkami na wątek i kradzieżą zadań.
+ */
+class TaskScheduler
+{
+public:
+    using Job = std::function<void()>;
+
+    static constexpr int kLaneCount = 3;    ///< Liczba priorytetów
+
+    /**
+     * @brief Zwraca wspólnego planistę aplikacji (tworzony przy pierwszym użyciu).
+     */
+    static TaskScheduler& instance();
+
+    /**
+     * @brief Ustawia liczbę wątków wspólnego planisty (przed pierwszym instance()).
+     * @param count Liczba wątków (0 - liczba rdzeni).
+     */
+    static void setDefaultWorkerCount(int count);
+
+    /**
+     * @brief Priorytet zadania wykonywanego w bieżącym wątku (Normal poza zadaniami).
+     */
+    static TaskPriority currentPriority();
+
+    /**
+     * @brief Tworzy planistę z zadaną liczbą wątków (0 - liczba rdzeni).
+     */
+    explicit TaskScheduler(int workerCount = 0);
+    ~TaskScheduler();
+
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+    int workerCount() const { return int(workers.size()); }
+
+    /**
+     * @brief Zgłasza zadanie (z dowolnego wątku).
+     *
+     * Zadanie nie może zgłaszać wyjątków - obsługują je TaskGroup i Parallel::run.
+     */
+    void submit(Job job, TaskPriority priority);
+
+    /**
+     * @brief Wykonuje w bieżącym wątku jedno oczekujące zadanie.
+     * @param lowest Najniższy priorytet zadania, które można wziąć.
+     * @return False, jeśli żadne takie zadanie nie czekało.
+     */
+    bool runOne(TaskPriority lowest = TaskPriority::Batch);
+
+    /**
+     * @brief Czy bieżący wątek jest wątkiem roboczym tego planisty.
+     */
+    bool isWorkerThread() const { return currentWorker() >= 0; }
+
+private:
+    /**
+     * @brief Kolejki jednego wątku roboczego.
+     */
+    struct Worker
+    {
+        std::mutex mutex;                   ///< Chroni kolejki
+        std::deque<Job> lanes[kLaneCount];  ///< Kolejki według priorytetu
+        std::thread thread;                 ///< Wątek roboczy
+    };
+
+    void workerLoop(int index);
+
+    /**
+     * @brief Pobiera zadanie: własna kolejka, kolejka wejściowa, kradzież.
+     * @param self Indeks bieżącego wątku roboczego (-1 spoza planisty).
+     * @param laneCount Liczba przeglądanych priorytetów (od najwyższego).
+     */
+    bool take(int self, int laneCount, Job* job, TaskPriority* priority);
+
+    void execute(Job& job, TaskPriority priority);
+
+    /**
+     * @brief Indeks bieżącego wątku wśród wątków tego planisty (-1, gdy obcy).
+     */
+    int currentWorker() const;
+
+    std::vector<std::unique_ptr<Worker>> workers;   ///< Wątki robocze
+    std::mutex injectedMutex;                       ///< Chroni kolejkę wejściową
+    std::deque<Job> injected[kLaneCount];           ///< Zadania zgłoszone spoza planisty
+    std::atomic<int> queued = 0;                    ///< Liczba zadań w kolejkach
+    std::atomic<unsigned> nextVictim = 0;           ///< Pierwszy okradany wątek dla wątków obcych
+    std::mutex sleepMutex;                          ///< Usypianie bezczynnych wątków
+    std::condition_variable wake;                   ///< Budzi wątki po zgłoszeniu zadania
+    bool stopping = false;                          ///< Zamykanie planisty (chronione sleepMutex)
+};
+
+/**
+ * @class TaskGroup
+ * @brief Grupa zadań fork/join.
+ *
+ * Destruktor czeka na wszystkie zadania grupy, więc zadania mogą
+ * odwoływać się do zmiennych lokalnych funkcji tworzącej grupę.
+ */
+class TaskGroup
+{
+public:
+    /**
+     * @brief Tworzy grupę.
+     * @param priority Priorytet zadań (domyślnie priorytet bieżącego zadania).
+     * @param cancel Token anulowania zadań grupy.
+     */
+    explicit TaskGroup(TaskPriority priority = TaskScheduler::currentPriority(),
+        Async::CancellationToken cancel = Async::CancellationToken(),
+        TaskScheduler& scheduler = TaskScheduler::instance());
+    ~TaskGroup();
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    /**
+     * @brief Uruchamia zadanie w grupie.
+     */
+    void run(std::function<void()> job);
+
+    /**
+     * @brief Czeka na zadania grupy, wykonując w tym czasie jej oczekujące zadania.
+     *
+     * Wątek roboczy może też wykonywać inne zadania planisty; wątek spoza
+     * planisty wykonuje tylko zadania tej grupy. Zgłasza ponownie pierwszy
+     * wyjątek zadania; po wyjątku pozostałe niewystartowane zadania są pomijane.
+     */
+    void wait();
+
+    /**
+     * @brief Pomija niewystartowane zadania grupy.
+     */
+    void cancel();
+
+    /**
+     * @brief Czy grupę anulowano (tokenem, cancel() lub wyjątkiem zadania).
+     */
+    bool isCancelled() const;
+
+private:
+    /**
+     * @brief Stan współdzielony z zadaniami w kolejkach.
+     */
+    struct State
+    {
+        std::atomic<int> pending = 0;               ///< Zadania niezakończone
+        std::atomic<bool> cancelled = false;        ///< Anulowanie lokalne
+        std::mutex mutex;                           ///< Chroni queue i error
+        std::condition_variable changed;            ///< Nowe zadanie w kolejce lub koniec grupy
+        std::deque<std::function<void()>> queue;    ///< Niewystartowane zadania grupy
+        std::exception_ptr error;                   ///< Pierwszy wyjątek zadania
+    };
+
+    /**
+     * @brief Wykonuje jedno zadanie z kolejki grupy.
+     * @return False, jeśli kolejka była pusta.
+     */
+    static bool runQueued(State& state, const Async::CancellationToken& token);
+
+    void help();
+
+    std::shared_ptr<State> state;       ///< Stan grupy
+    TaskPriority priority;              ///< Priorytet zadań
+    Async::CancellationToken token;     ///< Anulowanie z zewnątrz
+    TaskScheduler& scheduler;           ///< Planista wykonujący zadania
+};
+
+/**
+ * @class TaskPriorityScope
+ * @brief Ustawia priorytet zadań tworzonych w bieżącym wątku do końca zakresu.
+ *
+ * Służy wątkom spoza planisty, np. narzędziu wsadowemu, które chce, aby
+ * jego obliczenia ustępowały zadaniom interaktywnym.
+ */
+class TaskPriorityScope
+{
+public:
+    explicit TaskPriorityScope(TaskPriority priority);
+    ~TaskPriorityScope();
+
+    TaskPriorityScope(const TaskPriorityScope&) = delete;
+    TaskPriorityScope& operator=(const TaskPriorityScope&) = delete;
+
+private:
+    TaskPriority previous;  ///< Priorytet przywracany po zakresie
+};
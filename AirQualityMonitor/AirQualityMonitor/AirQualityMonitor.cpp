@@ -6,32 +6,71 @@
 #include "AirQualityMonitor.h"
 #include "ui_AirQualityMonitor.h"
 #include "Bridge.h"
+#include "AirQualityIndex.h"
+#include "GapAnalysis.h"
+#include "CorrelationAnalysis.h"
+#include "Forecast.h"
+#include "Rollups.h"
+#include "GiosClient.h"
+#include "LocalApiServer.h"
+#include "MeasurementPublisher.h"
+#include "MeasurementStatistics.h"
+#include "ChartController.h"
+#include "Downsampling.h"
+#include "ListModels.h"
+#include "StationSearch.h"
+#include "TileCache.h"
+#include "RouteExposure.h"
+#include "StartupTrace.h"
+#include "StateSnapshot.h"
+#include "Parallel.h"
 #include <QTimer>
 #include <QNetworkReply>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
-#include <QListWidgetItem>
 #include <QDateTime>
 #include <QFile>
 #include <QDir>
 #include <QDebug>
-#include <QtCharts/QChartView>
-#include <QtCharts/QLineSeries>
-#include <QtCharts/QDateTimeAxis>
-#include <QtCharts/QValueAxis>
+#include <QCloseEvent>
 #include <QQmlContext>
 #include <QWebEngineView>
+#include <QWebEnginePage>
+#include <QWebEngineProfile>
+#include <QWebEngineSettings>
 #include <numeric>
 #include <algorithm>
+#include <cmath>
 #include <QWebChannel>
-#include <QtConcurrent/QtConcurrentRun>
 #include <QMessageBox>
+#include <QDialog>
+#include <QFileDialog>
+#include <QHeaderView>
+#include <QLabel>
+#include <QPointer>
+#include <QRegularExpression>
+#include <QTableWidget>
+#include <QVBoxLayout>
 #include <stdexcept>
 
  // Stałe globalne
-constexpr double kEarthRadiusKm = 6371.0;  ///< Promień Ziemi w kilometrach (do obliczeń metodą haversine)
-const QString kApiBaseUrl = "https://api.gios.gov.pl/pjp-api/rest/";  ///< Bazowy URL dla API GIOŚ
+constexpr int kMeasurementTimeoutMs = 10000;  ///< Limit czasu pobierania pomiarów na żądanie użytkownika
+constexpr int kMaxCorrelationLagHours = 24;  ///< Największe przesunięcie badane w korelacji wzajemnej
+constexpr int kMaxChartRows = 24 * 100;  ///< Limit wierszy na wykresie, powyżej którego używane są agregaty
+constexpr DownsampleMode kChartDownsampleMode = DownsampleMode::Lttb;  ///< Redukcja punktów wykresu (MinMax zachowuje piki)
+constexpr int kDefaultPlotWidth = 800;  ///< Szerokość wykresu przyjmowana, zanim zostanie on wyświetlony
+constexpr int kDisplayDebounceMs = 150;  ///< Opóźnienie odświeżenia wykresu po zmianie zakresu dat
+constexpr int kSearchDebounceMs = 120;  ///< Opóźnienie wyszukiwania stacji po wpisaniu znaku
+const QString kMapPageUrl = "qrc:/AirQualityMonitor/map/map.html";  ///< Strona mapy w zasobach aplikacji
+constexpr int kMapCacheBytes = 200 * 1024 * 1024;  ///< Rozmiar dyskowej pamięci podręcznej mapy
+constexpr int kMapPrewarmDelayMs = 1000;  ///< Opóźnienie wczytania mapy w tle po pierwszym narysowaniu okna
+constexpr int kMapPageIndex = 3;  ///< Strona mapy w stosie widoków
+constexpr int kMapClusterMaxZoom = 10;  ///< Poniżej tego przybliżenia mapa dostaje grupy stacji
+constexpr int kMaxViewportMarkers = 2000;  ///< Limit pojedynczych znaczników w widoku mapy
+constexpr double kNearestFallbackKm = 100.0;  ///< Zasięg szukania najbliższej stacji mierzącej parametr, gdy w promieniu nie ma żadnej
+constexpr double kRouteSpacingKm = 0.1;  ///< Odstęp próbek trasy przy liczeniu narażenia
+constexpr double kRouteSpeedKmh = 15.0;  ///< Prędkość przejazdu trasy (rower)
 
 /**
  * @brief Konstruktor klasy AirQualityMonitor.
@@ -40,284 +79,385 @@ const QString kApiBaseUrl = "https://api.gios.gov.pl/pjp-api/rest/";  ///< Bazow
 AirQualityMonitor::AirQualityMonitor(QWidget* parent)
     : QMainWindow(parent),
     networkManager(new QNetworkAccessManager(this)),
+    gios(new GiosClient(networkManager, this)),
+    ingest(repository),
+    localApi(nullptr),
+    publisher(nullptr),
     currentStationId(-1),
     currentSensorId(-1),
-    webView(nullptr)
+    channel(nullptr),
+    webView(nullptr),
+    mapLoaded(false),
+    firstPaintDone(false),
+    tilePrefetchMinZoom(-1),
+    tilePrefetchMaxZoom(-1),
+    radiusSearchRequest(0),
+    routeExposureRequest(0)
 {
     // Konfiguracja UI
     ui.setupUi(this);
+    chartController = new ChartController(ui.verticalLayout, this);
+    StartupTrace::mark("interfejs");
+
+    // Modele list - wiersze generowane w data() tylko dla widocznych pozycji
+    stationModel = new StationListModel(this);
+    stationProxy = new StationFilterProxyModel(this);
+    stationProxy->setSourceModel(stationModel);
+    sensorModel = new SensorListModel(this);
+    measurementModel = new MeasurementListModel(this);
+    ui.stationListWidget->setModel(stationProxy);
+    ui.stationDetailWidget->setModel(sensorModel);
+    ui.stationParameterListWidget->setModel(measurementModel);
+    ui.stationListWidget->setUniformItemSizes(true);
+    ui.stationParameterListWidget->setUniformItemSizes(true);
+
+    // Przewijanie dat generuje serię zmian - wykres odświeżany jest po ich ustaniu
+    displayTimer = new QTimer(this);
+    displayTimer->setSingleShot(true);
+    displayTimer->setInterval(kDisplayDebounceMs);
+    connect(displayTimer, &QTimer::timeout, this, &AirQualityMonitor::updateMeasurementDisplay);
+
+    // Wyszukiwanie uruchamiane po przerwie w pisaniu, a nie przy każdym znaku
+    searchTimer = new QTimer(this);
+    searchTimer->setSingleShot(true);
+    searchTimer->setInterval(kSearchDebounceMs);
+    connect(searchTimer, &QTimer::timeout, this, [this]() {
+        filterStations(ui.searchBox->text());
+        });
 
-    // Ładowanie początkowych danych
-    loadStations();
+    // Ładowanie początkowych danych - z migawki poprzedniej sesji, a bez niej z plików JSON
+    if (restoreSnapshot()) {
+        StartupTrace::mark("migawka stanu");
+    }
+    else {
+        loadStations();
+        StartupTrace::mark("stacje");
+        ingest.loadFromRepository();
+        StartupTrace::mark("pomiary");
+    }
+    ui.pollutantComboBox->addItems(AirQualityIndex::pollutants());
 
     // Połączenia sygnałów i slotów
-    connect(ui.searchBox, &QLineEdit::textChanged, this, &AirQualityMonitor::filterStations);
-    connect(ui.stationListWidget, &QListWidget::itemClicked, this, &AirQualityMonitor::showStationDetails);
-    connect(ui.stationDetailWidget, &QListWidget::itemClicked, this, &AirQualityMonitor::showSensorDetails);
+    connect(ui.searchBox, &QLineEdit::textChanged, searchTimer, qOverload<>(&QTimer::start));
+    connect(ui.stationListWidget, &QListView::clicked, this, &AirQualityMonitor::showStationDetails);
+    connect(ui.stationDetailWidget, &QListView::clicked, this, &AirQualityMonitor::showSensorDetails);
     connect(ui.backButton, &QPushButton::clicked, this, &AirQualityMonitor::showStationListView);
-    connect(ui.startDateEdit, &QDateTimeEdit::dateTimeChanged, this, &AirQualityMonitor::updateMeasurementDisplay);
-    connect(ui.endDateEdit, &QDateTimeEdit::dateTimeChanged, this, &AirQualityMonitor::updateMeasurementDisplay);
+    connect(ui.startDateEdit, &QDateTimeEdit::dateTimeChanged, displayTimer, qOverload<>(&QTimer::start));
+    connect(ui.endDateEdit, &QDateTimeEdit::dateTimeChanged, displayTimer, qOverload<>(&QTimer::start));
     connect(ui.showMapButton, &QPushButton::clicked, this, [this]() {
-        loadMap();
-        ui.confirmButton->setCurrentIndex(3);
+        ui.confirmButton->setCurrentIndex(kMapPageIndex);
         });
     connect(ui.backToListButton, &QPushButton::clicked, this, [this]() {
         ui.confirmButton->setCurrentIndex(0);
         });
+    connect(ui.confirmButton, &QStackedWidget::currentChanged, this, [this](int index) {
+        // Pierwsze wejście na stronę mapy tworzy widok, jeśli nie powstał jeszcze w tle,
+        // i uruchamia zamówione pobieranie kafelków z wyprzedzeniem
+        if (index != kMapPageIndex)
+            return;
+        loadMap();
+        if (tilePrefetchMaxZoom >= 0) {
+            tilePrefetcher->start(tilePrefetchMinZoom, tilePrefetchMaxZoom);
+            tilePrefetchMaxZoom = -1;
+        }
+        });
     connect(ui.searchNearbyButton, &QPushButton::clicked, this, &AirQualityMonitor::onSearchNearbyClicked);
     connect(ui.showAllStationsButton, &QPushButton::clicked, this, &AirQualityMonitor::showAllStationsOnMap);
+    connect(ui.pollutantComboBox, &QComboBox::currentTextChanged, this, &AirQualityMonitor::publishViewportMarkers);
+    connect(ui.pollutantComboBox, &QComboBox::currentTextChanged, this, &AirQualityMonitor::publishRouteExposure);
+    connect(ui.importRouteButton, &QPushButton::clicked, this, &AirQualityMonitor::importRouteFromGpx);
 
     // Przyciski pobierania danych
     connect(ui.downloadStationDetail, &QPushButton::clicked, this, &AirQualityMonitor::downloadSensorData);
+    connect(ui.correlationButton, &QPushButton::clicked, this, &AirQualityMonitor::showStationCorrelations);
     connect(ui.downloadMeasurementButton, &QPushButton::clicked, this, &AirQualityMonitor::downloadMeasurementData);
 
-    // Konfiguracja widoku webowego
-    webView = new QWebEngineView(ui.mapPage);
-    if (ui.mapLayout) {
-        ui.mapLayout->addWidget(webView);
-    }
-    webView->setContextMenuPolicy(Qt::NoContextMenu);
+    // Kafelki mapy z lokalnej bazy, brakujące pobierane w tle; pobieranie
+    // z wyprzedzeniem tylko na życzenie (enableTilePrefetch)
+    tileCache = new TileCache(QDir::currentPath() + "/tiles.mbtiles", this);
+    tilePrefetcher = new TilePrefetcher(tileCache, this);
 
-    // Konfiguracja mostu Qt-JavaScript
+    // Most istnieje od początku i przechowuje stan mapy; widok webowy powstaje
+    // dopiero w setupWebView (w tle po pierwszym narysowaniu okna lub przy wejściu na mapę)
     bridge = new Bridge(this);
-    channel = new QWebChannel(this);
-    channel->registerObject(QStringLiteral("bridge"), bridge);
-    webView->page()->setWebChannel(channel);
+    connect(bridge, &Bridge::stationClicked, this, &AirQualityMonitor::showStationDetailsById);
+    connect(bridge, &Bridge::viewportChanged, this, &AirQualityMonitor::onViewportChanged);
+    connect(bridge, &Bridge::routeDrawn, this, &AirQualityMonitor::onRouteDrawn);
 
-    // Połączenie sygnału kliknięcia markera
-    connect(bridge, &Bridge::markerClicked, this, &AirQualityMonitor::onMarkerClicked);
+    StartupTrace::mark("okno utworzone");
 }
 
 /**
- * @brief Destruktor klasy AirQualityMonitor.
+ * @brief Rejestruje pierwsze narysowanie okna i planuje wczytanie mapy w tle.
+ * @param event Zdarzenie okna.
+ *
+ * Uruchomienie silnika przeglądarki przed pierwszym narysowaniem opóźniałoby
+ * pokazanie listy stacji, dlatego mapa tworzona jest dopiero chwilę później.
  */
-AirQualityMonitor::~AirQualityMonitor()
+bool AirQualityMonitor::event(QEvent* event)
 {
-    if (webView) {
-        delete webView;
-        webView = nullptr;
+    if (event->type() == QEvent::Paint && !firstPaintDone) {
+        firstPaintDone = true;
+        StartupTrace::mark("pierwsze rysowanie");
+        QTimer::singleShot(kMapPrewarmDelayMs, this, &AirQualityMonitor::loadMap);
     }
+    return QMainWindow::event(event);
 }
 
 /**
- * @brief Sprawdza czy połączenie z internetem jest dostępne.
- * @return True jeśli połączenie jest dostępne, false w przeciwnym razie.
+ * @brief Zapisuje migawkę stanu przy zamykaniu okna.
+ * @param event Zdarzenie zamknięcia.
  */
-bool AirQualityMonitor::isInternetAvailable()
+void AirQualityMonitor::closeEvent(QCloseEvent* event)
 {
-    // Tworzenie dedykowanego managera sieci do tego testu
-    QNetworkAccessManager manager;
-    QNetworkRequest request(QUrl(kApiBaseUrl + "station/findAll"));
-
-    // Ustawienie limitu czasu dla żądania
-    request.setTransferTimeout(5000); // 5 sekund timeout
-
-    QNetworkReply* reply = manager.get(request);
+    saveSnapshot();
+    QMainWindow::closeEvent(event);
+}
 
-    QEventLoop loop;
-    QObject::connect(reply, &QNetworkReply::finished, &loop, &QEventLoop::quit);
+/**
+ * @brief Odtwarza stan z poprzedniego uruchomienia.
+ * @return False, gdy brak aktualnej migawki - dane trzeba wczytać z plików.
+ *
+ * Przywraca listę stacji, ostatnio oglądaną stację i sensor, zakres dat
+ * i gotowy wykres bez odczytu plików JSON.
+ */
+bool AirQualityMonitor::restoreSnapshot()
+{
+    AppState state;
+    if (!StateSnapshot::load(repository, state) || state.stations.isEmpty())
+        return false;
 
-    // Również wyjdź z pętli jeśli żądanie przekroczy limit czasu
-    QTimer timer;
-    timer.setSingleShot(true);
-    QObject::connect(&timer, &QTimer::timeout, &loop, &QEventLoop::quit);
-    timer.start(5000);  // 5 sekund timeout
+    setStations(state.stations);
 
-    loop.exec();  // Czekaj na odpowiedź lub timeout
+    const int row = stationModel->rowOfId(state.stationId);
+    if (row != -1) {
+        currentStationId = state.stationId;
+        ui.stationListWidget->setCurrentIndex(stationProxy->mapFromSource(stationModel->index(row)));
 
-    bool success = (reply->error() == QNetworkReply::NoError);
-    reply->deleteLater();
+        QVector<SensorRecord> stationSensors;
+        for (const SensorRecord& sensor : state.sensors) {
+            if (sensor.stationId == currentStationId)
+                stationSensors.append(sensor);
+        }
+        setSensors(stationSensors);
+        ui.confirmButton->setCurrentIndex(1);
+
+        // Wykres z zapisanej serii i piramid - bez ponownego scalania i redukcji punktów
+        if (state.sensorId != -1 && state.series.size() > 0) {
+            currentSensorId = state.sensorId;
+            lastSeries = state.series;
+            segmentPyramids = state.pyramids;
+            ui.startDateEdit->setDateTime(QDateTime::fromMSecsSinceEpoch(state.rangeStartMs));
+            ui.endDateEdit->setDateTime(QDateTime::fromMSecsSinceEpoch(state.rangeEndMs));
+            updateMeasurementDisplay();
+            ui.confirmButton->setCurrentIndex(2);
+        }
+    }
 
-    return success;
+    // Prognozy dopasowywane w tle dopiero po odtworzeniu widoku
+    ingest.restore(state.sensors, state.readings);
+    return true;
 }
 
 /**
- * @brief Pobiera dane sensorów dla aktualnej stacji i zapisuje do pliku.
+ * @brief Zapisuje migawkę stanu do odtworzenia przy następnym uruchomieniu.
  */
-void AirQualityMonitor::downloadSensorData()
+void AirQualityMonitor::saveSnapshot()
 {
-    if (currentStationId == -1) {
-        QMessageBox::warning(this, "Ostrzeżenie", "Nie wybrano stacji.", QMessageBox::Ok);
+    // Bez listy stacji (np. brak połączenia przy pierwszym uruchomieniu) nie ma czego odtwarzać
+    if (stationModel->records().isEmpty())
         return;
-    }
 
-    // Sprawdź czy dane już istnieją w pliku
-    QFile file(QDir::currentPath() + "/sensors.json");
-    if (file.exists()) {
-        QJsonArray sensorsData = loadSensorsFromFile();
-        bool stationExists = false;
+    AppState state;
+    state.stations = stationModel->records();
+    for (const QJsonValue& value : repository.loadSensors())
+        state.sensors.append(SensorRecord::fromJson(value.toObject()));
+    state.readings = ingest.stationIndex().allReadings();
+    state.stationId = currentStationId;
+    if (lastSeries.size() > 0) {
+        state.sensorId = currentSensorId;
+        state.rangeStartMs = ui.startDateEdit->dateTime().toMSecsSinceEpoch();
+        state.rangeEndMs = ui.endDateEdit->dateTime().toMSecsSinceEpoch();
+        state.series = lastSeries;
+        state.pyramids = segmentPyramids;
+    }
+
+    QString error;
+    if (!StateSnapshot::save(repository, state, &error))
+        qDebug() << "Nie udało się zapisać migawki stanu:" << error;
+}
 
-        // Sprawdź czy już mamy sensory tej stacji
-        for (const QJsonValue& value : sensorsData) {
-            QJsonObject obj = value.toObject();
-            if (obj.value("stationId").toInt() == currentStationId) {
-                stationExists = true;
-                break;
-            }
-        }
+/**
+ * @brief Destruktor klasy AirQualityMonitor.
+ */
+AirQualityMonitor::~AirQualityMonitor()
+{
+    // Przerwane pobieranie kończy oczekujące korutyny, które sprawdzą, że okna już nie ma
+    measurementFetch.cancel();
 
-        if (stationExists) {
-            onSensorsLoadedFromFile(currentStationId);
-            QMessageBox::information(this, "Informacja",
-                "Dane dla tej stacji są już zapisane.", QMessageBox::Ok);
-            return;
-        }
+    if (webView) {
+        delete webView;
+        webView = nullptr;
     }
-
-    // Dane nie znalezione lokalnie, pobierz z API
-    QUrl url(QString(kApiBaseUrl + "station/sensors/%1").arg(currentStationId));
-    QNetworkRequest request(url);
-    QNetworkReply* reply = networkManager->get(request);
-    connect(reply, &QNetworkReply::finished, this, &AirQualityMonitor::onSensorsDownloaded);
 }
 
 /**
- * @brief Obsługa zakończenia pobierania danych sensorów.
+ * @brief Uruchamia lokalny serwer HTTP z zapisanymi danymi.
+ * @param port Port nasłuchiwania.
+ * @param address Adres nasłuchiwania (domyślnie tylko ten komputer).
+ * @return False, jeśli nie udało się otworzyć portu.
+ *
+ * Serwer dostaje dane z plików przy starcie, a później każdą zmianę
+ * stacji, sensorów i pomiarów zapisaną przez aplikację.
  */
-void AirQualityMonitor::onSensorsDownloaded()
+bool AirQualityMonitor::startLocalApi(quint16 port, const QHostAddress& address)
 {
-    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
-    if (!reply) return;
+    if (!localApi)
+        localApi = new LocalApiServer(repository, this);
+    localApi->reload();
 
-    if (reply->error() != QNetworkReply::NoError) {
-        qDebug() << "Błąd sieci:" << reply->errorString();
-        onSensorsLoadedFromFile(currentStationId);
-        reply->deleteLater();
-        return;
+    if (!localApi->listen(port, address)) {
+        qDebug() << "Nie udało się uruchomić lokalnego API:" << localApi->errorString();
+        return false;
     }
+    ui.statusBar->showMessage(QString("Lokalne API dostępne na porcie %1").arg(localApi->port()));
+    return true;
+}
 
-    QByteArray data = reply->readAll();
-    QJsonDocument doc = QJsonDocument::fromJson(data);
-
-    if (doc.isArray()) {
-        QJsonArray sensorsData = doc.array();
-        QJsonArray enhancedData;
+/**
+ * @brief Ustawia serwer kafelków mapy.
+ * @param urlTemplate Adres kafelka z polami {z}, {x} i {y}.
+ */
+void AirQualityMonitor::setTileServer(const QString& urlTemplate)
+{
+    tileCache->setServerUrl(urlTemplate);
+}
 
-        // Dodaj stationId do każdego obiektu sensora
-        for (const QJsonValue& value : sensorsData) {
-            QJsonObject sensor = value.toObject();
-            sensor.insert("stationId", currentStationId);
-            enhancedData.append(sensor);
-        }
+/**
+ * @brief Włącza pobieranie kafelków Polski z wyprzedzeniem.
+ * @param minZoom Najmniejszy poziom przybliżenia.
+ * @param maxZoom Największy poziom przybliżenia.
+ *
+ * Pobieranie startuje przy pierwszym pokazaniu mapy, a nie przy
+ * uruchomieniu aplikacji, i wymaga własnego serwera kafelków.
+ */
+void AirQualityMonitor::enableTilePrefetch(int minZoom, int maxZoom)
+{
+    tilePrefetchMinZoom = std::max(0, minZoom);
+    tilePrefetchMaxZoom = maxZoom;
+}
 
-        updateSensorsFile(enhancedData);
-        updateSensorsList(enhancedData);
+/**
+ * @brief Uruchamia serwer WebSocket powiadamiający o nowych pomiarach.
+ * @param port Port nasłuchiwania.
+ * @param address Adres nasłuchiwania (domyślnie tylko ten komputer).
+ * @return False, jeśli nie udało się otworzyć portu.
+ *
+ * Klienci dostają pomiary zapisane przez aplikację dla subskrybowanych
+ * sensorów i stacji.
+ */
+bool AirQualityMonitor::startPublisher(quint16 port, const QHostAddress& address)
+{
+    if (!publisher) {
+        publisher = new MeasurementPublisher(this);
+        QVector<SensorRecord> sensors;
+        for (const QJsonValue& value : repository.loadSensors())
+            sensors.append(SensorRecord::fromJson(value.toObject()));
+        publisher->addSensors(sensors);
     }
 
-    reply->deleteLater();
+    if (!publisher->listen(port, address)) {
+        qDebug() << "Nie udało się uruchomić powiadomień WebSocket:" << publisher->errorString();
+        return false;
+    }
+    return true;
 }
 
 /**
- * @brief Aktualizuje plik sensorów nowymi danymi.
- * @param newSensors Tablica JSON z nowymi danymi sensorów.
+ * @brief Pobiera dane sensorów dla aktualnej stacji i zapisuje do pliku.
  */
-void AirQualityMonitor::updateSensorsFile(const QJsonArray& newSensors)
+void AirQualityMonitor::downloadSensorData()
 {
-    QJsonArray allSensors;
-
-    try {
-        // Wczytaj istniejące dane, jeśli plik istnieje
-        QFile readFile(QDir::currentPath() + "/sensors.json");
-        if (readFile.exists() && readFile.open(QIODevice::ReadOnly)) {
-            QByteArray data = readFile.readAll();
-            QJsonDocument doc = QJsonDocument::fromJson(data);
-            if (doc.isArray()) {
-                allSensors = doc.array();
-            }
-            readFile.close();
-        }
-
-        // Usuń stare dane dla tej stacji, jeśli istnieją
-        int stationId = -1;
-        if (!newSensors.isEmpty()) {
-            stationId = newSensors.at(0).toObject().value("stationId").toInt();
-        }
-
-        if (stationId != -1) {
-            for (int i = allSensors.size() - 1; i >= 0; i--) {
-                QJsonObject obj = allSensors.at(i).toObject();
-                if (obj.value("stationId").toInt() == stationId) {
-                    allSensors.removeAt(i);
-                }
-            }
-        }
-
-        // Dodaj nowe dane
-        for (const QJsonValue& value : newSensors) {
-            allSensors.append(value);
-        }
-
-        // Zapisz zaktualizowane dane do pliku
-        saveSensorsToFile(allSensors);
+    if (currentStationId == -1) {
+        QMessageBox::warning(this, "Ostrzeżenie", "Nie wybrano stacji.", QMessageBox::Ok);
+        return;
     }
-    catch (const std::exception& e) {
-        qDebug() << "Błąd podczas aktualizacji pliku sensorów: " << e.what();
-        QMessageBox::warning(this, "Błąd",
-            QString("Nie udało się zaktualizować pliku sensorów: %1").arg(e.what()),
-            QMessageBox::Ok);
+
+    // Sprawdź czy już mamy sensory tej stacji
+    if (!repository.loadSensors(currentStationId).isEmpty()) {
+        onSensorsLoadedFromFile(currentStationId);
+        QMessageBox::information(this, "Informacja",
+            "Dane dla tej stacji są już zapisane.", QMessageBox::Ok);
+        return;
     }
+
+    // Dane nie znalezione lokalnie, pobierz z API
+    const int stationId = currentStationId;
+    gios->fetchSensors(stationId, [this, stationId](const QJsonArray& sensors, const QString& error) {
+        onSensorsDownloaded(stationId, sensors, error);
+        });
 }
 
 /**
- * @brief Zapisuje dane sensorów do pliku.
- * @param sensors Tablica JSON z danymi sensorów do zapisania.
+ * @brief Obsługa zakończenia pobierania danych sensorów.
+ * @param stationId ID stacji.
+ * @param sensors Sensory stacji (z polem stationId).
+ * @param error Opis błędu (pusty, gdy pobrano dane).
  */
-void AirQualityMonitor::saveSensorsToFile(const QJsonArray& sensors)
+void AirQualityMonitor::onSensorsDownloaded(int stationId, const QJsonArray& sensors, const QString& error)
 {
-    QMessageBox::information(this, "Informacja", "Dane zostały pobrane do pliku", QMessageBox::Ok);
-
-    qDebug() << "Kliknięto przycisk, rozpoczynamy zapis...";
-    QFile file(QDir::currentPath() + "/sensors.json");
-    if (file.open(QIODevice::WriteOnly)) {
-        file.write(QJsonDocument(sensors).toJson());
-        file.close();
-        qDebug() << "Dane zapisane do pliku sensors.json";
+    if (!error.isEmpty()) {
+        qDebug() << "Błąd sieci:" << error;
+        onSensorsLoadedFromFile(stationId);
+        return;
+    }
+
+    if (!repository.replaceStationSensors(sensors)) {
+        QMessageBox::warning(this, "Błąd",
+            QString("Nie udało się zaktualizować pliku sensorów: %1").arg(repository.errorString()),
+            QMessageBox::Ok);
     }
     else {
-        qDebug() << "Błąd przy otwieraniu pliku do zapisu";
+        QMessageBox::information(this, "Informacja", "Dane zostały pobrane do pliku", QMessageBox::Ok);
     }
+    if (localApi)
+        localApi->setStationSensors(stationId, sensors);
+    updateSensorsList(sensors);
 }
 
 /**
  * @brief Ładuje dane sensorów dla konkretnej stacji z pliku.
  * @param stationId ID stacji do załadowania danych.
+ *
+ * Gdy w pliku nie ma sensorów stacji, a API odpowiada, pobiera je z API.
+ * Korutyna nie jest nigdzie oczekiwana, więc po każdym co_await sprawdza,
+ * czy okno nadal istnieje.
  */
-void AirQualityMonitor::onSensorsLoadedFromFile(int stationId)
+Async::Task<void> AirQualityMonitor::onSensorsLoadedFromFile(int stationId)
 {
-    // Wczytanie wszystkich sensorów z pliku
-    QJsonArray allSensors = loadSensorsFromFile();
-    QJsonArray stationSensors;
-
-    // Filtruj sensory tylko dla tej konkretnej stacji
-    for (const QJsonValue& value : allSensors) {
-        QJsonObject obj = value.toObject();
-        // Dodaj tylko te sensory, które mają odpowiedni stationId
-        if (obj.value("stationId").toInt() == stationId) {
-            stationSensors.append(obj);
-        }
+    const QPointer<AirQualityMonitor> self(this);
+    const QJsonArray stationSensors = repository.loadSensors(stationId);
+    if (!stationSensors.isEmpty()) {
+        updateSensorsList(stationSensors);
+        co_return;
     }
 
-    // Jeśli nie ma danych dla danej stacji
-    if (stationSensors.isEmpty()) {
-        ui.stationDetailWidget->clear();
-
-        // Jeśli brak danych w pliku i brak internetu
-        if (!isInternetAvailable()) {
-            QMessageBox::critical(this, "Błąd",
-                "Brak danych dla wybranej stacji oraz brak połączenia z internetem.", QMessageBox::Ok);
-            return;
-        }
-
-        // Jeśli brak danych w pliku, a internet jest dostępny, pobierz dane z API
-        QUrl url(QString(kApiBaseUrl + "station/sensors/%1").arg(stationId));
-        QNetworkRequest request(url);
-        QNetworkReply* reply = networkManager->get(request);
-        connect(reply, &QNetworkReply::finished, this, &AirQualityMonitor::onSensorsDownloaded);
-    }
-    else {
-        // Zaktualizuj listę sensorów tylko dla tej stacji
-        updateSensorsList(stationSensors);
+    // Brak danych dla stacji w pliku
+    sensorModel->setSensors(QVector<SensorRecord>());
+    const bool online = co_await gios->available();
+    if (!self)
+        co_return;
+    if (!online) {
+        QMessageBox::critical(this, "Błąd",
+            "Brak danych dla wybranej stacji oraz brak połączenia z internetem.", QMessageBox::Ok);
+        co_return;
     }
+
+    // Internet jest dostępny - pobierz dane z API
+    const ApiResult result = co_await gios->sensors(stationId);
+    if (!self)
+        co_return;
+    onSensorsDownloaded(stationId, result.data, result.error);
 }
 
 /**
@@ -326,25 +466,27 @@ void AirQualityMonitor::onSensorsLoadedFromFile(int stationId)
  */
 void AirQualityMonitor::updateSensorsList(const QJsonArray& sensorsData)
 {
-    ui.stationDetailWidget->clear();  // Wyczyść starą listę
-    sensorMap.clear();  // Wyczyść mapę sensorów
-
-    if (sensorsData.isEmpty()) {
-        // Jeżeli nie ma danych dla stacji, nie wyświetlaj nic
-        return;
-    }
-
     // Przetwórz dane sensorów i zaktualizuj listę
-    for (const QJsonValue& value : sensorsData) {
-        QJsonObject sensor = value.toObject();
-        QString paramName = sensor.value("param").toObject().value("paramName").toString();
-        QString paramCode = sensor.value("param").toObject().value("paramCode").toString();
-        int sensorId = sensor.value("id").toInt();
-
-        QString sensorDisplay = QString("%1 (%2)").arg(paramName, paramCode);
-        ui.stationDetailWidget->addItem(sensorDisplay);
-        sensorMap.insert(sensorDisplay, sensorId);
-    }
+    QVector<SensorRecord> sensors;
+    sensors.reserve(sensorsData.size());
+    for (const QJsonValue& value : sensorsData)
+        sensors.append(SensorRecord::fromJson(value.toObject()));
+    setSensors(sensors);
+}
+
+/**
+ * @brief Ustawia listę sensorów wybranej stacji.
+ * @param sensors Sensory stacji.
+ */
+void AirQualityMonitor::setSensors(const QVector<SensorRecord>& sensors)
+{
+    sensorMap.clear();
+    for (const SensorRecord& sensor : sensors)
+        sensorMap.insert(sensor.displayName(), sensor.id);
+    sensorModel->setSensors(sensors);
+    ingest.addSensors(sensors);
+    if (publisher)
+        publisher->addSensors(sensors);
 }
 
 /**
@@ -360,111 +502,106 @@ void AirQualityMonitor::downloadMeasurementData()
         return;
     }
 
+    refreshMeasurements(currentSensorId);
+}
+
+/**
+ * @brief Pobiera najnowsze pomiary sensora, a bez połączenia pokazuje dane lokalne.
+ * @param sensorId ID sensora.
+ */
+Async::Task<void> AirQualityMonitor::refreshMeasurements(int sensorId)
+{
+    const QPointer<AirQualityMonitor> self(this);
+
     // Sprawdź czy jesteśmy online
-    if (!isInternetAvailable()) {
+    const bool online = co_await gios->available();
+    if (!self)
+        co_return;
+    if (!online) {
         QMessageBox::warning(this, "Brak połączenia",
             "Brak połączenia z internetem. Nie można pobrać nowych danych.\n"
             "Sprawdzam dane lokalne...", QMessageBox::Ok);
 
         // Próba załadowania z lokalnego magazynu
-        onMeasurementsLoadedFromFile(currentSensorId);
-        return;
+        co_await onMeasurementsLoadedFromFile(sensorId);
+        co_return;
     }
 
-    // Mamy połączenie internetowe, kontynuujemy pobieranie
-    QUrl url(QString("https://api.gios.gov.pl/pjp-api/rest/data/getData/%1").arg(currentSensorId));
-    QNetworkRequest request(url);
-    QNetworkReply* reply = networkManager->get(request);
+    // Mamy połączenie internetowe, kontynuujemy pobieranie (limit czasu odpowiedzi serwera)
+    co_await downloadMeasurements(sensorId, kMeasurementTimeoutMs);
+}
 
-    // Zapisz ID sensora jako właściwość odpowiedzi
-    reply->setProperty("sensorId", currentSensorId);
-
-    // Ustaw timeout dla żądania
-    QTimer* timer = new QTimer(this);
-    timer->setSingleShot(true);
-    connect(timer, &QTimer::timeout, [=]() {
-        if (reply && reply->isRunning()) {
-            reply->abort();
-            QMessageBox::warning(this, "Timeout",
-                "Serwer nie odpowiada w wymaganym czasie. Sprawdzam dane lokalne...",
-                QMessageBox::Ok);
-            onMeasurementsLoadedFromFile(currentSensorId);
-        }
-        timer->deleteLater();
-        });
-    timer->start(10000);  // 10 sekund timeout
+/**
+ * @brief Pobiera pomiary sensora z API, scala je z historią i wyświetla.
+ * @param sensorId ID sensora.
+ * @param timeoutMs Limit czasu odpowiedzi serwera (0 - bez limitu).
+ *
+ * Wynik żądania anulowanego przez wybór innego sensora jest pomijany.
+ */
+Async::Task<void> AirQualityMonitor::downloadMeasurements(int sensorId, int timeoutMs)
+{
+    const QPointer<AirQualityMonitor> self(this);
+    const ApiResult result = co_await gios->measurements(sensorId, timeoutMs, restartMeasurementFetch());
+    if (!self || result.cancelled)
+        co_return;
+    onMeasurementsDownloaded(sensorId, result.data, result.error);
+}
 
-    // Połącz z sygnałem zakończenia
-    connect(reply, &QNetworkReply::finished, this, [=]() {
-        timer->stop();
-        timer->deleteLater();
-        onMeasurementsDownloaded();
-        });
+/**
+ * @brief Anuluje trwające pobieranie pomiarów i zwraca token dla nowego.
+ */
+Async::CancellationToken AirQualityMonitor::restartMeasurementFetch()
+{
+    measurementFetch.cancel();
+    measurementFetch = Async::CancellationSource();
+    return measurementFetch.token();
 }
 
 /**
  * @brief Obsługuje zakończenie pobierania danych pomiarowych.
+ * @param sensorId ID sensora.
+ * @param values Pobrane pomiary.
+ * @param error Opis błędu (pusty, gdy pobrano dane).
  *
- * Przetwarza odpowiedź z API i aktualizuje interfejs użytkownika oraz
- * zapisuje dane lokalnie.
+ * Scala pomiary z historią, aktualizuje interfejs użytkownika, a w razie
+ * błędu wyświetla dane zapisane lokalnie.
  */
-void AirQualityMonitor::onMeasurementsDownloaded()
+void AirQualityMonitor::onMeasurementsDownloaded(int sensorId, const QJsonArray& values, const QString& error)
 {
-    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
-    if (!reply) return;
-
-    int sensorId = reply->property("sensorId").toInt();
-
-    try {
-        if (reply->error() != QNetworkReply::NoError)
-            throw std::runtime_error(reply->errorString().toStdString());
-
-        QByteArray data = reply->readAll();
-        QJsonDocument doc = QJsonDocument::fromJson(data);
-
-        if (!doc.isObject())
-            throw std::runtime_error("Nieprawidłowy format danych z API");
-
-        QJsonObject root = doc.object();
-        QJsonArray values = root.value("values").toArray();
-
-        // Sprawdź czy otrzymaliśmy jakiekolwiek poprawne dane
-        bool hasValidData = false;
-        for (const QJsonValue& val : values) {
-            QJsonObject obj = val.toObject();
-            if (obj.contains("value") && !obj.value("value").isNull()) {
-                hasValidData = true;
-                break;
-            }
-        }
-
-        if (!hasValidData)
-            throw std::runtime_error("Serwer nie zwrócił żadnych ważnych danych pomiarowych");
-
-        // Otrzymano poprawne dane, zapisz je
-        updateMeasurementsFile(sensorId, values);
-
-        // Aktualizuj wyświetlanie
-        updateMeasurementsList(values);
-
-        // Zaktualizuj również wyświetlanie pomiarów za pomocą wykresu
-        displayMeasurementData(values);
-
-        QMessageBox::information(this, "Sukces",
-            "Pomyślnie pobrano najnowsze dane z serwera.", QMessageBox::Ok);
-    }
-    catch (const std::exception& e) {
-        qDebug() << "Błąd przy pobieraniu pomiarów:" << e.what();
+    if (!error.isEmpty()) {
+        qDebug() << "Błąd przy pobieraniu pomiarów:" << error;
         QMessageBox::warning(this, "Błąd pobierania",
             QString("Nie udało się pobrać danych z serwera: %1\n"
                 "Sprawdzam dane lokalne...")
-            .arg(e.what()), QMessageBox::Ok);
+            .arg(error), QMessageBox::Ok);
 
         // Próba załadowania danych offline
         onMeasurementsLoadedFromFile(sensorId);
+        return;
+    }
+
+    // Otrzymano poprawne dane, scal je z historią i zapisz
+    const IngestResult result = ingest.ingest(sensorId, values);
+    if (localApi)
+        localApi->setMeasurements(sensorId, result.merged);
+    if (publisher)
+        publisher->publish(sensorId, result.changes, result.series);
+    if (result.saved) {
+        QMessageBox::information(this, "Informacja", "Dane pomiarowe zostały zapisane do pliku", QMessageBox::Ok);
+    }
+    else {
+        QMessageBox::warning(this, "Błąd", "Nie udało się zapisać danych do pliku. Sprawdź uprawnienia.", QMessageBox::Ok);
     }
 
-    reply->deleteLater();
+    // Mapa dostaje tylko zmieniony znacznik stacji
+    if (result.stationChanged && result.stationChange.paramCode == ui.pollutantComboBox->currentText())
+        bridge->updateMarkers({ result.stationChange });
+
+    // Aktualizuj listę i wykres
+    displayMeasurementData(result.merged);
+
+    QMessageBox::information(this, "Sukces",
+        "Pomyślnie pobrano najnowsze dane z serwera.", QMessageBox::Ok);
 }
 
 /**
@@ -474,214 +611,51 @@ void AirQualityMonitor::onMeasurementsDownloaded()
  * Jeśli dane nie są dostępne lokalnie i jest połączenie z internetem,
  * próbuje pobrać dane z API.
  */
-void AirQualityMonitor::onMeasurementsLoadedFromFile(int sensorId)
+Async::Task<void> AirQualityMonitor::onMeasurementsLoadedFromFile(int sensorId)
 {
-    QJsonArray allMeasurements = loadMeasurementsFromFile();
-    QJsonArray sensorMeasurements;
-    QString lastUpdated = "Nieznany";
-
-    // Znajdź pomiary dla wymaganego sensora
-    for (const QJsonValue& value : allMeasurements) {
-        QJsonObject obj = value.toObject();
-        if (obj.value("id").toInt() == sensorId) {
-            sensorMeasurements = obj.value("values").toArray();
-            // Pobierz timestamp ostatniej aktualizacji jeśli dostępny
-            if (obj.contains("lastUpdated")) {
-                lastUpdated = obj.value("lastUpdated").toString();
-            }
-            break;
-        }
-    }
+    const QPointer<AirQualityMonitor> self(this);
+    QDateTime lastUpdated;
+    const QJsonArray sensorMeasurements = repository.loadMeasurements(sensorId, &lastUpdated);
 
     if (sensorMeasurements.isEmpty()) {
         // Spróbuj pobrać dane online jeśli to możliwe
-        if (!isInternetAvailable()) {
+        const bool online = co_await gios->available();
+        if (!self)
+            co_return;
+        if (!online) {
             QMessageBox::warning(this, "Brak danych",
                 "Nie znaleziono zapisanych danych pomiarowych dla tego sensora.\n"
                 "Dodatkowo brak połączenia z internetem - nie można pobrać nowych danych.",
                 QMessageBox::Ok);
-            return;
-        }
-
-        // Jeśli mamy połączenie, pobierz nowe dane
-        QUrl url(QString("https://api.gios.gov.pl/pjp-api/rest/data/getData/%1").arg(sensorId));
-        QNetworkRequest request(url);
-        QNetworkReply* reply = networkManager->get(request);
-        reply->setProperty("sensorId", sensorId); // Zapisz ID sensora jako właściwość
-        connect(reply, &QNetworkReply::finished, this, &AirQualityMonitor::onMeasurementsDownloaded);
-    }
-    else {
-        // Mamy dane offline, używamy ich
-        updateMeasurementsList(sensorMeasurements);
-        displayMeasurementData(sensorMeasurements);
-
-        // Poinformuj użytkownika, że używamy danych z pamięci podręcznej i kiedy były aktualizowane
-        QDateTime updateTime = QDateTime::fromString(lastUpdated, Qt::ISODate);
-        QString displayTime = updateTime.toString("dd.MM.yyyy HH:mm");
-
-        QMessageBox::information(this, "Używam danych lokalnych",
-            QString("Wyświetlam dane z lokalnej bazy. Ostatnia aktualizacja: %1\n\n"
-                "Naciśnij przycisk 'Pobierz dane' aby spróbować pobrać aktualne dane z internetu.")
-            .arg(displayTime),
-            QMessageBox::Ok);
-
-        // Jeśli internet jest dostępny, zapytaj czy chcą świeżych danych
-        if (isInternetAvailable()) {
-            QMessageBox::StandardButton reply = QMessageBox::question(this, "Połączenie dostępne",
-                "Wykryto dostępne połączenie z internetem. Czy chcesz pobrać najnowsze dane?",
-                QMessageBox::Yes | QMessageBox::No);
-
-            if (reply == QMessageBox::Yes) {
-                // Pobierz nowe dane
-                QUrl url(QString("https://api.gios.gov.pl/pjp-api/rest/data/getData/%1").arg(sensorId));
-                QNetworkRequest request(url);
-                QNetworkReply* netReply = networkManager->get(request);
-                netReply->setProperty("sensorId", sensorId);
-                connect(netReply, &QNetworkReply::finished, this, &AirQualityMonitor::onMeasurementsDownloaded);
-            }
+            co_return;
         }
-    }
-}
 
-/**
- * @brief Aktualizuje listę pomiarów w interfejsie użytkownika.
- * @param values Tablica JSON z wartościami pomiarów.
- *
- * Wyświetla pomiary w liście z kolorowym formatowaniem zależnym od wartości.
- */
-void AirQualityMonitor::updateMeasurementsList(const QJsonArray& values)
-{
-    ui.stationParameterListWidget->clear();
-    qDebug() << "Liczba wartości:" << values.size();
-
-    // Jeśli nie ma danych
-    if (values.isEmpty()) {
-        ui.stationParameterListWidget->addItem("Brak ważnych danych pomiarowych.");
-        return;
+        co_await downloadMeasurements(sensorId, 0);
+        co_return;
     }
 
-    // Filtruj wartości null dla czystszego wyświetlania
-    QList<QListWidgetItem*> validItems;
-    QList<QListWidgetItem*> nullItems;
-
-    // Iteruj przez dane
-    for (const QJsonValue& val : values) {
-        QJsonObject obj = val.toObject();
-
-        if (obj.contains("date")) {
-            QString dateStr = obj.value("date").toString();
-            QDateTime dateTime = QDateTime::fromString(dateStr, "yyyy-MM-dd HH:mm:ss");
-            QJsonValue value = obj.value("value");
-
-            QListWidgetItem* item;
-
-            // Jeśli wartość jest null, dodaj do nullItems
-            if (value.isNull()) {
-                item = new QListWidgetItem(
-                    QString("%1 - Brak danych")
-                    .arg(dateTime.toString("dd.MM.yyyy HH:mm"))
-                );
-                item->setForeground(Qt::gray);
-                nullItems.append(item);
-            }
-            else {
-                // Dla poprawnych wartości
-                double actualValue = value.toDouble();
-                item = new QListWidgetItem(
-                    QString("%1 - %2")
-                    .arg(dateTime.toString("dd.MM.yyyy HH:mm"))
-                    .arg(actualValue, 0, 'f', 1)
-                );
-
-                // Dodaj kodowanie kolorami na podstawie wartości (możesz dostosować progi)
-                if (actualValue > 50.0) {
-                    item->setForeground(Qt::red);
-                }
-                else if (actualValue > 25.0) {
-                    item->setForeground(QColor(255, 165, 0)); // Pomarańczowy
-                }
-                else {
-                    item->setForeground(Qt::green);
-                }
-                validItems.append(item);
-            }
-        }
-    }
+    // Mamy dane offline, używamy ich
+    displayMeasurementData(sensorMeasurements);
 
-    // Dodaj najpierw poprawne wartości, potem null
-    for (QListWidgetItem* item : validItems) {
-        ui.stationParameterListWidget->addItem(item);
-    }
+    // Poinformuj użytkownika, że używamy danych z pamięci podręcznej i kiedy były aktualizowane
+    QMessageBox::information(this, "Używam danych lokalnych",
+        QString("Wyświetlam dane z lokalnej bazy. Ostatnia aktualizacja: %1\n\n"
+            "Naciśnij przycisk 'Pobierz dane' aby spróbować pobrać aktualne dane z internetu.")
+        .arg(lastUpdated.toString("dd.MM.yyyy HH:mm")),
+        QMessageBox::Ok);
 
-    for (QListWidgetItem* item : nullItems) {
-        ui.stationParameterListWidget->addItem(item);
-    }
+    // Jeśli internet jest dostępny, zapytaj czy chcą świeżych danych
+    const bool online = co_await gios->available();
+    if (!self)
+        co_return;
+    if (online) {
+        QMessageBox::StandardButton reply = QMessageBox::question(this, "Połączenie dostępne",
+            "Wykryto dostępne połączenie z internetem. Czy chcesz pobrać najnowsze dane?",
+            QMessageBox::Yes | QMessageBox::No);
 
-    // Jeśli po przetworzeniu nie ma elementów, pokaż komunikat
-    if (ui.stationParameterListWidget->count() == 0) {
-        ui.stationParameterListWidget->addItem("Brak ważnych danych pomiarowych.");
-    }
-}
-
-/**
- * @brief Aktualizuje plik pomiarów nowymi danymi.
- * @param sensorId ID sensora, którego dane są aktualizowane.
- * @param newValues Tablica JSON z nowymi wartościami pomiarów.
- *
- * Odczytuje istniejące dane, aktualizuje je nowymi wartościami dla danego
- * sensora i zapisuje z powrotem do pliku.
- */
-void AirQualityMonitor::updateMeasurementsFile(int sensorId, const QJsonArray& newValues)
-{
-    // Utwórz timestamp dla danych
-    QDateTime currentTime = QDateTime::currentDateTime();
-    QString timestamp = currentTime.toString(Qt::ISODate);
-
-    QFile file(QDir::currentPath() + "/measurements.json");
-    QJsonArray allMeasurements;
-
-    // Odczytaj istniejące dane jeśli plik istnieje
-    if (file.exists() && file.open(QIODevice::ReadOnly)) {
-        QByteArray data = file.readAll();
-        QJsonDocument doc = QJsonDocument::fromJson(data);
-        if (doc.isArray()) allMeasurements = doc.array();
-        file.close();
-    }
-
-    // Sprawdź czy mamy już dane dla tego sensora
-    bool sensorFound = false;
-    for (int i = 0; i < allMeasurements.size(); i++) {
-        QJsonObject obj = allMeasurements[i].toObject();
-        if (obj.value("id").toInt() == sensorId) {
-            // Aktualizuj istniejące dane sensora
-            sensorFound = true;
-
-            // Dodaj timestamp wskazujący kiedy dane były ostatnio aktualizowane
-            obj["lastUpdated"] = timestamp;
-            obj["values"] = newValues;
-            allMeasurements[i] = obj;
-            break;
-        }
-    }
-
-    // Jeśli sensor nie istnieje w naszym magazynie, dodaj go
-    if (!sensorFound) {
-        QJsonObject newEntry;
-        newEntry["id"] = sensorId;
-        newEntry["values"] = newValues;
-        newEntry["lastUpdated"] = timestamp;
-        allMeasurements.append(newEntry);
-    }
-
-    // Zapisz wszystkie pomiary z powrotem do pliku
-    if (file.open(QIODevice::WriteOnly)) {
-        file.write(QJsonDocument(allMeasurements).toJson());
-        file.close();
-        QMessageBox::information(this, "Informacja", "Dane pomiarowe zostały zapisane do pliku", QMessageBox::Ok);
-    }
-    else {
-        QMessageBox::warning(this, "Błąd", "Nie udało się zapisać danych do pliku. Sprawdź uprawnienia.", QMessageBox::Ok);
-        qDebug() << "Błąd zapisu do measurements.json";
+        // Okno mogło zostać zamknięte w czasie wyświetlania pytania
+        if (self && reply == QMessageBox::Yes)
+            co_await downloadMeasurements(sensorId, 0);
     }
 }
 
@@ -690,27 +664,38 @@ void AirQualityMonitor::updateMeasurementsFile(int sensorId, const QJsonArray& n
  * @param values Tablica JSON z wartościami pomiarów.
  *
  * Tworzy wykres liniowy z danymi pomiarowymi oraz oblicza i wyświetla
- * statystyki: wartość minimalną, maksymalną, średnią i trend.
+ * statystyki: wartość minimalną, maksymalną, średnią i trend. Lista
+ * pomiarów budowana jest w updateMeasurementDisplay dla wybranego zakresu.
  */
 void AirQualityMonitor::displayMeasurementData(const QJsonArray& values)
 {
-    if (values.isEmpty())
+    lastSeries = MeasurementIngest::filledSeries(values);
+
+    if (lastSeries.measuredCount == 0) {
+        measurementModel->setMessage("Brak ważnych danych pomiarowych.");
         return;
+    }
 
-    lastMeasurements = values;
+    // Nowe godziny trafiają do modelu prognozy przyrostowo
+    if (currentSensorId != -1)
+        ingest.forecasts().ingest(currentSensorId, lastSeries);
 
-    QDateTime minDate = QDateTime::currentDateTime();
-    QDateTime maxDate = QDateTime::fromSecsSinceEpoch(0);
+    // Piramidy budowane raz na serię - zmiana zakresu dat tylko z nich czyta
+    segmentPyramids.clear();
+    for (const auto& segment : GapAnalysis::segments(lastSeries)) {
+        QVector<QPointF> points;
+        points.reserve(segment.second - segment.first + 1);
+        for (int i = segment.first; i <= segment.second; ++i)
+            points.append(QPointF(lastSeries.timeAt(i), lastSeries.values[i]));
 
-    for (const QJsonValue& value : values) {
-        QJsonObject obj = value.toObject();
-        QDateTime dt = QDateTime::fromString(obj.value("date").toString(), Qt::ISODate);
-        if (dt.isValid()) {
-            if (dt < minDate) minDate = dt;
-            if (dt > maxDate) maxDate = dt;
-        }
+        DownsamplePyramid pyramid;
+        pyramid.build(points, kChartDownsampleMode);
+        segmentPyramids.append(pyramid);
     }
 
+    QDateTime minDate = QDateTime::fromMSecsSinceEpoch(lastSeries.timeAt(0));
+    QDateTime maxDate = QDateTime::fromMSecsSinceEpoch(lastSeries.timeAt(lastSeries.size() - 1));
+
     ui.startDateEdit->setDateTime(minDate);
     ui.endDateEdit->setDateTime(maxDate);
 
@@ -720,22 +705,19 @@ void AirQualityMonitor::displayMeasurementData(const QJsonArray& values)
 /**
  * @brief Aktualizuje wyświetlanie wykresu i statystyk pomiarów.
  *
- * Odświeża wykres i statystyki na podstawie wybranego zakresu dat.
- * Oblicza minimalną, maksymalną i średnią wartość oraz trend danych.
+ * Odświeża wykres, listę pomiarów i statystyki na podstawie wybranego
+ * zakresu dat. Oblicza minimalną, maksymalną i średnią wartość oraz trend
+ * danych. Lista godzinowa zawiera wartości zmierzone, uzupełnione (szare)
+ * oraz nieuzupełnione przerwy zakresu, w kolejności czasu.
  */
 void AirQualityMonitor::updateMeasurementDisplay()
 {
-    ui.stationParameterListWidget->clear();
-
-    QLayoutItem* item;
-    while ((item = ui.verticalLayout->takeAt(0)) != nullptr) {
-        if (item->widget())
-            delete item->widget();
-        delete item;
-    }
-
+    // Wywołanie bezpośrednie unieważnia odświeżenie oczekujące po zmianie dat
+    displayTimer->stop();
 
-    if (lastMeasurements.isEmpty()) {
+    if (lastSeries.size() == 0) {
+        measurementModel->clear();
+        chartController->clear();
         ui.minValueLabel->setText("Wartość minimalna\nBrak danych");
         ui.maxValueLabel->setText("Wartość maksymalna\nBrak danych");
         ui.avgValueLabel->setText("Wartość średnia\nBrak danych");
@@ -743,61 +725,119 @@ void AirQualityMonitor::updateMeasurementDisplay()
         return;
     }
 
-    QLineSeries* series = new QLineSeries();
-    QList<double> selectedValues;
-
-    for (const QJsonValue& value : lastMeasurements) {
-        QJsonObject obj = value.toObject();
-        QDateTime dt = QDateTime::fromString(obj.value("date").toString(), Qt::ISODate);
-        if (dt.isValid() && obj.contains("value") && !obj.value("value").isNull()) {
-            if (dt >= ui.startDateEdit->dateTime() && dt <= ui.endDateEdit->dateTime()) {
-                double val = obj.value("value").toDouble();
-                selectedValues.append(val);
-                series->append(dt.toMSecsSinceEpoch(), val);
-                ui.stationParameterListWidget->addItem(dt.toString("yyyy-MM-dd HH:mm") + ": " + QString::number(val));
-            }
-        }
-    }
+    QVector<QVector<QPointF>> segmentPoints;
+    QVector<QPointF> filledPoints;
 
-    if (selectedValues.isEmpty()) {
-        ui.minValueLabel->setText("Wartość minimalna\nBrak danych");
-        ui.maxValueLabel->setText("Wartość maksymalna\nBrak danych");
-        ui.avgValueLabel->setText("Wartość średnia\nBrak danych");
-        ui.trendLabel->setText("Trend wykresu\nBrak danych");
-    }
-    else {
-        double min = *std::min_element(selectedValues.begin(), selectedValues.end());
-        double max = *std::max_element(selectedValues.begin(), selectedValues.end());
-        double avg = std::accumulate(selectedValues.begin(), selectedValues.end(), 0.0) / selectedValues.size();
-        QString trend;
+    const qint64 rangeStart = ui.startDateEdit->dateTime().toMSecsSinceEpoch();
+    const qint64 rangeEnd = ui.endDateEdit->dateTime().toMSecsSinceEpoch();
+    const RollupResolution resolution = RollupStore::resolutionFor(rangeEnd - rangeStart, kMaxChartRows);
 
-        double sumFirst = 0, sumLast = 0;
-        int size = selectedValues.size();
+    // Statystyki zakresu oraz jego połówek (do wyznaczenia trendu)
+    RangeSummary summary;
+    QVector<MeasurementRow> listRows;
 
-        // Liczymy średnią z pierwszej połowy
-        for (int i = 0; i < size / 2; ++i) {
-            sumFirst += selectedValues[i];
-        }
+    if (resolution == RollupResolution::Hourly) {
+        int filledInRange = 0;
+        QVector<int> segmentCounts;
+        int pointsInRange = 0;
 
-        // Liczymy średnią z drugiej połowy
-        for (int i = size / 2; i < size; ++i) {
-            sumLast += selectedValues[i];
-        }
+        for (const auto& segment : GapAnalysis::segments(lastSeries)) {
+            int count = 0;
+            for (int i = segment.first; i <= segment.second; ++i) {
+                const qint64 ms = lastSeries.timeAt(i);
+                if (ms < rangeStart || ms > rangeEnd)
+                    continue;
 
-        double avgFirst = sumFirst / (size / 2);
-        double avgLast = sumLast / (size - size / 2); // druga połowa może być o 1 większa
+                const double val = lastSeries.values[i];
+                ++count;
+
+                MeasurementRow row;
+                row.startMs = ms;
+                row.value = val;
+                if (lastSeries.origin[i] != PointOrigin::Measured) {
+                    row.kind = MeasurementRow::Filled;
+                    filledPoints.append(QPointF(ms, val));
+                    ++filledInRange;
+                }
+                listRows.append(row);
+            }
+            segmentCounts.append(count);
+            pointsInRange += count;
+        }
 
-        // Określamy trend
-        if (avgLast > avgFirst) {
-            trend = "Rosnący";
+        // Każdy ciągły fragment to osobna linia - wykres nie łączy punktów przez przerwy.
+        // Łącznie około dwóch punktów na piksel, rozdzielonych proporcjonalnie do długości fragmentów.
+        const int plotWidth = chartController->plotWidth() > 0 ? chartController->plotWidth() : kDefaultPlotWidth;
+        const qint64 targetPoints = 2 * plotWidth;
+        for (int s = 0; s < segmentCounts.size() && s < segmentPyramids.size(); ++s) {
+            if (segmentCounts[s] == 0)
+                continue;
+            const int target = int(std::max<qint64>(3, targetPoints * segmentCounts[s] / pointsInRange));
+            segmentPoints.append(segmentPyramids[s].query(rangeStart, rangeEnd, target));
         }
-        else if (avgLast < avgFirst) {
-            trend = "Malejący";
+
+        // Statystyki liczone wyłącznie z wartości zmierzonych
+        summary = MeasurementStatistics::summarize(lastSeries, rangeStart, rangeEnd);
+
+        // Przerwy wpisane do listy między pomiary, w kolejności czasu
+        const qsizetype valueRows = listRows.size();
+        for (const GapInterval& gap : GapAnalysis::findGaps(lastSeries)) {
+            if (gap.filled || gap.endMs < rangeStart || gap.startMs > rangeEnd)
+                continue;
+
+            MeasurementRow row;
+            row.kind = MeasurementRow::Gap;
+            row.startMs = gap.startMs;
+            row.endMs = gap.endMs;
+            row.count = gap.missingHours;
+            listRows.append(row);
         }
-        else {
-            trend = "Stabilny";
+        const int openGaps = int(listRows.size() - valueRows);
+        std::inplace_merge(listRows.begin(), listRows.begin() + valueRows, listRows.end(),
+            [](const MeasurementRow& a, const MeasurementRow& b) { return a.startMs < b.startMs; });
+        measurementModel->setRows(listRows, "yyyy-MM-dd HH:mm", true);
+        ui.statusBar->showMessage(QString("Przerwy w danych: %1, uzupełnione pomiary: %2")
+            .arg(openGaps).arg(filledInRange));
+    }
+    else {
+        // Długi zakres - zamiast pomiarów godzinowych czytamy agregaty pełnej historii sensora
+        const QVector<RollupBucket> rows = ingest.rollupRange(currentSensorId, resolution, rangeStart, rangeEnd);
+        const bool monthly = resolution == RollupResolution::Monthly;
+        QVector<QPointF> points;
+        points.reserve(rows.size());
+
+        for (int i = 0; i < rows.size(); ++i) {
+            const RollupBucket& bucket = rows[i];
+            points.append(QPointF(bucket.startMs, bucket.mean()));
+
+            MeasurementRow row;
+            row.kind = MeasurementRow::Rollup;
+            row.startMs = bucket.startMs;
+            row.value = bucket.mean();
+            row.min = bucket.min;
+            row.max = bucket.max;
+            row.count = bucket.count;
+            listRows.append(row);
         }
 
+        segmentPoints.append(points);
+        summary = MeasurementStatistics::summarize(rows);
+        measurementModel->setRows(listRows, monthly ? "yyyy-MM" : "yyyy-MM-dd", false);
+        ui.statusBar->showMessage(QString("Agregaty %1: %2 wierszy")
+            .arg(monthly ? "miesięczne" : "dzienne").arg(rows.size()));
+    }
+
+    if (summary.total.count == 0) {
+        ui.minValueLabel->setText("Wartość minimalna\nBrak danych");
+        ui.maxValueLabel->setText("Wartość maksymalna\nBrak danych");
+        ui.avgValueLabel->setText("Wartość średnia\nBrak danych");
+        ui.trendLabel->setText("Trend wykresu\nBrak danych");
+    }
+    else {
+        double min = summary.total.min;
+        double max = summary.total.max;
+        double avg = summary.total.mean();
+        QString trend = MeasurementStatistics::trendName(summary.trend());
 
         // Styl + wyśrodkowanie
         QString labelStyle = "font-size: 18px; font-weight: bold; color: #00FFC6;";
@@ -820,105 +860,41 @@ void AirQualityMonitor::updateMeasurementDisplay()
         ui.trendLabel->setText(QString("Trend wykresu\n%1").arg(trend));
     }
 
-    // Wykres
-    QChart* chart = new QChart();
-    chart->legend()->hide();
-    chart->addSeries(series);
-    chart->setTitle("Pomiary");
-
-    QDateTimeAxis* axisX = new QDateTimeAxis;
-    axisX->setFormat("dd-MM HH:mm");
-    axisX->setTitleText("Czas");
-    axisX->setLabelsAngle(-45);
-    chart->addAxis(axisX, Qt::AlignBottom);
-    series->attachAxis(axisX);
-
-    QValueAxis* axisY = new QValueAxis;
-    axisY->setTitleText("Wartość");
-    chart->addAxis(axisY, Qt::AlignLeft);
-    series->attachAxis(axisY);
-
-    chart->setBackgroundBrush(QBrush(QColor("#121212")));
-    chart->setTitleBrush(QBrush(Qt::white));
-    axisX->setLinePenColor(Qt::white);
-    axisX->setLabelsBrush(Qt::white);
-    axisY->setLinePenColor(Qt::white);
-    axisY->setLabelsBrush(Qt::white);
-    axisX->setGridLineColor(QColor("#555555"));
-    axisY->setGridLineColor(QColor("#555555"));
-    series->setColor(QColor("#00c3ff"));
-
-    QChartView* chartView = new QChartView(chart);
-    chartView->setRenderHint(QPainter::Antialiasing);
-
-    ui.verticalLayout->addWidget(chartView);
+    // Prognoza na kolejne godziny jako przerywana kontynuacja, gdy widoczny jest koniec danych
+    QVector<QPointF> forecastPoints;
+    const QVector<QPointF> forecast = ingest.forecasts().forecast(currentSensorId);
+    const int lastIndex = lastSeries.size() - 1;
+    if (resolution == RollupResolution::Hourly && !forecast.isEmpty() && lastSeries.hasValue(lastIndex)
+        && QDateTime::fromMSecsSinceEpoch(rangeEnd).date() >= QDateTime::fromMSecsSinceEpoch(lastSeries.timeAt(lastIndex)).date()) {
+        forecastPoints.reserve(forecast.size() + 1);
+        forecastPoints.append(QPointF(lastSeries.timeAt(lastIndex), lastSeries.values[lastIndex]));
+        forecastPoints += forecast;
+    }
+
+    // Wykres - istniejące serie dostają nowe dane, bez przebudowy sceny
+    chartController->setData(segmentPoints, filledPoints, forecastPoints,
+        resolution == RollupResolution::Hourly ? "dd-MM HH:mm" : "dd-MM-yyyy");
 }
 
 /**
  * @brief Ładuje interfejs mapy.
  *
- * Tworzy i inicjalizuje interfejs OpenStreetMap do wyświetlania
- * stacji pomiarowych na mapie interaktywnej.
+ * Tworzy widok webowy (przy pierwszym wywołaniu) i wczytuje stronę mapy
+ * OpenStreetMap z zasobów aplikacji. Strona jest ładowana jednokrotnie
+ * i pozostaje aktywna w widoku mapy.
  */
 void AirQualityMonitor::loadMap()
 {
-    QString html = R"(
-    <!DOCTYPE html>
-    <html>
-    <head>
-      <meta charset="utf-8" />
-      <title>Mapa Stacji</title>
-      <meta name="viewport" content="width=device-width, initial-scale=1.0">
-      <link rel="stylesheet" href="https://unpkg.com/leaflet@1.9.4/dist/leaflet.css" />
-      <script src="https://unpkg.com/leaflet@1.9.4/dist/leaflet.js"></script>
-      <script src="qrc:///qtwebchannel/qwebchannel.js"></script>
-      <script>
-        new QWebChannel(qt.webChannelTransport, function(channel) {
-            window.bridge = channel.objects.bridge;
-        });
-
-        var map;
-        var markers = [];
-
-        function addMarker(lat, lon, popupText) {
-            var marker = L.marker([lat, lon]).addTo(map);
-            marker.bindPopup(popupText);
-            marker.on('click', function() {
-                bridge.onMarkerClicked(popupText);
-            });
-            markers.push(marker);
-        }
-
-        function clearMarkers() {
-            for (var i = 0; i < markers.length; i++) {
-                map.removeLayer(markers[i]);
-            }
-            markers = [];
-        }
-
-        window.onload = function() {
-            map = L.map('map').setView([52.4064, 16.9252], 12);
-            L.tileLayer('https://{s}.tile.openstreetmap.org/{z}/{x}/{y}.png', {
-                maxZoom: 19,
-                attribution: '© OpenStreetMap'
-            }).addTo(map);
-        };
-      </script>
-
-      <style>
-        html, body { height: 100%; margin: 0; }
-        #map { height: 100%; }
-      </style>
-    </head>
-    <body>
-      <div id="map"></div>
-    </body>
-    </html>
-    )";
+    // Strona mapy ładowana tylko raz - kolejne przełączenia pokazują gotowy widok
+    if (mapLoaded)
+        return;
 
-    if (webView) {
-        webView->setHtml(html);
-    }
+    setupWebView();
+    mapLoaded = true;
+    connect(webView, &QWebEngineView::loadFinished, this, [](bool ok) {
+        StartupTrace::mark(ok ? "mapa wczytana" : "błąd wczytania mapy");
+        }, Qt::SingleShotConnection);
+    webView->setUrl(QUrl(kMapPageUrl));
 }
 
 /**
@@ -928,39 +904,10 @@ void AirQualityMonitor::loadMap()
  */
 void AirQualityMonitor::showAllStationsOnMap()
 {
-    if (!webView)
-        return;
-
-    // Wyczyść stare markery
-    webView->page()->runJavaScript("clearMarkers();");
-
-    // Dodaj wszystkie stacje
-    for (const QJsonValue& value : cachedStations) {
-        QJsonObject obj = value.toObject();
-        double lat = obj.value("gegrLat").toString().toDouble();
-        double lon = obj.value("gegrLon").toString().toDouble();
-        QString name = obj.value("stationName").toString().replace("'", "\\'");
-        QString js = QString("addMarker(%1, %2, '%3');").arg(lat).arg(lon).arg(name);
-        webView->page()->runJavaScript(js);
-    }
+    mapIndex.build(stationModel->records());
+    publishViewportMarkers();
 }
 
-/**
- * @brief Obsługuje kliknięcie markera na mapie.
- * @param stationName Nazwa stacji, która została kliknięta.
- *
- * Znajduje stację o podanej nazwie i wyświetla jej szczegóły.
- */
-void AirQualityMonitor::onMarkerClicked(const QString& stationName)
-{
-    qDebug() << "Kliknięto marker:" << stationName;
-
-    // Ręcznie znajdź stację i pokaż szczegóły
-    QList<QListWidgetItem*> items = ui.stationListWidget->findItems(stationName, Qt::MatchExactly);
-    if (!items.isEmpty()) {
-        showStationDetails(items.first());
-    }
-}
 
 /**
  * @brief Obsługuje kliknięcie przycisku wyszukiwania w pobliżu.
@@ -985,19 +932,34 @@ void AirQualityMonitor::onSearchNearbyClicked()
         return;
     }
 
-    geocodeAddress(address, radius);
+    // Kilka adresów rozdzielonych średnikami - stacje w promieniu od każdego z nich
+    QStringList addresses;
+    for (const QString& part : address.split(';', Qt::SkipEmptyParts)) {
+        if (!part.trimmed().isEmpty())
+            addresses.append(part.trimmed());
+    }
+    geocodeAddresses(addresses, QVector<GeoPoint>(), radius);
 }
 
 /**
- * @brief Konwertuje adres tekstowy na współrzędne geograficzne.
- * @param address Adres do geokodowania.
+ * @brief Konwertuje kolejne adresy tekstowe na współrzędne geograficzne.
+ * @param addresses Adresy pozostałe do geokodowania.
+ * @param found Współrzędne adresów już znalezionych.
  * @param radius Promień wyszukiwania w kilometrach.
  *
- * Wykorzystuje usługę Nominatim OpenStreetMap do geokodowania adresu,
- * a następnie wywołuje funkcję wyszukiwania stacji w promieniu.
+ * Wykorzystuje usługę Nominatim OpenStreetMap do geokodowania adresów
+ * (po jednym żądaniu naraz, zgodnie z zasadami usługi), a po ostatnim
+ * wywołuje wyszukiwanie stacji w promieniu od wszystkich znalezionych punktów.
  */
-void AirQualityMonitor::geocodeAddress(const QString& address, double radius)
+void AirQualityMonitor::geocodeAddresses(QStringList addresses, QVector<GeoPoint> found, double radius)
 {
+    if (addresses.isEmpty()) {
+        if (!found.isEmpty())
+            findStationsInRadius(found, radius);
+        return;
+    }
+
+    const QString address = addresses.takeFirst();
     QUrl url(QString("https://nominatim.openstreetmap.org/search?q=%1&format=json&limit=1")
         .arg(QUrl::toPercentEncoding(address)));
 
@@ -1005,7 +967,7 @@ void AirQualityMonitor::geocodeAddress(const QString& address, double radius)
     request.setRawHeader("User-Agent", "AirQualityMonitorApp");
 
     QNetworkReply* reply = networkManager->get(request);
-    connect(reply, &QNetworkReply::finished, this, [this, reply, radius]() {
+    connect(reply, &QNetworkReply::finished, this, [this, reply, addresses, found, radius]() mutable {
         if (reply->error() != QNetworkReply::NoError) {
             qDebug() << "Błąd geokodowania:" << reply->errorString();
             reply->deleteLater();
@@ -1020,37 +982,76 @@ void AirQualityMonitor::geocodeAddress(const QString& address, double radius)
             double lon = obj.value("lon").toString().toDouble();
             qDebug() << "Adres znaleziony: " << lat << lon;
 
-            findStationsInRadius(lat, lon, radius);
+            found.append({ lat, lon });
         }
         else {
             qDebug() << "Nie znaleziono adresu.";
         }
 
         reply->deleteLater();
+        geocodeAddresses(addresses, found, radius);
         });
 }
 
 /**
  * @brief Znajduje stacje w promieniu od określonych współrzędnych.
- * @param centerLat Szerokość geograficzna środka obszaru wyszukiwania.
- * @param centerLon Długość geograficzna środka obszaru wyszukiwania.
+ * @param centers Środki obszarów wyszukiwania.
  * @param radiusKm Promień wyszukiwania w kilometrach.
  *
- * Przeszukuje buforowane stacje i wybiera te, które znajdują się
- * w określonym promieniu od podanych współrzędnych.
+ * Zapytania wykonywane są w planiście na kopii drzewa k-d stacji (dla
+ * wielu punktów równolegle), a wynik odbierany jest w wątku aplikacji;
+ * wynik wyszukiwania zastąpionego nowszym jest pomijany. Gdy w promieniu
+ * nie ma żadnej stacji, pokazywana jest najbliższa stacja mierząca parametr
+ * wybrany na mapie (lub po prostu najbliższa, jeśli sensory żadnej nie są
+ * jeszcze znane).
  */
-void AirQualityMonitor::findStationsInRadius(double centerLat, double centerLon, double radiusKm)
+void AirQualityMonitor::findStationsInRadius(const QVector<GeoPoint>& centers, double radiusKm)
 {
-    QVector<QJsonObject> stationsInRadius;
+    const int request = ++radiusSearchRequest;
+    const StationKdTree tree = stationTree;
+    QPointer<AirQualityMonitor> self(this);
+    Parallel::run([tree, centers, radiusKm]() { return tree.withinRadius(centers, radiusKm); },
+        TaskPriority::Interactive).then(
+        [this, self, request, centers](const QVector<QVector<StationDistance>>& results) {
+        if (!self || request != radiusSearchRequest)
+            return;
+        showStationsInRadius(centers, results);
+        });
+}
 
-    for (const QJsonValue& value : cachedStations) {
-        QJsonObject obj = value.toObject();
-        double lat = obj.value("gegrLat").toString().toDouble();
-        double lon = obj.value("gegrLon").toString().toDouble();
+/**
+ * @brief Pokazuje na mapie stacje znalezione w promieniu.
+ * @param centers Środki obszarów wyszukiwania.
+ * @param results Stacje w promieniu od kolejnych środków.
+ */
+void AirQualityMonitor::showStationsInRadius(const QVector<GeoPoint>& centers, const QVector<QVector<StationDistance>>& results)
+{
+    const QVector<StationRecord>& records = stationModel->records();
+    QVector<bool> selected(records.size(), false);
+    QVector<StationRecord> stationsInRadius;
+
+    for (const QVector<StationDistance>& found : results) {
+        for (const StationDistance& station : found) {
+            if (!selected[station.row]) {
+                selected[station.row] = true;
+                stationsInRadius.append(records[station.row]);
+            }
+        }
+    }
 
-        double distance = haversineDistance(centerLat, centerLon, lat, lon);
-        if (distance <= radiusKm) {
-            stationsInRadius.append(obj);
+    if (stationsInRadius.isEmpty() && !centers.isEmpty()) {
+        const QString pollutant = ui.pollutantComboBox->currentText();
+        StationDistance nearest = stationTree.nearestMatching(centers.first(), [&](int row) {
+            return ingest.stationIndex().measures(records[row].id, pollutant);
+            }, kNearestFallbackKm);
+        if (nearest.row == -1) {
+            const QVector<StationDistance> closest = stationTree.nearest(centers.first(), 1);
+            if (!closest.isEmpty())
+                nearest = closest.first();
+        }
+        if (nearest.row != -1) {
+            qDebug() << "Brak stacji w promieniu, najbliższa:" << records[nearest.row].name << nearest.km << "km";
+            stationsInRadius.append(records[nearest.row]);
         }
     }
 
@@ -1058,51 +1059,145 @@ void AirQualityMonitor::findStationsInRadius(double centerLat, double centerLon,
 }
 
 /**
- * @brief Oblicza odległość między dwoma punktami geograficznymi używając formuły Haversine.
- * @param lat1 Szerokość geograficzna pierwszego punktu.
- * @param lon1 Długość geograficzna pierwszego punktu.
- * @param lat2 Szerokość geograficzna drugiego punktu.
- * @param lon2 Długość geograficzna drugiego punktu.
- * @return Odległość w kilometrach.
+ * @brief Aktualizuje mapę znacznikami stacji.
+ * @param stations Stacje do wyświetlenia.
+ *
+ * Podane stacje stają się zestawem mapy; znaczniki widocznego obszaru
+ * wysyłane są jednym komunikatem przez most QWebChannel.
+ */
+void AirQualityMonitor::updateMapWithStations(const QVector<StationRecord>& stations)
+{
+    mapIndex.build(stations);
+    publishViewportMarkers();
+}
+
+/**
+ * @brief Obsługuje zmianę widocznego obszaru mapy.
+ * @param viewport Obszar i poziom przybliżenia zgłoszone przez mapę.
+ */
+void AirQualityMonitor::onViewportChanged(const MapViewport& viewport)
+{
+    mapViewport = viewport;
+    publishViewportMarkers();
+}
+
+/**
+ * @brief Wysyła mapie znaczniki stacji z widocznego obszaru.
  *
- * Implementacja formuły Haversine do obliczania odległości między punktami
- * na powierzchni Ziemi, uwzględniając jej krzywiznę.
+ * Przy małym przybliżeniu lub zbyt wielu stacjach w widoku wysyłane są
+ * grupy stacji (środek, liczność i najgorsza klasa indeksu) zamiast
+ * pojedynczych znaczników; kratka z jedną stacją pozostaje zwykłym
+ * znacznikiem z klasą i obsługą kliknięcia.
  */
-double AirQualityMonitor::haversineDistance(double lat1, double lon1, double lat2, double lon2)
+void AirQualityMonitor::publishViewportMarkers()
 {
-    double dLat = qDegreesToRadians(lat2 - lat1);
-    double dLon = qDegreesToRadians(lon2 - lon1);
+    if (mapViewport.zoom < 0)
+        return;
 
-    double a = sin(dLat / 2) * sin(dLat / 2) +
-        cos(qDegreesToRadians(lat1)) * cos(qDegreesToRadians(lat2)) *
-        sin(dLon / 2) * sin(dLon / 2);
+    const QString pollutant = ui.pollutantComboBox->currentText();
+    const QHash<int, StationReading> readings = ingest.stationIndex().readings(pollutant);
+    const QVector<StationRecord>& stations = mapIndex.stations();
+    QVector<StationRecord> visible;
+
+    if (mapViewport.zoom < kMapClusterMaxZoom || mapIndex.count(mapViewport) > kMaxViewportMarkers) {
+        QVector<int> levels(stations.size());
+        for (int row = 0; row < stations.size(); ++row)
+            levels[row] = readings.value(stations[row].id).level;
+
+        // Kratka grupowania ok. 64 pikseli na bieżącym poziomie przybliżenia
+        const double clusterDegrees = 90.0 / (1 << std::clamp(mapViewport.zoom, 0, 24));
+        QVector<StationCluster> clusters;
+        for (const StationCluster& cluster : mapIndex.clusters(mapViewport, clusterDegrees, levels)) {
+            if (cluster.row != -1)
+                visible.append(stations[cluster.row]);
+            else
+                clusters.append(cluster);
+        }
+        bridge->setMarkers(visible, clusters, pollutant, readings);
+        return;
+    }
 
-    double c = 2 * atan2(sqrt(a), sqrt(1 - a));
+    for (int row : mapIndex.query(mapViewport))
+        visible.append(stations[row]);
+    bridge->setMarkers(visible, QVector<StationCluster>(), pollutant, readings);
+}
 
-    return kEarthRadiusKm * c;
+/**
+ * @brief Obsługuje trasę narysowaną na mapie.
+ * @param route Punkty trasy (pusta lista czyści trasę).
+ */
+void AirQualityMonitor::onRouteDrawn(const QVector<GeoPoint>& route)
+{
+    mapRoutes.clear();
+    if (route.size() >= 2)
+        mapRoutes.append(route);
+    publishRouteExposure();
 }
 
 /**
- * @brief Aktualizuje mapę znacznikami stacji.
- * @param stations Wektor obiektów JSON z danymi stacji.
+ * @brief Wczytuje trasy z pliku GPX i pokazuje narażenie na każdej z nich.
  *
- * Generuje kod JavaScript do aktualizacji mapy znacznikami
- * dla podanych stacji. Każdy znacznik zawiera nazwę stacji.
+ * Każdy segment śladu i każda trasa pliku traktowane są jako osobna
+ * (alternatywna) trasa.
  */
-void AirQualityMonitor::updateMapWithStations(const QVector<QJsonObject>& stations)
+void AirQualityMonitor::importRouteFromGpx()
 {
-    QString jsCode = "clearMarkers();\n"; // zakładamy, że masz funkcję w mapie która czyści stare markery
+    const QString fileName = QFileDialog::getOpenFileName(this, "Wybierz trasę", QString(), "Trasy GPX (*.gpx)");
+    if (fileName.isEmpty())
+        return;
 
-    for (const auto& station : stations) {
-        double lat = station["gegrLat"].toString().toDouble();
-        double lon = station["gegrLon"].toString().toDouble();
-        QString name = station["stationName"].toString();
-        QString popup = QString("%1").arg(name);
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        QMessageBox::warning(this, "Błąd", "Nie udało się otworzyć pliku trasy.", QMessageBox::Ok);
+        return;
+    }
 
-        jsCode += QString("addMarker(%1, %2, \"%3\");\n").arg(lat).arg(lon).arg(popup);
+    const QVector<QVector<GeoPoint>> routes = RouteExposure::fromGpx(file.readAll());
+    if (routes.isEmpty()) {
+        QMessageBox::warning(this, "Błąd", "Plik nie zawiera żadnej trasy.", QMessageBox::Ok);
+        return;
     }
 
-    webView->page()->runJavaScript(jsCode);
+    mapRoutes = routes;
+    publishRouteExposure();
+}
+
+/**
+ * @brief Liczy narażenie na trasach mapy i przekazuje je mapie.
+ *
+ * Pole stężenia budowane jest z najnowszych pomiarów parametru wybranego
+ * na mapie; trasy liczone są równolegle w planiście, a wynik trafia do mapy
+ * w wątku aplikacji (o ile w międzyczasie nie zlecono nowszego liczenia).
+ */
+void AirQualityMonitor::publishRouteExposure()
+{
+    const int request = ++routeExposureRequest;
+    const QString pollutant = ui.pollutantComboBox->currentText();
+    const QVector<QVector<GeoPoint>> routes = mapRoutes;
+    if (routes.isEmpty()) {
+        bridge->setRoutes(routes, QVector<RouteExposureResult>(), pollutant);
+        return;
+    }
+
+    const QVector<StationRecord> stations = stationModel->records();
+    const QHash<int, StationReading> readings = ingest.stationIndex().readings(pollutant);
+    auto compute = [stations, readings, routes]() {
+        RouteExposure exposure;
+        exposure.build(stations, readings);
+
+        RouteExposureOptions options;
+        options.spacingKm = kRouteSpacingKm;
+        options.speedKmh = kRouteSpeedKmh;
+        return exposure.evaluate(routes, options);
+    };
+
+    QPointer<AirQualityMonitor> self(this);
+    Parallel::run(compute, TaskPriority::Interactive).then(
+        [this, self, request, routes, pollutant](const QVector<RouteExposureResult>& results) {
+        if (!self || request != routeExposureRequest)
+            return;
+        bridge->setRoutes(routes, results, pollutant);
+        });
 }
 
 /**
@@ -1113,84 +1208,69 @@ void AirQualityMonitor::updateMapWithStations(const QVector<QJsonObject>& statio
  */
 void AirQualityMonitor::loadStations()
 {
-    QFile file(QDir::currentPath() + "/stations.json");
-    if (file.exists()) {
-        cachedStations = loadStationsFromFile();
-        filterStations(ui.searchBox->text());
-    }
-    else {
+    if (repository.hasStations())
+        setStations(StationRecord::fromJson(repository.loadStations()));
+    else
         loadStationsFromApi();
-    }
 }
 
+/**
+ * @brief Ustawia listę stacji i buduje jej indeksy.
+ * @param stations Rekordy stacji.
+ */
+void AirQualityMonitor::setStations(const QVector<StationRecord>& stations)
+{
+    stationModel->setStations(stations);
+    stationSearch.build(stationModel->records());
+    stationTree.build(stationModel->records());
+    filterStations(ui.searchBox->text());
+}
 
-/////////////////////////////////////////////////////////////////////////////////////////////////
 /**
  * @brief Pobiera dane stacji z API GIOŚ.
  *
- * Używa wielowątkowości do pobrania danych stacji z API,
- * aby nie blokować interfejsu użytkownika podczas pobierania.
+ * Żądanie jest asynchroniczne, więc nie blokuje interfejsu użytkownika.
  */
 void AirQualityMonitor::loadStationsFromApi()
 {
-    // Wielowątkowość - pobiera stacje z API, bo łączy z netem, pobiera dużo danych,
-    // może potrwać i czasami zamraża GUI
-    QtConcurrent::run([this]() {
-        QUrl url("https://api.gios.gov.pl/pjp-api/rest/station/findAll");
-        QNetworkRequest request(url);
-        QNetworkReply* reply = networkManager->get(request);
-        connect(reply, &QNetworkReply::finished, this, &AirQualityMonitor::onStationsFinished);
+    gios->fetchStations([this](const QJsonArray& stations, const QString& error) {
+        onStationsFinished(stations, error);
         });
 }
-/////////////////////////////////////////////////////////////////////////////////////////////////
 
 
 /**
  * @brief Obsługuje zakończenie pobierania danych stacji z API.
+ * @param stations Pobrane stacje.
+ * @param error Opis błędu (pusty, gdy pobrano dane).
  *
- * Przetwarza odpowiedź API, zapisuje dane do pliku lokalnego
- * i aktualizuje interfejs użytkownika.
+ * Zapisuje dane do pliku lokalnego i aktualizuje interfejs użytkownika.
  */
-void AirQualityMonitor::onStationsFinished()
+void AirQualityMonitor::onStationsFinished(const QJsonArray& stations, const QString& error)
 {
-    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
-    if (!reply) return;
-
-    if (reply->error() != QNetworkReply::NoError) {
-        qDebug() << "Błąd sieci:" << reply->errorString();
-        reply->deleteLater();
+    if (!error.isEmpty()) {
+        qDebug() << "Błąd sieci:" << error;
         return;
     }
 
-    QByteArray data = reply->readAll();
-    QJsonDocument doc = QJsonDocument::fromJson(data);
-
-    if (doc.isArray()) {
-        cachedStations = doc.array();
-        saveStationsToFile(cachedStations);
-        filterStations(ui.searchBox->text());
-    }
-
-    reply->deleteLater();
+    repository.saveStations(stations);
+    if (localApi)
+        localApi->setStations(stations);
+    setStations(StationRecord::fromJson(stations));
 }
 
 /**
  * @brief Filtruje listę stacji na podstawie tekstu wyszukiwania.
  * @param text Tekst filtrujący nazwy stacji.
  *
- * Wyświetla w liście stacji tylko te, których nazwy zawierają
- * podany tekst (bez uwzględniania wielkości liter).
+ * Wyświetla w liście stacji tylko te, których nazwa, miejscowość, gmina,
+ * powiat lub ulica pasują do podanego tekstu (bez uwzględniania wielkości
+ * liter i polskich znaków), od najlepiej dopasowanych.
  */
 void AirQualityMonitor::filterStations(const QString& text)
 {
-    ui.stationListWidget->clear();
-    for (const QJsonValue& value : cachedStations) {
-        QJsonObject obj = value.toObject();
-        QString stationName = obj.value("stationName").toString();
-        if (stationName.contains(text, Qt::CaseInsensitive)) {
-            ui.stationListWidget->addItem(stationName);
-        }
-    }
+    searchTimer->stop();
+    stationProxy->setResult(stationSearch.search(text));
 }
 
 /**
@@ -1205,134 +1285,199 @@ void AirQualityMonitor::showStationListView()
 
 /**
  * @brief Wyświetla szczegóły wybranej stacji.
- * @param item Element listy reprezentujący wybraną stację.
+ * @param index Indeks wybranego wiersza listy stacji.
  *
  * Przełącza widok na panel szczegółów stacji i ładuje dane o sensorach
  * dla wybranej stacji.
  */
-void AirQualityMonitor::showStationDetails(QListWidgetItem* item)
+void AirQualityMonitor::showStationDetails(const QModelIndex& index)
 {
-    if (!item) return;
+    if (!index.isValid()) return;
 
-    ui.confirmButton->setCurrentIndex(1);
+    showStationDetailsById(index.data(IdRole).toInt());
+}
 
-    QString stationName = item->text();
-    int stationId = -1;
-    for (const QJsonValue& value : cachedStations) {
-        QJsonObject obj = value.toObject();
-        if (obj.value("stationName").toString() == stationName) {
-            stationId = obj.value("id").toInt();
-            break;
-        }
+/**
+ * @brief Wyświetla szczegóły stacji o podanym ID.
+ * @param stationId ID stacji.
+ *
+ * Stacja wyszukiwana jest w indeksie ID modelu listy, więc wynik nie zależy
+ * od filtra listy ani od powtarzających się nazw stacji.
+ */
+void AirQualityMonitor::showStationDetailsById(int stationId)
+{
+    const int row = stationModel->rowOfId(stationId);
+    if (row == -1) {
+        qDebug() << "Nieznana stacja:" << stationId;
+        return;
     }
 
-    if (stationId != -1) {
-        currentStationId = stationId;
-        QUrl url(QString("https://api.gios.gov.pl/pjp-api/rest/station/sensors/%1").arg(stationId));
-        QNetworkRequest request(url);
-        QNetworkReply* reply = networkManager->get(request);
-        connect(reply, &QNetworkReply::finished, this, &AirQualityMonitor::onSensorsFinished);
-    }
+    // Zaznaczenie stacji na liście (jeśli jest widoczna po filtrowaniu)
+    ui.stationListWidget->setCurrentIndex(stationProxy->mapFromSource(stationModel->index(row)));
+    ui.confirmButton->setCurrentIndex(1);
+
+    currentStationId = stationId;
+    gios->fetchSensors(stationId, [this, stationId](const QJsonArray& sensors, const QString& error) {
+        onSensorsFinished(stationId, sensors, error);
+        });
 }
 
 /**
  * @brief Wyświetla szczegóły wybranego sensora.
- * @param item Element listy reprezentujący wybrany sensor.
+ * @param index Indeks wybranego wiersza listy sensorów.
  *
  * Przełącza widok na panel szczegółów sensora i ładuje dane pomiarowe
  * dla wybranego sensora.
  */
-void AirQualityMonitor::showSensorDetails(QListWidgetItem* item)
+void AirQualityMonitor::showSensorDetails(const QModelIndex& index)
 {
-    if (!item) return;
+    if (!index.isValid()) return;
 
     ui.confirmButton->setCurrentIndex(2);
 
-    QString sensorDisplayName = item->text();
-    if (sensorMap.contains(sensorDisplayName)) {
-        int sensorId = sensorMap.value(sensorDisplayName);
-        currentSensorId = sensorMap.value(sensorDisplayName);
-        qDebug() << "Ładowanie danych pomiarowych dla sensora o ID:" << sensorId;
-        loadMeasurementData(sensorId);
-    }
-    else {
-        qDebug() << "Sensor o nazwie" << sensorDisplayName << "nie został znaleziony!";
-    }
+    int sensorId = index.data(IdRole).toInt();
+    currentSensorId = sensorId;
+    qDebug() << "Ładowanie danych pomiarowych dla sensora o ID:" << sensorId;
+    loadMeasurementData(sensorId);
 }
 
 
-
-//////////////////////
-
 /**
- * @brief Ładuje dane stacji z pliku JSON.
- * @return Tablica JSON z danymi stacji.
+ * @brief Liczy i wyświetla korelacje między zanieczyszczeniami aktualnej stacji.
+ *
+ * Serie wszystkich sensorów stacji zapisanych w measurements.json są
+ * wyrównywane do wspólnej osi godzinowej, a obliczenia wykonywane w tle.
  */
-QJsonArray AirQualityMonitor::loadStationsFromFile()
+void AirQualityMonitor::showStationCorrelations()
 {
-    QFile file(QDir::currentPath() + "/stations.json");
-    if (!file.open(QIODevice::ReadOnly)) {
-        qDebug() << "Nie można otworzyć pliku stations.json: " << file.errorString();
-        return QJsonArray();
+    if (currentStationId == -1 || sensorMap.isEmpty()) {
+        QMessageBox::warning(this, "Ostrzeżenie", "Nie wybrano stacji.", QMessageBox::Ok);
+        return;
     }
 
-    QByteArray data = file.readAll();
-    file.close();
+    // Kod parametru z nazwy wyświetlanej "nazwa (KOD)"
+    static const QRegularExpression codePattern("\\(([^)]+)\\)$");
+    QMap<int, QString> columnNames;
+    for (auto it = sensorMap.constBegin(); it != sensorMap.constEnd(); ++it) {
+        QRegularExpressionMatch match = codePattern.match(it.key());
+        columnNames.insert(it.value(), match.hasMatch() ? match.captured(1) : it.key());
+    }
 
-    QJsonParseError parseError;
-    QJsonDocument doc = QJsonDocument::fromJson(data, &parseError);
+    QJsonArray allMeasurements = repository.loadMeasurements();
 
-    if (parseError.error != QJsonParseError::NoError) {
-        qDebug() << "Błąd parsowania JSON: " << parseError.errorString();
-        return QJsonArray();
-    }
+    // Obliczenia z priorytetem interaktywnym wyprzedzają zadania wsadowe w planiście
+    auto compute = [allMeasurements, columnNames]() {
+        QVector<QPair<QString, MeasurementSeries>> series;
+        for (const QJsonValue& value : allMeasurements) {
+            QJsonObject obj = value.toObject();
+            const int sensorId = obj.value("id").toInt();
+            if (columnNames.contains(sensorId))
+                series.append(qMakePair(columnNames.value(sensorId), GapAnalysis::fromJson(obj.value("values").toArray())));
+        }
 
-    if (!doc.isArray()) {
-        qDebug() << "Dokument JSON nie zawiera tablicy";
-        return QJsonArray();
-    }
+        AlignedColumns columns = CorrelationAnalysis::align(series);
+        CorrelationResult result = CorrelationAnalysis::correlate(columns);
+
+        // Opóźnienie, przy którym zależność między parą jest najsilniejsza
+        QStringList lagLines;
+        for (int i = 0; i < columns.columns(); ++i) {
+            for (int j = i + 1; j < columns.columns(); ++j) {
+                LaggedCorrelation lagged = CorrelationAnalysis::crossCorrelation(columns, i, j, kMaxCorrelationLagHours);
+                if (lagged.best == 0.0)
+                    continue;
+                lagLines.append(QString("%1 / %2: najsilniejsza korelacja %3 przy przesunięciu %4 h")
+                    .arg(columns.names[i], columns.names[j])
+                    .arg(lagged.best, 0, 'f', 2)
+                    .arg(lagged.bestLag));
+            }
+        }
+        return qMakePair(result, lagLines);
+    };
 
-    return doc.array();
-}
+    QPointer<AirQualityMonitor> self(this);
+    Parallel::run(compute, TaskPriority::Interactive).then(
+        [this, self](const QPair<CorrelationResult, QStringList>& computed) {
+        if (!self)
+            return;
+        const CorrelationResult& result = computed.first;
+        const QStringList& lagLines = computed.second;
 
-/**
- * @brief Zapisuje dane stacji do pliku JSON.
- * @param stations Tablica JSON z danymi stacji.
- */
-void AirQualityMonitor::saveStationsToFile(const QJsonArray& stations)
-{
-    QFile file(QDir::currentPath() + "/stations.json");
-    if (file.open(QIODevice::WriteOnly)) {
-        file.write(QJsonDocument(stations).toJson());
-        file.close();
-        qDebug() << "Dane zapisane do pliku stations.json";
-    }
-    else {
-        qDebug() << "Nie można otworzyć pliku stations.json do zapisu: " << file.errorString();
-    }
+        if (result.size() < 2) {
+            QMessageBox::information(this, "Korelacje",
+                "Za mało zapisanych serii pomiarowych dla tej stacji.\n"
+                "Pobierz dane co najmniej dwóch sensorów.", QMessageBox::Ok);
+            return;
+        }
+
+        QDialog dialog(this);
+        dialog.setWindowTitle("Korelacje zanieczyszczeń");
+        QVBoxLayout* layout = new QVBoxLayout(&dialog);
+        layout->addWidget(new QLabel("Pearson (P) i Spearman (S) na wspólnych godzinach pomiarów", &dialog));
+
+        QTableWidget* table = new QTableWidget(result.size(), result.size(), &dialog);
+        table->setHorizontalHeaderLabels(result.names);
+        table->setVerticalHeaderLabels(result.names);
+        table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+        for (int i = 0; i < result.size(); ++i) {
+            for (int j = 0; j < result.size(); ++j) {
+                const int cell = result.at(i, j);
+                QString text = result.pairCounts[cell] < CorrelationAnalysis::kMinPairCount
+                    ? QString("-")
+                    : QString("P: %1\nS: %2")
+                    .arg(result.pearson[cell], 0, 'f', 2)
+                    .arg(result.spearman[cell], 0, 'f', 2);
+                table->setItem(i, j, new QTableWidgetItem(text));
+            }
+        }
+        table->resizeColumnsToContents();
+        table->resizeRowsToContents();
+        layout->addWidget(table);
+
+        if (!lagLines.isEmpty())
+            layout->addWidget(new QLabel(lagLines.join("\n"), &dialog));
+
+        dialog.resize(600, 450);
+        dialog.exec();
+        });
 }
 
+
+
+//////////////////////
+
 /**
  * @brief Konfiguruje widok webowy dla mapy.
+ *
+ * Tworzy widok, profil z pamięcią podręczną i kanał do mostu przy
+ * pierwszym wywołaniu; kolejne wywołania nic nie robią.
  */
 void AirQualityMonitor::setupWebView()
 {
-    webView = new QWebEngineView(ui.mapPage);
+    if (webView)
+        return;
 
+    webView = new QWebEngineView(ui.mapPage);
     if (ui.mapLayout) {
         ui.mapLayout->addWidget(webView);
     }
-
     webView->setContextMenuPolicy(Qt::NoContextMenu);
 
+    // Leaflet wczytywany jest z zasobów aplikacji (lub z CDN ze sprawdzeniem skrótu);
+    // trwały profil z dyskową pamięcią podręczną przechowuje kafelki pobrane spoza
+    // lokalnej bazy i bibliotekę pobraną z CDN
+    QWebEngineProfile* profile = new QWebEngineProfile(QStringLiteral("AirQualityMonitor"), this);
+    profile->setHttpCacheType(QWebEngineProfile::DiskHttpCache);
+    profile->setHttpCacheMaximumSize(kMapCacheBytes);
+    profile->installUrlSchemeHandler(TileSchemeHandler::kScheme, new TileSchemeHandler(tileCache, this));
+    webView->setPage(new QWebEnginePage(profile, webView));
+    webView->settings()->setAttribute(QWebEngineSettings::LocalContentCanAccessRemoteUrls, true);
+
     // Konfiguracja mostu Qt-JavaScript
-    bridge = new Bridge(this);
     channel = new QWebChannel(this);
     channel->registerObject(QStringLiteral("bridge"), bridge);
     webView->page()->setWebChannel(channel);
 
-    // Połączenie sygnału kliknięcia markera
-    connect(bridge, &Bridge::markerClicked, this, &AirQualityMonitor::onMarkerClicked);
+    StartupTrace::mark("widok mapy utworzony");
 }
 
 /**
@@ -1341,243 +1486,80 @@ void AirQualityMonitor::setupWebView()
 void AirQualityMonitor::connectSignalsAndSlots()
 {
     // Główna nawigacja
-    connect(ui.searchBox, &QLineEdit::textChanged, this, &AirQualityMonitor::filterStations);
-    connect(ui.stationListWidget, &QListWidget::itemClicked, this, &AirQualityMonitor::showStationDetails);
-    connect(ui.stationDetailWidget, &QListWidget::itemClicked, this, &AirQualityMonitor::showSensorDetails);
+    connect(ui.searchBox, &QLineEdit::textChanged, searchTimer, qOverload<>(&QTimer::start));
+    connect(ui.stationListWidget, &QListView::clicked, this, &AirQualityMonitor::showStationDetails);
+    connect(ui.stationDetailWidget, &QListView::clicked, this, &AirQualityMonitor::showSensorDetails);
     connect(ui.backButton, &QPushButton::clicked, this, &AirQualityMonitor::showStationListView);
 
     // Wybór zakresu dat
-    connect(ui.startDateEdit, &QDateTimeEdit::dateTimeChanged, this, &AirQualityMonitor::updateMeasurementDisplay);
-    connect(ui.endDateEdit, &QDateTimeEdit::dateTimeChanged, this, &AirQualityMonitor::updateMeasurementDisplay);
+    connect(ui.startDateEdit, &QDateTimeEdit::dateTimeChanged, displayTimer, qOverload<>(&QTimer::start));
+    connect(ui.endDateEdit, &QDateTimeEdit::dateTimeChanged, displayTimer, qOverload<>(&QTimer::start));
 
     // Nawigacja mapy
     connect(ui.showMapButton, &QPushButton::clicked, this, [this]() {
-        loadMap();
-        ui.confirmButton->setCurrentIndex(3);
+        ui.confirmButton->setCurrentIndex(kMapPageIndex);
         });
     connect(ui.backToListButton, &QPushButton::clicked, this, [this]() {
         ui.confirmButton->setCurrentIndex(0);
         });
     connect(ui.searchNearbyButton, &QPushButton::clicked, this, &AirQualityMonitor::onSearchNearbyClicked);
     connect(ui.showAllStationsButton, &QPushButton::clicked, this, &AirQualityMonitor::showAllStationsOnMap);
+    connect(ui.pollutantComboBox, &QComboBox::currentTextChanged, this, &AirQualityMonitor::publishViewportMarkers);
+    connect(ui.pollutantComboBox, &QComboBox::currentTextChanged, this, &AirQualityMonitor::publishRouteExposure);
+    connect(ui.importRouteButton, &QPushButton::clicked, this, &AirQualityMonitor::importRouteFromGpx);
 
     // Przyciski pobierania danych
     connect(ui.downloadStationDetail, &QPushButton::clicked, this, &AirQualityMonitor::downloadSensorData);
+    connect(ui.correlationButton, &QPushButton::clicked, this, &AirQualityMonitor::showStationCorrelations);
     connect(ui.downloadMeasurementButton, &QPushButton::clicked, this, &AirQualityMonitor::downloadMeasurementData);
 }
 
 /**
  * @brief Obsługuje zakończenie pobierania danych pomiarowych dla sensora.
+ * @param values Pobrane pomiary.
+ * @param error Opis błędu (pusty, gdy pobrano dane).
  */
-void AirQualityMonitor::onMeasurementDataFinished()
+void AirQualityMonitor::onMeasurementDataFinished(const QJsonArray& values, const QString& error)
 {
-    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
-    if (!reply) return;
-
-    if (reply->error() != QNetworkReply::NoError) {
-        qDebug() << "Błąd sieci:" << reply->errorString();
-        reply->deleteLater();
+    if (!error.isEmpty()) {
+        qDebug() << "Błąd sieci:" << error;
         return;
     }
 
-    QByteArray data = reply->readAll();
-    QJsonDocument doc = QJsonDocument::fromJson(data);
-
-    if (doc.isObject()) {
-        QJsonArray values = doc.object().value("values").toArray();
-        displayMeasurementData(values);
-    }
-
-    reply->deleteLater();
+    displayMeasurementData(values);
 }
 
 /**
  * @brief Obsługuje zakończenie pobierania danych sensorów dla stacji.
+ * @param stationId ID stacji.
+ * @param sensors Sensory stacji.
+ * @param error Opis błędu (pusty, gdy pobrano dane).
  */
-void AirQualityMonitor::onSensorsFinished()
+void AirQualityMonitor::onSensorsFinished(int stationId, const QJsonArray& sensors, const QString& error)
 {
-    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
-    if (!reply) return;
-
-    if (reply->error() != QNetworkReply::NoError) {
-        qDebug() << "Błąd sieci:" << reply->errorString();
+    if (!error.isEmpty()) {
+        qDebug() << "Błąd sieci:" << error;
 
         // Spróbuj załadować z pliku, jeśli dostępny
-        onSensorsLoadedFromFile(currentStationId);
-
-        reply->deleteLater();
+        onSensorsLoadedFromFile(stationId);
         return;
     }
 
-    QByteArray data = reply->readAll();
-    QJsonDocument doc = QJsonDocument::fromJson(data);
-
-    if (doc.isArray()) {
-        QJsonArray sensorsData = doc.array();
-        updateSensorsList(sensorsData);
-    }
-
-    reply->deleteLater();
+    updateSensorsList(sensors);
 }
 
 /**
  * @brief Ładuje dane pomiarowe dla określonego sensora.
  * @param sensorId ID sensora, dla którego ładowane są pomiary.
+ *
+ * Wybór kolejnego sensora anuluje poprzednie żądanie, więc wykres nie
+ * pokaże spóźnionej odpowiedzi dla innego sensora.
  */
-void AirQualityMonitor::loadMeasurementData(int sensorId)
-{
-    QUrl url(QString("https://api.gios.gov.pl/pjp-api/rest/data/getData/%1").arg(sensorId));
-    QNetworkRequest request(url);
-    QNetworkReply* reply = networkManager->get(request);
-    connect(reply, &QNetworkReply::finished, this, &AirQualityMonitor::onMeasurementDataFinished);
-}
-
-/**
- * @brief Ładuje dane pomiarowe dla określonego sensora.
- * @param sensorId ID sensora, dla którego ładowane są dane.
- */
-void AirQualityMonitor::loadSensorMeasurements(int sensorId)
-{
-    QString filePath = QString("measurements_%1.json").arg(sensorId);
-    QFile file(filePath);
-
-    if (file.exists() && file.open(QIODevice::ReadOnly)) {
-        QByteArray fileData = file.readAll();
-        file.close();
-
-        QJsonDocument doc = QJsonDocument::fromJson(fileData);
-        if (doc.isObject() && doc.object().contains("values")) {
-            QJsonArray values = doc.object().value("values").toArray();
-            qDebug() << "Wczytano dane z pliku dla sensora" << sensorId;
-            updateMeasurementsList(values);
-            return;
-        }
-    }
-
-    // Jeżeli pliku brak lub nie da się sparsować – wyślij żądanie HTTP
-    qDebug() << "Plik nie istnieje lub nieczytelny, pobieranie z serwera...";
-    QUrl url(QString("https://api.gios.gov.pl/pjp-api/rest/data/getData/%1").arg(sensorId));
-    QNetworkRequest request(url);
-    QNetworkReply* reply = networkManager->get(request);
-    reply->setProperty("sensorId", sensorId);
-    connect(reply, &QNetworkReply::finished, this, &AirQualityMonitor::onMeasurementsDownloaded);
-}
-
-/**
- * @brief Zapisuje dane pomiarowe do pliku JSON.
- * @param allMeasurements Tablica JSON z danymi pomiarowymi.
- */
-void AirQualityMonitor::saveMeasurementsToFile(const QJsonArray& allMeasurements)
-{
-    try {
-        QFile file(QDir::currentPath() + "/measurements.json");
-        if (!file.open(QIODevice::WriteOnly))
-            throw std::runtime_error(file.errorString().toStdString());
-
-        file.write(QJsonDocument(allMeasurements).toJson());
-        file.close();
-        qDebug() << "Dane zapisane do pliku measurements.json";
-    }
-    catch (const std::exception& e) {
-        qDebug() << "Błąd zapisu do pliku measurements.json: " << e.what();
-        QMessageBox::warning(this, "Błąd zapisu",
-            QString("Nie udało się zapisać danych: %1").arg(e.what()),
-            QMessageBox::Ok);
-    }
-}
-
-/**
- * @brief Ładuje dane pomiarowe z pliku JSON.
- * @return Tablica JSON z danymi pomiarowymi.
- */
-QJsonArray AirQualityMonitor::loadMeasurementsFromFile()
-{
-    try {
-        QFile file(QDir::currentPath() + "/measurements.json");
-
-        if (!file.exists())
-            throw std::runtime_error("Plik measurements.json nie istnieje.");
-
-        if (!file.open(QIODevice::ReadOnly))
-            throw std::runtime_error(QString("Nie można otworzyć pliku measurements.json: %1").arg(file.errorString()).toStdString());
-
-        QByteArray data = file.readAll();
-        file.close();
-
-        QJsonParseError parseError;
-        QJsonDocument doc = QJsonDocument::fromJson(data, &parseError);
-
-        if (parseError.error != QJsonParseError::NoError)
-            throw std::runtime_error(QString("Błąd parsowania JSON: %1").arg(parseError.errorString()).toStdString());
-
-        if (!doc.isArray())
-            throw std::runtime_error("Plik JSON nie zawiera tablicy jako głównego elementu.");
-
-        return doc.array();
-    }
-    catch (const std::exception& e) {
-        qDebug() << e.what();
-        return QJsonArray();
-    }
-}
-
-/**
- * @brief Ładuje dane sensorów z pliku JSON.
- * @return Tablica JSON z danymi sensorów.
- */
-QJsonArray AirQualityMonitor::loadSensorsFromFile()
-{
-    QFile file(QDir::currentPath() + "/sensors.json");
-    if (!file.open(QIODevice::ReadOnly)) {
-        qDebug() << "Nie można otworzyć pliku sensors.json: " << file.errorString();
-        return QJsonArray();
-    }
-
-    QByteArray data = file.readAll();
-    file.close();
-
-    QJsonParseError parseError;
-    QJsonDocument doc = QJsonDocument::fromJson(data, &parseError);
-
-    if (parseError.error != QJsonParseError::NoError) {
-        qDebug() << "Błąd parsowania JSON:" << parseError.errorString();
-        return QJsonArray();
-    }
-
-    if (!doc.isArray()) {
-        qDebug() << "Dokument JSON nie zawiera tablicy";
-        return QJsonArray();
-    }
-
-    return doc.array();
-}
-
-/**
- * @brief Tworzy kopię zapasową pliku JSON.
- * @param filename Nazwa pliku do wykonania kopii.
- */
-void AirQualityMonitor::backupJsonData(const QString& filename)
+Async::Task<void> AirQualityMonitor::loadMeasurementData(int sensorId)
 {
-    QFile file(QDir::currentPath() + "/" + filename);
-    if (!file.exists()) {
-        return; // Nic do backupu
-    }
-
-    // Utwórz katalog backupu jeśli nie istnieje
-    QDir dir(QDir::currentPath() + "/backups");
-    if (!dir.exists()) {
-        dir.mkpath(".");
-    }
-
-    // Utwórz nazwę pliku backupu z timestampem
-    QString timestamp = QDateTime::currentDateTime().toString("yyyyMMdd_HHmmss");
-    QString backupFilename = QString("backups/%1_%2").arg(timestamp).arg(filename);
-
-    // Kopiuj plik
-    if (file.copy(QDir::currentPath() + "/" + backupFilename)) {
-        qDebug() << "Backup utworzony:" << backupFilename;
-    }
-    else {
-        qDebug() << "Nie udało się utworzyć backupu pliku" << filename;
-    }
+    const QPointer<AirQualityMonitor> self(this);
+    const ApiResult result = co_await gios->measurements(sensorId, 0, restartMeasurementFetch());
+    if (!self || result.cancelled)
+        co_return;
+    onMeasurementDataFinished(result.data, result.error);
 }
\ No newline at end of file
@@ -14,13 +14,34 @@
 #include <QtWidgets/QMainWindow>
 #include "ui_AirQualityMonitor.h"
 #include "Bridge.h"
+#include "AirQualityIndex.h"
+#include "GapAnalysis.h"
+#include "Downsampling.h"
+#include "DataRepository.h"
+#include "MeasurementIngest.h"
+#include "Task.h"
+#include "StationSearch.h"
+#include "StationGrid.h"
+#include "StationKdTree.h"
 #include <QNetworkAccessManager>
 #include <QJsonArray>
+#include <QHostAddress>
 #include <QMap>
 #include <QUrlQuery>
 #include <QWebEngineView>
 #include <QWebChannel>
 
+class ChartController;
+class GiosClient;
+class LocalApiServer;
+class MeasurementPublisher;
+class MeasurementListModel;
+class SensorListModel;
+class StationListModel;
+class TileCache;
+class TilePrefetcher;
+class QTimer;
+
  /**
   * @class AirQualityMonitor
   * @brief Klasa głównego okna aplikacji monitorującej jakość powietrza.
@@ -45,17 +66,63 @@ public:
     ~AirQualityMonitor();
 
     /**
-     * @brief Sprawdza czy połączenie z internetem jest dostępne.
-     * @return True jeśli internet jest dostępny, false w przeciwnym razie.
+     * @brief Uruchamia lokalny serwer HTTP z zapisanymi danymi.
+     * @param port Port nasłuchiwania.
+     * @param address Adres nasłuchiwania (domyślnie tylko ten komputer).
+     * @return False, jeśli nie udało się otworzyć portu.
+     */
+    bool startLocalApi(quint16 port, const QHostAddress& address = QHostAddress::LocalHost);
+
+    /**
+     * @brief Uruchamia serwer WebSocket powiadamiający o nowych pomiarach.
+     * @param port Port nasłuchiwania.
+     * @param address Adres nasłuchiwania (domyślnie tylko ten komputer).
+     * @return False, jeśli nie udało się otworzyć portu.
+     */
+    bool startPublisher(quint16 port, const QHostAddress& address = QHostAddress::LocalHost);
+
+    /**
+     * @brief Ustawia serwer kafelków mapy.
+     * @param urlTemplate Adres kafelka z polami {z}, {x} i {y}.
+     */
+    void setTileServer(const QString& urlTemplate);
+
+    /**
+     * @brief Włącza pobieranie kafelków Polski z wyprzedzeniem po pierwszym pokazaniu mapy.
+     * @param minZoom Najmniejszy poziom przybliżenia.
+     * @param maxZoom Największy poziom przybliżenia.
+     */
+    void enableTilePrefetch(int minZoom, int maxZoom);
+
+protected:
+    /**
+     * @brief Po pierwszym narysowaniu okna planuje wczytanie mapy w tle.
+     */
+    bool event(QEvent* event) override;
+
+    /**
+     * @brief Zapisuje migawkę stanu przy zamykaniu okna.
      */
-    bool isInternetAvailable();
+    void closeEvent(QCloseEvent* event) override;
 
 public slots:
     /**
-     * @brief Obsługuje kliknięcie w marker na mapie.
-     * @param stationName Nazwa stacji, która została kliknięta.
+     * @brief Wyświetla szczegóły stacji o podanym ID (np. po kliknięciu znacznika na mapie).
+     * @param stationId ID stacji.
+     */
+    void showStationDetailsById(int stationId);
+
+    /**
+     * @brief Obsługuje zmianę widocznego obszaru mapy.
+     * @param viewport Obszar i poziom przybliżenia zgłoszone przez mapę.
      */
-    void onMarkerClicked(const QString& stationName);
+    void onViewportChanged(const MapViewport& viewport);
+
+    /**
+     * @brief Obsługuje trasę narysowaną na mapie.
+     * @param route Punkty trasy (pusta lista czyści trasę).
+     */
+    void onRouteDrawn(const QVector<GeoPoint>& route);
 
     /**
      * @brief Pobiera i zapisuje dane sensorów dla aktualnie wybranej stacji.
@@ -87,36 +154,37 @@ private slots:
 
     /**
      * @brief Wyświetla szczegóły wybranej stacji.
-     * @param item Wybrany element listy stacji.
+     * @param index Indeks wybranego wiersza listy stacji.
      */
-    void showStationDetails(QListWidgetItem* item);
+    void showStationDetails(const QModelIndex& index);
 
     /**
      * @brief Wyświetla szczegóły wybranego sensora.
-     * @param item Wybrany element listy sensorów.
+     * @param index Indeks wybranego wiersza listy sensorów.
      */
-    void showSensorDetails(QListWidgetItem* item);
+    void showSensorDetails(const QModelIndex& index);
 
     /**
      * @brief Obsługuje zakończenie pobierania danych stacji.
-     *
-     * Przetwarza dane stacji po zakończeniu żądania sieciowego.
+     * @param stations Pobrane stacje.
+     * @param error Opis błędu (pusty, gdy pobrano dane).
      */
-    void onStationsFinished();
+    void onStationsFinished(const QJsonArray& stations, const QString& error);
 
     /**
      * @brief Obsługuje zakończenie pobierania danych sensorów.
-     *
-     * Przetwarza dane sensorów po zakończeniu żądania sieciowego.
+     * @param stationId ID stacji.
+     * @param sensors Sensory stacji.
+     * @param error Opis błędu (pusty, gdy pobrano dane).
      */
-    void onSensorsFinished();
+    void onSensorsFinished(int stationId, const QJsonArray& sensors, const QString& error);
 
     /**
      * @brief Obsługuje zakończenie pobierania danych pomiarowych.
-     *
-     * Przetwarza dane pomiarowe po zakończeniu żądania sieciowego.
+     * @param values Pobrane pomiary.
+     * @param error Opis błędu (pusty, gdy pobrano dane).
      */
-    void onMeasurementDataFinished();
+    void onMeasurementDataFinished(const QJsonArray& values, const QString& error);
 
     /**
      * @brief Aktualizuje wyświetlanie wykresu i statystyk pomiarów.
@@ -128,7 +196,9 @@ private slots:
     /**
      * @brief Ładuje interfejs mapy.
      *
-     * Tworzy i inicjalizuje interfejs OpenStreetMap.
+     * Tworzy widok webowy, jeśli jeszcze nie istnieje, i wczytuje stronę
+     * OpenStreetMap. Wywoływana w tle po pierwszym narysowaniu okna lub
+     * przy pierwszym wejściu na stronę mapy.
      */
     void loadMap();
 
@@ -139,27 +209,32 @@ private slots:
      */
     void onSearchNearbyClicked();
 
+    /**
+     * @brief Wczytuje trasy z pliku GPX i pokazuje narażenie na każdej z nich.
+     */
+    void importRouteFromGpx();
+
     
 
     /**
      * @brief Obsługuje zakończenie pobierania danych sensorów.
+     * @param stationId ID stacji.
+     * @param sensors Sensory stacji.
+     * @param error Opis błędu (pusty, gdy pobrano dane).
      *
-     * Przetwarza dane sensorów po zakończeniu żądania sieciowego i zapisuje je.
+     * Zapisuje sensory stacji w repozytorium i aktualizuje listę.
      */
-    void onSensorsDownloaded();
+    void onSensorsDownloaded(int stationId, const QJsonArray& sensors, const QString& error);
 
     /**
      * @brief Obsługuje zakończenie pobierania danych pomiarowych.
+     * @param sensorId ID sensora.
+     * @param values Pobrane pomiary.
+     * @param error Opis błędu (pusty, gdy pobrano dane).
      *
-     * Przetwarza dane pomiarowe po zakończeniu żądania sieciowego i zapisuje je.
+     * Scala pomiary z historią w repozytorium i aktualizuje widok.
      */
-    void onMeasurementsDownloaded();
-
-    /**
-     * @brief Ładuje dane sensorów z pliku lokalnego dla stacji.
-     * @param stationId ID stacji, dla której ładowane są sensory.
-     */
-    void onSensorsLoadedFromFile(int stationId);
+    void onMeasurementsDownloaded(int sensorId, const QJsonArray& values, const QString& error);
 
     /**
      * @brief Aktualizuje interfejs użytkownika danymi sensorów dla stacji.
@@ -168,23 +243,11 @@ private slots:
     void updateSensorsList(const QJsonArray& sensorsData);
 
     /**
-     * @brief Aktualizuje lokalny plik sensorów nowymi danymi.
-     * @param newSensors Tablica JSON z nowymi danymi sensorów.
-     */
-    void updateSensorsFile(const QJsonArray& newSensors);
-
-    /**
-     * @brief Aktualizuje interfejs użytkownika danymi pomiarowymi.
-     * @param measurementData Tablica JSON z danymi pomiarowymi.
-     */
-    void updateMeasurementsList(const QJsonArray& measurementData);
-
-    /**
-     * @brief Aktualizuje lokalny plik pomiarów nowymi danymi.
-     * @param sensorId ID sensora, który jest aktualizowany.
-     * @param newValues Tablica JSON z nowymi wartościami pomiarów.
+     * @brief Wyświetla macierz korelacji zanieczyszczeń dla aktualnej stacji.
+     *
+     * Obliczenia wykonywane są w tle; wynik pokazywany jest w oknie dialogowym.
      */
-    void updateMeasurementsFile(int sensorId, const QJsonArray& newValues);
+    void showStationCorrelations();
 
 private:
     // ===== FUNKCJE INICJALIZACYJNE I PODSTAWOWE =====
@@ -199,7 +262,8 @@ private:
     /**
      * @brief Konfiguruje widok webowy dla mapy.
      *
-     * Inicjalizuje komponent QWebEngineView i most komunikacyjny z JavaScript.
+     * Tworzy komponent QWebEngineView z profilem i kanałem do mostu
+     * JavaScript. Kolejne wywołania nic nie robią.
      */
     void setupWebView();
 
@@ -220,30 +284,33 @@ private:
     void loadStationsFromApi();
 
     /**
-     * @brief Zapisuje dane stacji do lokalnego pliku JSON.
-     * @param stations Tablica JSON z danymi stacji do zapisania.
+     * @brief Ustawia listę stacji i buduje jej indeksy.
+     * @param stations Rekordy stacji.
      */
-    void saveStationsToFile(const QJsonArray& stations);
+    void setStations(const QVector<StationRecord>& stations);
 
     /**
-     * @brief Ładuje dane stacji z lokalnego pliku JSON.
-     * @return Tablica JSON z danymi stacji.
+     * @brief Ustawia listę sensorów wybranej stacji.
+     * @param sensors Sensory stacji.
      */
-    QJsonArray loadStationsFromFile();
+    void setSensors(const QVector<SensorRecord>& sensors);
 
-    // ===== FUNKCJE ZARZĄDZANIA SENSORAMI =====
+    /**
+     * @brief Odtwarza stan poprzedniej sesji z migawki.
+     * @return False, gdy brak aktualnej migawki.
+     */
+    bool restoreSnapshot();
 
     /**
-     * @brief Zapisuje dane sensorów do lokalnego pliku JSON.
-     * @param sensors Tablica JSON z danymi sensorów do zapisania.
+     * @brief Zapisuje migawkę stanu do odtworzenia przy następnym uruchomieniu.
      */
-    void saveSensorsToFile(const QJsonArray& sensors);
+    void saveSnapshot();
 
     /**
-     * @brief Ładuje dane sensorów z lokalnego pliku JSON.
-     * @return Tablica JSON z danymi sensorów.
+     * @brief Ładuje dane sensorów z pliku lokalnego dla stacji.
+     * @param stationId ID stacji, dla której ładowane są sensory.
      */
-    QJsonArray loadSensorsFromFile();
+    Async::Task<void> onSensorsLoadedFromFile(int stationId);
 
     // ===== FUNKCJE ZARZĄDZANIA POMIARAMI =====
 
@@ -251,13 +318,7 @@ private:
      * @brief Ładuje dane pomiarowe dla określonego sensora.
      * @param sensorId ID sensora, dla którego ładowane są dane.
      */
-    void loadMeasurementData(int sensorId);
-
-    /**
-     * @brief Ładuje dane pomiarowe dla konkretnego sensora.
-     * @param sensorId ID sensora, dla którego ładowane są dane.
-     */
-    void loadSensorMeasurements(int sensorId);
+    Async::Task<void> loadMeasurementData(int sensorId);
 
     /**
      * @brief Wyświetla dane pomiarowe w interfejsie użytkownika.
@@ -266,63 +327,68 @@ private:
     void displayMeasurementData(const QJsonArray& values);
 
     /**
-     * @brief Zapisuje dane pomiarowe do lokalnego pliku JSON.
-     * @param allMeasurements Tablica JSON ze wszystkimi danymi pomiarowymi.
+     * @brief Ładuje dane pomiarowe dla sensora z pliku lokalnego.
+     * @param sensorId ID sensora, dla którego ładowane są dane.
      */
-    void saveMeasurementsToFile(const QJsonArray& allMeasurements);
+    Async::Task<void> onMeasurementsLoadedFromFile(int sensorId);
 
     /**
-     * @brief Ładuje dane pomiarowe z lokalnego pliku JSON.
-     * @return Tablica JSON z danymi pomiarowymi.
+     * @brief Pobiera najnowsze pomiary sensora lub pokazuje dane lokalne bez połączenia.
+     * @param sensorId ID sensora.
      */
-    QJsonArray loadMeasurementsFromFile();
+    Async::Task<void> refreshMeasurements(int sensorId);
 
     /**
-     * @brief Ładuje dane pomiarowe dla sensora z pliku lokalnego.
-     * @param sensorId ID sensora, dla którego ładowane są dane.
+     * @brief Pobiera pomiary sensora z API i scala je z historią.
+     * @param sensorId ID sensora.
+     * @param timeoutMs Limit czasu odpowiedzi serwera (0 - bez limitu).
      */
-    void onMeasurementsLoadedFromFile(int sensorId);
-
-    // ===== FUNKCJE KOPII ZAPASOWYCH I BEZPIECZEŃSTWA =====
+    Async::Task<void> downloadMeasurements(int sensorId, int timeoutMs);
 
     /**
-     * @brief Tworzy kopię zapasową pliku JSON.
-     * @param filename Nazwa pliku do wykonania kopii.
+     * @brief Anuluje trwające pobieranie pomiarów i zwraca token dla nowego.
      */
-    void backupJsonData(const QString& filename);
+    Async::CancellationToken restartMeasurementFetch();
 
     // ===== FUNKCJE GEOLOKALIZACJI I MAPY =====
 
     /**
-     * @brief Konwertuje adres na współrzędne geograficzne.
-     * @param address Adres do geokodowania.
+     * @brief Konwertuje kolejne adresy na współrzędne geograficzne.
+     * @param addresses Adresy pozostałe do geokodowania.
+     * @param found Współrzędne adresów już znalezionych.
      * @param radiusKm Promień wyszukiwania w kilometrach.
      */
-    void geocodeAddress(const QString& address, double radiusKm);
+    void geocodeAddresses(QStringList addresses, QVector<GeoPoint> found, double radiusKm);
 
     /**
-     * @brief Znajduje stacje w promieniu od współrzędnych.
-     * @param centerLat Szerokość geograficzna środka.
-     * @param centerLon Długość geograficzna środka.
+     * @brief Znajduje stacje w promieniu od dowolnego z punktów.
+     * @param centers Środki obszarów wyszukiwania.
      * @param radiusKm Promień w kilometrach.
      */
-    void findStationsInRadius(double centerLat, double centerLon, double radiusKm);
+    void findStationsInRadius(const QVector<GeoPoint>& centers, double radiusKm);
+
+    /**
+     * @brief Pokazuje na mapie stacje znalezione w promieniu.
+     * @param centers Środki obszarów wyszukiwania.
+     * @param results Stacje w promieniu od kolejnych środków.
+     */
+    void showStationsInRadius(const QVector<GeoPoint>& centers, const QVector<QVector<StationDistance>>& results);
 
     /**
      * @brief Aktualizuje mapę znacznikami stacji.
-     * @param stations Wektor danych stacji do wyświetlenia.
+     * @param stations Stacje do wyświetlenia.
+     */
+    void updateMapWithStations(const QVector<StationRecord>& stations);
+
+    /**
+     * @brief Wysyła mapie znaczniki lub grupy stacji z widocznego obszaru.
      */
-    void updateMapWithStations(const QVector<QJsonObject>& stations);
+    void publishViewportMarkers();
 
     /**
-     * @brief Oblicza odległość między dwoma punktami geograficznymi.
-     * @param lat1 Szerokość geograficzna pierwszego punktu.
-     * @param lon1 Długość geograficzna pierwszego punktu.
-     * @param lat2 Szerokość geograficzna drugiego punktu.
-     * @param lon2 Długość geograficzna drugiego punktu.
-     * @return Odległość w kilometrach.
+     * @brief Liczy narażenie na trasach mapy i przekazuje je mapie.
      */
-    double haversineDistance(double lat1, double lon1, double lat2, double lon2);
+    void publishRouteExposure();
 
     /**
      * @brief Pokazuje wszystkie stacje na mapie.
@@ -332,14 +398,40 @@ private:
 private:
     Ui::AirQualityMonitorClass ui;              ///< Komponenty interfejsu użytkownika
     QNetworkAccessManager* networkManager;      ///< Manager żądań sieciowych
-    QJsonArray cachedStations;                  ///< Lokalnie buforowane dane stacji
+    GiosClient* gios;                           ///< Klient API GIOŚ
+    DataRepository repository;                  ///< Pliki stacji, sensorów i pomiarów
+    MeasurementIngest ingest;                   ///< Scalanie pomiarów, agregaty, indeks stacji i prognozy
+    LocalApiServer* localApi;                   ///< Lokalny serwer HTTP (nullptr, gdy wyłączony)
+    MeasurementPublisher* publisher;            ///< Powiadomienia WebSocket (nullptr, gdy wyłączone)
     int currentStationId;                       ///< ID aktualnie wybranej stacji
     int currentSensorId;                        ///< ID aktualnie wybranego sensora
+    Async::CancellationSource measurementFetch; ///< Anulowanie trwającego pobierania pomiarów
     QMap<QString, int> sensorMap;               ///< Mapuje nazwy wyświetlane sensorów na ID
-    QJsonArray lastMeasurements;                ///< Ostatnio pobrane pomiary
+    MeasurementSeries lastSeries;               ///< Ostatnie pomiary na siatce godzinowej (z uzupełnieniami)
+    QVector<DownsamplePyramid> segmentPyramids; ///< Piramidy punktów ciągłych fragmentów serii
+    ChartController* chartController;           ///< Trwały wykres pomiarów
+    QTimer* displayTimer;                       ///< Opóźnione odświeżenie wykresu po zmianie dat
+    StationListModel* stationModel;             ///< Model listy stacji
+    StationFilterProxyModel* stationProxy;      ///< Filtr listy stacji według wyniku wyszukiwania
+    StationSearchIndex stationSearch;           ///< Indeks wyszukiwania stacji
+    StationKdTree stationTree;                  ///< Drzewo k-d stacji do wyszukiwania w promieniu
+    QTimer* searchTimer;                        ///< Opóźnione wyszukiwanie po wpisaniu tekstu
+    SensorListModel* sensorModel;               ///< Model listy sensorów wybranej stacji
+    MeasurementListModel* measurementModel;     ///< Model listy pomiarów
     QWebChannel* channel;                       ///< Kanał webowy do komunikacji z mapą
     QWebEngineView* webView;                    ///< Widok webowy do wyświetlania mapy
     Bridge* bridge;                             ///< Most między JS a Qt
+    bool mapLoaded;                             ///< Czy strona mapy została już wczytana
+    bool firstPaintDone;                        ///< Czy okno zostało już narysowane
+    TileCache* tileCache;                       ///< Lokalna baza kafelków mapy
+    TilePrefetcher* tilePrefetcher;             ///< Pobieranie kafelków Polski z wyprzedzeniem
+    int tilePrefetchMinZoom;                    ///< Najmniejszy poziom pobierany z wyprzedzeniem
+    int tilePrefetchMaxZoom;                    ///< Największy poziom pobierany z wyprzedzeniem (-1 - wyłączone)
+    StationGridIndex mapIndex;                  ///< Indeks stacji pokazywanych na mapie
+    MapViewport mapViewport;                    ///< Ostatnio zgłoszony widok mapy
+    QVector<QVector<GeoPoint>> mapRoutes;       ///< Trasy pokazywane na mapie
+    int radiusSearchRequest;                    ///< Numer ostatniego wyszukiwania w promieniu
+    int routeExposureRequest;                   ///< Numer ostatniego liczenia narażenia na trasach
 
     // Komponenty UI
     QLineEdit* addressSearchBox;                ///< Pole wprowadzania adresu do wyszukiwania
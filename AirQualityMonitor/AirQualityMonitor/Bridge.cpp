@@ -0,0 +1,87 @@
+﻿// Bridge.cpp
+#include "Bridge.h"
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <cmath>
+
+namespace
+{
+    QJsonValue readingValue(const StationReading& reading)
+    {
+        return std::isnan(reading.value) ? QJsonValue(QJsonValue::Null) : QJsonValue(reading.value);
+    }
+}
+
+void Bridge::setMarkers(const QVector<StationRecord>& stations, const QVector<StationCluster>& clusters,
+    const QString& pollutant, const QHash<int, StationReading>& readings)
+{
+    QJsonArray markerRows;
+    for (const StationRecord& station : stations) {
+        const StationReading reading = readings.value(station.id);
+        markerRows.append(QJsonArray{ station.id, station.lat, station.lon, station.name,
+            reading.level, readingValue(reading) });
+    }
+
+    QJsonArray clusterRows;
+    for (const StationCluster& cluster : clusters)
+        clusterRows.append(QJsonArray{ cluster.lat, cluster.lon, cluster.count, cluster.level });
+
+    QJsonObject payload;
+    payload.insert("pollutant", pollutant);
+    payload.insert("markers", markerRows);
+    payload.insert("clusters", clusterRows);
+
+    markerPayload = QString::fromUtf8(QJsonDocument(payload).toJson(QJsonDocument::Compact));
+    emit markersChanged(markerPayload);
+}
+
+void Bridge::updateMarkers(const QVector<StationReadingChange>& changes)
+{
+    if (changes.isEmpty())
+        return;
+
+    QJsonArray rows;
+    for (const StationReadingChange& change : changes)
+        rows.append(QJsonArray{ change.stationId, change.reading.level, readingValue(change.reading) });
+
+    emit markersUpdated(QString::fromUtf8(QJsonDocument(rows).toJson(QJsonDocument::Compact)));
+}
+
+void Bridge::setRoutes(const QVector<QVector<GeoPoint>>& routes, const QVector<RouteExposureResult>& results,
+    const QString& pollutant)
+{
+    QJsonArray rows;
+    for (int i = 0; i < routes.size() && i < results.size(); ++i) {
+        QJsonArray points;
+        for (const GeoPoint& point : routes[i])
+            points.append(QJsonArray{ point.lat, point.lon });
+
+        const RouteExposureResult& result = results[i];
+        QJsonObject row;
+        row.insert("points", points);
+        row.insert("km", result.lengthKm);
+        row.insert("minutes", result.hours * 60.0);
+        row.insert("mean", result.meanConcentration);
+        row.insert("peak", result.peakConcentration);
+        row.insert("dose", result.dose);
+        row.insert("coveredKm", result.coveredKm);
+        rows.append(row);
+    }
+
+    QJsonObject payload;
+    payload.insert("pollutant", pollutant);
+    payload.insert("routes", rows);
+    emit routesChanged(QString::fromUtf8(QJsonDocument(payload).toJson(QJsonDocument::Compact)));
+}
+
+void Bridge::onRouteDrawn(const QString& points)
+{
+    QVector<GeoPoint> route;
+    for (const QJsonValue& value : QJsonDocument::fromJson(points.toUtf8()).array()) {
+        const QJsonArray point = value.toArray();
+        if (point.size() >= 2)
+            route.append({ point[0].toDouble(), point[1].toDouble() });
+    }
+    emit routeDrawn(route);
+}
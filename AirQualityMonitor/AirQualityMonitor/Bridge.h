@@ -1,19 +1,75 @@
-// Bridge.h
+﻿// Bridge.h
 #pragma once
 
+#include "AirQualityIndex.h"
+#include "Records.h"
+#include "RouteExposure.h"
+#include "StationGrid.h"
 #include <QObject>
+#include <QVector>
 
 class Bridge : public QObject
 {
     Q_OBJECT
+    /// Znaczniki widocznego obszaru: {"pollutant": kod, "markers": [[id, lat, lon, nazwa, klasa, wartość], ...],
+    /// "clusters": [[lat, lon, liczba, najgorsza klasa], ...]}
+    Q_PROPERTY(QString markers READ markers NOTIFY markersChanged)
 public:
     explicit Bridge(QObject* parent = nullptr) : QObject(parent) {}
 
+    QString markers() const { return markerPayload; }
+
+    /**
+     * @brief Przekazuje mapie znaczniki widocznego obszaru w jednym komunikacie.
+     * @param stations Pojedyncze stacje.
+     * @param clusters Grupy stacji (przy małym przybliżeniu).
+     * @param pollutant Parametr, według którego kolorowane są znaczniki.
+     * @param readings Najnowsze pomiary parametru (ID stacji -> pomiar).
+     */
+    void setMarkers(const QVector<StationRecord>& stations, const QVector<StationCluster>& clusters,
+        const QString& pollutant, const QHash<int, StationReading>& readings);
+
+    /**
+     * @brief Przekazuje mapie tylko zmienione pomiary stacji.
+     *
+     * Mapa przekolorowuje istniejące znaczniki; stacje spoza widoku są pomijane.
+     */
+    void updateMarkers(const QVector<StationReadingChange>& changes);
+
+    /**
+     * @brief Przekazuje mapie trasy wraz z narażeniem na każdej z nich.
+     * @param routes Punkty tras.
+     * @param results Narażenie na trasach (w kolejności tras).
+     * @param pollutant Parametr, dla którego liczono narażenie.
+     */
+    void setRoutes(const QVector<QVector<GeoPoint>>& routes, const QVector<RouteExposureResult>& results,
+        const QString& pollutant);
+
 public slots:
-    void onMarkerClicked(const QString& stationName) {
-        emit markerClicked(stationName);
+    /// Wywoływane przez mapę po kliknięciu znacznika stacji
+    void onStationClicked(int stationId) {
+        emit stationClicked(stationId);
     }
 
+    /// Wywoływane przez mapę po każdym przesunięciu lub zmianie przybliżenia
+    void onViewportChanged(double south, double west, double north, double east, int zoom) {
+        emit viewportChanged(MapViewport{ south, west, north, east, zoom });
+    }
+
+    /// Wywoływane przez mapę po dodaniu punktu trasy: [[lat, lon], ...] (pusta tablica czyści trasę)
+    void onRouteDrawn(const QString& points);
+
 signals:
-    void markerClicked(const QString& stationName);
-};
\ No newline at end of file
+    void stationClicked(int stationId);
+    void markersChanged(const QString& payload);
+    /// Zmienione znaczniki: [[id, klasa, wartość], ...]
+    void markersUpdated(const QString& delta);
+    void viewportChanged(const MapViewport& viewport);
+    void routeDrawn(const QVector<GeoPoint>& route);
+    /// Trasy z narażeniem: {"pollutant": kod, "routes": [{"points": [[lat, lon], ...], "km", "minutes",
+    /// "mean", "peak", "dose", "coveredKm"}, ...]}
+    void routesChanged(const QString& payload);
+
+private:
+    QString markerPayload;      ///< Ostatnio wysłane znaczniki
+};
@@ -0,0 +1,152 @@
+﻿/**
+ * @file ChartController.cpp
+ * @brief Implementacja trwałego wykresu pomiarów.
+ */
+
+#include "ChartController.h"
+#include <QBoxLayout>
+#include <QDateTime>
+#include <QtCharts/QChartView>
+#include <QtCharts/QDateTimeAxis>
+#include <QtCharts/QLineSeries>
+#include <QtCharts/QScatterSeries>
+#include <QtCharts/QValueAxis>
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+    const QColor kSeriesColor("#00c3ff");   ///< Kolor linii pomiarów
+    const QColor kFilledColor("#888888");   ///< Kolor punktów uzupełnionych
+}
+
+ChartController::ChartController(QBoxLayout* layout, QObject* parent)
+    : QObject(parent),
+    chart(new QChart()),
+    axisX(new QDateTimeAxis),
+    axisY(new QValueAxis),
+    filledSeries(new QScatterSeries()),
+    forecastSeries(new QLineSeries())
+{
+    chart->legend()->hide();
+    chart->setTitle("Pomiary");
+
+    axisX->setFormat("dd-MM HH:mm");
+    axisX->setTitleText("Czas");
+    axisX->setLabelsAngle(-45);
+    chart->addAxis(axisX, Qt::AlignBottom);
+
+    axisY->setTitleText("Wartość");
+    chart->addAxis(axisY, Qt::AlignLeft);
+
+    // Punkty uzupełnione rysowane osobno, aby było widać ich pochodzenie
+    chart->addSeries(filledSeries);
+    filledSeries->attachAxis(axisX);
+    filledSeries->attachAxis(axisY);
+    filledSeries->setMarkerSize(6.0);
+    filledSeries->setColor(kFilledColor);
+    filledSeries->setBorderColor(kFilledColor);
+
+    chart->addSeries(forecastSeries);
+    forecastSeries->attachAxis(axisX);
+    forecastSeries->attachAxis(axisY);
+    QPen pen(kSeriesColor);
+    pen.setStyle(Qt::DashLine);
+    pen.setWidthF(1.5);
+    forecastSeries->setPen(pen);
+
+    chart->setBackgroundBrush(QBrush(QColor("#121212")));
+    chart->setTitleBrush(QBrush(Qt::white));
+    axisX->setLinePenColor(Qt::white);
+    axisX->setLabelsBrush(Qt::white);
+    axisY->setLinePenColor(Qt::white);
+    axisY->setLabelsBrush(Qt::white);
+    axisX->setGridLineColor(QColor("#555555"));
+    axisY->setGridLineColor(QColor("#555555"));
+
+    chartView = new QChartView(chart);
+    chartView->setRenderHint(QPainter::Antialiasing);
+    layout->addWidget(chartView);
+}
+
+QLineSeries* ChartController::segmentSeries(int index)
+{
+    while (segmentPool.size() <= index) {
+        QLineSeries* series = new QLineSeries();
+        chart->addSeries(series);
+        series->attachAxis(axisX);
+        series->attachAxis(axisY);
+        series->setColor(kSeriesColor);
+        segmentPool.append(series);
+    }
+    return segmentPool[index];
+}
+
+void ChartController::setData(const QVector<QVector<QPointF>>& segments,
+    const QVector<QPointF>& filled,
+    const QVector<QPointF>& forecast,
+    const QString& timeFormat)
+{
+    // Jedno odświeżenie widoku po podmianie wszystkich serii
+    chartView->setUpdatesEnabled(false);
+
+    double minX = std::numeric_limits<double>::max();
+    double maxX = std::numeric_limits<double>::lowest();
+    double minY = std::numeric_limits<double>::max();
+    double maxY = std::numeric_limits<double>::lowest();
+    auto extend = [&](const QVector<QPointF>& points) {
+        for (const QPointF& p : points) {
+            minX = std::min(minX, p.x());
+            maxX = std::max(maxX, p.x());
+            minY = std::min(minY, p.y());
+            maxY = std::max(maxY, p.y());
+        }
+    };
+
+    for (int i = 0; i < segments.size(); ++i) {
+        segmentSeries(i)->replace(segments[i]);
+        extend(segments[i]);
+    }
+    trimPool(segments.size());
+
+    filledSeries->replace(filled);
+    forecastSeries->replace(forecast);
+    extend(forecast);
+
+    axisX->setFormat(timeFormat);
+    if (minX <= maxX) {
+        axisX->setRange(QDateTime::fromMSecsSinceEpoch(qint64(minX)), QDateTime::fromMSecsSinceEpoch(qint64(maxX)));
+        axisY->setRange(minY, maxY);
+    }
+
+    chartView->setUpdatesEnabled(true);
+}
+
+void ChartController::trimPool(int used)
+{
+    // Seria z wieloma przerwami nie powinna zostawiać setek pustych serii,
+    // które wykres nadal przegląda przy każdym rysowaniu
+    while (segmentPool.size() > used + kSpareSegments) {
+        QLineSeries* series = segmentPool.takeLast();
+        chart->removeSeries(series);
+        delete series;
+    }
+
+    // Kilka nadmiarowych serii zostaje do ponownego użycia, ale bez punktów
+    for (int i = used; i < segmentPool.size(); ++i) {
+        if (segmentPool[i]->count() > 0)
+            segmentPool[i]->clear();
+    }
+}
+
+void ChartController::clear()
+{
+    trimPool(0);
+    filledSeries->clear();
+    forecastSeries->clear();
+}
+
+int ChartController::plotWidth() const
+{
+    return int(chart->plotArea().width());
+}
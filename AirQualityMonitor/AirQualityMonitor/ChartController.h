@@ -0,0 +1,83 @@
+﻿/**
+ * @file ChartController.h
+ * @brief Trwały wykres pomiarów aktualizowany w miejscu.
+ *
+ * Zamiast tworzyć przy każdej zmianie zakresu dat nowy QChart, serie i osie,
+ * kontroler utrzymuje jeden wykres i podmienia dane serii hurtowo przez
+ * QXYSeries::replace, a zakresy osi zmienia w miejscu.
+ *
+ * @author Jakub Frąckowiak
+ * @date Maj 2025
+ */
+
+#pragma once
+
+#include <QObject>
+#include <QList>
+#include <QPointF>
+#include <QVector>
+
+class QBoxLayout;
+class QChart;
+class QChartView;
+class QDateTimeAxis;
+class QLineSeries;
+class QScatterSeries;
+class QValueAxis;
+
+/**
+ * @class ChartController
+ * @brief Zarządza jednym wykresem pomiarów osadzonym w układzie okna.
+ */
+class ChartController : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Tworzy wykres i umieszcza go w podanym układzie.
+     * @param layout Układ, do którego dodawany jest widok wykresu.
+     * @param parent Rodzic obiektu.
+     */
+    explicit ChartController(QBoxLayout* layout, QObject* parent = nullptr);
+
+    /**
+     * @brief Podmienia dane wykresu.
+     * @param segments Ciągłe fragmenty serii (każdy rysowany osobną linią).
+     * @param filled Punkty uzupełnione, rysowane jako znaczniki.
+     * @param forecast Prognoza rysowana linią przerywaną (może być pusta).
+     * @param timeFormat Format etykiet osi czasu.
+     */
+    void setData(const QVector<QVector<QPointF>>& segments,
+        const QVector<QPointF>& filled,
+        const QVector<QPointF>& forecast,
+        const QString& timeFormat);
+
+    /**
+     * @brief Usuwa dane ze wszystkich serii.
+     */
+    void clear();
+
+    /**
+     * @brief Zwraca szerokość obszaru wykresu w pikselach.
+     */
+    int plotWidth() const;
+
+private:
+    static constexpr int kSpareSegments = 8;   ///< Liczba nieużywanych serii zachowywanych w puli
+
+    QLineSeries* segmentSeries(int index);
+
+    /**
+     * @brief Czyści serie puli od podanej i usuwa te ponad zapas kSpareSegments.
+     */
+    void trimPool(int used);
+
+    QChartView* chartView;              ///< Widok wykresu (własność układu)
+    QChart* chart;                      ///< Jedyny wykres pomiarów
+    QDateTimeAxis* axisX;               ///< Oś czasu
+    QValueAxis* axisY;                  ///< Oś wartości
+    QList<QLineSeries*> segmentPool;    ///< Serie fragmentów, używane ponownie
+    QScatterSeries* filledSeries;       ///< Punkty uzupełnione
+    QLineSeries* forecastSeries;        ///< Prognoza
+};
@@ -0,0 +1,246 @@
+﻿/**
+ * @file ListModels.cpp
+ * @brief Implementacja modeli list stacji, sensorów i pomiarów.
+ */
+
+#include "ListModels.h"
+#include <QBrush>
+#include <QColor>
+#include <QDateTime>
+#include <QFont>
+#include <algorithm>
+
+StationListModel::StationListModel(QObject* parent)
+    : QAbstractListModel(parent)
+{
+}
+
+void StationListModel::setStations(const QVector<StationRecord>& records)
+{
+    beginResetModel();
+    stations = records;
+    rowById.clear();
+    rowById.reserve(stations.size());
+    for (int i = 0; i < stations.size(); ++i)
+        rowById.insert(stations[i].id, i);
+    endResetModel();
+}
+
+int StationListModel::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : stations.size();
+}
+
+QVariant StationListModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= stations.size())
+        return QVariant();
+
+    const StationRecord& station = stations[index.row()];
+    if (role == Qt::DisplayRole)
+        return station.name;
+    if (role == IdRole)
+        return station.id;
+    return QVariant();
+}
+
+SensorListModel::SensorListModel(QObject* parent)
+    : QAbstractListModel(parent)
+{
+}
+
+void SensorListModel::setSensors(const QVector<SensorRecord>& records)
+{
+    beginResetModel();
+    sensors = records;
+    endResetModel();
+}
+
+int SensorListModel::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : sensors.size();
+}
+
+QVariant SensorListModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= sensors.size())
+        return QVariant();
+
+    const SensorRecord& sensor = sensors[index.row()];
+    if (role == Qt::DisplayRole)
+        return sensor.displayName();
+    if (role == IdRole)
+        return sensor.id;
+    return QVariant();
+}
+
+MeasurementListModel::MeasurementListModel(QObject* parent)
+    : QAbstractListModel(parent)
+{
+}
+
+void MeasurementListModel::setRows(QVector<MeasurementRow> newRows, const QString& format, bool coloring)
+{
+    beginResetModel();
+    rows = std::move(newRows);
+    timeFormat = format;
+    valueColoring = coloring;
+    message.clear();
+    // Widok dostaje pierwszą porcję, kolejne przez fetchMore() przy przewijaniu
+    loaded = std::min<int>(int(rows.size()), kFetchChunk);
+    endResetModel();
+}
+
+void MeasurementListModel::setMessage(const QString& text)
+{
+    beginResetModel();
+    rows.clear();
+    loaded = 0;
+    message = text;
+    endResetModel();
+}
+
+void MeasurementListModel::clear()
+{
+    setMessage(QString());
+}
+
+int MeasurementListModel::rowCount(const QModelIndex& parent) const
+{
+    if (parent.isValid())
+        return 0;
+    if (rows.isEmpty())
+        return message.isEmpty() ? 0 : 1;
+    return loaded;
+}
+
+bool MeasurementListModel::canFetchMore(const QModelIndex& parent) const
+{
+    return !parent.isValid() && loaded < rows.size();
+}
+
+void MeasurementListModel::fetchMore(const QModelIndex& parent)
+{
+    if (parent.isValid())
+        return;
+
+    const int count = std::min<int>(int(rows.size()) - loaded, kFetchChunk);
+    if (count <= 0)
+        return;
+
+    beginInsertRows(QModelIndex(), loaded, loaded + count - 1);
+    loaded += count;
+    endInsertRows();
+}
+
+QString MeasurementListModel::text(const MeasurementRow& row) const
+{
+    const QString time = QDateTime::fromMSecsSinceEpoch(row.startMs).toString(timeFormat);
+    switch (row.kind) {
+    case MeasurementRow::Filled:
+        return QString("%1 - %2 (uzupełniono)").arg(time).arg(row.value, 0, 'f', 1);
+    case MeasurementRow::Gap:
+        return QString("%1 - %2 - Brak danych (%3 h)")
+            .arg(time)
+            .arg(QDateTime::fromMSecsSinceEpoch(row.endMs).toString(timeFormat))
+            .arg(row.count);
+    case MeasurementRow::Rollup:
+        return QString("%1: śr. %2 (min %3, maks %4, n=%5)")
+            .arg(time)
+            .arg(row.value, 0, 'f', 1)
+            .arg(row.min, 0, 'f', 1)
+            .arg(row.max, 0, 'f', 1)
+            .arg(row.count);
+    case MeasurementRow::Measured:
+    default:
+        return QString("%1 - %2").arg(time).arg(row.value, 0, 'f', 1);
+    }
+}
+
+QVariant MeasurementListModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid())
+        return QVariant();
+
+    if (rows.isEmpty()) {
+        if (role == Qt::DisplayRole && index.row() == 0)
+            return message;
+        return QVariant();
+    }
+
+    if (index.row() >= loaded)
+        return QVariant();
+
+    const MeasurementRow& row = rows[index.row()];
+    switch (role) {
+    case Qt::DisplayRole:
+        return text(row);
+    case TimeRole:
+        return row.startMs;
+    case Qt::ForegroundRole:
+        if (row.kind == MeasurementRow::Filled || row.kind == MeasurementRow::Gap)
+            return QBrush(Qt::gray);
+        if (row.kind == MeasurementRow::Measured && valueColoring) {
+            // Kodowanie kolorami na podstawie wartości
+            if (row.value > 50.0)
+                return QBrush(Qt::red);
+            if (row.value > 25.0)
+                return QBrush(QColor(255, 165, 0)); // Pomarańczowy
+            return QBrush(Qt::green);
+        }
+        return QVariant();
+    case Qt::FontRole:
+        if (row.kind == MeasurementRow::Filled) {
+            QFont font;
+            font.setItalic(true);
+            return font;
+        }
+        return QVariant();
+    default:
+        return QVariant();
+    }
+}
+
+StationFilterProxyModel::StationFilterProxyModel(QObject* parent)
+    : QSortFilterProxyModel(parent)
+{
+    sort(0);
+}
+
+void StationFilterProxyModel::setResult(const QVector<int>& rows)
+{
+    const int sourceRows = sourceModel() ? sourceModel()->rowCount() : 0;
+    positions.fill(-1, sourceRows);
+    for (int i = 0; i < rows.size(); ++i) {
+        if (rows[i] >= 0 && rows[i] < sourceRows)
+            positions[rows[i]] = i;
+    }
+    filtered = true;
+
+    // Najpierw sam filtr - widok dostaje tylko wstawione i usunięte wiersze
+    invalidateFilter();
+
+    // Pełne przesortowanie tylko wtedy, gdy zmieniła się kolejność pozostałych wierszy
+    int previous = -1;
+    for (int row = 0; row < rowCount(); ++row) {
+        const int position = positions.value(mapToSource(index(row, 0)).row(), -1);
+        if (position < previous) {
+            invalidate();
+            break;
+        }
+        previous = position;
+    }
+}
+
+bool StationFilterProxyModel::filterAcceptsRow(int sourceRow, const QModelIndex& sourceParent) const
+{
+    Q_UNUSED(sourceParent);
+    return !filtered || positions.value(sourceRow, -1) >= 0;
+}
+
+bool StationFilterProxyModel::lessThan(const QModelIndex& left, const QModelIndex& right) const
+{
+    if (!filtered)
+        return left.row() < right.row();
+    return positions.value(left.row(), -1) < positions.value(right.row(), -1);
+}
@@ -0,0 +1,186 @@
+﻿/**
+ * @file ListModels.h
+ * @brief Modele list stacji, sensorów i pomiarów.
+ *
+ * Modele przechowują zwarte, typowane wiersze, a tekst, kolor i czcionkę
+ * wyznaczają dopiero w data() dla wierszy widocznych w widoku. Lista
+ * pomiarów udostępnia wiersze porcjami przez fetchMore(), więc nawet
+ * dziesiątki tysięcy pozycji nie tworzą obiektów na stercie dla każdego wiersza.
+ *
+ * @author Jakub Frąckowiak
+ * @date Maj 2025
+ */
+
+#pragma once
+
+#include "Records.h"
+#include <QAbstractListModel>
+#include <QHash>
+#include <QSortFilterProxyModel>
+#include <QVector>
+
+/**
+ * @brief Role danych wspólne dla modeli list.
+ */
+enum ListRole
+{
+    IdRole = Qt::UserRole + 1,  ///< ID stacji lub sensora
+    TimeRole                    ///< Czas pomiaru (ms od epoki)
+};
+
+/**
+ * @class StationListModel
+ * @brief Model listy stacji pomiarowych.
+ */
+class StationListModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    explicit StationListModel(QObject* parent = nullptr);
+
+    /**
+     * @brief Podmienia listę stacji.
+     */
+    void setStations(const QVector<StationRecord>& records);
+
+    /**
+     * @brief Zwraca wszystkie stacje modelu.
+     */
+    const QVector<StationRecord>& records() const { return stations; }
+
+    /**
+     * @brief Zwraca numer wiersza stacji o podanym ID lub -1.
+     */
+    int rowOfId(int stationId) const { return rowById.value(stationId, -1); }
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+private:
+    QVector<StationRecord> stations;    ///< Stacje w kolejności z API
+    QHash<int, int> rowById;            ///< ID stacji -> numer wiersza
+};
+
+/**
+ * @class SensorListModel
+ * @brief Model listy sensorów wybranej stacji.
+ */
+class SensorListModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    explicit SensorListModel(QObject* parent = nullptr);
+
+    /**
+     * @brief Podmienia listę sensorów.
+     */
+    void setSensors(const QVector<SensorRecord>& records);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+private:
+    QVector<SensorRecord> sensors;      ///< Sensory stacji
+};
+
+/**
+ * @brief Wiersz listy pomiarów.
+ */
+struct MeasurementRow
+{
+    /**
+     * @brief Rodzaj wiersza.
+     */
+    enum Kind : quint8
+    {
+        Measured,   ///< Wartość zmierzona
+        Filled,     ///< Wartość uzupełniona
+        Gap,        ///< Nieuzupełniona przerwa w danych
+        Rollup      ///< Agregat dzienny lub miesięczny
+    };
+
+    Kind kind = Measured;   ///< Rodzaj wiersza
+    qint64 startMs = 0;     ///< Czas pomiaru lub początek przedziału
+    qint64 endMs = 0;       ///< Koniec przerwy
+    double value = 0.0;     ///< Wartość lub średnia agregatu
+    double min = 0.0;       ///< Minimum agregatu
+    double max = 0.0;       ///< Maksimum agregatu
+    int count = 0;          ///< Liczba pomiarów agregatu lub godzin przerwy
+};
+
+/**
+ * @class MeasurementListModel
+ * @brief Model listy pomiarów ładowany porcjami.
+ */
+class MeasurementListModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    explicit MeasurementListModel(QObject* parent = nullptr);
+
+    /**
+     * @brief Podmienia wiersze modelu.
+     * @param rows Wiersze w kolejności wyświetlania.
+     * @param timeFormat Format czasu w tekście wiersza.
+     * @param valueColoring Czy kolorować wartości zmierzone według progów.
+     */
+    void setRows(QVector<MeasurementRow> rows, const QString& timeFormat, bool valueColoring);
+
+    /**
+     * @brief Wyświetla pojedynczy komunikat zamiast wierszy.
+     */
+    void setMessage(const QString& text);
+
+    /**
+     * @brief Usuwa wszystkie wiersze.
+     */
+    void clear();
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    bool canFetchMore(const QModelIndex& parent) const override;
+    void fetchMore(const QModelIndex& parent) override;
+
+private:
+    static constexpr int kFetchChunk = 500; ///< Liczba wierszy udostępnianych naraz
+
+    QString text(const MeasurementRow& row) const;
+
+    QVector<MeasurementRow> rows;       ///< Wszystkie wiersze
+    int loaded = 0;                     ///< Liczba wierszy udostępnionych widokowi
+    QString timeFormat;                 ///< Format czasu
+    bool valueColoring = false;         ///< Kolorowanie wartości zmierzonych
+    QString message;                    ///< Komunikat wyświetlany, gdy brak wierszy
+};
+
+/**
+ * @class StationFilterProxyModel
+ * @brief Filtr listy stacji ustawiany wynikiem wyszukiwania.
+ *
+ * Zmiana wyniku jest nakładana na widok jako różnica: znikają tylko
+ * wiersze, które przestały pasować, a pojawiają się tylko nowe.
+ */
+class StationFilterProxyModel : public QSortFilterProxyModel
+{
+    Q_OBJECT
+
+public:
+    explicit StationFilterProxyModel(QObject* parent = nullptr);
+
+    /**
+     * @brief Ustawia wynik wyszukiwania.
+     * @param rows Numery wierszy modelu źródłowego w kolejności wyświetlania.
+     */
+    void setResult(const QVector<int>& rows);
+
+protected:
+    bool filterAcceptsRow(int sourceRow, const QModelIndex& sourceParent) const override;
+    bool lessThan(const QModelIndex& left, const QModelIndex& right) const override;
+
+private:
+    QVector<int> positions;     ///< Pozycja wiersza źródłowego w wyniku (-1, gdy odfiltrowany)
+    bool filtered = false;      ///< Czy wynik został ustawiony
+};
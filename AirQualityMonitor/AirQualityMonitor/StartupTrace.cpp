@@ -0,0 +1,34 @@
+﻿/**
+ * @file StartupTrace.cpp
+ * @brief Implementacja pomiaru faz uruchamiania.
+ */
+
+#include "StartupTrace.h"
+#include <QElapsedTimer>
+#include <QLoggingCategory>
+
+Q_LOGGING_CATEGORY(lcStartup, "aqm.startup", QtWarningMsg)
+
+namespace
+{
+    QElapsedTimer startTimer;   ///< Czas od początku main
+    qint64 lastMarkMs = 0;      ///< Czas poprzedniej fazy
+}
+
+namespace StartupTrace
+{
+    void start()
+    {
+        startTimer.start();
+        lastMarkMs = 0;
+    }
+
+    void mark(const QString& phase)
+    {
+        if (!startTimer.isValid() || !lcStartup().isDebugEnabled())
+            return;
+        const qint64 now = startTimer.elapsed();
+        qCDebug(lcStartup).noquote() << QString("[start] %1: %2 ms (+%3 ms)").arg(phase).arg(now).arg(now - lastMarkMs);
+        lastMarkMs = now;
+    }
+}
@@ -0,0 +1,32 @@
+﻿/**
+ * @file StartupTrace.h
+ * @brief Pomiar czasu kolejnych faz uruchamiania aplikacji.
+ *
+ * Każda faza wypisywana jest w logu z czasem od startu procesu i od
+ * poprzedniej fazy, np. "[start] pierwsze rysowanie: 412 ms (+35 ms)".
+ * Czas do faz "pierwsze rysowanie" (okno z listą stacji gotowe do użycia)
+ * i "mapa wczytana" pozwala porównywać zmiany kolejności inicjalizacji.
+ *
+ * Komunikaty należą do kategorii logowania "aqm.startup", domyślnie
+ * wyłączonej; włącza ją np. QT_LOGGING_RULES="aqm.startup.debug=true".
+ *
+ * @author Jakub Frąckowiak
+ * @date Maj 2025
+ */
+
+#pragma once
+
+#include <QString>
+
+namespace StartupTrace
+{
+    /**
+     * @brief Rozpoczyna pomiar (na początku main).
+     */
+    void start();
+
+    /**
+     * @brief Zapisuje zakończenie fazy uruchamiania.
+     */
+    void mark(const QString& phase);
+}
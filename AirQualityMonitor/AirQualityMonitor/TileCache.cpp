@@ -0,0 +1,318 @@
+﻿/**
+ * @file TileCache.cpp
+ * @brief Implementacja pamięci kafelków mapy.
+ */
+
+#include "TileCache.h"
+#include <QBuffer>
+#include <QDebug>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QPointer>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QUuid>
+#include <QWebEngineUrlRequestJob>
+#include <QWebEngineUrlScheme>
+#include <QtMath>
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    const QByteArray kUserAgent = "AirQualityMonitor/1.0";  ///< Wymagany przez zasady serwerów OSM
+    constexpr int kMaxZoom = 19;  ///< Największy poziom przybliżenia OSM
+    constexpr double kPi = 3.14159265358979323846;  ///< Liczba pi
+
+    // Obszar Polski (z niewielkim marginesem)
+    constexpr double kPolandSouth = 49.0;
+    constexpr double kPolandNorth = 54.9;
+    constexpr double kPolandWest = 14.1;
+    constexpr double kPolandEast = 24.2;
+
+    int lonToTileX(double lon, int z)
+    {
+        return int(std::floor((lon + 180.0) / 360.0 * (1 << z)));
+    }
+
+    int latToTileY(double lat, int z)
+    {
+        const double rad = qDegreesToRadians(lat);
+        return int(std::floor((1.0 - std::log(std::tan(rad) + 1.0 / std::cos(rad)) / kPi) / 2.0 * (1 << z)));
+    }
+}
+
+TileStore::TileStore(const QString& path)
+    : connectionName(QUuid::createUuid().toString())
+{
+    QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+    db.setDatabaseName(path);
+    if (!db.open()) {
+        qDebug() << "Nie można otworzyć bazy kafelków:" << db.lastError().text();
+        return;
+    }
+
+    QSqlQuery query(db);
+    query.exec("PRAGMA journal_mode=WAL");
+    query.exec("PRAGMA synchronous=NORMAL");
+    query.exec("CREATE TABLE IF NOT EXISTS metadata (name TEXT, value TEXT)");
+    query.exec("CREATE TABLE IF NOT EXISTS tiles (zoom_level INTEGER, tile_column INTEGER, tile_row INTEGER, tile_data BLOB)");
+    query.exec("CREATE UNIQUE INDEX IF NOT EXISTS tile_index ON tiles (zoom_level, tile_column, tile_row)");
+    query.exec("INSERT INTO metadata SELECT 'name', 'OpenStreetMap' WHERE NOT EXISTS (SELECT 1 FROM metadata WHERE name = 'name')");
+    query.exec("INSERT INTO metadata SELECT 'format', 'png' WHERE NOT EXISTS (SELECT 1 FROM metadata WHERE name = 'format')");
+
+    selectQuery = QSqlQuery(db);
+    selectQuery.prepare("SELECT tile_data FROM tiles WHERE zoom_level = ? AND tile_column = ? AND tile_row = ?");
+    existsQuery = QSqlQuery(db);
+    existsQuery.prepare("SELECT 1 FROM tiles WHERE zoom_level = ? AND tile_column = ? AND tile_row = ?");
+    insertQuery = QSqlQuery(db);
+    insertQuery.prepare("INSERT OR REPLACE INTO tiles (zoom_level, tile_column, tile_row, tile_data) VALUES (?, ?, ?, ?)");
+    open = true;
+}
+
+TileStore::~TileStore()
+{
+    // Zapytania muszą zniknąć przed usunięciem połączenia
+    selectQuery = QSqlQuery();
+    existsQuery = QSqlQuery();
+    insertQuery = QSqlQuery();
+    QSqlDatabase::database(connectionName, false).close();
+    QSqlDatabase::removeDatabase(connectionName);
+}
+
+QByteArray TileStore::tile(int z, int x, int y)
+{
+    if (!open)
+        return QByteArray();
+
+    selectQuery.addBindValue(z);
+    selectQuery.addBindValue(x);
+    selectQuery.addBindValue((1 << z) - 1 - y);
+    QByteArray data;
+    if (selectQuery.exec() && selectQuery.next())
+        data = selectQuery.value(0).toByteArray();
+    selectQuery.finish();
+    return data;
+}
+
+bool TileStore::contains(int z, int x, int y)
+{
+    if (!open)
+        return false;
+
+    existsQuery.addBindValue(z);
+    existsQuery.addBindValue(x);
+    existsQuery.addBindValue((1 << z) - 1 - y);
+    const bool found = existsQuery.exec() && existsQuery.next();
+    existsQuery.finish();
+    return found;
+}
+
+void TileStore::insert(int z, int x, int y, const QByteArray& data)
+{
+    if (!open)
+        return;
+
+    insertQuery.addBindValue(z);
+    insertQuery.addBindValue(x);
+    insertQuery.addBindValue((1 << z) - 1 - y);
+    insertQuery.addBindValue(data);
+    if (!insertQuery.exec())
+        qDebug() << "Błąd zapisu kafelka:" << insertQuery.lastError().text();
+}
+
+TileCache::TileCache(const QString& path, QObject* parent)
+    : QObject(parent),
+    store(path),
+    network(new QNetworkAccessManager(this))
+{
+}
+
+TileCache::~TileCache()
+{
+    // Przerwane pobrania kończą się przed zniszczeniem bazy i listy oczekujących
+    pending.clear();
+    delete network;
+}
+
+quint64 TileCache::key(int z, int x, int y)
+{
+    return (quint64(z) << 48) | (quint64(x) << 24) | quint64(y);
+}
+
+QByteArray TileCache::cached(int z, int x, int y)
+{
+    return store.tile(z, x, y);
+}
+
+void TileCache::fetch(int z, int x, int y, const Callback& done)
+{
+    const quint64 tileKey = key(z, x, y);
+    auto it = pending.find(tileKey);
+    if (it != pending.end()) {
+        it->append(done);
+        return;
+    }
+    pending.insert(tileKey, { done });
+
+    QString url = serverUrl;
+    url.replace("{z}", QString::number(z)).replace("{x}", QString::number(x)).replace("{y}", QString::number(y));
+    QNetworkRequest request{ QUrl(url) };
+    request.setHeader(QNetworkRequest::UserAgentHeader, kUserAgent);
+    QNetworkReply* reply = network->get(request);
+
+    connect(reply, &QNetworkReply::finished, this, [this, reply, z, x, y, tileKey]() {
+        QByteArray data;
+        if (reply->error() == QNetworkReply::NoError) {
+            data = reply->readAll();
+            store.insert(z, x, y, data);
+        }
+        else {
+            qDebug() << "Błąd pobierania kafelka" << z << x << y << ":" << reply->errorString();
+        }
+        reply->deleteLater();
+
+        const QList<Callback> callbacks = pending.take(tileKey);
+        for (const Callback& callback : callbacks)
+            callback(data);
+        });
+}
+
+void TileSchemeHandler::registerScheme()
+{
+    QWebEngineUrlScheme scheme(kScheme);
+    scheme.setSyntax(QWebEngineUrlScheme::Syntax::Path);
+    scheme.setFlags(QWebEngineUrlScheme::SecureScheme | QWebEngineUrlScheme::LocalAccessAllowed
+        | QWebEngineUrlScheme::CorsEnabled);
+    QWebEngineUrlScheme::registerScheme(scheme);
+}
+
+TileSchemeHandler::TileSchemeHandler(TileCache* cache, QObject* parent)
+    : QWebEngineUrlSchemeHandler(parent),
+    cache(cache)
+{
+}
+
+void TileSchemeHandler::requestStarted(QWebEngineUrlRequestJob* job)
+{
+    // Ścieżka: osm/{z}/{x}/{y}.png
+    const QStringList parts = job->requestUrl().path().split('/', Qt::SkipEmptyParts);
+    bool okZ = false, okX = false, okY = false;
+    const int z = parts.size() >= 3 ? parts[parts.size() - 3].toInt(&okZ) : 0;
+    const int x = parts.size() >= 3 ? parts[parts.size() - 2].toInt(&okX) : 0;
+    const int y = parts.size() >= 3 ? parts.last().section('.', 0, 0).toInt(&okY) : 0;
+
+    if (!okZ || !okX || !okY || z < 0 || z > kMaxZoom || x < 0 || y < 0 || x >= (1 << z) || y >= (1 << z)) {
+        job->fail(QWebEngineUrlRequestJob::UrlInvalid);
+        return;
+    }
+
+    auto reply = [](QWebEngineUrlRequestJob* target, const QByteArray& data) {
+        QBuffer* buffer = new QBuffer(target);
+        buffer->setData(data);
+        target->reply("image/png", buffer);
+    };
+
+    const QByteArray data = cache->cached(z, x, y);
+    if (!data.isEmpty()) {
+        reply(job, data);
+        return;
+    }
+
+    // Brak w bazie - pobranie w tle; zadanie może zostać anulowane w międzyczasie
+    QPointer<QWebEngineUrlRequestJob> pendingJob(job);
+    cache->fetch(z, x, y, [pendingJob, reply](const QByteArray& fetched) {
+        if (!pendingJob)
+            return;
+        if (fetched.isEmpty())
+            pendingJob->fail(QWebEngineUrlRequestJob::RequestFailed);
+        else
+            reply(pendingJob, fetched);
+        });
+}
+
+TilePrefetcher::TilePrefetcher(TileCache* cache, QObject* parent)
+    : QObject(parent),
+    cache(cache)
+{
+}
+
+bool TilePrefetcher::start(int minZoom, int lastZoom)
+{
+    if (cache->usesDefaultServer()) {
+        qWarning() << "Pobieranie kafelków z wyprzedzeniem wymaga własnego serwera kafelków (zasady serwerów OSM)";
+        return false;
+    }
+    if (running)
+        return true;
+
+    running = true;
+    fetched = 0;
+    maxZoom = std::min(lastZoom, kMaxZoom);
+    z = minZoom - 1;
+    xMax = -1;
+    yMax = -1;
+    x = 0;
+    y = 0;
+    pump();
+    return true;
+}
+
+bool TilePrefetcher::nextMissing(int& tileZ, int& tileX, int& tileY)
+{
+    for (;;) {
+        // Przejście do kolejnego kafelka, wiersza lub poziomu
+        if (x < xMax) {
+            ++x;
+        }
+        else if (y < yMax) {
+            ++y;
+            x = xMin;
+        }
+        else {
+            if (z >= maxZoom)
+                return false;
+            ++z;
+            xMin = lonToTileX(kPolandWest, z);
+            xMax = lonToTileX(kPolandEast, z);
+            yMin = latToTileY(kPolandNorth, z);
+            yMax = latToTileY(kPolandSouth, z);
+            x = xMin;
+            y = yMin;
+        }
+
+        if (!cache->contains(z, x, y)) {
+            tileZ = z;
+            tileX = x;
+            tileY = y;
+            return true;
+        }
+    }
+}
+
+void TilePrefetcher::pump()
+{
+    int tileZ, tileX, tileY;
+    while (running && inFlight < kParallelRequests) {
+        if (!nextMissing(tileZ, tileX, tileY)) {
+            running = false;
+            break;
+        }
+
+        ++inFlight;
+        QPointer<TilePrefetcher> self(this);
+        cache->fetch(tileZ, tileX, tileY, [self](const QByteArray& data) {
+            if (!self)
+                return;
+            --self->inFlight;
+            if (!data.isEmpty())
+                ++self->fetched;
+            self->pump();
+            });
+    }
+
+    if (!running && inFlight == 0) {
+        qDebug() << "Pobrano z wyprzedzeniem kafelków:" << fetched;
+        emit finished(fetched);
+    }
+}
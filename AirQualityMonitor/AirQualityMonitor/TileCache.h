@@ -0,0 +1,200 @@
+﻿/**
+ * @file TileCache.h
+ * @brief Lokalna pamięć kafelków mapy i ich serwowanie do widoku webowego.
+ *
+ * Kafelki OpenStreetMap są zapisywane w bazie SQLite o schemacie MBTiles.
+ * Strona mapy pobiera je przez własny schemat URL "tiles:", obsługiwany
+ * w aplikacji: kafelek z bazy jest zwracany od razu, brakujący pobierany
+ * z sieci w tle i zapisywany. Na życzenie (opcja uruchomienia) obszar Polski
+ * może zostać pobrany z wyprzedzeniem w zadanym zakresie przybliżeń - tylko
+ * z własnego serwera kafelków, bo zasady serwerów OSM zabraniają pobierania
+ * hurtowego.
+ *
+ * @author Jakub Frąckowiak
+ * @date Maj 2025
+ */
+
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QSqlQuery>
+#include <QWebEngineUrlSchemeHandler>
+#include <functional>
+
+class QNetworkAccessManager;
+
+/**
+ * @class TileStore
+ * @brief Baza kafelków w formacie MBTiles.
+ *
+ * Wiersze kafelków są numerowane w układzie TMS (oś Y od dołu), zgodnie ze
+ * specyfikacją MBTiles; metody przyjmują współrzędne XYZ jak w Leaflet.
+ */
+class TileStore
+{
+public:
+    /**
+     * @brief Otwiera lub tworzy bazę kafelków.
+     * @param path Ścieżka do pliku bazy.
+     */
+    explicit TileStore(const QString& path);
+    ~TileStore();
+
+    TileStore(const TileStore&) = delete;
+    TileStore& operator=(const TileStore&) = delete;
+
+    /**
+     * @brief Sprawdza, czy baza została poprawnie otwarta.
+     */
+    bool isOpen() const { return open; }
+
+    /**
+     * @brief Zwraca zapisany kafelek lub pustą tablicę.
+     */
+    QByteArray tile(int z, int x, int y);
+
+    /**
+     * @brief Sprawdza, czy kafelek jest zapisany.
+     */
+    bool contains(int z, int x, int y);
+
+    /**
+     * @brief Zapisuje (lub zastępuje) kafelek.
+     */
+    void insert(int z, int x, int y, const QByteArray& data);
+
+private:
+    QString connectionName;     ///< Nazwa połączenia QSqlDatabase
+    bool open = false;          ///< Czy baza jest otwarta
+    QSqlQuery selectQuery;      ///< Przygotowane zapytanie odczytu
+    QSqlQuery existsQuery;      ///< Przygotowane zapytanie sprawdzające
+    QSqlQuery insertQuery;      ///< Przygotowane zapytanie zapisu
+};
+
+/**
+ * @class TileCache
+ * @brief Kafelki z bazy lokalnej uzupełniane z sieci.
+ */
+class TileCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    /// Wywoływane po pobraniu kafelka; pusta tablica oznacza błąd
+    using Callback = std::function<void(const QByteArray&)>;
+
+    /// Domyślny serwer kafelków (OpenStreetMap - tylko kafelki oglądane na mapie)
+    static constexpr const char* kDefaultServerUrl = "https://tile.openstreetmap.org/{z}/{x}/{y}.png";
+
+    /**
+     * @brief Tworzy pamięć kafelków.
+     * @param path Ścieżka do pliku bazy MBTiles.
+     * @param parent Rodzic obiektu.
+     */
+    explicit TileCache(const QString& path, QObject* parent = nullptr);
+    ~TileCache() override;
+
+    /**
+     * @brief Zwraca kafelek z bazy lokalnej lub pustą tablicę.
+     */
+    QByteArray cached(int z, int x, int y);
+
+    /**
+     * @brief Sprawdza, czy kafelek jest w bazie lokalnej.
+     */
+    bool contains(int z, int x, int y) { return store.contains(z, x, y); }
+
+    /**
+     * @brief Pobiera kafelek z sieci i zapisuje go w bazie.
+     *
+     * Równoczesne żądania tego samego kafelka są łączone w jedno pobranie.
+     */
+    void fetch(int z, int x, int y, const Callback& done);
+
+    /**
+     * @brief Ustawia serwer, z którego pobierane są brakujące kafelki.
+     * @param urlTemplate Adres z polami {z}, {x} i {y}.
+     */
+    void setServerUrl(const QString& urlTemplate) { serverUrl = urlTemplate; }
+
+    /**
+     * @brief Sprawdza, czy kafelki pobierane są z domyślnego serwera OSM.
+     */
+    bool usesDefaultServer() const { return serverUrl == QLatin1String(kDefaultServerUrl); }
+
+private:
+    static quint64 key(int z, int x, int y);
+
+    TileStore store;                                ///< Baza kafelków
+    QString serverUrl = kDefaultServerUrl;          ///< Szablon adresu kafelka
+    QNetworkAccessManager* network;                 ///< Pobieranie brakujących kafelków
+    QHash<quint64, QList<Callback>> pending;        ///< Kafelki w trakcie pobierania
+};
+
+/**
+ * @class TileSchemeHandler
+ * @brief Obsługa schematu "tiles:osm/{z}/{x}/{y}.png" dla strony mapy.
+ */
+class TileSchemeHandler : public QWebEngineUrlSchemeHandler
+{
+    Q_OBJECT
+
+public:
+    /// Nazwa schematu rejestrowana przed utworzeniem aplikacji
+    static constexpr const char* kScheme = "tiles";
+
+    /**
+     * @brief Rejestruje schemat w QtWebEngine (przed utworzeniem QApplication).
+     */
+    static void registerScheme();
+
+    explicit TileSchemeHandler(TileCache* cache, QObject* parent = nullptr);
+
+    void requestStarted(QWebEngineUrlRequestJob* job) override;
+
+private:
+    TileCache* cache;   ///< Źródło kafelków
+};
+
+/**
+ * @class TilePrefetcher
+ * @brief Pobiera z wyprzedzeniem kafelki obszaru Polski.
+ */
+class TilePrefetcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit TilePrefetcher(TileCache* cache, QObject* parent = nullptr);
+
+    /**
+     * @brief Rozpoczyna pobieranie brakujących kafelków.
+     * @param minZoom Najmniejszy poziom przybliżenia.
+     * @param maxZoom Największy poziom przybliżenia.
+     * @return False, jeśli kafelki pochodzą z serwera OSM (pobieranie hurtowe jest tam zabronione).
+     */
+    bool start(int minZoom, int maxZoom);
+
+signals:
+    /**
+     * @brief Zakończono przeglądanie obszaru.
+     * @param fetched Liczba pobranych kafelków.
+     */
+    void finished(int fetched);
+
+private:
+    static constexpr int kParallelRequests = 2;    ///< Limit równoczesnych pobrań (zasady serwerów OSM)
+
+    bool nextMissing(int& z, int& x, int& y);
+    void pump();
+
+    TileCache* cache;       ///< Pamięć kafelków
+    int maxZoom = 0;        ///< Ostatni poziom
+    int z = 0;              ///< Bieżący poziom
+    int x = 0, y = 0;       ///< Bieżący kafelek
+    int xMin = 0, xMax = -1, yMin = 0, yMax = -1;   ///< Zakres kafelków poziomu
+    int inFlight = 0;       ///< Pobrania w toku
+    int fetched = 0;        ///< Pobrane kafelki
+    bool running = false;   ///< Czy pobieranie trwa
+};
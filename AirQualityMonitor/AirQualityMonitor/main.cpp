@@ -1,12 +1,57 @@
-#include "AirQualityMonitor.h"
+﻿#include "AirQualityMonitor.h"
+#include "TileCache.h"
+#include "LocalApiServer.h"
+#include "MeasurementPublisher.h"
+#include "StartupTrace.h"
+#include <QCommandLineParser>
 #include <QtWidgets/QApplication>
 
 
 int main(int argc, char *argv[])
 {
+    StartupTrace::start();
+
+    // Własne schematy URL muszą być zarejestrowane przed utworzeniem aplikacji
+    TileSchemeHandler::registerScheme();
+
     QApplication a(argc, argv);
+    StartupTrace::mark("QApplication");
+
+    // Opcjonalny serwer HTTP udostępniający zapisane dane i powiadomienia
+    // WebSocket o nowych pomiarach (w sieci lokalnej tylko z --lan);
+    // nieznane opcje (np. przełączniki WebEngine) są pomijane
+    QCommandLineParser parser;
+    const QCommandLineOption serveOption("serve",
+        QString("Udostępnia zapisane dane przez HTTP na porcie (np. %1).").arg(LocalApiServer::kDefaultPort), "port");
+    const QCommandLineOption lanOption("lan",
+        "Udostępnia serwery --serve i --publish w sieci lokalnej (domyślnie tylko na tym komputerze).");
+    const QCommandLineOption publishOption("publish",
+        QString("Powiadamia o nowych pomiarach przez WebSocket na porcie (np. %1).").arg(MeasurementPublisher::kDefaultPort), "port");
+    const QCommandLineOption tileUrlOption("tile-url",
+        "Serwer kafelków mapy, np. https://tiles.example.org/{z}/{x}/{y}.png.", "url");
+    const QCommandLineOption prefetchOption("prefetch-tiles",
+        "Pobiera kafelki Polski z wyprzedzeniem w zakresie przybliżeń (np. 5-10); wymaga --tile-url.", "min-max");
+    parser.addOption(serveOption);
+    parser.addOption(lanOption);
+    parser.addOption(publishOption);
+    parser.addOption(tileUrlOption);
+    parser.addOption(prefetchOption);
+    parser.parse(a.arguments());
 
     AirQualityMonitor w;
+    const QHostAddress address = parser.isSet(lanOption) ? QHostAddress::Any : QHostAddress::LocalHost;
+    if (parser.isSet(serveOption))
+        w.startLocalApi(quint16(parser.value(serveOption).toUInt()), address);
+    if (parser.isSet(publishOption))
+        w.startPublisher(quint16(parser.value(publishOption).toUInt()), address);
+    if (parser.isSet(tileUrlOption))
+        w.setTileServer(parser.value(tileUrlOption));
+    if (parser.isSet(prefetchOption)) {
+        const QStringList zooms = parser.value(prefetchOption).split('-');
+        const int minZoom = zooms.first().toInt();
+        w.enableTilePrefetch(minZoom, zooms.size() > 1 ? zooms.last().toInt() : minZoom);
+    }
     w.show();
+    StartupTrace::mark("okno pokazane");
     return a.exec();
 }
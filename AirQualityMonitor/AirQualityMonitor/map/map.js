@@ -0,0 +1,192 @@
+// Strona mapy stacji - ładowana raz z zasobów aplikacji i utrzymywana przy życiu
+var map;
+var renderer;
+var layer;
+var pollutant = '';
+var markersById = {};
+var routeLayer;
+var drawnRoute = [];
+var drawnLine = null;
+
+// Kolory i nazwy klas polskiego indeksu jakości powietrza
+var levelColors = ['#57b108', '#b0dd10', '#ffd911', '#e58100', '#e50000', '#990000'];
+var levelNames = ['bardzo dobry', 'dobry', 'umiarkowany', 'dostateczny', 'zły', 'bardzo zły'];
+var noLevelColor = '#9e9e9e';
+
+// Znaczniki widocznego obszaru w jednym komunikacie:
+// {"pollutant": kod, "markers": [[id, lat, lon, nazwa, klasa, wartość], ...],
+//  "clusters": [[lat, lon, liczba, najgorsza klasa], ...]}
+function setMarkers(payload) {
+    var data = JSON.parse(payload || '{}');
+    var markers = data.markers || [];
+    var clusters = data.clusters || [];
+
+    pollutant = data.pollutant || '';
+    markersById = {};
+    layer.clearLayers();
+    for (var i = 0; i < clusters.length; i++) {
+        addCluster(clusters[i]);
+    }
+    for (var j = 0; j < markers.length; j++) {
+        var row = markers[j];
+        var marker = L.circleMarker([row[1], row[2]], {
+            renderer: renderer, radius: 7, weight: 1,
+            color: '#ffffff', fillOpacity: 0.9
+        });
+        marker.on('click', onMarkerClick);
+        marker.stationId = row[0];
+        marker.stationName = row[3];
+        applyReading(marker, row[4], row[5]);
+        markersById[row[0]] = marker;
+        layer.addLayer(marker);
+    }
+}
+
+// Zmienione pomiary stacji: [[id, klasa, wartość], ...] - przekolorowanie bez przerysowania warstwy
+function updateMarkers(delta) {
+    var rows = JSON.parse(delta || '[]');
+    for (var i = 0; i < rows.length; i++) {
+        var marker = markersById[rows[i][0]];
+        if (marker) {
+            applyReading(marker, rows[i][1], rows[i][2]);
+        }
+    }
+}
+
+function applyReading(marker, level, value) {
+    var known = level >= 0 && level < levelColors.length;
+    marker.setStyle({ fillColor: known ? levelColors[level] : noLevelColor });
+
+    var lines = [marker.stationName];
+    if (value !== null && value !== undefined) {
+        var reading = pollutant + ': ' + value.toFixed(1) + ' µg/m³';
+        if (known) {
+            reading += ' (' + levelNames[level] + ')';
+        }
+        lines.push(reading);
+    }
+    var content = textLines(lines);
+    if (marker.getPopup()) {
+        marker.setPopupContent(content);
+    } else {
+        marker.bindPopup(content);
+    }
+}
+
+// Treść dymku z wierszy zwykłego tekstu - nazwy z API lub pliku nie są
+// interpretowane jako HTML (strona ma dostęp do obiektu bridge)
+function textLines(lines) {
+    var div = document.createElement('div');
+    for (var i = 0; i < lines.length; i++) {
+        if (i > 0) {
+            div.appendChild(document.createElement('br'));
+        }
+        div.appendChild(document.createTextNode(String(lines[i])));
+    }
+    return div;
+}
+
+function addCluster(cluster) {
+    var size = cluster[2] < 10 ? 30 : (cluster[2] < 100 ? 36 : 44);
+    // Kolor grupy według najgorszej klasy jej stacji
+    var level = cluster[3];
+    var color = level >= 0 && level < levelColors.length ? levelColors[level] : noLevelColor;
+    var marker = L.marker([cluster[0], cluster[1]], {
+        icon: L.divIcon({
+            className: 'station-cluster',
+            html: '<div style="background:' + color + '">' + Number(cluster[2]) + '</div>',
+            iconSize: [size, size]
+        })
+    });
+    // Kliknięcie grupy przybliża mapę do jej środka
+    marker.on('click', function() {
+        map.setView([cluster[0], cluster[1]], map.getZoom() + 2);
+    });
+    layer.addLayer(marker);
+}
+
+function onMarkerClick(e) {
+    bridge.onStationClicked(e.target.stationId);
+}
+
+// Trasy z narażeniem: {"pollutant": kod, "routes": [{"points": [[lat, lon], ...], "km", "minutes",
+// "mean", "peak", "dose", "coveredKm"}, ...]}
+function setRoutes(payload) {
+    var data = JSON.parse(payload || '{}');
+    var routes = data.routes || [];
+
+    routeLayer.clearLayers();
+    var bounds = null;
+    for (var i = 0; i < routes.length; i++) {
+        var route = routes[i];
+        var line = L.polyline(route.points, { color: '#3f51b5', weight: 4, opacity: 0.8 });
+        var lines = [route.km.toFixed(1) + ' km, ' + Math.round(route.minutes) + ' min'];
+        if (route.coveredKm > 0) {
+            lines.push(data.pollutant + ': średnio ' + route.mean.toFixed(1) + ' µg/m³, maks. ' + route.peak.toFixed(1) + ' µg/m³');
+            lines.push('Dawka: ' + route.dose.toFixed(1) + ' µg·h/m³');
+        } else {
+            lines.push('Brak stacji mierzących ' + data.pollutant + ' w pobliżu trasy');
+        }
+        line.bindTooltip(textLines(lines), { sticky: true });
+        routeLayer.addLayer(line);
+        bounds = bounds ? bounds.extend(line.getBounds()) : line.getBounds();
+    }
+    // Trasy zaimportowane z pliku - mapa pokazuje je w całości
+    if (bounds && drawnRoute.length === 0) {
+        map.fitBounds(bounds, { padding: [20, 20] });
+    }
+}
+
+// Prawy przycisk dodaje punkt rysowanej trasy, Escape ją czyści
+function onRoutePoint(e) {
+    drawnRoute.push([e.latlng.lat, e.latlng.lng]);
+    if (drawnLine) {
+        drawnLine.setLatLngs(drawnRoute);
+    } else {
+        drawnLine = L.polyline(drawnRoute, { color: '#3f51b5', weight: 2, dashArray: '4 6' }).addTo(map);
+    }
+    if (drawnRoute.length >= 2) {
+        bridge.onRouteDrawn(JSON.stringify(drawnRoute));
+    }
+}
+
+function clearRoute(e) {
+    if (e.key !== 'Escape' || drawnRoute.length === 0) {
+        return;
+    }
+    drawnRoute = [];
+    map.removeLayer(drawnLine);
+    drawnLine = null;
+    bridge.onRouteDrawn('[]');
+}
+
+function reportViewport() {
+    var bounds = map.getBounds();
+    bridge.onViewportChanged(bounds.getSouth(), bounds.getWest(), bounds.getNorth(), bounds.getEast(), map.getZoom());
+}
+
+window.onload = function() {
+    map = L.map('map', { preferCanvas: true }).setView([52.4064, 16.9252], 12);
+    renderer = L.canvas({ padding: 0.5 });
+    layer = L.layerGroup().addTo(map);
+    routeLayer = L.layerGroup().addTo(map);
+    // Kafelki serwowane przez aplikację z lokalnej bazy (schemat tiles:)
+    L.tileLayer('tiles:osm/{z}/{x}/{y}.png', {
+        maxZoom: 19,
+        attribution: '© OpenStreetMap'
+    }).addTo(map);
+
+    new QWebChannel(qt.webChannelTransport, function(channel) {
+        window.bridge = channel.objects.bridge;
+        bridge.markersChanged.connect(setMarkers);
+        bridge.markersUpdated.connect(updateMarkers);
+        bridge.routesChanged.connect(setRoutes);
+        setMarkers(bridge.markers);
+        map.on('contextmenu', onRoutePoint);
+        document.addEventListener('keydown', clearRoute);
+
+        // Aplikacja odpowiada tylko znacznikami widocznego obszaru
+        map.on('moveend', reportViewport);
+        reportViewport();
+    });
+};
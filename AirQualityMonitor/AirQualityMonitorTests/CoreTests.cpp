@@ -0,0 +1,1192 @@
+﻿#include "pch.h"
+#include "CoreTests.h"
+#include "AsyncIo.h"
+#include "CorrelationAnalysis.h"
+#include "Downsampling.h"
+#include "Forecast.h"
+#include "GeoDistance.h"
+#include "LocalApiServer.h"
+#include "Parallel.h"
+#include "Rollups.h"
+#include "StateSnapshot.h"
+#include "StationKdTree.h"
+#include "StationSearch.h"
+#include "TaskScheduler.h"
+#include <QDateTime>
+#include <QFile>
+#include <QNetworkAccessManager>
+#include <QNetworkRequest>
+#include <QTcpServer>
+#include <QTemporaryDir>
+#include <QtEndian>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <latch>
+#include <limits>
+#include <memory>
+#include <numbers>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+namespace
+{
+    // Siatka nad Polską, punkty przy południku 180° i biegunie oraz liczba
+    // punktów niepodzielna przez 4 (końcówka liczona wersją skalarną)
+    QVector<GeoPoint> geoTestPoints()
+    {
+        QVector<GeoPoint> points;
+        for (int i = 0; i < 23; ++i) {
+            for (int j = 0; j < 21; ++j)
+                points.append({ 49.0 + 0.27 * i, 14.1 + 0.49 * j });
+        }
+        points.append({ 0.0, 179.95 });
+        points.append({ 0.0, -179.95 });
+        points.append({ 89.9, 0.0 });
+        points.append({ -52.23, -163.0 });
+        points.append({ -52.23, 17.0 });
+        return points;
+    }
+
+    double geoTolerance(double km)
+    {
+        return GeoDistance::kMaxErrorKm + GeoDistance::kMaxRelativeError * km;
+    }
+
+    // Seria godzinowa z wartości; NaN oznacza brak pomiaru
+    MeasurementSeries hourlySeries(qint64 startMs, const QVector<double>& values)
+    {
+        MeasurementSeries series;
+        series.startMs = startMs;
+        series.values = values;
+        series.origin.fill(PointOrigin::Missing, values.size());
+        series.validity.resize(values.size());
+        for (int i = 0; i < values.size(); ++i) {
+            if (std::isnan(values[i]))
+                continue;
+            series.origin[i] = PointOrigin::Measured;
+            series.validity.setBit(i);
+            ++series.measuredCount;
+        }
+        return series;
+    }
+
+    // Stacje rozrzucone nad Polską ze stałym ziarnem
+    QVector<StationRecord> randomStations(int count)
+    {
+        std::mt19937 random(2025);
+        QVector<StationRecord> stations(count);
+        for (int i = 0; i < count; ++i) {
+            stations[i].id = i;
+            stations[i].lat = 49.0 + 6.0 * (random() % 100000) / 100000.0;
+            stations[i].lon = 14.1 + 10.0 * (random() % 100000) / 100000.0;
+        }
+        return stations;
+    }
+
+    StationRecord namedStation(int id, const char* name, const char* city, const char* street)
+    {
+        StationRecord station;
+        station.id = id;
+        station.name = QString::fromUtf8(name);
+        station.city = QString::fromUtf8(city);
+        station.street = QString::fromUtf8(street);
+        return station;
+    }
+
+    // Stacje o podobnych nazwach, ulicach i miejscowościach
+    QVector<StationRecord> searchStations()
+    {
+        return {
+            namedStation(0, "Łódź, Bałuty", "Łódź", "ul. Zgierska"),
+            namedStation(1, "Kraków, Aleja Krasińskiego", "Kraków", "al. Krasińskiego"),
+            namedStation(2, "Zgierz, ul. Mielczarskiego", "Zgierz", "ul. Mielczarskiego"),
+            namedStation(3, "Łódź, ul. Czernika", "Łódź", "ul. Czernika"),
+            namedStation(4, "Kraków, ul. Bujaka", "Kraków", "ul. Bujaka"),
+            namedStation(5, "Zgierz", "Zgierz", "ul. Konstantynowska"),
+            namedStation(6, "Warszawa, Marszałkowska", "Warszawa", "ul. Marszałkowska"),
+            namedStation(7, "Warszawa-Ursynów", "Warszawa", "ul. Wokalna"),
+            namedStation(8, "Legionowo, Zegrzyńska", "Legionowo", "ul. Zegrzyńska"),
+            namedStation(9, "Warszawa, Komunikacyjna", "Warszawa", "ul. Marszałkowska"),
+            namedStation(10, "Pruszków, Bohaterów Warszawy", "Pruszków", "ul. Piastów"),
+            namedStation(11, "Piastów", "Piastów", "ul. Warszawska"),
+        };
+    }
+
+    // Zamienia gzip na format qUncompress (długość i strumień zlib bez Adler-32),
+    // zwracając wartości stopki gzip (CRC-32 i długość)
+    QByteArray gzipToZlib(const QByteArray& gz, quint32& crc, quint32& size)
+    {
+        if (gz.size() < 18 || !gz.startsWith(QByteArray("\x1f\x8b\x08", 3)))
+            return QByteArray();
+        crc = qFromLittleEndian<quint32>(gz.constData() + gz.size() - 8);
+        size = qFromLittleEndian<quint32>(gz.constData() + gz.size() - 4);
+
+        char length[4];
+        qToBigEndian<quint32>(size, length);
+        QByteArray zlib(length, 4);
+        zlib.append("\x78\x9c", 2);
+        zlib.append(gz.mid(10, gz.size() - 18));
+        return zlib;
+    }
+
+    // CRC-32 liczone bit po bicie, niezależnie od tablicy serwera
+    quint32 crc32Bitwise(const QByteArray& data)
+    {
+        quint32 crc = 0xFFFFFFFFu;
+        for (const char byte : data) {
+            crc ^= quint8(byte);
+            for (int k = 0; k < 8; ++k)
+                crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+        }
+        return ~crc;
+    }
+
+    // Suma Adler-32 zamykająca strumień zlib
+    QByteArray adler32(const QByteArray& data)
+    {
+        quint32 a = 1, b = 0;
+        for (const char byte : data) {
+            a = (a + quint8(byte)) % 65521;
+            b = (b + a) % 65521;
+        }
+        char out[4];
+        qToBigEndian<quint32>((b << 16) | a, out);
+        return QByteArray(out, 4);
+    }
+
+    // Układ nagłówka migawki: znacznik, wersja, odcisk JSON, rozmiar danych, suma FNV-1a
+    constexpr int kSnapshotVersionOffset = 4;
+    constexpr int kSnapshotSizeOffset = 16;
+    constexpr int kSnapshotChecksumOffset = 24;
+    constexpr int kSnapshotHeaderSize = 32;
+
+    // Stan z kilkoma stacjami, serią z przerwą i piramidą
+    AppState sampleState()
+    {
+        AppState state;
+        state.stations = randomStations(5);
+        state.stations[0].name = QString::fromUtf8("Łódź, ul. Czernika");
+        state.sensors.append({ 101, 0, "pył zawieszony PM10", "PM10" });
+        state.sensors.append({ 102, 0, "dwutlenek azotu", "NO2" });
+        state.readings.append({ 0, "PM10", { 1737331200000, 42.5, 2 } });
+        state.stationId = 0;
+        state.sensorId = 101;
+        state.rangeStartMs = 1737331200000;
+        state.rangeEndMs = 1737936000000;
+
+        QVector<double> values(600);
+        for (int i = 0; i < values.size(); ++i)
+            values[i] = (i >= 200 && i < 210) ? std::numeric_limits<double>::quiet_NaN() : 20.0 + i % 17;
+        state.series = hourlySeries(1737331200000, values);
+
+        QVector<QPointF> points;
+        for (int i = 0; i < values.size(); ++i)
+            points.append(QPointF(i, values[i]));
+        DownsamplePyramid pyramid;
+        pyramid.build(points.mid(0, 200), DownsampleMode::MinMax);
+        state.pyramids.append(pyramid);
+        pyramid.build(points.mid(210), DownsampleMode::Lttb);
+        state.pyramids.append(pyramid);
+        return state;
+    }
+
+    // Zmienia dane migawki; opcjonalnie uaktualnia rozmiar i sumę kontrolną,
+    // aby błąd musiał wykryć dopiero dekoder
+    bool patchSnapshot(const QString& path, const std::function<void(QByteArray&)>& patch, bool fixHeader)
+    {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly))
+            return false;
+        QByteArray data = file.readAll();
+        file.close();
+
+        patch(data);
+        if (fixHeader && data.size() >= kSnapshotHeaderSize) {
+            quint64 hash = 14695981039346656037ULL;
+            for (qsizetype i = kSnapshotHeaderSize; i < data.size(); ++i) {
+                hash ^= quint8(data[i]);
+                hash *= 1099511628211ULL;
+            }
+            const quint64 size = quint64(data.size() - kSnapshotHeaderSize);
+            std::memcpy(data.data() + kSnapshotSizeOffset, &size, sizeof(size));
+            std::memcpy(data.data() + kSnapshotChecksumOffset, &hash, sizeof(hash));
+        }
+
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+            return false;
+        return file.write(data) == data.size();
+    }
+
+    // Stężenia z rytmem dobowym, słabym trendem i deterministycznym szumem
+    QVector<double> dailyPattern(int hours)
+    {
+        QVector<double> values(hours);
+        for (int i = 0; i < hours; ++i)
+            values[i] = 30.0 + 12.0 * std::sin(2.0 * std::numbers::pi * i / 24.0) + 0.05 * i + (i * 7 % 5) * 0.8;
+        return values;
+    }
+
+    // Czerwiec - zakres bez zmiany czasu, godzina doby rośnie razem z indeksem
+    qint64 forecastStartMs()
+    {
+        return QDateTime(QDate(2025, 6, 2), QTime(0, 0)).toMSecsSinceEpoch();
+    }
+
+    // Sygnał z pikami do testów redukcji punktów
+    QVector<QPointF> wavePoints(int count)
+    {
+        QVector<QPointF> points(count);
+        for (int i = 0; i < count; ++i)
+            points[i] = QPointF(1000.0 * i, 50.0 + 30.0 * std::sin(i * 0.01) + (i % 997 == 0 ? 400.0 : 0.0));
+        return points;
+    }
+
+    // Czy punkty są podzbiorem oryginału w kolejności rosnącej osi X
+    bool isOrderedSubset(const QVector<QPointF>& subset, const QVector<QPointF>& points)
+    {
+        auto it = points.cbegin();
+        for (const QPointF& point : subset) {
+            it = std::find(it, points.cend(), point);
+            if (it == points.cend())
+                return false;
+            ++it;
+        }
+        return true;
+    }
+
+    // Zajmuje jedyny wątek roboczy planisty do release(), aby kolejność
+    // i miejsce wykonania pozostałych zadań zależały tylko od testu
+    class WorkerBlocker
+    {
+    public:
+        explicit WorkerBlocker(TaskScheduler& scheduler)
+        {
+            std::future<void> running = started.get_future();
+            scheduler.submit([this, gate = gate.get_future().share()]() {
+                started.set_value();
+                gate.wait();
+                }, TaskPriority::Interactive);
+            running.wait();
+        }
+
+        ~WorkerBlocker() { release(); }
+
+        void release()
+        {
+            if (!released) {
+                released = true;
+                gate.set_value();
+            }
+        }
+
+    private:
+        std::promise<void> started;     ///< Wątek roboczy wszedł do zadania
+        std::promise<void> gate;        ///< Zwolnienie wątku roboczego
+        bool released = false;
+    };
+
+    // Wynik zadania odebrany w pętli zdarzeń (brak, gdy zadanie zgłosiło wyjątek lub nie zdążyło)
+    template<typename T>
+    std::optional<T> resultOf(const Async::Task<T>& task)
+    {
+        auto result = std::make_shared<std::optional<T>>();
+        task.then([result](const T& value) { *result = value; });
+        QTest::qWaitFor([result]() { return result->has_value(); }, 5000);
+        return *result;
+    }
+
+    Async::Task<int> sumOf(Async::Task<int> first, Async::Task<int> second)
+    {
+        const int a = co_await first;
+        const int b = co_await second;
+        co_return a + b;
+    }
+
+    Async::Task<int> checkedValue(Async::Task<int> input)
+    {
+        const int value = co_await input;
+        if (value < 0)
+            throw std::runtime_error("ujemna wartość");
+        co_return value;
+    }
+
+    // Komunikat wyjątku zgłoszonego przez oczekiwane zadanie (pusty, gdy go nie było)
+    Async::Task<QString> errorOf(Async::Task<int> task)
+    {
+        try {
+            co_await task;
+        }
+        catch (const std::exception& error) {
+            co_return QString::fromUtf8(error.what());
+        }
+        co_return QString();
+    }
+
+    void compareBuckets(const QVector<RollupBucket>& actual, const QVector<RollupBucket>& expected)
+    {
+        QCOMPARE(actual.size(), expected.size());
+        for (int i = 0; i < actual.size(); ++i) {
+            QCOMPARE(actual[i].startMs, expected[i].startMs);
+            QCOMPARE(actual[i].count, expected[i].count);
+            QCOMPARE(actual[i].min, expected[i].min);
+            QCOMPARE(actual[i].max, expected[i].max);
+            // Sumy pomniejszane przyrostowo mogą różnić się zaokrągleniem
+            QVERIFY(std::abs(actual[i].sum - expected[i].sum) <= 1e-9 * std::max(1.0, std::abs(expected[i].sum)));
+            QVERIFY(std::abs(actual[i].sumSquares - expected[i].sumSquares)
+                <= 1e-9 * std::max(1.0, std::abs(expected[i].sumSquares)));
+        }
+    }
+}
+
+void CoreTests::testSpearmanPairwiseComplete()
+{
+    // Kolumny z różnymi brakami - rangi liczone tylko na wspólnych godzinach
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    const int rows = 40;
+    AlignedColumns columns;
+    columns.rows = rows;
+    columns.names = { "PM10", "NO2" };
+    columns.data.resize(2 * rows);
+    for (int r = 0; r < rows; ++r) {
+        columns.data[r] = r % 9 == 0 ? nan : double((r * 7) % 11) + 0.5 * r;
+        columns.data[rows + r] = r % 7 == 3 ? nan : double((r * 5) % 13) + 0.25 * r;
+    }
+
+    const CorrelationResult result = CorrelationAnalysis::correlate(columns);
+
+    // Wartości wzorcowe: scipy.stats.spearmanr / pearsonr na 29 wierszach kompletnych
+    QCOMPARE(result.pairCounts[result.at(0, 1)], 29);
+    QVERIFY(std::abs(result.spearman[result.at(0, 1)] - 0.48472906403940885) < 1e-12);
+    QVERIFY(std::abs(result.spearman[result.at(1, 0)] - 0.48472906403940885) < 1e-12);
+    QVERIFY(std::abs(result.pearson[result.at(0, 1)] - 0.4575933283055039) < 1e-12);
+    QVERIFY(std::abs(result.spearman[result.at(0, 0)] - 1.0) < 1e-12);
+}
+
+void CoreTests::testGeoDistanceMatchesHaversine()
+{
+    const QVector<GeoPoint> points = geoTestPoints();
+    const GeoCoordinates coords = GeoCoordinates::fromPoints(points);
+    const int n = coords.size();
+
+    // Przybliżenia float (SSE2 i skalarne) względem haversine w podwójnej precyzji
+    for (const GeoPoint& from : points) {
+        const QVector<float> km = GeoDistance::distancesFrom(from, coords);
+        for (int i = 0; i < n; ++i) {
+            const double exact = GeoDistance::haversineKm(from, points[i]);
+            QVERIFY2(std::abs(km[i] - exact) <= geoTolerance(exact),
+                qPrintable(QString("(%1, %2) -> (%3, %4): %5 zamiast %6")
+                    .arg(from.lat).arg(from.lon).arg(points[i].lat).arg(points[i].lon).arg(km[i]).arg(exact)));
+        }
+    }
+
+    const QVector<float> matrix = GeoDistance::distanceMatrix(coords);
+    QCOMPARE(matrix.size(), qsizetype(n) * n);
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < n; ++j) {
+            const double exact = GeoDistance::haversineKm(points[i], points[j]);
+            QVERIFY(std::abs(matrix[qsizetype(i) * n + j] - exact) <= geoTolerance(exact));
+        }
+    }
+}
+
+void CoreTests::testGeoDistanceRadiusLowerBound()
+{
+    const QVector<GeoPoint> points = geoTestPoints();
+    const GeoCoordinates coords = GeoCoordinates::fromPoints(points);
+
+    // Filtr dolnego ograniczenia nie może odrzucić punktu, który przyjąłby pełny wzór
+    for (const double radius : { 0.0, 5.0, 30.0, 100.0, 250.0, 20000.0 }) {
+        for (int k = 0; k < points.size(); k += 7) {
+            const QVector<float> km = GeoDistance::distancesFrom(points[k], coords);
+            QVector<int> expected;
+            QVector<float> expectedKm;
+            for (int i = 0; i < coords.size(); ++i) {
+                if (km[i] <= float(radius)) {
+                    expected.append(i);
+                    expectedKm.append(km[i]);
+                }
+            }
+
+            QVector<float> foundKm;
+            QCOMPARE(GeoDistance::withinRadius(points[k], coords, radius, &foundKm), expected);
+            QCOMPARE(foundKm, expectedKm);
+        }
+    }
+
+    // Środek przy południku 180° - sąsiad po drugiej stronie jest w promieniu
+    const QVector<int> across = GeoDistance::withinRadius({ 0.0, 179.95 }, coords, 12.0);
+    QVERIFY(across.contains(int(points.size()) - 4));
+}
+
+void CoreTests::testRollupUpdateMatchesRebuild()
+{
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    const qint64 start = QDateTime(QDate(2025, 1, 20), QTime(0, 0)).toMSecsSinceEpoch();
+
+    // 22 dni przez granicę miesięcy, z pojedynczymi brakami
+    QVector<double> before(22 * 24);
+    for (int i = 0; i < before.size(); ++i)
+        before[i] = i % 29 == 5 ? nan : 20.0 + (i * 37) % 50 + 0.25 * (i % 4);
+
+    // Scalenie: nowe godziny, zmiana maksimum i zwykłej wartości, uzupełniony brak,
+    // usunięty pojedynczy pomiar i cały dzień
+    QVector<double> after = before;
+    for (int i = 0; i < 40; ++i)
+        after.append(20.0 + (i * 13) % 40);
+    const int dayMax = int(std::max_element(before.begin() + 72, before.begin() + 96) - before.begin());
+    after[dayMax] = 1.0;
+    after[200] += 0.5;
+    after[5] = 33.0;
+    after[300] = nan;
+    for (int i = 240; i < 264; ++i)
+        after[i] = nan;
+
+    QVector<MeasurementChange> changes;
+    for (int i = 0; i < after.size(); ++i) {
+        const double oldValue = i < before.size() ? before[i] : nan;
+        if ((std::isnan(oldValue) && std::isnan(after[i])) || oldValue == after[i])
+            continue;
+        changes.append({ start + i * MeasurementSeries::kHourMs, oldValue, after[i] });
+    }
+
+    const MeasurementSeries merged = hourlySeries(start, after);
+    RollupStore store;
+    store.rebuild(1, hourlySeries(start, before));
+    store.update(1, changes, merged);
+    store.rebuild(2, merged);
+
+    const qint64 end = merged.timeAt(merged.size() - 1);
+    compareBuckets(store.range(1, RollupResolution::Daily, start, end), store.range(2, RollupResolution::Daily, start, end));
+    compareBuckets(store.range(1, RollupResolution::Monthly, start, end), store.range(2, RollupResolution::Monthly, start, end));
+}
+
+void CoreTests::testFillGapsLinear()
+{
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    const qint64 start = QDateTime(QDate(2025, 1, 20), QTime(0, 0)).toMSecsSinceEpoch();
+    MeasurementSeries series = hourlySeries(start,
+        { nan, 10.0, nan, nan, 40.0, nan, nan, nan, nan, nan, 100.0, nan });
+
+    GapAnalysis::fillGaps(series, FillMethod::Linear, 2);
+
+    // Przerwa 2 h uzupełniona liniowo; dłuższa i brzegowe pozostają brakami
+    QCOMPARE(series.filledCount, 2);
+    QCOMPARE(series.values[2], 20.0);
+    QCOMPARE(series.values[3], 30.0);
+    QVERIFY(series.origin[2] == PointOrigin::FilledLinear);
+    QVERIFY(series.origin[3] == PointOrigin::FilledLinear);
+    QVERIFY(!series.validity.testBit(2));
+    for (const int i : { 0, 5, 9, 11 })
+        QVERIFY(!series.hasValue(i));
+
+    const QVector<GapInterval> gaps = GapAnalysis::findGaps(series);
+    QCOMPARE(gaps.size(), 4);
+    QVERIFY(!gaps[0].filled);
+    QVERIFY(gaps[1].filled);
+    QCOMPARE(gaps[1].missingHours, 2);
+    QVERIFY(!gaps[2].filled);
+    QCOMPARE(gaps[2].missingHours, 5);
+    QVERIFY(!gaps[3].filled);
+}
+
+void CoreTests::testFillGapsSeasonal()
+{
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    const qint64 start = QDateTime(QDate(2025, 1, 20), QTime(0, 0)).toMSecsSinceEpoch();
+
+    // Trzy doby powtarzającego się profilu dobowego - uzupełnienie odtwarza go dokładnie
+    QVector<double> expected(3 * 24);
+    for (int i = 0; i < expected.size(); ++i)
+        expected[i] = 20.0 + ((i % 24) * 7) % 11;
+    QVector<double> values = expected;
+    for (int i = 30; i < 34; ++i)
+        values[i] = nan;
+
+    MeasurementSeries series = hourlySeries(start, values);
+    GapAnalysis::fillGaps(series, FillMethod::Seasonal, 6);
+
+    QCOMPARE(series.filledCount, 4);
+    for (int i = 30; i < 34; ++i) {
+        QVERIFY(series.origin[i] == PointOrigin::FilledSeasonal);
+        QVERIFY(std::abs(series.values[i] - expected[i]) < 1e-9);
+    }
+}
+
+void CoreTests::testFillGapsRepeated()
+{
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    const qint64 start = QDateTime(QDate(2025, 1, 20), QTime(0, 0)).toMSecsSinceEpoch();
+    const MeasurementSeries measured = hourlySeries(start,
+        { nan, 10.0, nan, nan, 40.0, nan, nan, nan, nan, nan, 100.0, nan });
+
+    // Ponowne wywołanie nie liczy uzupełnień drugi raz
+    MeasurementSeries series = measured;
+    GapAnalysis::fillGaps(series, FillMethod::Linear, 2);
+    const MeasurementSeries once = series;
+    GapAnalysis::fillGaps(series, FillMethod::Linear, 2);
+    QCOMPARE(series.filledCount, 2);
+    QCOMPARE(series.measuredCount, measured.measuredCount);
+    QVERIFY(series.origin == once.origin);
+    for (int i = 0; i < series.size(); ++i)
+        QVERIFY(series.hasValue(i) ? series.values[i] == once.values[i] : std::isnan(series.values[i]));
+
+    // Inne argumenty zastępują poprzednie uzupełnienia
+    GapAnalysis::fillGaps(series, FillMethod::Linear, 5);
+    QCOMPARE(series.filledCount, 7);
+    QCOMPARE(series.values[7], 70.0);
+    GapAnalysis::fillGaps(series, FillMethod::Linear, 2);
+    QCOMPARE(series.filledCount, 2);
+    QVERIFY(!series.hasValue(7));
+    QVERIFY(std::isnan(series.values[7]));
+    GapAnalysis::fillGaps(series, FillMethod::None, 2);
+    QCOMPARE(series.filledCount, 0);
+    QVERIFY(series.origin == measured.origin);
+}
+
+void CoreTests::testFillGapsAcrossDstChange()
+{
+    // Wartości zależą od lokalnej godziny zegarowej; w strefie ze zmianą czasu
+    // (np. Europe/Warsaw, 30 marca) przerwa leży po zmianie, więc godziny profilu
+    // i uzupełnianych punktów muszą być liczone tak samo
+    const qint64 start = QDateTime(QDate(2025, 3, 27), QTime(0, 0)).toMSecsSinceEpoch();
+    const int hours = 6 * 24;
+    QVector<double> expected(hours);
+    for (int i = 0; i < hours; ++i) {
+        const int hour = QDateTime::fromMSecsSinceEpoch(start + i * MeasurementSeries::kHourMs).time().hour();
+        expected[i] = 20.0 + (hour * 7) % 11;
+    }
+    QVector<double> values = expected;
+    for (int i = 100; i < 104; ++i)
+        values[i] = std::numeric_limits<double>::quiet_NaN();
+
+    MeasurementSeries series = hourlySeries(start, values);
+    GapAnalysis::fillGaps(series, FillMethod::Seasonal, 6);
+
+    QCOMPARE(series.filledCount, 4);
+    for (int i = 100; i < 104; ++i)
+        QVERIFY(std::abs(series.values[i] - expected[i]) < 1e-9);
+}
+
+void CoreTests::testLttbKeepsShape()
+{
+    // Wzorzec policzony ręcznie według opisu algorytmu (Steinarsson 2013)
+    const QVector<double> ys = { 0, 1, 0, 0, 9, 0, 0, 2, 0, -3, 0, 0 };
+    QVector<QPointF> points;
+    for (int i = 0; i < ys.size(); ++i)
+        points.append(QPointF(i, ys[i]));
+
+    const QVector<QPointF> reduced = Downsampling::lttb(points.constData(), int(points.size()), 6);
+    QVector<QPointF> expected;
+    for (const int i : { 0, 2, 4, 6, 9, 11 })
+        expected.append(points[i]);
+    QCOMPARE(reduced, expected);
+
+    // Duża seria: dokładnie threshold punktów, skrajne zachowane, wszystkie piki zachowane
+    const QVector<QPointF> wave = wavePoints(20000);
+    const QVector<QPointF> lttb = Downsampling::lttb(wave.constData(), int(wave.size()), 500);
+    QCOMPARE(lttb.size(), qsizetype(500));
+    QCOMPARE(lttb.first(), wave.first());
+    QCOMPARE(lttb.last(), wave.last());
+    QVERIFY(isOrderedSubset(lttb, wave));
+    for (int i = 997; i < wave.size() - 1; i += 997)
+        QVERIFY(lttb.contains(wave[i]));
+
+    // Próg nie mniejszy niż liczba punktów - bez redukcji
+    QCOMPARE(Downsampling::lttb(points.constData(), int(points.size()), 100), points);
+}
+
+void CoreTests::testMinMaxKeepsExtremes()
+{
+    const QVector<QPointF> wave = wavePoints(20000);
+    const QVector<QPointF> reduced = Downsampling::minMax(wave.constData(), int(wave.size()), 400);
+
+    QVERIFY(reduced.size() <= 400);
+    QVERIFY(isOrderedSubset(reduced, wave));
+    auto byY = [](const QPointF& a, const QPointF& b) { return a.y() < b.y(); };
+    QCOMPARE(*std::max_element(reduced.cbegin(), reduced.cend(), byY), *std::max_element(wave.cbegin(), wave.cend(), byY));
+    QCOMPARE(*std::min_element(reduced.cbegin(), reduced.cend(), byY), *std::min_element(wave.cbegin(), wave.cend(), byY));
+}
+
+void CoreTests::testPyramidQuery()
+{
+    const QVector<QPointF> wave = wavePoints(20000);
+    DownsamplePyramid pyramid;
+    pyramid.build(wave, DownsampleMode::Lttb);
+
+    // Poziomy o połowę mniejsze, ostatni nie większy niż próg budowy
+    const QVector<QVector<QPointF>>& levels = pyramid.levelPoints();
+    QCOMPARE(pyramid.size(), 20000);
+    QVERIFY(levels.size() > 1);
+    for (int level = 1; level < levels.size(); ++level) {
+        QCOMPARE(levels[level].size(), levels[level - 1].size() / 2);
+        QVERIFY(isOrderedSubset(levels[level], levels[level - 1]));
+    }
+    QVERIFY(levels.last().size() <= 256);
+
+    // Cały zakres: docelowa liczba punktów wybranych z oryginału
+    const QVector<QPointF> full = pyramid.query(wave.first().x(), wave.last().x(), 800);
+    QCOMPARE(full.size(), qsizetype(800));
+    QVERIFY(isOrderedSubset(full, wave));
+
+    // Wycinek: tylko punkty zakresu
+    const double fromX = wave[5000].x();
+    const double toX = wave[9000].x();
+    const QVector<QPointF> part = pyramid.query(fromX, toX, 300);
+    QCOMPARE(part.size(), qsizetype(300));
+    for (const QPointF& point : part)
+        QVERIFY(point.x() >= fromX && point.x() <= toX);
+
+    // Wąski zakres poniżej celu - oryginalne punkty bez redukcji
+    const QVector<QPointF> narrow = pyramid.query(wave[100].x(), wave[149].x(), 300);
+    QCOMPARE(narrow, wave.mid(100, 50));
+}
+
+void CoreTests::testKdTreeMatchesBruteForce()
+{
+    const QVector<StationRecord> stations = randomStations(500);
+    StationKdTree tree;
+    tree.build(stations);
+    QCOMPARE(tree.size(), 500);
+
+    const QVector<GeoPoint> centers = { { 52.23, 21.01 }, { 50.06, 19.94 }, { 54.35, 18.65 }, { 48.5, 13.0 }, { 56.0, 25.0 } };
+    constexpr double kEpsKm = 1e-6;
+    auto accept = [](int row) { return row % 37 == 0; };
+
+    for (const GeoPoint& center : centers) {
+        QVector<double> km(stations.size());
+        for (int row = 0; row < stations.size(); ++row)
+            km[row] = GeoDistance::haversineKm(center, { stations[row].lat, stations[row].lon });
+
+        // Promień: te same stacje, odległości rosnąco
+        for (const double radiusKm : { 0.0, 15.0, 60.0, 250.0 }) {
+            const QVector<StationDistance> found = tree.withinRadius(center, radiusKm);
+            QVector<bool> inResult(stations.size(), false);
+            for (int i = 0; i < found.size(); ++i) {
+                QVERIFY(std::abs(found[i].km - km[found[i].row]) < kEpsKm);
+                QVERIFY(i == 0 || found[i - 1].km <= found[i].km);
+                inResult[found[i].row] = true;
+            }
+            for (int row = 0; row < stations.size(); ++row) {
+                if (std::abs(km[row] - radiusKm) > kEpsKm)
+                    QCOMPARE(inResult[row], km[row] <= radiusKm);
+            }
+        }
+
+        // k najbliższych: odległości jak w posortowanej liście wszystkich
+        QVector<double> sorted = km;
+        std::sort(sorted.begin(), sorted.end());
+        const QVector<StationDistance> nearest = tree.nearest(center, 7);
+        QCOMPARE(nearest.size(), qsizetype(7));
+        for (int i = 0; i < nearest.size(); ++i) {
+            QVERIFY(std::abs(nearest[i].km - sorted[i]) < kEpsKm);
+            QVERIFY(std::abs(km[nearest[i].row] - sorted[i]) < kEpsKm);
+        }
+
+        // Najbliższa spełniająca warunek, bez ograniczenia i w promieniu
+        int bestRow = -1;
+        for (int row = 0; row < stations.size(); ++row) {
+            if (accept(row) && (bestRow == -1 || km[row] < km[bestRow]))
+                bestRow = row;
+        }
+        const StationDistance matching = tree.nearestMatching(center, accept);
+        QCOMPARE(matching.row, bestRow);
+        QVERIFY(std::abs(matching.km - km[bestRow]) < kEpsKm);
+
+        const StationDistance inside = tree.nearestMatching(center, accept, km[bestRow] + 1.0);
+        QCOMPARE(inside.row, bestRow);
+        const StationDistance outside = tree.nearestMatching(center, accept, km[bestRow] - 1.0);
+        QCOMPARE(outside.row, -1);
+    }
+
+    // Zapytania zbiorcze (równoległe) zgodne z pojedynczymi
+    const QVector<QVector<StationDistance>> batch = tree.withinRadius(centers, 60.0);
+    QCOMPARE(batch.size(), centers.size());
+    for (int i = 0; i < centers.size(); ++i) {
+        const QVector<StationDistance> single = tree.withinRadius(centers[i], 60.0);
+        QCOMPARE(batch[i].size(), single.size());
+        for (int j = 0; j < single.size(); ++j)
+            QCOMPARE(batch[i][j].row, single[j].row);
+    }
+}
+
+void CoreTests::testGzipRoundTrip()
+{
+    QByteArray json;
+    for (int i = 0; i < 2000; ++i)
+        json += "{\"date\":\"2025-01-20 " + QByteArray::number(i % 24).rightJustified(2, '0') + ":00:00\",\"value\":" + QByteArray::number(i * 0.37) + "},";
+    const QByteArray binary(QByteArray("\x00\xff\x80\x7f", 4).repeated(300));
+
+    for (const QByteArray& data : { QByteArray(), QByteArray("123456789"), json, binary }) {
+        const QByteArray gz = LocalApiServer::gzip(data);
+        quint32 crc = 0, size = 0;
+        QByteArray zlib = gzipToZlib(gz, crc, size);
+        QVERIFY(!zlib.isEmpty());
+        QCOMPARE(size, quint32(data.size()));
+        QCOMPARE(crc, crc32Bitwise(data));
+        zlib.append(adler32(data));
+        QCOMPARE(qUncompress(zlib), data);
+    }
+
+    QCOMPARE(crc32Bitwise("123456789"), 0xCBF43926u);   // Wartość kontrolna CRC-32 (ISO-HDLC)
+}
+
+void CoreTests::testSnapshotRoundTrip()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const DataRepository repository(dir.path());
+    const AppState state = sampleState();
+
+    QString error;
+    QVERIFY2(StateSnapshot::save(repository, state, &error), qPrintable(error));
+
+    AppState loaded;
+    QVERIFY(StateSnapshot::load(repository, loaded));
+    QCOMPARE(loaded.stations.size(), state.stations.size());
+    for (int i = 0; i < state.stations.size(); ++i) {
+        QCOMPARE(loaded.stations[i].id, state.stations[i].id);
+        QCOMPARE(loaded.stations[i].name, state.stations[i].name);
+        QCOMPARE(loaded.stations[i].lat, state.stations[i].lat);
+        QCOMPARE(loaded.stations[i].lon, state.stations[i].lon);
+    }
+    QCOMPARE(loaded.sensors.size(), state.sensors.size());
+    QCOMPARE(loaded.sensors[1].paramName, state.sensors[1].paramName);
+    QCOMPARE(loaded.readings.size(), qsizetype(1));
+    QCOMPARE(loaded.readings[0].paramCode, QString("PM10"));
+    QCOMPARE(loaded.readings[0].reading.value, 42.5);
+    QCOMPARE(loaded.sensorId, state.sensorId);
+    QCOMPARE(loaded.rangeEndMs, state.rangeEndMs);
+
+    QCOMPARE(loaded.series.startMs, state.series.startMs);
+    QCOMPARE(loaded.series.validity, state.series.validity);
+    QVERIFY(loaded.series.origin == state.series.origin);
+    QCOMPARE(loaded.series.measuredCount, state.series.measuredCount);
+    QVERIFY(std::isnan(loaded.series.values[205]));
+    QCOMPARE(loaded.series.values[300], state.series.values[300]);
+
+    QCOMPARE(loaded.pyramids.size(), state.pyramids.size());
+    for (int i = 0; i < state.pyramids.size(); ++i) {
+        QVERIFY(loaded.pyramids[i].reductionMode() == state.pyramids[i].reductionMode());
+        QVERIFY(loaded.pyramids[i].levelPoints() == state.pyramids[i].levelPoints());
+    }
+}
+
+void CoreTests::testSnapshotRejectsCorruption()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const DataRepository repository(dir.path());
+    const QString path = repository.filePath(StateSnapshot::kFileName);
+    const AppState state = sampleState();
+
+    struct Corruption
+    {
+        const char* name;
+        std::function<void(QByteArray&)> patch;
+        bool fixHeader;
+    };
+    const QVector<Corruption> corruptions = {
+        { "obcięty nagłówek", [](QByteArray& d) { d.truncate(kSnapshotHeaderSize - 1); }, false },
+        { "obcięte dane", [](QByteArray& d) { d.chop(9); }, false },
+        { "znacznik", [](QByteArray& d) { d[0] = 'X'; }, false },
+        { "wersja", [](QByteArray& d) { d[kSnapshotVersionOffset] = char(StateSnapshot::kVersion + 1); }, false },
+        { "suma kontrolna", [](QByteArray& d) { d[d.size() / 2] = char(d[d.size() / 2] ^ 0x5a); }, false },
+        // Poniżej nagłówek jest zgodny - błąd musi wykryć odczyt danych
+        { "długość nazwy", [](QByteArray& d) { d[kSnapshotHeaderSize + 8 + 3] = char(0x7f); }, true },
+        { "ujemna liczba", [](QByteArray& d) { d[kSnapshotHeaderSize + 8 + 3] = char(0x80); }, true },
+        { "liczba stacji", [](QByteArray& d) { d[kSnapshotHeaderSize + 3] = char(0x10); }, true },
+        { "nadmiarowe dane", [](QByteArray& d) { d.append("\0\0\0\0", 4); }, true },
+        { "obcięte dane ze zgodną sumą", [](QByteArray& d) { d.chop(4); }, true },
+    };
+
+    for (const Corruption& corruption : corruptions) {
+        QVERIFY(StateSnapshot::save(repository, state, nullptr));
+        QVERIFY(patchSnapshot(path, corruption.patch, corruption.fixHeader));
+        AppState loaded;
+        loaded.sensorId = -7;
+        QVERIFY2(!StateSnapshot::load(repository, loaded), corruption.name);
+        QCOMPARE(loaded.sensorId, -7);  // Stan nie jest zmieniany przy błędzie
+    }
+
+    // Zmiana pliku JSON po zapisie unieważnia migawkę
+    QVERIFY(StateSnapshot::save(repository, state, nullptr));
+    AppState loaded;
+    QVERIFY(StateSnapshot::load(repository, loaded));
+    QFile stations(repository.filePath(DataRepository::kStationsFile));
+    QVERIFY(stations.open(QIODevice::WriteOnly));
+    stations.write("[]");
+    stations.close();
+    QVERIFY(!StateSnapshot::load(repository, loaded));
+}
+
+void CoreTests::testNestedForEachOnTwoWorkers()
+{
+    // main.cpp ogranicza wspólnego planistę do dwóch wątków; oba wykonują
+    // zewnętrzną pętlę i czekają na zagnieżdżone grupy, więc muszą w tym
+    // czasie wykonywać cudze zadania zamiast blokować się nawzajem
+    TaskScheduler& scheduler = TaskScheduler::instance();
+    QCOMPARE(scheduler.workerCount(), 2);
+
+    std::atomic<int> count = 0;
+    Parallel::Options options;
+    options.grain = 1;
+    const auto nested = [&count, &options]() {
+        Parallel::forEach(8, [&count, &options](int) {
+            Parallel::forEach(16, [&count](int) { ++count; }, options);
+            }, options);
+        };
+
+    std::latch done(scheduler.workerCount());
+    for (int i = 0; i < scheduler.workerCount(); ++i) {
+        scheduler.submit([&nested, &done]() {
+            nested();
+            done.count_down();
+            }, TaskPriority::Normal);
+    }
+    done.wait();
+    QCOMPARE(count.load(), 2 * 8 * 16);
+
+    // To samo wywołane z wątku spoza planisty
+    count = 0;
+    nested();
+    QCOMPARE(count.load(), 8 * 16);
+}
+
+void CoreTests::testForeignWaitRunsOnlyOwnGroup()
+{
+    TaskScheduler scheduler(1);
+    WorkerBlocker blocker(scheduler);
+
+    std::atomic<bool> otherRan = false;
+    TaskGroup other(TaskPriority::Normal, Async::CancellationToken(), scheduler);
+    other.run([&otherRan]() { otherRan = true; });
+
+    // Wątek roboczy jest zajęty - zadanie grupy wykonuje sam czekający
+    std::thread::id ranOn;
+    TaskGroup group(TaskPriority::Normal, Async::CancellationToken(), scheduler);
+    group.run([&ranOn]() { ranOn = std::this_thread::get_id(); });
+    group.wait();
+    QVERIFY(ranOn == std::this_thread::get_id());
+    QVERIFY(!otherRan);
+
+    blocker.release();
+    other.wait();
+    QVERIFY(otherRan);
+}
+
+void CoreTests::testGroupExceptionSkipsRest()
+{
+    TaskScheduler scheduler(1);
+    WorkerBlocker blocker(scheduler);
+
+    // Zadania wykonuje po kolei czekający wątek - po wyjątku reszta jest pomijana
+    std::atomic<int> ran = 0;
+    TaskGroup group(TaskPriority::Normal, Async::CancellationToken(), scheduler);
+    group.run([]() { throw std::runtime_error("błąd zadania"); });
+    for (int i = 0; i < 5; ++i)
+        group.run([&ran]() { ++ran; });
+
+    QVERIFY_THROWS_EXCEPTION(std::runtime_error, group.wait());
+    QCOMPARE(ran.load(), 0);
+    QVERIFY(group.isCancelled());
+
+    // Wyjątek zgłaszany jest raz
+    group.wait();
+}
+
+void CoreTests::testCancellationSkipsPendingJobs()
+{
+    TaskScheduler scheduler(1);
+    WorkerBlocker blocker(scheduler);
+
+    Async::CancellationSource source;
+    std::atomic<int> ran = 0;
+    TaskGroup group(TaskPriority::Normal, source.token(), scheduler);
+    group.run([&ran, &source]() {
+        ++ran;
+        source.cancel();
+        });
+    for (int i = 0; i < 5; ++i)
+        group.run([&ran]() { ++ran; });
+    group.wait();
+    QCOMPARE(ran.load(), 1);
+    QVERIFY(group.isCancelled());
+
+    // Pętla z anulowanym tokenem nie wykonuje żadnego indeksu
+    Parallel::Options options;
+    options.cancel = source.token();
+    ran = 0;
+    Parallel::forEach(100, [&ran](int) { ++ran; }, options);
+    QCOMPARE(ran.load(), 0);
+}
+
+void CoreTests::testInteractiveLaneBeforeBatch()
+{
+    QStringList order;
+    {
+        // Jeden wątek roboczy wykonuje zadania po kolei; kolejność odczytywana
+        // jest po zamknięciu planisty, które czeka na opróżnienie kolejek
+        TaskScheduler scheduler(1);
+        WorkerBlocker blocker(scheduler);
+        scheduler.submit([&order]() { order.append("batch 1"); }, TaskPriority::Batch);
+        scheduler.submit([&order]() { order.append("normal"); }, TaskPriority::Normal);
+        scheduler.submit([&order]() { order.append("batch 2"); }, TaskPriority::Batch);
+        scheduler.submit([&order]() { order.append("interactive"); }, TaskPriority::Interactive);
+        blocker.release();
+    }
+    QCOMPARE(order, QStringList({ "interactive", "normal", "batch 1", "batch 2" }));
+}
+
+void CoreTests::testAwaitFinishedAndPendingTask()
+{
+    Async::TaskSource<int> finished;
+    finished.complete(2);
+    Async::TaskSource<int> pending;
+
+    // Zakończone zadanie nie zawiesza korutyny, niezakończone tak
+    const Async::Task<int> sum = sumOf(finished.task(), pending.task());
+    QVERIFY(!sum.isDone());
+
+    // Oczekujący wznawiany jest w następnym obiegu pętli, nie wewnątrz complete()
+    pending.complete(3);
+    QVERIFY(!sum.isDone());
+    QCOMPARE(resultOf(sum), std::optional<int>(5));
+
+    // Ponowne zakończenie źródła jest pomijane
+    pending.complete(7);
+    QCOMPARE(resultOf(pending.task()), std::optional<int>(3));
+}
+
+void CoreTests::testWhenAllKeepsOrder()
+{
+    QVector<Async::TaskSource<int>> sources(4);
+    QVector<Async::Task<int>> tasks;
+    for (const Async::TaskSource<int>& source : sources)
+        tasks.append(source.task());
+    const Async::Task<QVector<int>> all = Async::whenAll(tasks);
+
+    // Kończone od końca - wyniki i tak w kolejności zadań
+    for (int i = sources.size() - 1; i >= 0; --i) {
+        sources[i].complete(10 * i);
+        QVERIFY(!all.isDone());
+    }
+    QCOMPARE(resultOf(all), std::optional<QVector<int>>(QVector<int>({ 0, 10, 20, 30 })));
+}
+
+void CoreTests::testExceptionReachesAwait()
+{
+    // Wyjątek zgłoszony w korutynie, która zakończyła się od razu
+    Async::TaskSource<int> negative;
+    negative.complete(-1);
+    const Async::Task<int> failed = checkedValue(negative.task());
+    QVERIFY(failed.isDone());
+    QCOMPARE(resultOf(errorOf(failed)), std::optional<QString>(QString::fromUtf8("ujemna wartość")));
+
+    // Wyjątek przekazany przez źródło, na które już ktoś czeka
+    Async::TaskSource<int> pending;
+    const Async::Task<QString> error = errorOf(pending.task());
+    pending.fail(std::make_exception_ptr(std::runtime_error("przerwane")));
+    QCOMPARE(resultOf(error), std::optional<QString>(QString("przerwane")));
+
+    // Bez wyjątku komunikat jest pusty
+    Async::TaskSource<int> positive;
+    positive.complete(4);
+    QCOMPARE(resultOf(errorOf(checkedValue(positive.task()))), std::optional<QString>(QString()));
+}
+
+void CoreTests::testFetchCancelled()
+{
+    QNetworkAccessManager network;
+
+    // Token anulowany przed wywołaniem - żądanie nie jest wysyłane
+    Async::CancellationSource before;
+    before.cancel();
+    const Async::Task<Async::NetworkResult> skipped =
+        Async::fetch(&network, QNetworkRequest(QUrl("http://127.0.0.1:9/")), before.token());
+    QVERIFY(skipped.isDone());
+    const std::optional<Async::NetworkResult> first = resultOf(skipped);
+    QVERIFY(first.has_value());
+    QVERIFY(first->cancelled);
+    QVERIFY(!first->ok());
+    QCOMPARE(first->code, QNetworkReply::OperationCanceledError);
+
+    // Anulowanie w trakcie - serwer przyjmuje połączenie, ale nie odpowiada
+    QTcpServer server;
+    QVERIFY(server.listen(QHostAddress::LocalHost));
+    QUrl url("http://127.0.0.1/");
+    url.setPort(server.serverPort());
+    Async::CancellationSource during;
+    const Async::Task<Async::NetworkResult> aborted = Async::fetch(&network, QNetworkRequest(url), during.token());
+    QTRY_VERIFY(server.hasPendingConnections());
+    QVERIFY(!aborted.isDone());
+    during.cancel();
+    const std::optional<Async::NetworkResult> second = resultOf(aborted);
+    QVERIFY(second.has_value());
+    QVERIFY(second->cancelled);
+    QVERIFY(second->data.isEmpty());
+}
+
+void CoreTests::testReadFileAsyncMissingFile()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    const std::optional<Async::FileResult> missing = resultOf(Async::readFileAsync(dir.filePath("brak.json")));
+    QVERIFY(missing.has_value());
+    QVERIFY(!missing->ok());
+    QVERIFY(missing->data.isEmpty());
+
+    QFile file(dir.filePath("dane.json"));
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("[1,2,3]");
+    file.close();
+    const std::optional<Async::FileResult> present = resultOf(Async::readFileAsync(file.fileName()));
+    QVERIFY(present.has_value());
+    QVERIFY(present->ok());
+    QCOMPARE(present->data, QByteArray("[1,2,3]"));
+}
+
+void CoreTests::testSearchIgnoresPolishLetters()
+{
+    QCOMPARE(StationSearchIndex::fold(QString::fromUtf8("Zażółć gęślą jaźń!")), QString("zazolc gesla jazn"));
+    QCOMPARE(StationSearchIndex::fold(QString::fromUtf8("ŁÓDŹ, ul.Czernika")), QString("lodz ul czernika"));
+
+    StationSearchIndex index;
+    index.build(searchStations());
+    const QVector<int> expected = { 0, 3 };
+    QCOMPARE(index.search(QString::fromUtf8("Łodz czern")), QVector<int>({ 3 }));
+    QCOMPARE(index.search(QString::fromUtf8("Łodz")), expected);
+    QCOMPARE(index.search("lodz"), expected);
+    QCOMPARE(index.search(QString::fromUtf8("ŁÓDŹ")), expected);
+}
+
+void CoreTests::testSearchMatchesAllTerms()
+{
+    StationSearchIndex index;
+    index.build(searchStations());
+
+    // Każde słowo musi pasować, kolejność słów nie ma znaczenia
+    QCOMPARE(index.search("krakow krasin"), QVector<int>({ 1 }));
+    QCOMPARE(index.search("krasin krakow"), QVector<int>({ 1 }));
+    QCOMPARE(index.search("warszawa marszalk"), QVector<int>({ 6, 9 }));
+    QVERIFY(index.search("lodz krasin").isEmpty());
+
+    // Puste zapytanie zwraca wszystkie stacje w kolejności listy
+    QCOMPARE(index.search("  ").size(), searchStations().size());
+}
+
+void CoreTests::testSearchExtendedQueryMatchesFresh()
+{
+    // Wpisywanie znak po znaku, z cofnięciem i zmianą słowa; indeks
+    // przeszukujący poprzednie wyniki musi zwracać to samo co świeży
+    const QStringList typed = {
+        "w", "wa", "war", "wars", "warsz", "warszawa", "warszawa m", "warszawa mar",
+        "warszawa ma", "warszawa", "warszawa u", "warszawa ursyn", "z", "zg", "zgi", "zgierz",
+        "zgierz mielcz", "zgierz", "ze", "zeg", QString::fromUtf8("zegrzyńska"),
+    };
+
+    StationSearchIndex incremental;
+    incremental.build(searchStations());
+    for (const QString& query : typed) {
+        StationSearchIndex fresh;
+        fresh.build(searchStations());
+        QVERIFY2(incremental.search(query) == fresh.search(query), qPrintable(query));
+    }
+}
+
+void CoreTests::testSearchRanksExactNameFirst()
+{
+    StationSearchIndex index;
+    index.build(searchStations());
+
+    // Pełna nazwa przed nazwą zaczynającą się od zapytania i przed ulicą,
+    // mimo że stacje te są wcześniej na liście
+    QCOMPARE(index.search("zgierz"), QVector<int>({ 5, 2 }));
+    QCOMPARE(index.search("piastow"), QVector<int>({ 11, 10 }));
+}
+
+void CoreTests::testForecastIncrementalMatchesFullFit()
+{
+    const QVector<double> values = dailyPattern(24 * 6);
+    const MeasurementSeries full = hourlySeries(forecastStartMs(), values);
+
+    ForecastEngine once;
+    once.ingest(1, full);
+    const QVector<QPointF> expected = once.forecast(1);
+    QCOMPARE(expected.size(), ForecastEngine::kHorizonHours);
+    QCOMPARE(qint64(expected.first().x()), full.timeAt(full.size() - 1) + MeasurementSeries::kHourMs);
+
+    // Dwie połowy (pierwsza kończy się w trakcie rozgrzewki) dają ten sam model
+    ForecastEngine halves;
+    const int split = 30;
+    halves.ingest(1, hourlySeries(forecastStartMs(), values.mid(0, split)));
+    QVERIFY(halves.forecast(1).isEmpty());
+    halves.ingest(1, hourlySeries(full.timeAt(split), values.mid(split)));
+    QCOMPARE(halves.forecast(1), expected);
+
+    // Druga seria zachodzi na pierwszą - widziane godziny nie są liczone ponownie
+    ForecastEngine overlapping;
+    overlapping.ingest(1, hourlySeries(forecastStartMs(), values.mid(0, 80)));
+    overlapping.ingest(1, hourlySeries(full.timeAt(50), values.mid(50)));
+    QCOMPARE(overlapping.forecast(1), expected);
+}
+
+void CoreTests::testForecastBridgesGapBetweenSeries()
+{
+    // Godziny między seriami są brakami, tak jak NaN wewnątrz jednej serii
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    QVector<double> values = dailyPattern(24 * 6);
+    const int gapStart = 70, gapEnd = 76;
+    for (int i = gapStart; i < gapEnd; ++i)
+        values[i] = nan;
+    const MeasurementSeries full = hourlySeries(forecastStartMs(), values);
+
+    ForecastEngine withNan;
+    withNan.ingest(1, full);
+    const QVector<QPointF> expected = withNan.forecast(1);
+    QCOMPARE(expected.size(), ForecastEngine::kHorizonHours);
+
+    ForecastEngine bridged;
+    bridged.ingest(1, hourlySeries(forecastStartMs(), values.mid(0, gapStart)));
+    bridged.ingest(1, hourlySeries(full.timeAt(gapEnd), values.mid(gapEnd)));
+    QCOMPARE(bridged.forecast(1), expected);
+
+    // Przerwa w rozgrzewce zaczyna ją od nowa - 40 godzin po przerwie to za mało
+    ForecastEngine warmup;
+    warmup.ingest(1, hourlySeries(forecastStartMs(), values.mid(gapStart - 30, 30 + (gapEnd - gapStart) + 40)));
+    QVERIFY(warmup.forecast(1).isEmpty());
+}
+
+void CoreTests::testForecastKeepsModelThatSawMore()
+{
+    const QVector<double> values = dailyPattern(24 * 6);
+    const MeasurementSeries full = hourlySeries(forecastStartMs(), values);
+    const MeasurementSeries shorter = hourlySeries(forecastStartMs(), values.mid(0, 24 * 4));
+
+    ForecastEngine reference;
+    reference.ingest(1, full);
+    const QVector<QPointF> expected = reference.forecast(1);
+
+    // Starsza, krótsza seria po pełnej nie cofa modelu
+    ForecastEngine engine;
+    engine.ingest(1, full);
+    engine.ingest(1, shorter);
+    QCOMPARE(engine.forecast(1), expected);
+
+    // Ten sam sensor dwa razy w partii: obie kopie startują od tego samego
+    // modelu, a zapisany zostaje ten, który widział więcej godzin
+    for (const bool fullFirst : { true, false }) {
+        ForecastEngine batch;
+        QVector<QPair<int, MeasurementSeries>> items = { { 1, full }, { 1, shorter } };
+        if (!fullFirst)
+            std::swap(items[0], items[1]);
+        batch.ingestAll(items);
+        QCOMPARE(batch.forecast(1), expected);
+    }
+}
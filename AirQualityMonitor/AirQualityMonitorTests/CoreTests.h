@@ -0,0 +1,43 @@
+﻿// CoreTests.h
+#pragma once
+// Testy obliczeń biblioteki AirQualityCore
+#include <QtTest>
+
+class CoreTests : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testSpearmanPairwiseComplete();
+    void testGeoDistanceMatchesHaversine();
+    void testGeoDistanceRadiusLowerBound();
+    void testRollupUpdateMatchesRebuild();
+    void testFillGapsLinear();
+    void testFillGapsSeasonal();
+    void testFillGapsRepeated();
+    void testFillGapsAcrossDstChange();
+    void testLttbKeepsShape();
+    void testMinMaxKeepsExtremes();
+    void testPyramidQuery();
+    void testKdTreeMatchesBruteForce();
+    void testGzipRoundTrip();
+    void testSnapshotRoundTrip();
+    void testSnapshotRejectsCorruption();
+    void testNestedForEachOnTwoWorkers();
+    void testForeignWaitRunsOnlyOwnGroup();
+    void testGroupExceptionSkipsRest();
+    void testCancellationSkipsPendingJobs();
+    void testInteractiveLaneBeforeBatch();
+    void testAwaitFinishedAndPendingTask();
+    void testWhenAllKeepsOrder();
+    void testExceptionReachesAwait();
+    void testFetchCancelled();
+    void testReadFileAsyncMissingFile();
+    void testSearchIgnoresPolishLetters();
+    void testSearchMatchesAllTerms();
+    void testSearchExtendedQueryMatchesFresh();
+    void testSearchRanksExactNameFirst();
+    void testForecastIncrementalMatchesFullFit();
+    void testForecastBridgesGapBetweenSeries();
+    void testForecastKeepsModelThatSawMore();
+};
@@ -110,6 +110,3 @@ void SimpleTests::testReadJsonFromFile()
         QCOMPARE(readCoordinates[1].toDouble(), 16.9252);
     }
 }
-
-// Używamy QTEST_GUILESS_MAIN zamiast QTEST_MAIN dla lepszej stabilności
-QTEST_GUILESS_MAIN(SimpleTests)
\ No newline at end of file
@@ -0,0 +1,21 @@
+﻿#include "pch.h"
+#include "SimpleTests.h"
+#include "CoreTests.h"
+#include "TaskScheduler.h"
+#include <QCoreApplication>
+
+// Wszystkie klasy testów w jednym programie; kod wyjścia niezerowy, gdy którykolwiek test zawiódł
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    // Mała pula wątków - testy zagnieżdżonych pętli sprawdzają, że nie wyczerpują wątków
+    TaskScheduler::setDefaultWorkerCount(2);
+
+    int status = 0;
+    SimpleTests simpleTests;
+    status |= QTest::qExec(&simpleTests, argc, argv);
+    CoreTests coreTests;
+    status |= QTest::qExec(&coreTests, argc, argv);
+    return status;
+}